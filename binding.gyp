@@ -1,8 +1,32 @@
 ﻿{
+  "variables": {
+    "build_bench%": 0,
+    "vlc_sdk%": "<!(node -p \"process.env.VLC_SDK_PATH || 'C:/Program Files/VideoLAN/VLC/sdk'\")"
+  },
   "targets": [
     {
       "target_name": "vlc_player_stub",
       "type": "none"
     }
+  ],
+  "conditions": [
+    ["build_bench==1", {
+      "targets": [
+        {
+          "target_name": "vlc_player_bench",
+          "type": "executable",
+          "sources": ["native/bench/vlc_player_bench.cpp"],
+          "include_dirs": ["native", "<(vlc_sdk)/include"],
+          "libraries": ["<(vlc_sdk)/lib/libvlc.lib"],
+          "defines": ["_CRT_SECURE_NO_WARNINGS"],
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "ExceptionHandling": 1,
+              "AdditionalOptions": ["/std:c++17"]
+            }
+          }
+        }
+      ]
+    }]
   ]
 }
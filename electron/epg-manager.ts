@@ -194,6 +194,13 @@ export class EpgManager {
     return Array.from(this.channels.values());
   }
 
+  /**
+   * Get all programs, keyed by channel id
+   */
+  getAllPrograms(): Map<string, EpgProgram[]> {
+    return this.programs;
+  }
+
   /**
    * Check if EPG data is loaded
    */
@@ -1,6 +1,23 @@
 import * as fs from 'fs';
 import * as path from 'path';
 
+/**
+ * Native asynchronous logger exposed by the VLC addon. Records are pushed
+ * into a lock-free ring and written, rotated and gzipped off the main thread.
+ */
+export interface NativeLogBackend {
+  logOpen(options: { dir: string; baseName: string; maxSize: number; maxFiles: number }): boolean;
+  logDefine(message: string, argNames: string[]): number;
+  logEvent(level: number, eventId: number, text: string, ...args: number[]): void;
+  logClose(): void;
+}
+
+// Must match LogLevel / NativeLogEvent in native/native_log.h
+const NATIVE_LEVELS: Record<string, number> = { DEBUG: 0, INFO: 1, WARN: 2, ERROR: 3 };
+const NATIVE_TEXT_EVENT = 0;
+const NATIVE_MAX_ARGS = 4;
+const MAX_NATIVE_EVENTS = 1024;
+
 export class RotatingLogger {
   private logDir: string;
   private maxLogSize: number;
@@ -10,6 +27,8 @@ export class RotatingLogger {
   private isWriting = false;
   private consecutiveFailures = 0;
   private static readonly MAX_WRITE_RETRIES = 2;
+  private nativeBackend: NativeLogBackend | null = null;
+  private nativeEventIds = new Map<string, number>();
 
   constructor(logDir: string, maxLogSize = 5 * 1024 * 1024, maxLogFiles = 5) {
     this.logDir = logDir;
@@ -109,9 +128,96 @@ export class RotatingLogger {
   }
 
   /**
-   * Flush remaining log messages synchronously (for shutdown)
+   * Hand logging over to the native addon once it is loaded. The JS queue is
+   * flushed first so line order is preserved across the switch.
    */
-  close(): void {
+  attachNativeBackend(backend: NativeLogBackend): boolean {
+    if (this.nativeBackend) {
+      return true;
+    }
+    if (typeof backend?.logOpen !== 'function') {
+      return false;
+    }
+
+    this.flushQueue();
+    try {
+      const opened = backend.logOpen({
+        dir: this.logDir,
+        baseName: 'vlc-player',
+        maxSize: this.maxLogSize,
+        maxFiles: this.maxLogFiles,
+      });
+      if (opened) {
+        this.nativeBackend = backend;
+      }
+      return opened;
+    } catch (error) {
+      console.error('[RotatingLogger] Failed to open native log:', error);
+      return false;
+    }
+  }
+
+  /**
+   * Numeric meta fields travel as binary arguments of a per-message event;
+   * everything else is serialized into the record's text fragment.
+   */
+  private writeNative(level: string, message: string, meta?: any): void {
+    const backend = this.nativeBackend!;
+    const levelId = NATIVE_LEVELS[level] ?? NATIVE_LEVELS.INFO;
+
+    if (meta && (typeof meta !== 'object' || Array.isArray(meta))) {
+      backend.logEvent(levelId, NATIVE_TEXT_EVENT, `${message} ${JSON.stringify(meta)}`);
+      return;
+    }
+
+    const argNames: string[] = [];
+    const args: number[] = [];
+    let rest: Record<string, unknown> | null = null;
+    if (meta) {
+      for (const key of Object.keys(meta)) {
+        const value = meta[key];
+        if (typeof value === 'number' && Number.isFinite(value) && argNames.length < NATIVE_MAX_ARGS) {
+          argNames.push(key);
+          args.push(value);
+        } else {
+          (rest ??= {})[key] = value;
+        }
+      }
+    }
+
+    const restJson = rest ? JSON.stringify(rest) : '';
+    const text = restJson.length > 2 ? restJson.slice(1, -1) : '';
+
+    const key = argNames.length > 0 ? `${message}\0${argNames.join('\0')}` : message;
+    let eventId = this.nativeEventIds.get(key);
+    if (eventId === undefined) {
+      if (this.nativeEventIds.size >= MAX_NATIVE_EVENTS) {
+        // Unbounded message variety (e.g. interpolated errors): log as text
+        const metaStr = meta ? ` ${JSON.stringify(meta)}` : '';
+        backend.logEvent(levelId, NATIVE_TEXT_EVENT, `${message}${metaStr}`);
+        return;
+      }
+      eventId = backend.logDefine(message, argNames);
+      this.nativeEventIds.set(key, eventId);
+    }
+
+    backend.logEvent(levelId, eventId, text, ...args);
+  }
+
+  private write(level: string, message: string, meta?: any): void {
+    if (this.nativeBackend) {
+      try {
+        this.writeNative(level, message, meta);
+        return;
+      } catch (error) {
+        console.error('[RotatingLogger] Native log write failed, falling back:', error);
+        this.nativeBackend = null;
+      }
+    }
+    this.writeLog(this.formatMessage(level, message, meta));
+  }
+
+  private flushQueue(): void {
     if (this.writeQueue.length > 0) {
       try {
         this.rotateIfNeeded();
@@ -123,21 +229,36 @@ export class RotatingLogger {
     }
   }
 
+  /**
+   * Flush remaining log messages synchronously (for shutdown)
+   */
+  close(): void {
+    this.flushQueue();
+    if (this.nativeBackend) {
+      try {
+        this.nativeBackend.logClose();
+      } catch (error) {
+        console.error('[RotatingLogger] Failed to close native log:', error);
+      }
+      this.nativeBackend = null;
+    }
+  }
+
   info(message: string, meta?: any): void {
-    this.writeLog(this.formatMessage('INFO', message, meta));
+    this.write('INFO', message, meta);
   }
 
   warn(message: string, meta?: any): void {
-    this.writeLog(this.formatMessage('WARN', message, meta));
+    this.write('WARN', message, meta);
     console.warn(`[VLC] ${message}`, meta || '');
   }
 
   error(message: string, meta?: any): void {
-    this.writeLog(this.formatMessage('ERROR', message, meta));
+    this.write('ERROR', message, meta);
     console.error(`[VLC] ${message}`, meta || '');
   }
 
   debug(message: string, meta?: any): void {
-    this.writeLog(this.formatMessage('DEBUG', message, meta));
+    this.write('DEBUG', message, meta);
   }
 }
@@ -1,6 +1,9 @@
-import { app, BrowserWindow, ipcMain, dialog, crashReporter, shell, Menu } from 'electron';
+import { app, BrowserWindow, ipcMain, dialog, crashReporter, shell, Menu, nativeImage } from 'electron';
 import * as path from 'path';
 import * as fs from 'fs';
+import * as os from 'os';
+import { randomBytes } from 'crypto';
+import { pathToFileURL } from 'url';
 import { parseM3U } from '../src/parser/m3u-parser';
 import type { ParserResult } from '../src/types/channel';
 import { RotatingLogger } from './logger';
@@ -21,23 +24,53 @@ let fallbackManager: StreamFallbackManager | null = null;
 let recordingManager: RecordingManager | null = null;
 let epgManager: EpgManager | null = null;
 let profileManager: ProfileManager | null = null;
+let schedulerOpen = false;
+let scheduledEpgChannels = new Set<string>(); // Channels whose guide the scheduler has
+
+interface ScheduleChannel {
+  id: string;
+  name: string;
+  urls: string[];
+}
+let scheduleChannels: ScheduleChannel[] = [];
 
 /**
- * VLC Command Queue - Prevents race conditions and stale commands
+ * VLC command queue - owned by the addon, which runs commands on its control
+ * thread, coalesces bursts of zaps and cancels opens a newer command supersedes
  */
-interface VlcCommand {
+type VlcCommandType = 'play' | 'stop' | 'pause' | 'resume' | 'seek' | 'trickPlay';
+
+interface VlcCommandResult {
   id: number;
-  type: 'play' | 'stop' | 'pause' | 'resume';
-  url?: string;
-  timestamp: number;
+  command: VlcCommandType;
+  status: 'done' | 'failed' | 'coalesced' | 'cancelled' | 'superseded' | 'timeout';
+  success: boolean;
+  queueMs: number;
+  execMs: number;
 }
 
-let commandSequence = 0;
-let activeCommandId: number | null = null;
-let pendingCommand: VlcCommand | null = null;
-let isProcessingCommand = false;
 let isShuttingDown = false;
 
+// Addon load and libvlc warm-up, started before the window exists
+interface VlcStartup {
+  pluginPath: string;
+  bundled: boolean;
+  resetPluginCache: boolean;
+  error?: string;
+}
+
+let vlcStartup: VlcStartup | null = null;
+let vlcWarmUp: Promise<{ success: boolean; elapsedMs: number; resumeUrl: string }> | null = null;
+// Started as soon as the window has a handle, so a resumed channel opens
+// while the renderer is still loading
+let vlcInit: Promise<boolean> | null = null;
+
+// Settles once initializeVlcPlayer has finished; commands wait for it
+let resolveVlcReady: (ready: boolean) => void = () => {};
+const vlcReady = new Promise<boolean>(resolve => {
+  resolveVlcReady = resolve;
+});
+
 const isDev = process.env.NODE_ENV === 'development' || !app.isPackaged;
 const settingsPath = path.join(app.getPath('userData'), 'settings.json');
 const logPath = path.join(app.getPath('userData'), 'logs');
@@ -101,98 +134,61 @@ ipcMain.on('renderer:error', (_event, { error, componentStack }: { error: string
 const MAX_RESTART_ATTEMPTS = 1;
 const FREEZE_CHECK_INTERVAL = 5000; // Check every 5 seconds
 const FREEZE_THRESHOLD = 10; // Consider frozen after 10 seconds
+const DECODER_GRACE_MS = 2000; // An unsupported codec fails the stream only if no picture follows
 const HEALTH_CHECK_INTERVAL = 3000; // Collect stats every 3 seconds
+const RECONNECT_TIMEOUT = 8000; // Max wait for the standby's first frame on a seamless restart
+const METRICS_DUMP_INTERVAL = 15000; // Metrics textfile refresh interval
+const TELEMETRY_RETENTION_DAYS = 400; // Session journal history kept on disk
+const RELIABILITY_HALF_LIFE_DAYS = 7; // Older mirror outcomes count half as much per week
+const REMUX_BYTES_PER_SECOND = 24 * 1024 * 1024; // Remux read + write budget, well under disk speed
+const GB = 1024 * 1024 * 1024;
+const PREVIEW_INTERVAL_SEC = 10; // Scrub-preview thumbnail spacing in recordings
+const CHAPTER_THREADS = 2; // Recordings analysed for chapters at once
+const ARCHIVE_VIDEO_KBPS = 2000; // Archived recordings: H.264 at this rate, 720p at most
+const RELAY_PORT = 8090; // LAN re-streaming port unless relayPort is set
+const RECORDING_SERVER_PORT = 8091; // Recordings HTTP port unless recordingServerPort is set
 
 /**
- * Process VLC command queue - ensures only one command executes at a time
+ * Run a VLC command through the native queue. Resolves once it has run (a
+ * play once the stream opened or failed) or was dropped for a newer command.
+ * arg: the URL for play, the time (ms) for seek, the speed for trickPlay.
  */
-async function processVlcCommand(command: VlcCommand): Promise<boolean> {
-  if (isShuttingDown) {
-    logger?.warn('Command rejected: app is shutting down', { command: command.type });
-    return false;
-  }
-
-  // Ignore stale commands (older pending command superseded by newer one)
-  if (pendingCommand && pendingCommand.id !== command.id) {
-    logger?.info('Ignoring stale command', { 
-      staleId: command.id, 
-      activeId: pendingCommand.id,
-      type: command.type 
-    });
-    return false;
-  }
+async function runVlcCommand(type: VlcCommandType, arg?: string | number): Promise<VlcCommandResult | null> {
+  if (!vlcPlayer || !(await vlcReady)) return null;
 
-  if (isProcessingCommand) {
-    logger?.warn('Command already processing, queuing', { type: command.type });
-    pendingCommand = command;
-    return false;
+  if (isShuttingDown) {
+    logger?.warn('Command rejected: app is shutting down', { command: type });
+    return null;
   }
 
-  isProcessingCommand = true;
-  activeCommandId = command.id;
-
-  try {
-    logger?.info('Processing VLC command', { id: command.id, type: command.type });
-
-    let success = false;
-    switch (command.type) {
-      case 'play':
-        if (command.url && vlcPlayer) {
-          // Stop current playback first
-          try {
-            vlcPlayer.stop();
-            await new Promise(resolve => setTimeout(resolve, 100));
-          } catch (e) {
-            logger?.warn('Stop before play failed', { error: e });
-          }
-          success = vlcPlayer.play(command.url);
-        }
-        break;
-      case 'stop':
-        if (vlcPlayer) {
-          success = vlcPlayer.stop();
-        }
-        break;
-      case 'pause':
-        if (vlcPlayer) {
-          success = vlcPlayer.pause();
-        }
-        break;
-      case 'resume':
-        if (vlcPlayer) {
-          success = vlcPlayer.resume();
-        }
-        break;
-    }
-
-    return success;
-  } finally {
-    isProcessingCommand = false;
-    activeCommandId = null;
-
-    // Process next pending command if any
-    if (pendingCommand) {
-      const next = pendingCommand;
-      pendingCommand = null;
-      setTimeout(() => processVlcCommand(next), 50);
-    }
-  }
+  const result: VlcCommandResult = await vlcPlayer.enqueueCommand(type, arg);
+  logger?.info('VLC command finished', {
+    id: result.id,
+    type,
+    status: result.status,
+    queueMs: Math.round(result.queueMs),
+    execMs: Math.round(result.execMs)
+  });
+  return result;
 }
 
 /**
- * Queue a VLC command with sequence ID
+ * A newer command replaced this one before it ran, or interrupted a play
+ * before its stream opened
  */
-function queueVlcCommand(type: VlcCommand['type'], url?: string): number {
-  const commandId = ++commandSequence;
-  const command: VlcCommand = {
-    id: commandId,
-    type,
-    url,
-    timestamp: Date.now()
-  };
+function wasDropped(result: VlcCommandResult | null): boolean {
+  return result !== null &&
+    (result.status === 'coalesced' || result.status === 'cancelled' || result.status === 'superseded');
+}
 
-  processVlcCommand(command);
-  return commandId;
+/**
+ * Streams a recording keeps (native PID filter). Channels without an entry
+ * record the whole multiplex.
+ */
+interface RecordingPidSelection {
+  program?: number; // MPEG programme number; default the first in the PAT
+  audioTrack?: number; // Index among audio streams, -1 for all; default 0
+  captions?: boolean; // Default true
 }
 
 interface AppSettings {
@@ -202,6 +198,21 @@ interface AppSettings {
   channelHistory: string[];
   favorites: string[];
   volume: number;
+  recordingPids?: Record<string, RecordingPidSelection>; // By channel id
+  remuxRecordings?: boolean; // Remux finished recordings to fragmented MP4
+  remuxDeleteSource?: boolean; // Delete the .ts once its MP4 is complete
+  recordingQuotaGB?: number; // Evict the oldest recordings above this; 0 or unset = no quota
+  recordingMinFreeGB?: number; // ...or when the disk has less free; 0 or unset = off
+  protectedRecordings?: string[]; // Recording paths never evicted
+  archiveAfterDays?: number; // Re-encode recordings older than this to a smaller size; 0 or unset = off
+  archiveVideoKbps?: number; // Video bitrate of archived recordings; default ARCHIVE_VIDEO_KBPS
+  nativeMulticast?: boolean; // Receive udp:// and rtp:// channels natively instead of through libvlc
+  relayEnabled?: boolean; // Re-stream the current channel over HTTP from a single upstream
+  relayLan?: boolean; // ...to other devices too, not just this machine
+  relayPort?: number; // Default RELAY_PORT; 0 picks a free one
+  recordingServerEnabled?: boolean; // Serve recordings (and the one being recorded) over HTTP with byte ranges
+  recordingServerLan?: boolean; // ...to other devices too, not just this machine
+  recordingServerPort?: number; // Default RECORDING_SERVER_PORT; 0 picks a free one
 }
 
 const defaultSettings: AppSettings = {
@@ -259,6 +270,8 @@ function createWindow() {
     show: false             // Don't show until ready (prevents flash)
   });
 
+  attachVlcWindow();
+
   // Create application menu
   const menuTemplate: Electron.MenuItemConstructorOptions[] = [
     {
@@ -347,7 +360,7 @@ function createWindow() {
   // Initialize VLC player after window is ready
   mainWindow.webContents.once('did-finish-load', async () => {
     await initializeManagers();
-    initializeVlcPlayer();
+    await initializeVlcPlayer();
   });
 }
 
@@ -372,7 +385,7 @@ async function initializeManagers() {
     // Initialize EPG data (from cache if available) - non-blocking with timeout
     const EPG_INIT_TIMEOUT = 10000; // 10 seconds max for cache load
     Promise.race([
-      epgManager.initialize(),
+      epgManager.initialize().then(() => pushEpgToScheduler()),
       new Promise((_, reject) => 
         setTimeout(() => reject(new Error('EPG initialization timeout')), EPG_INIT_TIMEOUT)
       )
@@ -406,35 +419,114 @@ ipcMain.handle('window:isFullscreen', async () => {
 });
 
 /**
- * Initialize VLC native addon and freeze detection
+ * Load the native addon and start libvlc (plugin loading) on a worker thread
+ * while the window and renderer boot. Runs before the logger exists, so what
+ * happened is recorded in vlcStartup and logged by initializeVlcPlayer.
  */
-function initializeVlcPlayer() {
-  try {
-    logger?.info('Initializing VLC player');
+function loadVlcAddon() {
+  if (vlcPlayer || vlcStartup) return;
 
+  vlcStartup = { pluginPath: '', bundled: false, resetPluginCache: false };
+  try {
     // Set VLC plugin path for bundled runtime in production
     if (!isDev) {
       const vlcPath = path.join(process.resourcesPath, 'vlc');
       const pluginPath = path.join(vlcPath, 'plugins');
+      vlcStartup.pluginPath = pluginPath;
       
       if (fs.existsSync(vlcPath)) {
         process.env.VLC_PLUGIN_PATH = pluginPath;
-        logger?.info('Using bundled VLC runtime', { vlcPath, pluginPath });
-      } else {
-        logger?.warn('Bundled VLC not found, falling back to system VLC', { vlcPath });
+        vlcStartup.bundled = true;
+        // Without plugins.dat libvlc opens every plugin DLL on each launch;
+        // the first warm-up writes it (if the directory is writable)
+        vlcStartup.resetPluginCache = !fs.existsSync(path.join(pluginPath, 'plugins.dat'));
       }
     }
 
     // Load native VLC addon
     const addonPath = path.join(__dirname, '../build/Release/vlc_player.node');
-    
     if (!fs.existsSync(addonPath)) {
-      const error = 'Native addon not found';
-      logger?.error(error, { path: addonPath, hint: 'Run npm run build:native' });
+      vlcStartup.error = `Native addon not found: ${addonPath}`;
       return;
     }
 
     vlcPlayer = require(addonPath);
+    vlcWarmUp = vlcPlayer.warmUp({
+      resetPluginCache: vlcStartup.resetPluginCache,
+      resumeStatePath: path.join(app.getPath('userData'), 'resume.dat'),
+      // Only pre-open the last stream if the renderer will restore that channel
+      resume: !!loadSettings().lastChannelId
+    });
+  } catch (error) {
+    vlcStartup.error = error instanceof Error ? error.message : String(error);
+  }
+}
+
+/**
+ * One-time plugins.dat rebuild for the bundled runtime. Must run before
+ * libvlc is loaded, so it uses the addon without warming it up.
+ */
+function regenerateVlcPluginCache() {
+  const pluginPath = path.join(process.resourcesPath, 'vlc', 'plugins');
+  const addonPath = path.join(__dirname, '../build/Release/vlc_player.node');
+  if (!fs.existsSync(pluginPath) || !fs.existsSync(addonPath)) {
+    console.error('[VLC] Cannot regenerate plugin cache: runtime or addon missing', { pluginPath, addonPath });
+    app.exit(1);
+    return;
+  }
+
+  process.env.VLC_PLUGIN_PATH = pluginPath;
+  const addon = require(addonPath);
+  addon.regeneratePluginCache()
+    .then((success: boolean) => {
+      const written = fs.existsSync(path.join(pluginPath, 'plugins.dat'));
+      console.log('[VLC] Plugin cache regeneration', { success, written, pluginPath });
+      app.exit(success && written ? 0 : 1);
+    })
+    .catch((error: unknown) => {
+      console.error('[VLC] Plugin cache regeneration failed', error);
+      app.exit(1);
+    });
+}
+
+/**
+ * Hand the window to libvlc. The native side finishes the warm-up first, then
+ * starts opening the resume stream (if any) on a standby player.
+ */
+function attachVlcWindow() {
+  if (vlcInit || !vlcPlayer || !mainWindow) return;
+
+  // Get HWND from BrowserWindow
+  const hwnd = mainWindow.getNativeWindowHandle();
+  const hwndValue = hwnd.readBigInt64LE(0);
+  vlcInit = vlcPlayer.initialize(hwndValue);
+}
+
+/**
+ * Initialize VLC native addon and freeze detection
+ */
+async function initializeVlcPlayer() {
+  try {
+    logger?.info('Initializing VLC player');
+
+    loadVlcAddon();
+    if (vlcStartup?.bundled) {
+      logger?.info('Using bundled VLC runtime', { pluginPath: vlcStartup.pluginPath });
+    } else if (!isDev) {
+      logger?.warn('Bundled VLC not found, falling back to system VLC', { pluginPath: vlcStartup?.pluginPath });
+    }
+
+    if (!vlcPlayer) {
+      const error = 'Native addon not found';
+      logger?.error(error, { error: vlcStartup?.error, hint: 'Run npm run build:native' });
+      resolveVlcReady(false);
+      return;
+    }
+
+    // Move log writes, rotation and compression off the main thread
+    if (logger?.attachNativeBackend(vlcPlayer)) {
+      logger?.info('Native logger attached');
+    }
 
     // CRITICAL: Ensure mainWindow is ready before VLC initialization
     if (!mainWindow) {
@@ -443,20 +535,44 @@ function initializeVlcPlayer() {
       throw new Error(error); // Fail-fast: VLC requires window handle
     }
 
-    // Get HWND from BrowserWindow
-    const hwnd = mainWindow.getNativeWindowHandle();
-    const hwndValue = hwnd.readBigInt64LE(0);
-    
-    const success = vlcPlayer.initialize(hwndValue);
+    if (vlcWarmUp) {
+      const warmUp = await vlcWarmUp;
+      logger?.info('libvlc warm-up finished', {
+        success: warmUp.success,
+        elapsedMs: Math.round(warmUp.elapsedMs),
+        resetPluginCache: vlcStartup?.resetPluginCache,
+        resumeUrl: warmUp.resumeUrl || undefined
+      });
+      if (vlcStartup?.resetPluginCache && !fs.existsSync(path.join(vlcStartup.pluginPath, 'plugins.dat'))) {
+        logger?.warn('VLC plugin cache could not be written', { pluginPath: vlcStartup.pluginPath });
+      }
+    }
+
+    // Normally already started by createWindow; waits for the warm-up if it
+    // is still loading plugins
+    attachVlcWindow();
+    const success = await vlcInit;
     if (success) {
       logger?.info('VLC player initialized successfully');
       
       // Initialize VLC-dependent managers
       healthScorer = new StreamHealthScorer();
-      fallbackManager = new StreamFallbackManager(logger!);
+      fallbackManager = new StreamFallbackManager(logger!, openReliabilityStore() ? rankByReliability : undefined);
       
+      applyNativeMulticast(loadSettings());
       startFreezeDetection();
+      vlcPlayer.onStreamFailed(handleStreamFailed);
       startHealthMonitoring();
+      startMetricsExport();
+      openTelemetryJournal();
+      openRemuxQueue();
+      openRecordingStorage();
+      openArchiveTranscoder();
+      applyRelay(loadSettings());
+      applyRecordingServer(loadSettings());
+      recoverRecordings();
+      openRecordingScheduler();
+      resolveVlcReady(true);
     } else {
       const error = 'VLC initialization returned false';
       logger?.error(error);
@@ -465,10 +581,444 @@ function initializeVlcPlayer() {
   } catch (error) {
     const errorMsg = error instanceof Error ? error.message : 'Unknown error';
     logger?.error('Failed to load VLC native addon', { error: errorMsg, hint: 'Ensure VLC is installed and addon is compiled' });
+    resolveVlcReady(false);
     throw error; // Fail-fast: VLC is critical for app functionality
   }
 }
 
+/**
+ * Start Prometheus metrics export from the native addon (opt-in).
+ * JPTV_METRICS_PORT serves /metrics on 127.0.0.1; JPTV_METRICS_FILE
+ * writes the same text to a file for a textfile collector.
+ */
+function startMetricsExport() {
+  if (!vlcPlayer) return;
+
+  const port = Number(process.env.JPTV_METRICS_PORT || 0);
+  const filePath = process.env.JPTV_METRICS_FILE || '';
+  if (!port && !filePath) return;
+
+  if (!Number.isInteger(port) || port < 0 || port > 65535) {
+    logger?.warn('Ignoring invalid JPTV_METRICS_PORT', { port: process.env.JPTV_METRICS_PORT });
+    return;
+  }
+
+  try {
+    const started = vlcPlayer.startMetrics({ port, filePath, intervalMs: METRICS_DUMP_INTERVAL });
+    if (started) {
+      logger?.info('Metrics export started', { port, filePath });
+    } else {
+      logger?.warn('Metrics export failed to start', { port, filePath });
+    }
+  } catch (error) {
+    logger?.error('Error starting metrics export', { error });
+  }
+}
+
+/**
+ * Open the append-only session journal used for playback statistics
+ */
+function openTelemetryJournal() {
+  if (!vlcPlayer) return;
+
+  const dir = path.join(app.getPath('userData'), 'telemetry');
+  try {
+    if (!vlcPlayer.journalOpen({ dir, retentionDays: TELEMETRY_RETENTION_DAYS })) {
+      logger?.warn('Telemetry journal failed to open', { dir });
+    }
+  } catch (error) {
+    logger?.error('Error opening telemetry journal', { error });
+  }
+}
+
+/**
+ * Open the persistent per-URL reliability model used to order mirrors
+ */
+function openReliabilityStore(): boolean {
+  if (!vlcPlayer) return false;
+
+  const filePath = path.join(app.getPath('userData'), 'reliability.dat');
+  try {
+    const opened = vlcPlayer.reliabilityOpen({ filePath, halfLifeDays: RELIABILITY_HALF_LIFE_DAYS });
+    if (!opened) {
+      logger?.warn('Reliability store failed to open', { filePath });
+    }
+    return opened;
+  } catch (error) {
+    logger?.error('Error opening reliability store', { error });
+    return false;
+  }
+}
+
+function rankByReliability(urls: string[]): string[] {
+  return vlcPlayer.reliabilityRank(urls);
+}
+
+/**
+ * Start the background remux queue. Finished recordings (manual and
+ * scheduled) are queued natively when enabled; progress goes to the renderer.
+ */
+function openRemuxQueue(): boolean {
+  if (!vlcPlayer) return false;
+
+  const settings = loadSettings();
+  try {
+    return vlcPlayer.remuxOpen({
+      onEvent: (job: unknown) => mainWindow?.webContents.send('remux:progress', job),
+      bytesPerSecond: REMUX_BYTES_PER_SECOND,
+      recordings: settings.remuxRecordings ?? false,
+      deleteSource: settings.remuxDeleteSource ?? false
+    });
+  } catch (error) {
+    logger?.error('Error opening remux queue', { error });
+    return false;
+  }
+}
+
+function storagePolicy(settings: AppSettings) {
+  return {
+    quotaBytes: (settings.recordingQuotaGB ?? 0) * GB,
+    minFreeBytes: (settings.recordingMinFreeGB ?? 0) * GB
+  };
+}
+
+function archiveSettings(settings: AppSettings) {
+  return {
+    afterDays: settings.archiveAfterDays ?? 0,
+    videoKbps: settings.archiveVideoKbps ?? ARCHIVE_VIDEO_KBPS
+  };
+}
+
+// Applies to channels opened from now on; the current one keeps its input
+function applyNativeMulticast(settings: AppSettings): void {
+  try {
+    vlcPlayer?.setNativeMulticast(settings.nativeMulticast ?? false);
+  } catch (error) {
+    logger?.warn('Failed to set native multicast input', { error });
+  }
+}
+
+// LAN re-streaming of the current channel (settings relayEnabled, relayLan,
+// relayPort). Clients fetch /<token>.ts; the token is kept across runs so
+// devices can bookmark the URL.
+let relayPath = ''; // '/<token>.ts' while the relay runs
+let relayListenPort = 0;
+
+// A secret path segment for URLs served to other devices, kept in userData
+// under `file` so it survives restarts
+function accessToken(file: string): string {
+  const tokenPath = path.join(app.getPath('userData'), file);
+  try {
+    const token = fs.readFileSync(tokenPath, 'utf8').trim();
+    if (/^[0-9a-f]{32}$/.test(token)) {
+      return token;
+    }
+  } catch {
+    // First run: created below
+  }
+  const token = randomBytes(16).toString('hex');
+  try {
+    fs.writeFileSync(tokenPath, token);
+  } catch (error) {
+    logger?.warn('Failed to save access token', { error, file });
+  }
+  return token;
+}
+
+function relayLocalUrl(): string {
+  return relayPath ? `http://127.0.0.1:${relayListenPort}${relayPath}` : '';
+}
+
+// (Re)starts or stops the relay. While it runs the player plays every
+// stream through it (native side points the relay at the stream and opens
+// the relay's local URL), so this machine is one more client of the single
+// upstream. Restarting disconnects its clients, this player among them, so
+// the stream playing is reopened through the new relay, or directly.
+function applyRelay(settings: AppSettings): void {
+  if (!vlcPlayer) return;
+  const wasRunning = relayPath !== '';
+  try {
+    vlcPlayer.setRelayInput('');
+    vlcPlayer.relayClose();
+    relayPath = '';
+    relayListenPort = 0;
+    if (settings.relayEnabled) {
+      const token = accessToken('relay.token');
+      relayListenPort = vlcPlayer.relayOpen({
+        token,
+        port: settings.relayPort ?? RELAY_PORT,
+        lan: settings.relayLan ?? false
+      });
+      relayPath = `/${token}.ts`;
+      vlcPlayer.setRelayInput(relayLocalUrl());
+      logger?.info('Stream relay listening', { port: relayListenPort, lan: settings.relayLan ?? false });
+    }
+  } catch (error) {
+    logger?.warn('Failed to start stream relay', { error });
+  }
+
+  const url = wasRunning || relayPath ? vlcPlayer.getCurrentUrl() : '';
+  if (url) {
+    runVlcCommand('play', url).catch(error => logger?.warn('Failed to reopen stream for the relay', { error, url }));
+  }
+}
+
+// HTTP access to the recordings folder (settings recordingServerEnabled,
+// recordingServerLan, recordingServerPort): /<token>/recordings.m3u lists
+// them, /<token>/<file> serves one with byte ranges. A recording in progress
+// is followed live, so it works as a time-shift buffer for other devices.
+let recordingServerBase = ''; // 'http://127.0.0.1:<port>/<token>/' while serving
+
+function lanAddresses(): string[] {
+  return Object.values(os.networkInterfaces())
+    .flat()
+    .filter(address => address && address.family === 'IPv4' && !address.internal)
+    .map(address => address!.address);
+}
+
+// (Re)starts or stops the server; restarting drops its connections
+function applyRecordingServer(settings: AppSettings): void {
+  if (!vlcPlayer) return;
+  try {
+    vlcPlayer.recordingServerClose();
+    recordingServerBase = '';
+    if (!settings.recordingServerEnabled) {
+      return;
+    }
+    const token = accessToken('recordings.token');
+    const port = vlcPlayer.recordingServerOpen({
+      root: recordingsPath,
+      token,
+      port: settings.recordingServerPort ?? RECORDING_SERVER_PORT,
+      lan: settings.recordingServerLan ?? false
+    });
+    recordingServerBase = `http://127.0.0.1:${port}/${token}/`;
+    logger?.info('Recording server listening', { port, lan: settings.recordingServerLan ?? false });
+  } catch (error) {
+    logger?.warn('Failed to start recording server', { error });
+  }
+}
+
+/**
+ * Re-encode old recordings natively at idle priority, paused while anything
+ * plays or records. An archived recording replaces the original and is
+ * rescanned for a new index, previews and chapters.
+ */
+function openArchiveTranscoder(): boolean {
+  if (!vlcPlayer) return false;
+
+  try {
+    return vlcPlayer.archiveOpen({
+      onEvent: (job: any) => {
+        mainWindow?.webContents.send('archive:progress', job);
+        if (job.state === 'done') {
+          logger?.info('Recording archived', { filePath: job.path, sourceBytes: job.sourceBytes, outputBytes: job.outputBytes });
+          scanRecording(job.path);
+        } else if (job.state === 'failed') {
+          logger?.warn('Recording archive failed', { filePath: job.path, error: job.error });
+        }
+      },
+      ...archiveSettings(loadSettings())
+    });
+  } catch (error) {
+    logger?.error('Error opening archive transcoder', { error });
+    return false;
+  }
+}
+
+/**
+ * Index the recordings folder and keep it within the configured quota and
+ * free-space floor, deleting the oldest unprotected recordings natively
+ */
+function openRecordingStorage(): boolean {
+  if (!vlcPlayer) return false;
+
+  const settings = loadSettings();
+  try {
+    vlcPlayer.storageSetProtected(settings.protectedRecordings ?? []);
+    return vlcPlayer.storageOpen(recordingsPath, storagePolicy(settings));
+  } catch (error) {
+    logger?.error('Error opening recording storage', { error });
+    return false;
+  }
+}
+
+/**
+ * Check a finished recording: truncate a torn last packet and write its
+ * seek index (<file>.idx), then build its scrub-preview strip from that
+ * index and, unless the caller batches them, find its chapters. Runs on
+ * native worker threads; resolves true once the index is written.
+ */
+async function scanRecording(filePath: string, analyse = true): Promise<boolean> {
+  try {
+    const report = await vlcPlayer.scanRecording(filePath, { repair: true, index: true });
+    if (!report.ok || report.syncErrors > 0 || report.truncated) {
+      logger?.warn('Recording scan found damage', { filePath, ...report });
+    } else {
+      logger?.info('Recording scanned', { filePath, packets: report.packets, elapsedMs: report.elapsedMs });
+    }
+    if (report.ok && report.indexEntries > 0) {
+      await buildPreviews(filePath);
+      if (analyse) await analyseRecordings([filePath]);
+      return true;
+    }
+  } catch (error) {
+    logger?.error('Recording scan error', { filePath, error });
+  }
+  return false;
+}
+
+async function buildPreviews(filePath: string) {
+  try {
+    const report = await vlcPlayer.buildPreviews(filePath, { intervalSec: PREVIEW_INTERVAL_SEC });
+    if (!report.ok) {
+      logger?.warn('Preview strip not built', { filePath, error: report.error });
+    } else {
+      logger?.info('Preview strip built', { filePath, count: report.count, elapsedMs: Math.round(report.elapsedMs) });
+    }
+  } catch (error) {
+    logger?.error('Preview strip error', { filePath, error });
+  }
+}
+
+/**
+ * Mark black frames, silences and ad breaks in indexed recordings (stored
+ * in their .idx), a recording per native thread
+ */
+async function analyseRecordings(filePaths: string[]) {
+  if (filePaths.length === 0) return;
+  try {
+    const reports = await vlcPlayer.analyzeRecordings(filePaths, { threads: CHAPTER_THREADS });
+    for (const report of reports) {
+      if (!report.ok) {
+        logger?.warn('Recording chapters not found', { filePath: report.path, error: report.error });
+      } else {
+        logger?.info('Recording chapters found', {
+          filePath: report.path, markers: report.markers, speed: Math.round(report.speed)
+        });
+      }
+    }
+  } catch (error) {
+    logger?.error('Recording chapter analysis error', { filePaths, error });
+  }
+}
+
+/**
+ * A .ts or .mp4 inside the recordings folder (IPC paths are untrusted)
+ */
+function isRecordingFile(filePath: unknown): filePath is string {
+  if (typeof filePath !== 'string') return false;
+  const resolved = path.resolve(filePath);
+  const ext = path.extname(resolved).toLowerCase();
+  return (ext === '.ts' || ext === '.mp4') &&
+    resolved.toLowerCase().startsWith(path.resolve(recordingsPath).toLowerCase() + path.sep);
+}
+
+/**
+ * Recordings without an index were never finished - the app crashed or
+ * the disk filled while they were written. Listed before the scheduler
+ * starts new ones, scanned one at a time.
+ */
+function recoverRecordings() {
+  if (!vlcPlayer) return;
+
+  let pending: string[];
+  try {
+    pending = fs.readdirSync(recordingsPath)
+      .filter(name => name.toLowerCase().endsWith('.ts') && !fs.existsSync(path.join(recordingsPath, name + '.idx')))
+      .map(name => path.join(recordingsPath, name));
+  } catch {
+    return; // No recordings yet
+  }
+  if (pending.length === 0) return;
+
+  logger?.info('Scanning unfinished recordings', { count: pending.length });
+  (async () => {
+    const indexed: string[] = [];
+    for (const filePath of pending) {
+      if (await scanRecording(filePath, false)) indexed.push(filePath);
+    }
+    await analyseRecordings(indexed);
+  })();
+}
+
+/**
+ * Start the native recording scheduler (rules persist in schedule.dat) and
+ * hand it the guide loaded so far
+ */
+function openRecordingScheduler(): boolean {
+  if (!vlcPlayer) return false;
+
+  const filePath = path.join(app.getPath('userData'), 'schedule.dat');
+  try {
+    schedulerOpen = vlcPlayer.scheduleOpen({ filePath, recordingsPath });
+    if (!schedulerOpen) {
+      logger?.warn('Recording scheduler failed to open', { filePath });
+      return false;
+    }
+    pushEpgToScheduler();
+    return true;
+  } catch (error) {
+    logger?.error('Error opening recording scheduler', { error });
+    return false;
+  }
+}
+
+/**
+ * Send every channel's programmes to the scheduler. It diffs each channel
+ * against what it already has, so only changed programmes reach the rules.
+ */
+function pushEpgToScheduler() {
+  if (!schedulerOpen || !epgManager) return;
+
+  const programs = epgManager.getAllPrograms();
+  try {
+    for (const [channelId, list] of programs) {
+      vlcPlayer.scheduleUpdateEpg(channelId, list.map(p => ({ title: p.title, start: p.start, stop: p.stop })));
+    }
+    // Channels that dropped out of the guide
+    for (const channelId of scheduledEpgChannels) {
+      if (!programs.has(channelId)) {
+        vlcPlayer.scheduleUpdateEpg(channelId, []);
+      }
+    }
+    scheduledEpgChannels = new Set(programs.keys());
+  } catch (error) {
+    logger?.error('Failed to update recording schedule from EPG', { error });
+  }
+}
+
+/**
+ * Tell the native player which mirror to pre-open if it predicts a stall.
+ * Without another mirror an HLS stream is reopened at a lower rendition;
+ * anything else gets no standby, since reopening it would only fetch the
+ * same bytes twice.
+ */
+function armStandbyMirror(channelId: string | null, currentUrl: string) {
+  if (!vlcPlayer) return;
+
+  const mirror = channelId && fallbackManager
+    ? fallbackManager.getUrls(channelId).find(url => url && url !== currentUrl) || ''
+    : '';
+
+  try {
+    vlcPlayer.setStandbyUrl(mirror);
+  } catch (error) {
+    logger?.warn('Failed to set standby mirror', { error, channelId });
+  }
+}
+
+/**
+ * Key subsequent sessions by channel ('' keys them by URL)
+ */
+function setTelemetryChannel(channelId: string) {
+  try {
+    vlcPlayer?.journalSetChannel(channelId);
+  } catch (error) {
+    logger?.warn('Failed to set telemetry channel', { error, channelId });
+  }
+}
+
 /**
  * Start periodic freeze detection
  */
@@ -522,6 +1072,7 @@ function startHealthMonitoring() {
 
       // Get VLC statistics
       const stats = vlcPlayer.getStats();
+      const buffer = vlcPlayer.getBufferHealth();
       
       // Update health scorer
       healthScorer.updateStats(currentUrl, {
@@ -531,7 +1082,9 @@ function startHealthMonitoring() {
 
       logger?.debug('Health stats collected', { 
         url: currentUrl, 
-        bitrate: stats.inputBitrate 
+        bitrate: stats.inputBitrate,
+        bufferedMs: buffer.bufferedMs,
+        stallRisk: buffer.atRisk
       });
     } catch (error) {
       logger?.error('Error during health monitoring', { error });
@@ -539,24 +1092,117 @@ function startHealthMonitoring() {
   }, HEALTH_CHECK_INTERVAL);
 }
 
+/**
+ * Reopen the stream on the standby player and swap it in once it shows a
+ * frame; the frozen picture stays up meanwhile instead of going black
+ */
+async function tryReconnect(url: string): Promise<boolean> {
+  if (!vlcPlayer) return false;
+
+  try {
+    const result = await vlcPlayer.reconnect(url, RECONNECT_TIMEOUT);
+    if (result.success) {
+      logger?.info('Stream reconnected seamlessly', { url, elapsedMs: Math.round(result.elapsedMs) });
+    } else {
+      logger?.warn('Seamless reconnect failed', { url, elapsedMs: Math.round(result.elapsedMs) });
+    }
+    return result.success;
+  } catch (error) {
+    logger?.warn('Seamless reconnect error', { url, error });
+    return false;
+  }
+}
+
+let freezeRecoveryInFlight = false;
+
+// Channel whose mirrors a failed stream falls back through; null for a
+// directly played URL
+let failoverChannelId: string | null = null;
+let failoverInFlight = false;
+
+interface StreamFailedEvent {
+  reason: string; // http, refused, dns, timeout, open, demux, decoder, error
+  detail: string;
+  url: string;
+  firstFrame: boolean;
+}
+
+/**
+ * A stream that fails after play() resolved (libvlc's log names an HTTP
+ * error, a refused connection, no demuxer...) moves to the next mirror now
+ * instead of after FREEZE_THRESHOLD
+ */
+function handleStreamFailed(event: StreamFailedEvent) {
+  if (!vlcPlayer || vlcPlayer.getCurrentUrl() !== event.url) return; // Already zapped away
+
+  logger?.warn('Stream failed', { ...event });
+  if (event.reason !== 'decoder') {
+    failOver(event.url);
+    return;
+  }
+
+  // Often a subtitle or data track the picture does not need
+  if (event.firstFrame) return;
+  setTimeout(() => {
+    try {
+      if (vlcPlayer?.getCurrentUrl() === event.url && vlcPlayer.getStats().displayedPictures === 0) {
+        failOver(event.url);
+      }
+    } catch (error) {
+      logger?.error('Error checking decoder failure', { url: event.url, error });
+    }
+  }, DECODER_GRACE_MS);
+}
+
+async function failOver(url: string) {
+  if (!fallbackManager || !failoverChannelId || failoverInFlight) return;
+
+  const channelId = failoverChannelId;
+  failoverInFlight = true;
+  try {
+    const result = await tryNextFallbackUrl(channelId);
+    if (!result.success && !result.superseded && mainWindow) {
+      mainWindow.webContents.send('player:error', {
+        message: 'Stream failed and no mirror could take over',
+        url
+      });
+    }
+  } catch (error) {
+    logger?.error('Error failing over', { channelId, url, error });
+  } finally {
+    failoverInFlight = false;
+  }
+}
+
 /**
  * Handle frozen stream with auto-restart
  */
 async function handleStreamFreeze(url: string) {
-  if (!vlcPlayer) return;
+  if (!vlcPlayer || freezeRecoveryInFlight) return;
 
+  freezeRecoveryInFlight = true;
   try {
     const attempts = restartAttempts.get(url) || 0;
 
     if (attempts < MAX_RESTART_ATTEMPTS) {
       logger?.info('Attempting auto-restart', { url, attempt: attempts + 1 });
-      
-      // Stop current playback
-      vlcPlayer.stop();
-      await new Promise(resolve => setTimeout(resolve, 500));
 
-      // Try to restart
-      const success = vlcPlayer.play(url);
+      if (await tryReconnect(url)) {
+        restartAttempts.set(url, attempts + 1);
+        return;
+      }
+
+      // A zap while reconnecting supersedes the restart
+      if (vlcPlayer.getCurrentUrl() !== url) {
+        return;
+      }
+
+      // Cold restart (play stops the frozen input first)
+      const result = await runVlcCommand('play', url);
+      if (wasDropped(result)) {
+        return;
+      }
+      const success = result?.success ?? false;
       
       if (success) {
         restartAttempts.set(url, attempts + 1);
@@ -587,6 +1233,8 @@ async function handleStreamFreeze(url: string) {
     }
   } catch (error) {
     logger?.error('Error handling stream freeze', { url, error });
+  } finally {
+    freezeRecoveryInFlight = false;
   }
 }
 
@@ -767,7 +1415,10 @@ ipcMain.handle('settings:get', (_event, key: keyof AppSettings) => {
 
 const VALID_SETTINGS_KEYS: ReadonlySet<keyof AppSettings> = new Set([
   'lastPlaylist', 'lastChannelId', 'lastChannelIndex',
-  'channelHistory', 'favorites', 'volume'
+  'channelHistory', 'favorites', 'volume', 'recordingPids',
+  'remuxRecordings', 'remuxDeleteSource', 'recordingQuotaGB', 'recordingMinFreeGB', 'protectedRecordings',
+  'archiveAfterDays', 'archiveVideoKbps', 'nativeMulticast', 'relayEnabled', 'relayLan', 'relayPort',
+  'recordingServerEnabled', 'recordingServerLan', 'recordingServerPort'
 ]);
 
 ipcMain.handle('settings:set', (_event, key: keyof AppSettings, value: unknown) => {
@@ -783,6 +1434,22 @@ ipcMain.handle('settings:set', (_event, key: keyof AppSettings, value: unknown)
     channelHistory: (v) => Array.isArray(v) && v.every(i => typeof i === 'string'),
     favorites: (v) => Array.isArray(v) && v.every(i => typeof i === 'string'),
     volume: (v) => typeof v === 'number' && isFinite(v as number),
+    recordingPids: (v) => typeof v === 'object' && v !== null && !Array.isArray(v) &&
+      Object.values(v).every(p => typeof p === 'object' && p !== null),
+    remuxRecordings: (v) => typeof v === 'boolean',
+    remuxDeleteSource: (v) => typeof v === 'boolean',
+    recordingQuotaGB: (v) => typeof v === 'number' && isFinite(v as number) && (v as number) >= 0,
+    recordingMinFreeGB: (v) => typeof v === 'number' && isFinite(v as number) && (v as number) >= 0,
+    protectedRecordings: (v) => Array.isArray(v) && v.every(i => typeof i === 'string'),
+    archiveAfterDays: (v) => typeof v === 'number' && isFinite(v as number) && (v as number) >= 0,
+    archiveVideoKbps: (v) => typeof v === 'number' && isFinite(v as number) && (v as number) >= 250,
+    nativeMulticast: (v) => typeof v === 'boolean',
+    relayEnabled: (v) => typeof v === 'boolean',
+    relayLan: (v) => typeof v === 'boolean',
+    relayPort: (v) => Number.isInteger(v) && (v as number) >= 0 && (v as number) <= 65535,
+    recordingServerEnabled: (v) => typeof v === 'boolean',
+    recordingServerLan: (v) => typeof v === 'boolean',
+    recordingServerPort: (v) => Number.isInteger(v) && (v as number) >= 0 && (v as number) <= 65535,
   };
   if (!validators[key]?.(value)) {
     logger?.warn('Rejected invalid settings value', { key });
@@ -791,6 +1458,50 @@ ipcMain.handle('settings:set', (_event, key: keyof AppSettings, value: unknown)
   const settings = loadSettings();
   (settings as any)[key] = value;
   saveSettings(settings);
+  if (key === 'recordingPids') {
+    pushScheduleChannels();
+  }
+  if (key === 'remuxRecordings' || key === 'remuxDeleteSource') {
+    try {
+      vlcPlayer?.remuxConfigure({
+        recordings: settings.remuxRecordings ?? false,
+        deleteSource: settings.remuxDeleteSource ?? false,
+        bytesPerSecond: REMUX_BYTES_PER_SECOND
+      });
+    } catch (error) {
+      logger?.warn('Failed to configure remux queue', { error });
+    }
+  }
+  if (key === 'recordingQuotaGB' || key === 'recordingMinFreeGB') {
+    try {
+      vlcPlayer?.storageConfigure(storagePolicy(settings));
+    } catch (error) {
+      logger?.warn('Failed to configure recording storage', { error });
+    }
+  }
+  if (key === 'protectedRecordings') {
+    try {
+      vlcPlayer?.storageSetProtected(settings.protectedRecordings ?? []);
+    } catch (error) {
+      logger?.warn('Failed to set protected recordings', { error });
+    }
+  }
+  if (key === 'archiveAfterDays' || key === 'archiveVideoKbps') {
+    try {
+      vlcPlayer?.archiveConfigure(archiveSettings(settings));
+    } catch (error) {
+      logger?.warn('Failed to configure archive transcoder', { error });
+    }
+  }
+  if (key === 'nativeMulticast') {
+    applyNativeMulticast(settings);
+  }
+  if (key === 'relayEnabled' || key === 'relayLan' || key === 'relayPort') {
+    applyRelay(settings);
+  }
+  if (key === 'recordingServerEnabled' || key === 'recordingServerLan' || key === 'recordingServerPort') {
+    applyRecordingServer(settings);
+  }
   return true;
 });
 
@@ -859,19 +1570,23 @@ ipcMain.handle('player:play', async (_event, url: string) => {
       }
     }
 
-    // Queue the play command (prevents race conditions)
-    queueVlcCommand('play', url);
-    
-    // Give VLC time to start
-    await new Promise(resolve => setTimeout(resolve, 300));
-    
-    // Check if playback started
-    const isPlaying = vlcPlayer.isPlaying();
+    // Direct URL playback has no channel; statistics are keyed by URL
+    failoverChannelId = null;
+    setTelemetryChannel('');
+    armStandbyMirror(null, url);
+
+    // Resolves once the stream opened or failed, or a newer command replaced it
+    const result = await runVlcCommand('play', url);
+    if (wasDropped(result)) {
+      return { success: false, superseded: true, error: 'Superseded by a newer command' };
+    }
+
+    const isPlaying = result?.success ?? false;
     
     if (isPlaying) {
       logger?.info('Playback started', { url });
     } else {
-      logger?.error('Playback failed', { url });
+      logger?.error('Playback failed', { url, status: result?.status });
     }
     
     return { success: isPlaying, error: isPlaying ? undefined : 'Failed to play stream' };
@@ -899,30 +1614,84 @@ ipcMain.handle('player:stop', async () => {
   }
 
   try {
-    logger?.info('Stop requested');
-    const currentUrl = vlcPlayer.getCurrentUrl();
-    
-    // Queue stop command
-    queueVlcCommand('stop');
-    
-    // Give VLC time to stop
-    await new Promise(resolve => setTimeout(resolve, 100));
-    
-    if (currentUrl) {
-      // Clear restart attempts when user manually stops
-      restartAttempts.delete(currentUrl);
-      logger?.info('Playback stopped', { url: currentUrl });
-    }
-    
-    return { success: true };
+    logger?.info('Stop requested');
+    const currentUrl = vlcPlayer.getCurrentUrl();
+    
+    // Runs ahead of (and cancels) any zap still queued
+    await runVlcCommand('stop');
+    
+    if (currentUrl) {
+      // Clear restart attempts when user manually stops
+      restartAttempts.delete(currentUrl);
+      logger?.info('Playback stopped', { url: currentUrl });
+    }
+    
+    return { success: true };
+  } catch (error) {
+    logger?.error('Stop error', { error });
+    return { success: false };
+  }
+});
+
+ipcMain.handle('player:pause', async () => {
+  if (!vlcPlayer) {
+    return { success: false };
+  }
+
+  if (isShuttingDown) {
+    return { success: false, error: 'App is shutting down' };
+  }
+
+  try {
+    logger?.debug('Pause requested');
+    const result = await runVlcCommand('pause');
+    return { success: result?.success ?? false };
+  } catch (error) {
+    logger?.error('Pause error', { error });
+    return { success: false };
+  }
+});
+
+ipcMain.handle('player:resume', async () => {
+  if (!vlcPlayer) {
+    return { success: false };
+  }
+
+  if (isShuttingDown) {
+    return { success: false, error: 'App is shutting down' };
+  }
+
+  try {
+    logger?.debug('Resume requested');
+    const result = await runVlcCommand('resume');
+    return { success: result?.success ?? false };
+  } catch (error) {
+    logger?.error('Resume error', { error });
+    return { success: false };
+  }
+});
+
+// Recording playback: seek (scrubbing coalesces natively) and trick play
+ipcMain.handle('player:seek', async (_event, timeMs: number) => {
+  if (!vlcPlayer || typeof timeMs !== 'number' || !isFinite(timeMs)) {
+    return { success: false };
+  }
+
+  if (isShuttingDown) {
+    return { success: false, error: 'App is shutting down' };
+  }
+
+  try {
+    const result = await runVlcCommand('seek', Math.max(0, timeMs));
+    return { success: result?.success ?? false, superseded: wasDropped(result) };
   } catch (error) {
-    logger?.error('Stop error', { error });
+    logger?.error('Seek error', { error, timeMs });
     return { success: false };
   }
 });
 
-ipcMain.handle('player:pause', async () => {
-  if (!vlcPlayer) {
+ipcMain.handle('player:setTrickPlay', async (_event, speed: number) => {
+  if (!vlcPlayer || typeof speed !== 'number' || !isFinite(speed) || speed <= 0) {
     return { success: false };
   }
 
@@ -931,33 +1700,39 @@ ipcMain.handle('player:pause', async () => {
   }
 
   try {
-    logger?.debug('Pause requested');
-    queueVlcCommand('pause');
-    await new Promise(resolve => setTimeout(resolve, 50));
-    return { success: true };
+    logger?.debug('Trick play requested', { speed });
+    const result = await runVlcCommand('trickPlay', speed);
+    return { success: result?.success ?? false };
   } catch (error) {
-    logger?.error('Pause error', { error });
+    logger?.error('Trick play error', { error, speed });
     return { success: false };
   }
 });
 
-ipcMain.handle('player:resume', async () => {
+ipcMain.handle('player:getPosition', async () => {
   if (!vlcPlayer) {
-    return { success: false };
+    return null;
   }
 
-  if (isShuttingDown) {
-    return { success: false, error: 'App is shutting down' };
+  try {
+    return vlcPlayer.getPlaybackPosition();
+  } catch (error) {
+    logger?.error('GetPosition error', { error });
+    return null;
+  }
+});
+
+// Receive statistics while the channel is on the native multicast input
+ipcMain.handle('player:getMulticastStats', async () => {
+  if (!vlcPlayer) {
+    return null;
   }
 
   try {
-    logger?.debug('Resume requested');
-    queueVlcCommand('resume');
-    await new Promise(resolve => setTimeout(resolve, 50));
-    return { success: true };
+    return vlcPlayer.getMulticastStats();
   } catch (error) {
-    logger?.error('Resume error', { error });
-    return { success: false };
+    logger?.error('GetMulticastStats error', { error });
+    return null;
   }
 });
 
@@ -1070,8 +1845,24 @@ ipcMain.handle('health:clear', async (_event, channelId?: string) => {
   }
 });
 
+// Telemetry IPC handlers
+ipcMain.handle('telemetry:query', async (_event, fromMs: number, toMs: number) => {
+  if (!vlcPlayer) {
+    return [];
+  }
+
+  try {
+    return await vlcPlayer.journalQuery(fromMs, toMs);
+  } catch (error) {
+    logger?.error('TelemetryQuery error', { error, fromMs, toMs });
+    return [];
+  }
+});
+
 // Fallback IPC handlers
 ipcMain.handle('player:playWithFallback', async (_event, channelId: string, urls: string[], lastSuccessfulUrl?: string) => {
+  // The fallback manager is created once libvlc has finished starting
+  await vlcReady;
   if (!vlcPlayer || !fallbackManager) {
     logger?.error('PlayWithFallback called but VLC or fallback manager not initialized');
     return { success: false, error: 'Player not initialized' };
@@ -1079,7 +1870,9 @@ ipcMain.handle('player:playWithFallback', async (_event, channelId: string, urls
 
   try {
     // Initialize fallback state
-    fallbackManager.initializeChannel(channelId, urls, lastSuccessfulUrl);
+    // Adopt the stream pre-opened at startup if it belongs to this channel
+    const resumeUrl: string = vlcPlayer.getResumeUrl();
+    fallbackManager.initializeChannel(channelId, urls, lastSuccessfulUrl, resumeUrl || undefined);
     
     // Get first URL to try
     const url = fallbackManager.getCurrentUrl(channelId);
@@ -1105,10 +1898,17 @@ ipcMain.handle('player:playWithFallback', async (_event, channelId: string, urls
     }
 
     // Try to play
-    const success = vlcPlayer.play(url);
+    failoverChannelId = channelId;
+    setTelemetryChannel(channelId);
+    const result = await runVlcCommand('play', url);
+    if (wasDropped(result)) {
+      return { success: false, superseded: true, error: 'Superseded by a newer command' };
+    }
+    const success = result?.success ?? false;
     
     if (success) {
       fallbackManager.markSuccess(channelId);
+      armStandbyMirror(channelId, url);
       logger?.info('Playback started successfully', { channelId, url });
       return { success: true, url };
     } else {
@@ -1150,7 +1950,7 @@ ipcMain.handle('player:getLastSuccessfulUrl', async (_event, channelId: string)
  */
 const MAX_FALLBACK_DEPTH = 20;
 
-async function tryNextFallbackUrl(channelId: string, depth = 0): Promise<{ success: boolean; error?: string; url?: string }> {
+async function tryNextFallbackUrl(channelId: string, depth = 0): Promise<{ success: boolean; error?: string; url?: string; superseded?: boolean }> {
   if (!vlcPlayer || !fallbackManager) {
     return { success: false, error: 'Player or fallback manager not available' };
   }
@@ -1169,14 +1969,6 @@ async function tryNextFallbackUrl(channelId: string, depth = 0): Promise<{ succe
 
   logger?.info('Trying fallback URL', { channelId, url: nextUrl });
 
-  // Stop current playback
-  try {
-    vlcPlayer.stop();
-    await new Promise(resolve => setTimeout(resolve, 300));
-  } catch (error) {
-    logger?.warn('Error stopping playback', { error });
-  }
-
   // Check if player needs recreation
   const inError = vlcPlayer.isInError();
   if (inError) {
@@ -1186,11 +1978,16 @@ async function tryNextFallbackUrl(channelId: string, depth = 0): Promise<{ succe
     }
   }
 
-  // Try to play next URL
-  const success = vlcPlayer.play(nextUrl);
+  // Try to play next URL (play stops the failed one first)
+  const result = await runVlcCommand('play', nextUrl);
+  if (wasDropped(result)) {
+    return { success: false, superseded: true, error: 'Superseded by a newer command' };
+  }
+  const success = result?.success ?? false;
   
   if (success) {
     fallbackManager.markSuccess(channelId);
+    armStandbyMirror(channelId, nextUrl);
     logger?.info('Fallback URL successful', { channelId, url: nextUrl });
     return { success: true, url: nextUrl };
   } else {
@@ -1216,8 +2013,9 @@ ipcMain.handle('recording:start', async (_event, channelId: string, channelName:
     // Generate file path
     const filePath = recordingManager.startRecording(channelId, channelName);
     
-    // Start recording via VLC
-    const success = vlcPlayer.startRecording(filePath);
+    // Start recording via VLC, filtered to one programme if configured
+    const pids = loadSettings().recordingPids?.[channelId];
+    const success = vlcPlayer.startRecording(filePath, pids);
     
     if (success) {
       logger?.info('Recording started successfully', { channelId, channelName, filePath });
@@ -1240,6 +2038,8 @@ ipcMain.handle('recording:stop', async (_event, channelId: string) => {
   }
 
   try {
+    const filePath = recordingManager.getRecordingInfo(channelId)?.filePath;
+
     // Stop VLC recording
     const vlcStopped = vlcPlayer.stopRecording();
     
@@ -1248,6 +2048,9 @@ ipcMain.handle('recording:stop', async (_event, channelId: string) => {
     
     if (vlcStopped && managerStopped) {
       logger?.info('Recording stopped successfully', { channelId });
+      if (filePath) {
+        scanRecording(filePath);
+      }
       return { success: true };
     } else {
       logger?.warn('Recording stop incomplete', { channelId, vlcStopped, managerStopped });
@@ -1304,6 +2107,58 @@ ipcMain.handle('recording:getActive', async () => {
   }
 });
 
+ipcMain.handle('recording:play', async (_event, filePath: string) => {
+  if (!vlcPlayer || !isRecordingFile(filePath)) {
+    return { success: false, error: 'Not a recording' };
+  }
+
+  if (isShuttingDown) {
+    return { success: false, error: 'App is shutting down' };
+  }
+
+  try {
+    setTelemetryChannel('');
+    const result = await runVlcCommand('play', pathToFileURL(filePath).href);
+    if (wasDropped(result)) {
+      return { success: false, superseded: true, error: 'Superseded by a newer command' };
+    }
+    return { success: result?.success ?? false };
+  } catch (error) {
+    logger?.error('Recording play error', { error, filePath });
+    return { success: false, error: String(error) };
+  }
+});
+
+// Scrub preview for a time in a recording, as a data URL; null without a strip
+ipcMain.handle('recording:preview', async (_event, filePath: string, timeMs: number) => {
+  if (!vlcPlayer || !isRecordingFile(filePath) || typeof timeMs !== 'number' || !isFinite(timeMs)) {
+    return null;
+  }
+
+  try {
+    const thumb = vlcPlayer.readPreview(filePath, Math.max(0, timeMs));
+    if (!thumb) return null;
+    return nativeImage.createFromBitmap(thumb.data, { width: thumb.width, height: thumb.height }).toDataURL();
+  } catch (error) {
+    logger?.error('Recording preview error', { error, filePath });
+    return null;
+  }
+});
+
+// Black, silence and break markers of an analysed recording; null if not analysed
+ipcMain.handle('recording:getChapters', async (_event, filePath: string) => {
+  if (!vlcPlayer || !isRecordingFile(filePath)) {
+    return null;
+  }
+
+  try {
+    return vlcPlayer.readChapters(filePath);
+  } catch (error) {
+    logger?.error('Recording chapters error', { error, filePath });
+    return null;
+  }
+});
+
 ipcMain.handle('recording:getPath', async () => {
   if (!recordingManager) {
     return '';
@@ -1312,6 +2167,211 @@ ipcMain.handle('recording:getPath', async () => {
   return recordingManager.getRecordingsPath();
 });
 
+// Scheduled recordings (native scheduler; rules persist across restarts)
+ipcMain.handle('schedule:addRule', async (_event, rule: unknown) => {
+  if (!schedulerOpen || !rule || typeof rule !== 'object') {
+    return 0;
+  }
+
+  try {
+    const id: number = vlcPlayer.scheduleAddRule(rule);
+    if (!id) {
+      logger?.warn('Schedule rule rejected', { rule });
+    }
+    return id;
+  } catch (error) {
+    logger?.error('Schedule addRule error', { error });
+    return 0;
+  }
+});
+
+ipcMain.handle('schedule:removeRule', async (_event, id: number) => {
+  if (!schedulerOpen || typeof id !== 'number') {
+    return false;
+  }
+
+  try {
+    return vlcPlayer.scheduleRemoveRule(id);
+  } catch (error) {
+    logger?.error('Schedule removeRule error', { error, id });
+    return false;
+  }
+});
+
+ipcMain.handle('schedule:list', async () => {
+  if (!schedulerOpen) {
+    return { rules: [], jobs: [] };
+  }
+
+  try {
+    return vlcPlayer.scheduleList();
+  } catch (error) {
+    logger?.error('Schedule list error', { error });
+    return { rules: [], jobs: [] };
+  }
+});
+
+ipcMain.handle('schedule:setChannels', async (_event, channels: ScheduleChannel[]) => {
+  if (!Array.isArray(channels)) {
+    return;
+  }
+
+  scheduleChannels = channels;
+  pushScheduleChannels();
+});
+
+// Remux of recordings to fragmented MP4 (runs in the background)
+ipcMain.handle('remux:enqueue', async (_event, filePath: string) => {
+  if (!vlcPlayer || typeof filePath !== 'string' || !filePath.toLowerCase().endsWith('.ts')) {
+    return 0;
+  }
+
+  try {
+    return vlcPlayer.remuxEnqueue(filePath);
+  } catch (error) {
+    logger?.error('Remux enqueue error', { error, filePath });
+    return 0;
+  }
+});
+
+ipcMain.handle('remux:cancel', async (_event, id: number) => {
+  if (!vlcPlayer || typeof id !== 'number') {
+    return false;
+  }
+
+  try {
+    return vlcPlayer.remuxCancel(id);
+  } catch (error) {
+    logger?.error('Remux cancel error', { error, id });
+    return false;
+  }
+});
+
+ipcMain.handle('remux:list', async () => {
+  if (!vlcPlayer) {
+    return [];
+  }
+
+  try {
+    return vlcPlayer.remuxList();
+  } catch (error) {
+    logger?.error('Remux list error', { error });
+    return [];
+  }
+});
+
+// The relay's URLs and who is watching through it
+ipcMain.handle('relay:getInfo', async () => {
+  if (!vlcPlayer || !relayPath) {
+    return null;
+  }
+
+  try {
+    const stats = vlcPlayer.relayStats();
+    const lanUrls = (loadSettings().relayLan ?? false)
+      ? lanAddresses().map(address => `http://${address}:${relayListenPort}${relayPath}`)
+      : [];
+    return { ...stats, localUrl: relayLocalUrl(), lanUrls };
+  } catch (error) {
+    logger?.error('Relay info error', { error });
+    return null;
+  }
+});
+
+// The recordings playlist URLs and how busy the server is
+ipcMain.handle('recordingServer:getInfo', async () => {
+  if (!vlcPlayer || !recordingServerBase) {
+    return null;
+  }
+
+  try {
+    const stats = vlcPlayer.recordingServerStats();
+    const playlist = 'recordings.m3u';
+    const lanPlaylistUrls = (loadSettings().recordingServerLan ?? false)
+      ? lanAddresses().map(address => recordingServerBase.replace('127.0.0.1', address) + playlist)
+      : [];
+    return { ...stats, playlistUrl: recordingServerBase + playlist, lanPlaylistUrls };
+  } catch (error) {
+    logger?.error('Recording server info error', { error });
+    return null;
+  }
+});
+
+// Re-encoding of old recordings (settings archiveAfterDays, archiveVideoKbps)
+ipcMain.handle('archive:list', async () => {
+  if (!vlcPlayer) {
+    return [];
+  }
+
+  try {
+    return vlcPlayer.archiveList();
+  } catch (error) {
+    logger?.error('Archive list error', { error });
+    return [];
+  }
+});
+
+// Recordings folder usage and eviction
+ipcMain.handle('storage:stats', async () => {
+  if (!vlcPlayer) {
+    return null;
+  }
+
+  try {
+    return vlcPlayer.storageStats();
+  } catch (error) {
+    logger?.error('Storage stats error', { error });
+    return null;
+  }
+});
+
+ipcMain.handle('storage:list', async () => {
+  if (!vlcPlayer) {
+    return [];
+  }
+
+  try {
+    return vlcPlayer.storageList();
+  } catch (error) {
+    logger?.error('Storage list error', { error });
+    return [];
+  }
+});
+
+// Keep (or stop keeping) one recording out of eviction
+ipcMain.handle('storage:protect', async (_event, filePath: string, keep: boolean) => {
+  if (!vlcPlayer || typeof filePath !== 'string' || typeof keep !== 'boolean') {
+    return false;
+  }
+
+  const settings = loadSettings();
+  const others = (settings.protectedRecordings ?? []).filter(p => p !== filePath);
+  settings.protectedRecordings = keep ? [...others, filePath] : others;
+  saveSettings(settings);
+  try {
+    vlcPlayer.storageSetProtected(settings.protectedRecordings);
+    return true;
+  } catch (error) {
+    logger?.error('Storage protect error', { error, filePath });
+    return false;
+  }
+});
+
+/**
+ * Hand the playlist's channels to the scheduler with their PID selections.
+ * Accepted before the scheduler opens; the channel table outlives it.
+ */
+function pushScheduleChannels() {
+  if (!vlcPlayer || scheduleChannels.length === 0) return;
+
+  const pids = loadSettings().recordingPids || {};
+  try {
+    vlcPlayer.scheduleSetChannels(scheduleChannels.map(channel => ({ ...channel, pids: pids[channel.id] })));
+  } catch (error) {
+    logger?.error('Schedule setChannels error', { error });
+  }
+}
+
 // Audio-only mode handlers (disabled - requires VLC SDK rebuild)
 /*
 ipcMain.handle('player:setAudioOnly', async (_event, enabled: boolean) => {
@@ -1422,6 +2482,9 @@ ipcMain.handle('epg:loadXmltv', async (_event, filePath: string) => {
   try {
     logger?.info('Loading XMLTV file', { filePath: resolvedEpgPath });
     const result = await epgManager.loadFromXmltv(resolvedEpgPath);
+    if (result.success) {
+      pushEpgToScheduler();
+    }
     return result;
   } catch (error) {
     logger?.error('Failed to load XMLTV', { error });
@@ -1462,6 +2525,9 @@ ipcMain.handle('epg:openXmltvFile', async () => {
     // Load the file
     if (epgManager) {
       const parseResult = await epgManager.loadFromXmltv(filePath);
+      if (parseResult.success) {
+        pushEpgToScheduler();
+      }
       return { filePath, parseResult };
     }
 
@@ -1562,6 +2628,7 @@ ipcMain.handle('epg:clear', async () => {
 
   try {
     epgManager.clear();
+    pushEpgToScheduler();
     logger?.info('EPG data cleared');
   } catch (error) {
     logger?.error('Failed to clear EPG', { error });
@@ -1709,6 +2776,8 @@ function forceStopVlc(): void {
 
   try {
     logger?.info('Force stopping VLC');
+    // Drop queued zaps so nothing starts after this stop
+    vlcPlayer.shutdownCommands();
     vlcPlayer.stop();
     
     // Give VLC a moment to cleanup
@@ -1781,6 +2850,16 @@ app.whenReady().then(() => {
   
   // Check for orphaned VLC processes on startup
   cleanupOrphanedVlcProcesses();
+
+  // Maintenance step (e.g. run by the installer): rebuild the bundled VLC
+  // plugin cache, then exit
+  if (process.argv.includes('--regenerate-vlc-plugin-cache')) {
+    regenerateVlcPluginCache();
+    return;
+  }
+
+  // libvlc loads its plugins while the window and renderer start
+  loadVlcAddon();
   
   createWindow();
 
@@ -1813,6 +2892,69 @@ app.on('before-quit', (event) => {
     healthCheckInterval = null;
   }
 
+  // Stop metrics export (writes a final dump if enabled)
+  try {
+    vlcPlayer?.stopMetrics();
+  } catch (error) {
+    logger?.warn('Failed to stop metrics export', { error });
+  }
+
+  // Close the telemetry journal (playback was stopped above)
+  try {
+    vlcPlayer?.journalClose();
+  } catch (error) {
+    logger?.warn('Failed to close telemetry journal', { error });
+  }
+
+  // Stop scheduled captures before the reliability store they rank with
+  try {
+    vlcPlayer?.scheduleClose();
+  } catch (error) {
+    logger?.warn('Failed to close recording scheduler', { error });
+  }
+
+  // Cancel remuxes in progress; their partial output is deleted
+  try {
+    vlcPlayer?.remuxClose();
+  } catch (error) {
+    logger?.warn('Failed to close remux queue', { error });
+  }
+
+  // Stop archiving; the recording in progress resumes from its checkpoint
+  try {
+    vlcPlayer?.archiveClose();
+  } catch (error) {
+    logger?.warn('Failed to close archive transcoder', { error });
+  }
+
+  // Disconnect relay clients and stop its upstream
+  try {
+    vlcPlayer?.relayClose();
+  } catch (error) {
+    logger?.warn('Failed to close stream relay', { error });
+  }
+
+  // Drop recording server connections, live followers included
+  try {
+    vlcPlayer?.recordingServerClose();
+  } catch (error) {
+    logger?.warn('Failed to close recording server', { error });
+  }
+
+  // Stop the storage watch and any eviction in progress
+  try {
+    vlcPlayer?.storageClose();
+  } catch (error) {
+    logger?.warn('Failed to close recording storage', { error });
+  }
+
+  // Unmap the reliability store so the last outcomes are flushed
+  try {
+    vlcPlayer?.reliabilityClose();
+  } catch (error) {
+    logger?.warn('Failed to close reliability store', { error });
+  }
+
   // 3. Save active profile (synchronous)
   if (profileManager) {
     try {
@@ -34,7 +34,7 @@ const electronApi = {
   // Track wrappers by channel name so removeListener can clean up correctly.
   // contextBridge proxies don't preserve function identity, so we key by channel.
   ipcRenderer: {
-    _validChannels: new Set(['menu:openDonation', 'menu:openPlaylist', 'player:error']),
+    _validChannels: new Set(['menu:openDonation', 'menu:openPlaylist', 'player:error', 'remux:progress', 'archive:progress']),
     _channelWrappers: new Map<string, (event: any, ...args: any[]) => void>(),
     on: (channel: string, callback: (...args: any[]) => void) => {
       if (!electronApi.ipcRenderer._validChannels.has(channel)) {
@@ -70,6 +70,10 @@ const electronApi = {
     getVolume: () => ipcRenderer.invoke('player:getVolume'),
     getState: () => ipcRenderer.invoke('player:getState'),
     isPlaying: () => ipcRenderer.invoke('player:isPlaying'),
+    seek: (timeMs: number) => ipcRenderer.invoke('player:seek', timeMs),
+    setTrickPlay: (speed: number) => ipcRenderer.invoke('player:setTrickPlay', speed),
+    getPosition: () => ipcRenderer.invoke('player:getPosition'),
+    getMulticastStats: () => ipcRenderer.invoke('player:getMulticastStats'),
     playWithFallback: (channelId: string, urls: string[], lastSuccessfulUrl?: string) => 
       ipcRenderer.invoke('player:playWithFallback', channelId, urls, lastSuccessfulUrl),
     retryFallback: (channelId: string) => ipcRenderer.invoke('player:retryFallback', channelId),
@@ -85,6 +89,11 @@ const electronApi = {
     getAllScores: () => ipcRenderer.invoke('health:getAllScores'),
     clear: (channelId?: string) => ipcRenderer.invoke('health:clear', channelId)
   },
+
+  // Playback statistics from the session journal
+  telemetry: {
+    query: (fromMs: number, toMs: number) => ipcRenderer.invoke('telemetry:query', fromMs, toMs)
+  },
   
   // Recording
   recording: {
@@ -93,7 +102,48 @@ const electronApi = {
     isRecording: (channelId?: string) => ipcRenderer.invoke('recording:isRecording', channelId),
     getInfo: (channelId: string) => ipcRenderer.invoke('recording:getInfo', channelId),
     getActive: () => ipcRenderer.invoke('recording:getActive'),
-    getPath: () => ipcRenderer.invoke('recording:getPath')
+    getPath: () => ipcRenderer.invoke('recording:getPath'),
+    play: (filePath: string) => ipcRenderer.invoke('recording:play', filePath),
+    getPreview: (filePath: string, timeMs: number) => ipcRenderer.invoke('recording:preview', filePath, timeMs),
+    getChapters: (filePath: string) => ipcRenderer.invoke('recording:getChapters', filePath)
+  },
+
+  // EPG-driven scheduled recordings
+  schedule: {
+    addRule: (rule: unknown) => ipcRenderer.invoke('schedule:addRule', rule),
+    removeRule: (id: number) => ipcRenderer.invoke('schedule:removeRule', id),
+    list: () => ipcRenderer.invoke('schedule:list'),
+    setChannels: (channels: { id: string; name: string; urls: string[] }[]) =>
+      ipcRenderer.invoke('schedule:setChannels', channels)
+  },
+
+  // Background remux of recordings to MP4; progress arrives on 'remux:progress'
+  remux: {
+    enqueue: (filePath: string) => ipcRenderer.invoke('remux:enqueue', filePath),
+    cancel: (id: number) => ipcRenderer.invoke('remux:cancel', id),
+    list: () => ipcRenderer.invoke('remux:list')
+  },
+
+  // LAN re-streaming of the current channel; settings relayEnabled, relayLan
+  relay: {
+    getInfo: () => ipcRenderer.invoke('relay:getInfo')
+  },
+
+  // HTTP access to recordings; settings recordingServerEnabled, recordingServerLan
+  recordingServer: {
+    getInfo: () => ipcRenderer.invoke('recordingServer:getInfo')
+  },
+
+  // Re-encoding of old recordings; progress arrives on 'archive:progress'
+  archive: {
+    list: () => ipcRenderer.invoke('archive:list')
+  },
+
+  // Recordings folder usage; quota and free-space limits are settings
+  storage: {
+    stats: () => ipcRenderer.invoke('storage:stats'),
+    list: () => ipcRenderer.invoke('storage:list'),
+    protect: (filePath: string, keep: boolean) => ipcRenderer.invoke('storage:protect', filePath, keep)
   },
 
   // VLC audio controls
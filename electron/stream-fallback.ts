@@ -2,7 +2,9 @@
  * Stream Fallback Manager
  * 
  * Handles automatic URL fallback when streams fail.
- * Tries each URL in sequence and remembers successful ones.
+ * Tries each URL in sequence and remembers successful ones. When a URL
+ * ranker is supplied (the native reliability store), mirrors are tried
+ * best-first across restarts instead of relying on lastSuccessfulUrl.
  */
 
 import { RotatingLogger } from './logger';
@@ -18,19 +20,39 @@ export interface FallbackState {
 
 const MAX_TRACKED_CHANNELS = 200; // Evict oldest entries beyond this
 
+/** Returns the given URLs reordered, most reliable first */
+export type UrlRanker = (urls: string[]) => string[];
+
 export class StreamFallbackManager {
   private fallbackStates: Map<string, FallbackState> = new Map();
   private logger: RotatingLogger | null = null;
   private maxRetriesPerUrl = 1;
+  private ranker: UrlRanker | null = null;
 
-  constructor(logger?: RotatingLogger) {
+  constructor(logger?: RotatingLogger, ranker?: UrlRanker) {
     this.logger = logger || null;
+    this.ranker = ranker || null;
+  }
+
+  /**
+   * Order URLs by the ranker, falling back to playlist order on error
+   */
+  private rankUrls(urls: string[]): string[] | null {
+    if (!this.ranker) return null;
+
+    try {
+      const ranked = this.ranker(urls);
+      return ranked.length === urls.length ? ranked : null;
+    } catch (error) {
+      this.logger?.warn('URL ranking failed, using playlist order', { error });
+      return null;
+    }
   }
 
   /**
    * Initialize or update fallback state for a channel
    */
-  initializeChannel(channelId: string, urls: string[], lastSuccessfulUrl?: string): void {
+  initializeChannel(channelId: string, urls: string[], lastSuccessfulUrl?: string, preferredUrl?: string): void {
     if (urls.length === 0) {
       this.logger?.warn('No URLs provided for channel', { channelId });
       return;
@@ -44,15 +66,25 @@ export class StreamFallbackManager {
       }
     }
 
-    // Find starting index
+    // Ranked order already reflects past successes; otherwise start at the
+    // last URL known to work
+    let ordered = this.rankUrls(urls);
+    const ranked = ordered !== null;
     let startIndex = 0;
-    if (lastSuccessfulUrl && urls.includes(lastSuccessfulUrl)) {
+    if (!ranked && lastSuccessfulUrl && urls.includes(lastSuccessfulUrl)) {
       startIndex = urls.indexOf(lastSuccessfulUrl);
     }
 
+    // A URL the player is already opening (startup resume) goes first
+    const preferred = !!preferredUrl && urls.includes(preferredUrl);
+    if (preferred) {
+      ordered = [preferredUrl, ...(ordered || urls).filter(u => u !== preferredUrl)];
+      startIndex = 0;
+    }
+
     this.fallbackStates.set(channelId, {
       channelId,
-      urls,
+      urls: ordered || urls,
       currentIndex: startIndex,
       lastSuccessfulUrl,
       failedUrls: new Set(),
@@ -62,7 +94,9 @@ export class StreamFallbackManager {
     this.logger?.info('Fallback initialized', { 
       channelId, 
       urlCount: urls.length, 
-      startIndex 
+      startIndex,
+      ranked,
+      preferred
     });
   }
 
@@ -0,0 +1,645 @@
+#pragma once
+
+// Re-encodes old recordings to H.264/AAC at a fraction of the broadcast
+// bitrate, in place, with libvlc's transcode sout. One recording at a time
+// on one background-mode thread; recordings older than afterDays whose
+// bitrate is well above the target are picked from RecordingStorage.
+//
+// libvlc runs the decoder and encoder on threads of its own, so priority is
+// applied where the data enters: the source is read through media callbacks
+// on a handle with very low I/O priority, and the input thread doing the
+// reads drops to idle priority. The single-threaded decoder and encoder
+// behind it run dry whenever that thread is starved. While anything plays
+// or records (the busy probe) the input is paused outright.
+//
+// A recording is transcoded in SEGMENT_MS pieces appended to
+// "<rec>.arc.part"; after each piece "<rec>.arc" records how far it got,
+// so a restart resumes at the last whole piece. A finished archive replaces
+// the recording, and its index and previews are deleted for a rescan.
+
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "native_log.h"
+#include "recording_storage.h"
+#include "shared_libvlc.h"
+#include "ts_scanner.h"
+#include "win_util.h"
+
+enum class ArchiveState : uint8_t { Queued = 0, Running, Paused, Done, Failed };
+
+inline const char* archiveStateName(ArchiveState state) {
+    switch (state) {
+        case ArchiveState::Queued: return "queued";
+        case ArchiveState::Running: return "running";
+        case ArchiveState::Paused: return "paused";
+        case ArchiveState::Done: return "done";
+        case ArchiveState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+struct ArchiveSettings {
+    uint32_t afterDays = 0;         // 0 = off
+    uint32_t videoKbps = 2000;
+    uint32_t audioKbps = 128;
+    uint32_t maxHeight = 720;
+};
+
+struct ArchiveJobInfo {
+    std::string path;
+    ArchiveState state = ArchiveState::Queued;
+    double progress = 0;            // 0..1
+    uint64_t sourceBytes = 0;
+    uint64_t outputBytes = 0;       // Archive so far
+    std::string error;
+};
+
+class ArchiveTranscoder {
+private:
+    static constexpr uint32_t SEGMENT_MS = 300000;
+    static constexpr int64_t SWEEP_MS = 600000;
+    static constexpr int POLL_MS = 500;
+    static constexpr int64_t STALL_TIMEOUT_MS = 60000;
+    static constexpr double MIN_SAVING = 1.5;           // Source bitrate over the target's worth archiving
+    static constexpr size_t MAX_FINISHED = 50;
+    static constexpr char CHECKPOINT_MAGIC[8] = {'J', 'P', 'T', 'V', 'A', 'R', 'C', '1'};
+
+#pragma pack(push, 1)
+    struct Checkpoint {
+        char magic[8];
+        uint64_t sourceSize;
+        uint32_t videoKbps;         // Settings the archive was started with
+        uint32_t audioKbps;
+        uint32_t maxHeight;
+        uint32_t segmentsDone;
+        uint64_t outputBytes;       // Of the part file after those segments
+    };
+#pragma pack(pop)
+
+    enum class Result { Done, Interrupted, Failed };
+
+    // libvlc reads the source through this
+    struct SourceReader {
+        std::wstring path;
+        HANDLE file = INVALID_HANDLE_VALUE;
+        DWORD demotedThread = 0;
+
+        static int open(void* opaque, void** data, uint64_t* size) {
+            SourceReader* reader = static_cast<SourceReader*>(opaque);
+            *data = reader;
+            reader->file = CreateFileW(reader->path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                       nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (reader->file == INVALID_HANDLE_VALUE) return -1;
+            FILE_IO_PRIORITY_HINT_INFO hint;
+            hint.PriorityHint = IoPriorityHintVeryLow;
+            SetFileInformationByHandle(reader->file, FileIoPriorityHintInfo, &hint, sizeof(hint));
+            LARGE_INTEGER length;
+            *size = GetFileSizeEx(reader->file, &length) ? static_cast<uint64_t>(length.QuadPart) : 0;
+            return 0;
+        }
+
+        static ssize_t read(void* opaque, unsigned char* buffer, size_t length) {
+            SourceReader* reader = static_cast<SourceReader*>(opaque);
+            // The input thread is this media's alone and ends with it
+            if (reader->demotedThread != GetCurrentThreadId()) {
+                SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+                reader->demotedThread = GetCurrentThreadId();
+            }
+            DWORD read = 0;
+            DWORD want = static_cast<DWORD>(std::min<size_t>(length, 1 << 20));
+            if (!ReadFile(reader->file, buffer, want, &read, nullptr)) return -1;
+            return static_cast<ssize_t>(read);
+        }
+
+        static int seek(void* opaque, uint64_t offset) {
+            SourceReader* reader = static_cast<SourceReader*>(opaque);
+            LARGE_INTEGER position;
+            position.QuadPart = static_cast<LONGLONG>(offset);
+            return SetFilePointerEx(reader->file, position, nullptr, FILE_BEGIN) ? 0 : -1;
+        }
+
+        static void close(void* opaque) {
+            SourceReader* reader = static_cast<SourceReader*>(opaque);
+            if (reader->file != INVALID_HANDLE_VALUE) CloseHandle(reader->file);
+            reader->file = INVALID_HANDLE_VALUE;
+        }
+    };
+
+    struct SegmentRun {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool ended = false;
+        bool failed = false;
+    };
+
+    std::mutex archiveMutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running = false;
+    ArchiveSettings settings;
+    int64_t nextSweepMs = 0;
+    std::deque<ArchiveJobInfo> pending;         // Resumed archives first
+    ArchiveJobInfo current;
+    bool hasCurrent = false;
+    std::deque<ArchiveJobInfo> finished;
+    std::set<std::string> skipped;              // Not worth archiving
+    std::function<bool()> busyProbe;
+    std::function<void(const ArchiveJobInfo&)> listener;
+
+    ArchiveTranscoder() = default;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t unixMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static bool isTs(const std::string& path) {
+        if (path.size() < 3) return false;
+        std::string ext = path.substr(path.size() - 3);
+        for (char& c : ext) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return ext == ".ts";
+    }
+
+    static bool exists(const std::string& path) {
+        return GetFileAttributesW(utf8ToWide(path).c_str()) != INVALID_FILE_ATTRIBUTES;
+    }
+
+    // Inside a quoted sout chain value
+    static std::string quote(const std::string& value) {
+        std::string quoted = "\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    static bool readCheckpoint(const std::string& path, Checkpoint& checkpoint) {
+        FILE* f = _wfopen(utf8ToWide(path).c_str(), L"rb");
+        if (!f) return false;
+        bool ok = fread(&checkpoint, sizeof(checkpoint), 1, f) == 1 &&
+                  memcmp(checkpoint.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0;
+        fclose(f);
+        return ok;
+    }
+
+    static bool writeCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+        std::string tempPath = path + ".tmp";
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) return false;
+        bool ok = fwrite(&checkpoint, sizeof(checkpoint), 1, f) == 1;
+        ok = fclose(f) == 0 && ok;
+        if (ok && MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            return true;
+        }
+        DeleteFileW(utf8ToWide(tempPath).c_str());
+        return false;
+    }
+
+    // Cuts a partial segment off the part file
+    static bool truncateTo(const std::string& path, uint64_t length) {
+        HANDLE file = CreateFileW(utf8ToWide(path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(length);
+        bool ok = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+        CloseHandle(file);
+        return ok;
+    }
+
+    static void onEvent(const libvlc_event_t* event, void* data) {
+        SegmentRun* segment = static_cast<SegmentRun*>(data);
+        std::lock_guard<std::mutex> lock(segment->mutex);
+        if (event->type == libvlc_MediaPlayerEncounteredError) segment->failed = true;
+        segment->ended = true;
+        segment->changed.notify_all();
+    }
+
+    void notify(const ArchiveJobInfo& info) {
+        std::function<void(const ArchiveJobInfo&)> callback;
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            callback = listener;
+        }
+        if (callback) callback(info);
+    }
+
+    bool busy() {
+        std::function<bool()> probe;
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            probe = busyProbe;
+        }
+        return probe && probe();
+    }
+
+    // Progress and pause state of the running job, reported to the listener
+    void update(ArchiveJobInfo& info) {
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            if (hasCurrent) current = info;
+        }
+        notify(info);
+    }
+
+    // Recordings old enough and big enough to archive, plus any with a
+    // checkpoint to resume
+    void sweep() {
+        ArchiveSettings active;
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            active = settings;
+        }
+        if (active.afterDays == 0) return;
+
+        int64_t cutoff = unixMs() - static_cast<int64_t>(active.afterDays) * 86400000;
+        double targetKbps = (active.videoKbps + active.audioKbps) * MIN_SAVING;
+        std::vector<std::string> resumed;
+        std::vector<std::string> fresh;
+        for (const StoredRecording& recording : RecordingStorage::instance().list()) {
+            if (!isTs(recording.path) || recording.isProtected) continue;
+            {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                if (skipped.count(recording.path)) continue;
+            }
+            if (exists(recording.path + ".arc")) {
+                resumed.push_back(recording.path);
+                continue;
+            }
+            if (recording.modifiedMs > cutoff) continue;
+
+            TsSeekIndex index;
+            if (!TsScanner::loadIndex(recording.path, index) || index.durationMs == 0) continue;
+            double kbps = index.fileSize * 8.0 / index.durationMs;
+            if (kbps > targetKbps) {
+                fresh.push_back(recording.path);
+            } else {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                skipped.insert(recording.path);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        auto known = [this](const std::string& path) {
+            if (hasCurrent && current.path == path) return true;
+            for (const ArchiveJobInfo& job : pending) {
+                if (job.path == path) return true;
+            }
+            for (const ArchiveJobInfo& job : finished) {
+                if (job.path == path) return true;
+            }
+            return false;
+        };
+        for (auto it = resumed.rbegin(); it != resumed.rend(); ++it) {
+            if (known(*it)) continue;
+            ArchiveJobInfo job;
+            job.path = *it;
+            pending.push_front(job);
+        }
+        for (const std::string& path : fresh) {
+            if (known(path)) continue;
+            ArchiveJobInfo job;
+            job.path = path;
+            pending.push_back(job);
+        }
+    }
+
+    // One piece of the recording, appended to the part file. stopMs 0 runs
+    // to the end.
+    Result runSegment(const std::string& path, const ArchiveSettings& active, uint32_t startMs, uint32_t stopMs,
+                      uint32_t durationMs, ArchiveJobInfo& info, std::string& error) {
+        std::shared_ptr<libvlc_instance_t> vlc = SharedLibvlc::instance().acquire();
+        if (!vlc) {
+            error = "libvlc unavailable";
+            return Result::Failed;
+        }
+
+        SourceReader reader;
+        reader.path = utf8ToWide(path);
+        libvlc_media_t* media = libvlc_media_new_callbacks(vlc.get(), &SourceReader::open, &SourceReader::read,
+                                                           &SourceReader::seek, &SourceReader::close, &reader);
+        if (!media) {
+            error = "Cannot open recording";
+            return Result::Failed;
+        }
+        std::string chain = ":sout=#transcode{vcodec=h264,venc=x264{preset=veryfast,threads=1},vb=" +
+            std::to_string(active.videoKbps) + ",maxheight=" + std::to_string(active.maxHeight) +
+            ",deinterlace,acodec=mp4a,ab=" + std::to_string(active.audioKbps) +
+            ",channels=2}:std{access=file{append},mux=ts,dst=" + quote(path + ".arc.part") + "}";
+        libvlc_media_add_option(media, ":demux=ts");
+        libvlc_media_add_option(media, chain.c_str());
+        libvlc_media_add_option(media, ":no-sout-spu");
+        libvlc_media_add_option(media, ":avcodec-hw=none");
+        libvlc_media_add_option(media, ":avcodec-threads=1");
+        libvlc_media_add_option(media, (":start-time=" + std::to_string(startMs / 1000.0)).c_str());
+        if (stopMs > 0) {
+            libvlc_media_add_option(media, (":stop-time=" + std::to_string(stopMs / 1000.0)).c_str());
+        }
+        libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!player) {
+            error = "Cannot create player";
+            return Result::Failed;
+        }
+
+        SegmentRun segment;
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(player);
+        libvlc_event_attach(events, libvlc_MediaPlayerEndReached, &ArchiveTranscoder::onEvent, &segment);
+        libvlc_event_attach(events, libvlc_MediaPlayerEncounteredError, &ArchiveTranscoder::onEvent, &segment);
+        libvlc_media_player_play(player);
+
+        Result result = Result::Done;
+        bool paused = false;
+        libvlc_time_t lastTime = -1;
+        int64_t lastProgressMs = nowMs();
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(segment.mutex);
+                segment.changed.wait_for(lock, std::chrono::milliseconds(POLL_MS));
+                if (segment.ended) {
+                    if (segment.failed) {
+                        error = "Transcode failed";
+                        result = Result::Failed;
+                    }
+                    break;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(archiveMutex);
+                if (!running) {
+                    result = Result::Interrupted;
+                    break;
+                }
+            }
+
+            bool wanted = busy();
+            if (wanted != paused) {
+                libvlc_media_player_set_pause(player, wanted ? 1 : 0);
+                paused = wanted;
+                info.state = paused ? ArchiveState::Paused : ArchiveState::Running;
+                lastProgressMs = nowMs();
+                update(info);
+            }
+            if (paused) continue;
+
+            libvlc_time_t time = libvlc_media_player_get_time(player);
+            if (time != lastTime) {
+                lastTime = time;
+                lastProgressMs = nowMs();
+                double fraction = std::min(1.0, std::max(0.0, static_cast<double>(time) / durationMs));
+                if (fraction - info.progress >= 0.01) {
+                    info.progress = fraction;
+                    update(info);
+                }
+            } else if (nowMs() - lastProgressMs > STALL_TIMEOUT_MS) {
+                error = "Transcode stalled";
+                result = Result::Failed;
+                break;
+            }
+        }
+
+        libvlc_event_detach(events, libvlc_MediaPlayerEndReached, &ArchiveTranscoder::onEvent, &segment);
+        libvlc_event_detach(events, libvlc_MediaPlayerEncounteredError, &ArchiveTranscoder::onEvent, &segment);
+        libvlc_media_player_stop(player);           // Closes the source and flushes the part file
+        libvlc_media_player_release(player);
+        return result;
+    }
+
+    Result transcode(ArchiveJobInfo& info, const ArchiveSettings& active, std::string& error) {
+        const std::string& path = info.path;
+        std::string partPath = path + ".arc.part";
+        std::string checkpointPath = path + ".arc";
+
+        TsSeekIndex index;
+        if (!TsScanner::loadIndex(path, index) || index.durationMs == 0) {
+            error = "No seek index";
+            return Result::Failed;
+        }
+        uint64_t sourceSize = 0;
+        getFileSize(path, sourceSize);
+        info.sourceBytes = sourceSize;
+
+        Checkpoint checkpoint;
+        uint64_t partSize = 0;
+        bool resume = readCheckpoint(checkpointPath, checkpoint) && checkpoint.sourceSize == sourceSize &&
+                      checkpoint.videoKbps == active.videoKbps && checkpoint.audioKbps == active.audioKbps &&
+                      checkpoint.maxHeight == active.maxHeight && getFileSize(partPath, partSize) &&
+                      partSize >= checkpoint.outputBytes &&
+                      (partSize == checkpoint.outputBytes || truncateTo(partPath, checkpoint.outputBytes));
+        if (!resume) {
+            memcpy(checkpoint.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+            checkpoint.sourceSize = sourceSize;
+            checkpoint.videoKbps = active.videoKbps;
+            checkpoint.audioKbps = active.audioKbps;
+            checkpoint.maxHeight = active.maxHeight;
+            checkpoint.segmentsDone = 0;
+            checkpoint.outputBytes = 0;
+            DeleteFileW(utf8ToWide(partPath).c_str());
+        }
+
+        uint32_t segments = (index.durationMs + SEGMENT_MS - 1) / SEGMENT_MS;
+        while (checkpoint.segmentsDone < segments) {
+            uint32_t startMs = checkpoint.segmentsDone * SEGMENT_MS;
+            // The last piece runs to the end: the index may stop short of it
+            uint32_t stopMs = checkpoint.segmentsDone + 1 < segments ? startMs + SEGMENT_MS : 0;
+            info.progress = static_cast<double>(startMs) / index.durationMs;
+            info.outputBytes = checkpoint.outputBytes;
+            update(info);
+
+            Result result = runSegment(path, active, startMs, stopMs, index.durationMs, info, error);
+            if (result != Result::Done) return result;
+            if (!getFileSize(partPath, checkpoint.outputBytes) || checkpoint.outputBytes == 0) {
+                error = "Transcode wrote nothing";
+                return Result::Failed;
+            }
+            checkpoint.segmentsDone++;
+            writeCheckpoint(checkpointPath, checkpoint);
+        }
+        info.outputBytes = checkpoint.outputBytes;
+
+        // Fails while the recording is open (played back); tried again later
+        if (!MoveFileExW(utf8ToWide(partPath).c_str(), utf8ToWide(path).c_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            error = "Recording in use";
+            return Result::Interrupted;
+        }
+        DeleteFileW(utf8ToWide(path + ".idx").c_str());
+        DeleteFileW(utf8ToWide(path + ".thumbs").c_str());
+        DeleteFileW(utf8ToWide(checkpointPath).c_str());
+        return Result::Done;
+    }
+
+    void run() {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        PlayerMetrics& metrics = PlayerMetrics::get();
+
+        std::unique_lock<std::mutex> lock(archiveMutex);
+        while (running) {
+            if (nowMs() >= nextSweepMs) {
+                nextSweepMs = nowMs() + SWEEP_MS;
+                lock.unlock();
+                sweep();
+                lock.lock();
+                continue;
+            }
+            if (pending.empty()) {
+                wake.wait_for(lock, std::chrono::milliseconds(nextSweepMs - nowMs()));
+                continue;
+            }
+            lock.unlock();
+            bool wait = busy();
+            lock.lock();
+            if (wait) {
+                wake.wait_for(lock, std::chrono::milliseconds(POLL_MS * 4));
+                continue;
+            }
+            if (!running || pending.empty()) continue;
+
+            ArchiveJobInfo info = pending.front();
+            pending.pop_front();
+            info.state = ArchiveState::Running;
+            info.error.clear();
+            current = info;
+            hasCurrent = true;
+            ArchiveSettings active = settings;
+            lock.unlock();
+
+            notify(info);
+            auto started = std::chrono::steady_clock::now();
+            std::string error;
+            Result result = transcode(info, active, error);
+            double hours = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() / 3600;
+
+            if (result == Result::Done) {
+                metrics.archivedRecordings.inc();
+                if (info.sourceBytes > info.outputBytes) {
+                    metrics.archiveSavedBytes.inc(static_cast<double>(info.sourceBytes - info.outputBytes));
+                }
+                NativeLog::instance().write(LogLevel::Info, LOG_EVENT_RECORDING_ARCHIVED,
+                                            {info.sourceBytes / 1048576.0, info.outputBytes / 1048576.0, hours},
+                                            NativeLog::jsonField("file", info.path));
+            } else if (result == Result::Failed) {
+                NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_ARCHIVE_FAILED, {},
+                                            NativeLog::jsonField("file", info.path) + "," +
+                                            NativeLog::jsonField("error", error));
+            }
+
+            lock.lock();
+            hasCurrent = false;
+            info.error = error;
+            switch (result) {
+                case Result::Done:
+                    info.state = ArchiveState::Done;
+                    info.progress = 1;
+                    break;
+                case Result::Interrupted:
+                    // Resumes from its checkpoint: next, or after a restart
+                    info.state = ArchiveState::Queued;
+                    pending.push_front(info);
+                    break;
+                case Result::Failed:
+                    info.state = ArchiveState::Failed;
+                    skipped.insert(info.path);
+                    break;
+            }
+            if (result != Result::Interrupted) {
+                finished.push_back(info);
+                while (finished.size() > MAX_FINISHED) finished.pop_front();
+            }
+            lock.unlock();
+            notify(info);
+            lock.lock();
+            if (result == Result::Interrupted && running) {
+                wake.wait_for(lock, std::chrono::milliseconds(POLL_MS * 4));
+            }
+        }
+    }
+
+public:
+    ArchiveTranscoder(const ArchiveTranscoder&) = delete;
+    ArchiveTranscoder& operator=(const ArchiveTranscoder&) = delete;
+
+    static ArchiveTranscoder& instance() {
+        static ArchiveTranscoder transcoder;
+        return transcoder;
+    }
+
+    // busy: true while playback or a recording needs the machine; polled.
+    // onEvent fires on state changes and each percent of progress.
+    bool start(const ArchiveSettings& initial, std::function<bool()> busy,
+               std::function<void(const ArchiveJobInfo&)> onEvent) {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        if (running) return true;
+
+        settings = initial;
+        busyProbe = std::move(busy);
+        listener = std::move(onEvent);
+        nextSweepMs = 0;
+        running = true;
+        worker = std::thread(&ArchiveTranscoder::run, this);
+        return true;
+    }
+
+    // Stops the running archive at once; its checkpoint stays for next time
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        pending.clear();
+        finished.clear();
+        skipped.clear();
+        busyProbe = nullptr;
+        listener = nullptr;
+    }
+
+    // New settings apply from the next recording; a sweep runs at once.
+    // Turning archiving off drops the queue but lets a running one finish.
+    void configure(const ArchiveSettings& updated) {
+        {
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            settings = updated;
+            if (settings.afterDays == 0) pending.clear();
+            skipped.clear();
+            nextSweepMs = 0;
+        }
+        wake.notify_all();
+    }
+
+    // The running archive, the queue in order, then finished ones newest first
+    std::vector<ArchiveJobInfo> list() {
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        std::vector<ArchiveJobInfo> result;
+        if (hasCurrent) result.push_back(current);
+        result.insert(result.end(), pending.begin(), pending.end());
+        result.insert(result.end(), finished.rbegin(), finished.rend());
+        return result;
+    }
+};
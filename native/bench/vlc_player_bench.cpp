@@ -0,0 +1,1493 @@
+// Benchmark harness for VlcPlayer.
+//
+// Serves canned MPEG-TS fixtures from a local HTTP/UDP server, drives
+// VlcPlayer headless (hidden windows) through scripted scenarios and prints
+// one JSON document so runs can be diffed against each other.
+//
+// Build:  npm run bench:native
+// Run:    build/Release/vlc_player_bench.exe --fixture a.ts --fixture b.ts --out bench.json
+//
+// Fixtures are not checked in. Any constant-bitrate TS works, e.g.:
+//   ffmpeg -f lavfi -i testsrc2=size=1280x720:rate=30 -f lavfi -i sine=frequency=440 -t 60
+//          -c:v libx264 -b:v 4M -maxrate 4M -bufsize 2M -g 30 -c:a aac -muxrate 4500k -f mpegts a.ts
+//   (one command line)
+//
+// Scenarios:
+//   zap        one player cycling through every fixture over HTTP and UDP
+//   multiview  N players sharing the one libvlc instance, playing at once
+//   recording  one player recording to a temporary file while playing, then
+//              a few seconds of its first programme through the PID filter;
+//              fails (exit code 3) if either file stays empty
+//   multicast  N RTP streams over loopback into the native multicast input,
+//              with packets dropped and swapped on purpose; reports receive
+//              CPU and whether loss and reordering were counted exactly
+//   deadurl    play() of URLs that answer 404 or refuse the connection;
+//              reports how long until the player knew the stream had failed
+//   relay      N HTTP clients of the stream relay, one of them reading far
+//              below the stream rate; the upstream must keep its rate and
+//              only the slow client skip
+//   recordings N HTTP clients fetching random byte ranges of a recording
+//              from the recording server; reports throughput, CPU and
+//              whether every byte matched the file
+//   soak       hours of zapping, recording and polling; fails (exit code 3)
+//              if memory, handles, threads or libvlc objects grow linearly.
+//              Not run by default: --scenarios soak --duration 14400
+
+#include "../vlc_player.h"
+#include "../recording_server.h"
+#include "../stream_relay.h"
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma comment(lib, "psapi.lib")
+#pragma comment(lib, "winmm.lib")
+
+struct BenchConfig {
+    std::vector<std::string> fixtures;
+    std::vector<std::string> scenarios = {"zap", "multiview", "recording", "deadurl", "multicast", "relay", "recordings"};
+    int bitrateKbps = 4500;        // Pacing rate for every fixture
+    int zapRounds = 3;             // Passes over the whole zap list
+    int dwellMs = 2000;            // Time spent on a channel after the first frame
+    int zapTimeoutMs = 15000;
+    int streams = 4;               // Players in multiview, inputs in multicast, clients in relay/recordings
+    int durationSeconds = 30;      // Multiview / recording run time
+    int udpBasePort = 51234;
+    int sampleSeconds = 60;        // Soak sampling interval
+    std::string outPath;
+};
+
+// ---------------------------------------------------------------------------
+// Fixture server
+// ---------------------------------------------------------------------------
+
+static const size_t TS_PACKET_SIZE = 188;
+static const size_t UDP_PAYLOAD = TS_PACKET_SIZE * 7;
+
+class FixtureServer {
+private:
+    std::vector<std::vector<uint8_t>> fixtures;
+    double bytesPerSecond = 0;
+    SOCKET listener = INVALID_SOCKET;
+    int httpPort = 0;
+    int udpBasePort = 0;
+    std::atomic<bool> running{false};
+    std::vector<std::thread> threads;
+    std::mutex clientsMutex;
+    std::vector<std::thread> clients;
+
+    // Sleep until `sent` bytes are due at the configured rate
+    void pace(std::chrono::steady_clock::time_point start, uint64_t sent) const {
+        double dueSeconds = sent / bytesPerSecond;
+        auto due = start + std::chrono::microseconds(static_cast<int64_t>(dueSeconds * 1e6));
+        auto now = std::chrono::steady_clock::now();
+        if (due > now) {
+            Sleep(static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()));
+        }
+    }
+
+    void serveHttpClient(SOCKET client) {
+        DWORD timeoutMs = 5000;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+
+        char request[2048];
+        int received = recv(client, request, sizeof(request) - 1, 0);
+        if (received <= 0) {
+            closesocket(client);
+            return;
+        }
+        request[received] = '\0';
+
+        // GET /<index>
+        size_t index = fixtures.size();
+        if (strncmp(request, "GET /", 5) == 0) {
+            index = static_cast<size_t>(strtoul(request + 5, nullptr, 10));
+        }
+        if (index >= fixtures.size()) {
+            const char* notFound = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            send(client, notFound, static_cast<int>(strlen(notFound)), 0);
+            closesocket(client);
+            return;
+        }
+
+        const char* header = "HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nConnection: close\r\n\r\n";
+        if (send(client, header, static_cast<int>(strlen(header)), 0) <= 0) {
+            closesocket(client);
+            return;
+        }
+
+        // Loop the fixture until the player disconnects
+        const std::vector<uint8_t>& data = fixtures[index];
+        const size_t chunk = TS_PACKET_SIZE * 64;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sent = 0;
+        size_t offset = 0;
+
+        while (running) {
+            size_t length = std::min(chunk, data.size() - offset);
+            int n = send(client, reinterpret_cast<const char*>(data.data() + offset), static_cast<int>(length), 0);
+            if (n <= 0) {
+                break;
+            }
+            sent += n;
+            offset = (offset + n) % data.size();
+            pace(start, sent);
+        }
+        closesocket(client);
+    }
+
+    void acceptLoop() {
+        while (running) {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(listener, &readSet);
+            timeval timeout = {0, 250000};
+            if (select(0, &readSet, nullptr, nullptr, &timeout) <= 0) {
+                continue;
+            }
+
+            SOCKET client = accept(listener, nullptr, nullptr);
+            if (client == INVALID_SOCKET) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.emplace_back(&FixtureServer::serveHttpClient, this, client);
+        }
+    }
+
+    // Unicast to 127.0.0.1:port, 7 TS packets per datagram like a headend
+    void udpLoop(size_t index) {
+        SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET) {
+            return;
+        }
+
+        sockaddr_in target = {};
+        target.sin_family = AF_INET;
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        target.sin_port = htons(static_cast<u_short>(udpBasePort + index));
+
+        const std::vector<uint8_t>& data = fixtures[index];
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sent = 0;
+        size_t offset = 0;
+
+        while (running) {
+            size_t length = std::min(UDP_PAYLOAD, data.size() - offset);
+            sendto(sock, reinterpret_cast<const char*>(data.data() + offset), static_cast<int>(length), 0,
+                   reinterpret_cast<sockaddr*>(&target), sizeof(target));
+            sent += length;
+            offset = (offset + length) % data.size();
+            pace(start, sent);
+        }
+        closesocket(sock);
+    }
+
+public:
+    ~FixtureServer() {
+        stop();
+    }
+
+    bool loadFixture(const std::string& path) {
+        FILE* f = _wfopen(utf8ToWide(path).c_str(), L"rb");
+        if (!f) {
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        uint8_t buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+        fclose(f);
+
+        // Whole packets only so looping never splits one
+        data.resize(data.size() - data.size() % TS_PACKET_SIZE);
+        if (data.empty() || data[0] != 0x47) {
+            return false;
+        }
+        fixtures.push_back(std::move(data));
+        return true;
+    }
+
+    bool start(int bitrateKbps, int udpPort) {
+        bytesPerSecond = bitrateKbps * 1000.0 / 8.0;
+        udpBasePort = udpPort;
+
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET) {
+            return false;
+        }
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        int addrLength = sizeof(addr);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listener, SOMAXCONN) != 0 ||
+            getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addrLength) != 0) {
+            closesocket(listener);
+            listener = INVALID_SOCKET;
+            return false;
+        }
+        httpPort = ntohs(addr.sin_port);
+
+        running = true;
+        threads.emplace_back(&FixtureServer::acceptLoop, this);
+        for (size_t i = 0; i < fixtures.size(); i++) {
+            threads.emplace_back(&FixtureServer::udpLoop, this, i);
+        }
+        return true;
+    }
+
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        threads.clear();
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            for (auto& t : clients) {
+                t.join();
+            }
+            clients.clear();
+        }
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+    }
+
+    size_t fixtureCount() const {
+        return fixtures.size();
+    }
+
+    const std::vector<uint8_t>& fixture(size_t index) const {
+        return fixtures[index];
+    }
+
+    double pacingBytesPerSecond() const {
+        return bytesPerSecond;
+    }
+
+    std::string httpUrl(size_t index) const {
+        return "http://127.0.0.1:" + std::to_string(httpPort) + "/" + std::to_string(index);
+    }
+
+    std::string udpUrl(size_t index) const {
+        return "udp://@127.0.0.1:" + std::to_string(udpBasePort + index);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Process sampling
+// ---------------------------------------------------------------------------
+
+struct ProcessSample {
+    std::chrono::steady_clock::time_point wall;
+    uint64_t cpu100ns = 0;         // User + kernel time
+    uint64_t workingSet = 0;
+    uint64_t peakWorkingSet = 0;
+};
+
+static ProcessSample sampleProcess() {
+    ProcessSample sample;
+    sample.wall = std::chrono::steady_clock::now();
+
+    FILETIME creation, exitTime, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user)) {
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        sample.cpu100ns = k.QuadPart + u.QuadPart;
+    }
+
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        sample.workingSet = counters.WorkingSetSize;
+        sample.peakWorkingSet = counters.PeakWorkingSetSize;
+    }
+    return sample;
+}
+
+// Percent of one core. Includes the fixture server's sender threads, which
+// cost the same on every run and so do not skew comparisons.
+static double cpuPercent(const ProcessSample& from, const ProcessSample& to) {
+    double wallSeconds = std::chrono::duration<double>(to.wall - from.wall).count();
+    if (wallSeconds <= 0) {
+        return 0;
+    }
+    return (to.cpu100ns - from.cpu100ns) / 1e7 / wallSeconds * 100.0;
+}
+
+// vout threads may SendMessage to the parent window, so keep pumping
+static void pumpFor(int ms) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < until) {
+        MSG msg;
+        while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+        Sleep(5);
+    }
+}
+
+static HWND createHiddenWindow() {
+    return CreateWindowExW(0, L"STATIC", L"vlc_player_bench", WS_POPUP, 0, 0, 1280, 720,
+                           nullptr, nullptr, GetModuleHandleW(nullptr), nullptr);
+}
+
+// ---------------------------------------------------------------------------
+// JSON output
+// ---------------------------------------------------------------------------
+
+class JsonWriter {
+private:
+    std::string out;
+    std::vector<bool> hasItems;
+
+    void separator() {
+        if (!hasItems.empty()) {
+            if (hasItems.back()) out += ',';
+            hasItems.back() = true;
+        }
+    }
+
+    void key(const char* name) {
+        separator();
+        out += '"';
+        out += name;
+        out += "\":";
+    }
+
+public:
+    void beginObject(const char* name = nullptr) {
+        if (name) key(name); else separator();
+        out += '{';
+        hasItems.push_back(false);
+    }
+
+    void endObject() {
+        out += '}';
+        hasItems.pop_back();
+    }
+
+    void beginArray(const char* name) {
+        key(name);
+        out += '[';
+        hasItems.push_back(false);
+    }
+
+    void endArray() {
+        out += ']';
+        hasItems.pop_back();
+    }
+
+    void number(const char* name, double value) {
+        if (name) key(name); else separator();
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.6g", value);
+        out += buf;
+    }
+
+    void string(const char* name, const std::string& value) {
+        if (name) key(name); else separator();
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) >= 0x20) out += c;
+            }
+        }
+        out += '"';
+    }
+
+    const std::string& str() const {
+        return out;
+    }
+};
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios
+// ---------------------------------------------------------------------------
+
+// Wait for the first frame of the current zap; returns latency in ms or -1
+static double waitForFirstFrame(VlcPlayer& player, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        int64_t latency = player.getLastZapLatencyNs();
+        if (latency > 0) {
+            return latency / 1e6;
+        }
+        if (player.getState() == "error") {
+            return -1;
+        }
+        pumpFor(5);
+    }
+    return -1;
+}
+
+static void runZapScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < server.fixtureCount(); i++) {
+        urls.push_back(server.httpUrl(i));
+        urls.push_back(server.udpUrl(i));
+    }
+
+    HWND window = createHiddenWindow();
+    VlcPlayer player;
+    json.beginObject("zap");
+    if (!player.initialize(window)) {
+        json.string("error", "initialize failed");
+        json.endObject();
+        DestroyWindow(window);
+        return;
+    }
+
+    ProcessSample before = sampleProcess();
+    std::vector<double> latencies;
+    std::vector<double> httpLatencies;
+    std::vector<double> udpLatencies;
+    int failures = 0;
+    int64_t droppedFrames = 0;
+
+    for (int round = 0; round < config.zapRounds; round++) {
+        for (const auto& url : urls) {
+            if (!player.play(url)) {
+                failures++;
+                continue;
+            }
+
+            double latency = waitForFirstFrame(player, config.zapTimeoutMs);
+            if (latency < 0) {
+                failures++;
+                continue;
+            }
+            latencies.push_back(latency);
+            (url.compare(0, 4, "http") == 0 ? httpLatencies : udpLatencies).push_back(latency);
+
+            pumpFor(config.dwellMs);
+            droppedFrames += player.getStats().lostPictures;
+        }
+    }
+    player.stop();
+    ProcessSample after = sampleProcess();
+
+    auto writeLatencies = [&](const char* name, const std::vector<double>& values) {
+        json.beginObject(name);
+        json.number("count", static_cast<double>(values.size()));
+        json.number("p50", percentile(values, 50));
+        json.number("p90", percentile(values, 90));
+        json.number("p99", percentile(values, 99));
+        json.number("max", values.empty() ? 0 : *std::max_element(values.begin(), values.end()));
+        json.endObject();
+    };
+
+    json.number("zaps", static_cast<double>(latencies.size() + failures));
+    json.number("failures", failures);
+    writeLatencies("latencyMs", latencies);
+    writeLatencies("httpLatencyMs", httpLatencies);
+    writeLatencies("udpLatencyMs", udpLatencies);
+    json.number("framesDropped", static_cast<double>(droppedFrames));
+    json.number("cpuPercent", cpuPercent(before, after));
+    json.number("rssGrowthBytes", static_cast<double>(after.workingSet) - static_cast<double>(before.workingSet));
+    json.endObject();
+
+    DestroyWindow(window);
+}
+
+static void runMultiviewScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    int count = config.streams;
+    std::vector<HWND> windows;
+    std::vector<std::unique_ptr<VlcPlayer>> players;
+
+    json.beginObject("multiview");
+    json.number("streams", count);
+
+    ProcessSample baseline = sampleProcess();
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        windows.push_back(createHiddenWindow());
+        players.emplace_back(new VlcPlayer());
+
+        size_t fixture = i % server.fixtureCount();
+        std::string url = (i % 2 == 0) ? server.httpUrl(fixture) : server.udpUrl(fixture);
+        if (players.back()->initialize(windows.back()) && players.back()->play(url)) {
+            started++;
+        }
+    }
+    json.number("started", started);
+
+    // Let every stream settle before measuring steady state
+    pumpFor(5000);
+    ProcessSample before = sampleProcess();
+    std::vector<int64_t> lostAtStart;
+    for (auto& player : players) {
+        lostAtStart.push_back(player->getStats().lostPictures);
+    }
+
+    uint64_t peakWorkingSet = before.workingSet;
+    for (int second = 0; second < config.durationSeconds; second++) {
+        pumpFor(1000);
+        peakWorkingSet = std::max<uint64_t>(peakWorkingSet, sampleProcess().workingSet);
+    }
+
+    ProcessSample after = sampleProcess();
+    int64_t dropped = 0;
+    int64_t displayed = 0;
+    int frozen = 0;
+    for (size_t i = 0; i < players.size(); i++) {
+        auto stats = players[i]->getStats();
+        dropped += stats.lostPictures - lostAtStart[i];
+        displayed += stats.displayedPictures;
+        if (players[i]->isStreamFrozen()) {
+            frozen++;
+        }
+    }
+
+    double cpu = cpuPercent(before, after);
+    json.number("cpuPercent", cpu);
+    json.number("cpuPercentPerStream", started > 0 ? cpu / started : 0);
+    json.number("rssBaselineBytes", static_cast<double>(baseline.workingSet));
+    json.number("rssGrowthBytes", static_cast<double>(after.workingSet) - static_cast<double>(before.workingSet));
+    json.number("rssPeakBytes", static_cast<double>(peakWorkingSet));
+    json.number("framesDisplayed", static_cast<double>(displayed));
+    json.number("framesDropped", static_cast<double>(dropped));
+    json.number("frozenStreams", frozen);
+    json.endObject();
+
+    for (auto& player : players) {
+        player->stop();
+    }
+    players.clear();
+    for (HWND window : windows) {
+        DestroyWindow(window);
+    }
+}
+
+// False if either recording stayed empty: a throughput of 0 is a broken
+// recording, not a result
+static bool runRecordingScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    wchar_t tempDir[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempDir);
+    std::string path = wideToUtf8(tempDir) + "vlc_player_bench_recording.ts";
+    std::string filteredPath = wideToUtf8(tempDir) + "vlc_player_bench_filtered.ts";
+    DeleteFileW(utf8ToWide(path).c_str());
+    DeleteFileW(utf8ToWide(filteredPath).c_str());
+
+    HWND window = createHiddenWindow();
+    VlcPlayer player;
+    json.beginObject("recording");
+    if (!player.initialize(window) || !player.play(server.httpUrl(0))) {
+        json.string("error", "playback failed");
+        json.endObject();
+        DestroyWindow(window);
+        return false;
+    }
+    waitForFirstFrame(player, config.zapTimeoutMs);
+
+    ProcessSample before = sampleProcess();
+    int64_t lostAtStart = player.getStats().lostPictures;
+    bool recording = player.startRecording(path);
+
+    for (int second = 0; second < config.durationSeconds; second++) {
+        pumpFor(1000);
+        player.getStats();
+    }
+
+    ProcessSample after = sampleProcess();
+    int64_t dropped = player.getStats().lostPictures - lostAtStart;
+    player.stopRecording();
+
+    // The first programme only, through the PID filter's pipe
+    TsPidSelection pids;
+    pids.enabled = true;
+    bool filtered = player.startRecording(filteredPath, pids);
+    pumpFor(5000);
+    player.stopRecording();
+    player.stop();
+    uint64_t filteredBytes = 0;
+    getFileSize(filteredPath, filteredBytes);
+
+    uint64_t bytes = 0;
+    getFileSize(path, bytes);
+    double seconds = std::chrono::duration<double>(after.wall - before.wall).count();
+
+    json.number("started", recording ? 1 : 0);
+    json.number("bytesWritten", static_cast<double>(bytes));
+    if (bytes > 0) {
+        json.number("throughputBytesPerSecond", seconds > 0 ? bytes / seconds : 0);
+    }
+    json.number("cpuPercent", cpuPercent(before, after));
+    json.number("rssGrowthBytes", static_cast<double>(after.workingSet) - static_cast<double>(before.workingSet));
+    json.number("framesDropped", static_cast<double>(dropped));
+    json.number("filteredStarted", filtered ? 1 : 0);
+    json.number("filteredBytesWritten", static_cast<double>(filteredBytes));
+    if (bytes == 0) {
+        json.string("error", "the recording is empty");
+    } else if (filteredBytes == 0) {
+        json.string("error", "the PID-filtered recording is empty");
+    }
+    json.endObject();
+
+    DeleteFileW(utf8ToWide(path).c_str());
+    DeleteFileW(utf8ToWide(filteredPath).c_str());
+    DestroyWindow(window);
+    return bytes > 0 && filteredBytes > 0;
+}
+
+// ---------------------------------------------------------------------------
+// Soak
+// ---------------------------------------------------------------------------
+
+struct SoakSample {
+    double seconds;
+    double workingSet;
+    double privateBytes;
+    double handles;
+    double gdiObjects;
+    double userObjects;
+    double threads;
+    double libvlcObjects;
+};
+
+static double countProcessThreads() {
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+
+    DWORD pid = GetCurrentProcessId();
+    THREADENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+    int count = 0;
+    if (Thread32First(snapshot, &entry)) {
+        do {
+            if (entry.th32OwnerProcessID == pid) count++;
+        } while (Thread32Next(snapshot, &entry));
+    }
+    CloseHandle(snapshot);
+    return count;
+}
+
+static SoakSample takeSoakSample(std::chrono::steady_clock::time_point start) {
+    SoakSample sample = {};
+    sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PROCESS_MEMORY_COUNTERS_EX counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters),
+                             sizeof(counters))) {
+        sample.workingSet = static_cast<double>(counters.WorkingSetSize);
+        sample.privateBytes = static_cast<double>(counters.PrivateUsage);
+    }
+
+    DWORD handles = 0;
+    GetProcessHandleCount(GetCurrentProcess(), &handles);
+    sample.handles = handles;
+    sample.gdiObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+    sample.userObjects = GetGuiResources(GetCurrentProcess(), GR_USEROBJECTS);
+    sample.threads = countProcessThreads();
+
+    auto& metrics = PlayerMetrics::get();
+    sample.libvlcObjects = metrics.libvlcInstances.get() + metrics.libvlcMediaPlayers.get();
+    return sample;
+}
+
+struct SoakTrend {
+    double slopePerHour = 0;
+    double r2 = 0;
+    double growth = 0;          // Fitted growth over the measured window
+    bool leaking = false;
+};
+
+// Least-squares fit after warm-up. A resource leaks if it grows by more than
+// max(floor, relative * starting value) and the fit is clearly linear.
+static SoakTrend fitTrend(const std::vector<SoakSample>& samples, double SoakSample::*field,
+                          double floor, double relative) {
+    SoakTrend trend;
+    size_t first = samples.size() / 5;
+    size_t n = samples.size() - first;
+    if (n < 6) {
+        return trend;
+    }
+
+    double sumX = 0, sumY = 0;
+    for (size_t i = first; i < samples.size(); i++) {
+        sumX += samples[i].seconds;
+        sumY += samples[i].*field;
+    }
+    double meanX = sumX / n;
+    double meanY = sumY / n;
+
+    double sxx = 0, sxy = 0, syy = 0;
+    for (size_t i = first; i < samples.size(); i++) {
+        double dx = samples[i].seconds - meanX;
+        double dy = samples[i].*field - meanY;
+        sxx += dx * dx;
+        sxy += dx * dy;
+        syy += dy * dy;
+    }
+    if (sxx <= 0) {
+        return trend;
+    }
+
+    double slope = sxy / sxx;
+    double span = samples.back().seconds - samples[first].seconds;
+    trend.slopePerHour = slope * 3600.0;
+    trend.r2 = syy > 0 ? (sxy * sxy) / (sxx * syy) : 0;
+    trend.growth = slope * span;
+
+    double limit = std::max(floor, relative * samples[first].*field);
+    trend.leaking = slope > 0 && trend.growth > limit && trend.r2 >= 0.6;
+    return trend;
+}
+
+// Mirrors the app: zap, dwell while polling stats/freeze state like main.ts,
+// record every few channels and recreate the media player now and then.
+static bool runSoakScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    const int RECORD_EVERY = 5;
+    const int RECREATE_EVERY = 25;
+
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < server.fixtureCount(); i++) {
+        urls.push_back(server.httpUrl(i));
+        urls.push_back(server.udpUrl(i));
+    }
+
+    wchar_t tempDir[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempDir);
+    std::string recordingPath = wideToUtf8(tempDir) + "vlc_player_bench_soak.ts";
+
+    HWND window = createHiddenWindow();
+    VlcPlayer player;
+    json.beginObject("soak");
+    if (!player.initialize(window)) {
+        json.string("error", "initialize failed");
+        json.endObject();
+        DestroyWindow(window);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(config.durationSeconds);
+    auto nextSample = start;
+    std::vector<SoakSample> samples;
+    int cycles = 0;
+    int zapFailures = 0;
+
+    auto sampleIfDue = [&]() {
+        if (std::chrono::steady_clock::now() < nextSample) return;
+        samples.push_back(takeSoakSample(start));
+        nextSample += std::chrono::seconds(config.sampleSeconds);
+
+        const SoakSample& s = samples.back();
+        fprintf(stderr, "[soak %6.0fs] ws=%.1fMB private=%.1fMB handles=%.0f threads=%.0f libvlc=%.0f\n",
+                s.seconds, s.workingSet / 1048576.0, s.privateBytes / 1048576.0, s.handles, s.threads,
+                s.libvlcObjects);
+    };
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        const std::string& url = urls[cycles % urls.size()];
+        if (!player.play(url) || waitForFirstFrame(player, config.zapTimeoutMs) < 0) {
+            zapFailures++;
+        }
+
+        bool recording = (cycles % RECORD_EVERY) == RECORD_EVERY - 1 && player.startRecording(recordingPath);
+
+        auto dwellEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.dwellMs);
+        while (std::chrono::steady_clock::now() < dwellEnd) {
+            pumpFor(500);
+            player.updateFrameTime();
+            player.isStreamFrozen();
+            player.getStats();
+            player.getState();
+            sampleIfDue();
+        }
+
+        if (recording) {
+            player.stopRecording();
+        }
+        if ((cycles % RECREATE_EVERY) == RECREATE_EVERY - 1) {
+            player.stop();
+            player.recreateMediaPlayer();
+        }
+        cycles++;
+    }
+    player.stop();
+    DeleteFileW(utf8ToWide(recordingPath).c_str());
+    samples.push_back(takeSoakSample(start));
+
+    struct Check {
+        const char* name;
+        double SoakSample::*field;
+        double floor;
+        double relative;
+    };
+    const Check checks[] = {
+        {"workingSetBytes", &SoakSample::workingSet, 32.0 * 1048576, 0.10},
+        {"privateBytes", &SoakSample::privateBytes, 32.0 * 1048576, 0.10},
+        {"handles", &SoakSample::handles, 64, 0.10},
+        {"gdiObjects", &SoakSample::gdiObjects, 16, 0.10},
+        {"userObjects", &SoakSample::userObjects, 16, 0.10},
+        {"threads", &SoakSample::threads, 8, 0.25},
+        {"libvlcObjects", &SoakSample::libvlcObjects, 2, 0},
+    };
+
+    bool passed = true;
+    json.number("durationSeconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    json.number("cycles", cycles);
+    json.number("zapFailures", zapFailures);
+
+    json.beginObject("trends");
+    for (const Check& check : checks) {
+        SoakTrend trend = fitTrend(samples, check.field, check.floor, check.relative);
+        json.beginObject(check.name);
+        json.number("first", samples.front().*check.field);
+        json.number("last", samples.back().*check.field);
+        json.number("slopePerHour", trend.slopePerHour);
+        json.number("r2", trend.r2);
+        json.number("growth", trend.growth);
+        json.number("leaking", trend.leaking ? 1 : 0);
+        json.endObject();
+
+        if (trend.leaking) {
+            passed = false;
+            fprintf(stderr, "LEAK: %s grows %.1f/hour (r2 %.2f)\n", check.name, trend.slopePerHour, trend.r2);
+        }
+    }
+    json.endObject();
+
+    json.beginArray("samples");
+    for (const SoakSample& s : samples) {
+        json.beginObject();
+        json.number("seconds", s.seconds);
+        json.number("workingSetBytes", s.workingSet);
+        json.number("privateBytes", s.privateBytes);
+        json.number("handles", s.handles);
+        json.number("gdiObjects", s.gdiObjects);
+        json.number("userObjects", s.userObjects);
+        json.number("threads", s.threads);
+        json.number("libvlcObjects", s.libvlcObjects);
+        json.endObject();
+    }
+    json.endArray();
+
+    json.number("passed", passed ? 1 : 0);
+    json.endObject();
+
+    DestroyWindow(window);
+    return passed;
+}
+
+// ---------------------------------------------------------------------------
+// Multicast input
+// ---------------------------------------------------------------------------
+
+struct RtpSenderCounts {
+    uint64_t sent = 0;
+    uint64_t dropped = 0;
+    uint64_t swapped = 0;
+};
+
+// RTP/MPEG-TS to 127.0.0.1:port at the fixture rate. Every DROP_EVERY-th
+// packet is never sent and every SWAP_EVERY-th pair goes out in reverse
+// order, so the receiver's counters can be checked against these.
+static void sendRtp(const std::vector<uint8_t>& data, double bytesPerSecond, u_short port,
+                    const std::atomic<bool>& running, RtpSenderCounts& counts) {
+    const uint64_t DROP_EVERY = 1000;
+    const uint64_t SWAP_EVERY = 250;
+    SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        return;
+    }
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    target.sin_port = htons(port);
+
+    auto sendPacket = [&](const uint8_t* packet, size_t length) {
+        sendto(sock, reinterpret_cast<const char*>(packet), static_cast<int>(length), 0,
+               reinterpret_cast<sockaddr*>(&target), sizeof(target));
+        counts.sent++;
+    };
+
+    uint8_t held[12 + UDP_PAYLOAD];
+    size_t heldLength = 0;
+    uint16_t sequence = 0;
+    uint64_t sentBytes = 0;
+    size_t offset = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (running) {
+        size_t length = std::min(UDP_PAYLOAD, data.size() - offset);
+        uint8_t packet[12 + UDP_PAYLOAD];
+        uint32_t timestamp = static_cast<uint32_t>(sentBytes / bytesPerSecond * 90000.0);
+        packet[0] = 0x80;
+        packet[1] = 33;                         // MP2T
+        packet[2] = static_cast<uint8_t>(sequence >> 8);
+        packet[3] = static_cast<uint8_t>(sequence);
+        for (int i = 0; i < 4; i++) packet[4 + i] = static_cast<uint8_t>(timestamp >> (24 - 8 * i));
+        memset(packet + 8, 0, 4);
+        memcpy(packet + 12, data.data() + offset, length);
+        uint64_t index = sequence + 1;          // Never 0 for the first packet
+        sequence++;
+
+        if (heldLength > 0) {
+            sendPacket(packet, 12 + length);
+            sendPacket(held, heldLength);
+            heldLength = 0;
+        } else if (index % DROP_EVERY == 0) {
+            counts.dropped++;
+        } else if (index % SWAP_EVERY == 0) {
+            memcpy(held, packet, 12 + length);
+            heldLength = 12 + length;
+            counts.swapped++;
+        } else {
+            sendPacket(packet, 12 + length);
+        }
+
+        sentBytes += length;
+        offset = (offset + length) % data.size();
+        auto due = start + std::chrono::microseconds(static_cast<int64_t>(sentBytes / bytesPerSecond * 1e6));
+        auto now = std::chrono::steady_clock::now();
+        if (due > now) {
+            Sleep(static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()));
+        }
+    }
+    closesocket(sock);
+}
+
+// The input alone, without libvlc: one thread per stream stands in for the
+// demuxer and drains read() as fast as it can
+static void runMulticastScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    int count = config.streams;
+    json.beginObject("multicast");
+    json.number("streams", count);
+
+    std::vector<std::unique_ptr<MulticastInput>> inputs;
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        std::string url = "rtp://@127.0.0.1:" + std::to_string(config.udpBasePort + 100 + i);
+        inputs.emplace_back(new MulticastInput(url));
+        std::string error;
+        if (inputs.back()->start(error)) {
+            started++;
+        } else {
+            fprintf(stderr, "Multicast input %s: %s\n", url.c_str(), error.c_str());
+        }
+    }
+    json.number("started", started);
+
+    std::atomic<bool> running{true};
+    std::vector<RtpSenderCounts> counts(count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back([&, i] {
+            uint8_t buffer[64 * 1024];
+            while (inputs[i]->read(buffer, sizeof(buffer)) > 0) continue;
+        });
+        threads.emplace_back(sendRtp, std::cref(server.fixture(i % server.fixtureCount())),
+                             server.pacingBytesPerSecond(), static_cast<u_short>(config.udpBasePort + 100 + i),
+                             std::cref(running), std::ref(counts[i]));
+    }
+
+    Sleep(1000);
+    ProcessSample before = sampleProcess();
+    Sleep(config.durationSeconds * 1000);
+    ProcessSample after = sampleProcess();
+
+    running = false;
+    Sleep(500);                                 // Gaps still open are given up on
+    std::vector<MulticastStats> stats;
+    for (auto& input : inputs) {
+        stats.push_back(input->stats());
+        input->stop();
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    uint64_t sent = 0, dropped = 0, swapped = 0;
+    MulticastStats total;
+    for (int i = 0; i < count; i++) {
+        sent += counts[i].sent;
+        dropped += counts[i].dropped;
+        swapped += counts[i].swapped;
+        total.datagrams += stats[i].datagrams;
+        total.bytes += stats[i].bytes;
+        total.batches += stats[i].batches;
+        total.lost += stats[i].lost;
+        total.reordered += stats[i].reordered;
+        total.late += stats[i].late;
+        total.overflows += stats[i].overflows;
+        total.jitterMs = std::max(total.jitterMs, stats[i].jitterMs);
+    }
+
+    double cpu = cpuPercent(before, after);
+    json.number("cpuPercent", cpu);
+    json.number("cpuPercentPerStream", started > 0 ? cpu / started : 0);
+    json.number("datagramsSent", static_cast<double>(sent));
+    json.number("datagramsReceived", static_cast<double>(total.datagrams));
+    json.number("bytesDelivered", static_cast<double>(total.bytes));
+    json.number("averageBatch", total.batches > 0 ? static_cast<double>(total.datagrams) / total.batches : 0);
+    json.number("droppedBySender", static_cast<double>(dropped));
+    json.number("lost", static_cast<double>(total.lost));
+    json.number("swappedBySender", static_cast<double>(swapped));
+    json.number("reordered", static_cast<double>(total.reordered));
+    json.number("late", static_cast<double>(total.late));
+    json.number("overflows", static_cast<double>(total.overflows));
+    json.number("maxJitterMs", total.jitterMs);
+    json.number("socketBufferBytes", stats.empty() ? 0 : stats[0].socketBuffer);
+    json.endObject();
+}
+
+// ---------------------------------------------------------------------------
+// Dead URLs
+// ---------------------------------------------------------------------------
+
+static void runDeadUrlScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    HWND window = createHiddenWindow();
+    VlcPlayer player;
+    json.beginObject("deadurl");
+    if (!player.initialize(window)) {
+        json.string("error", "initialize failed");
+        json.endObject();
+        DestroyWindow(window);
+        return;
+    }
+
+    // The open outcome, as the command queue would see it
+    std::mutex outcomeMutex;
+    std::condition_variable outcomeChanged;
+    int outcome = 0;                // 0 pending, 1 opened, -1 failed
+    player.setOpenListener([&](bool opened) {
+        std::lock_guard<std::mutex> lock(outcomeMutex);
+        outcome = opened ? 1 : -1;
+        outcomeChanged.notify_all();
+    });
+
+    struct Case {
+        const char* name;
+        std::string url;
+    };
+    const Case cases[] = {
+        {"notFound", server.httpUrl(server.fixtureCount())},
+        {"refused", "http://127.0.0.1:1/stream.ts"},
+    };
+    for (const Case& deadCase : cases) {
+        std::vector<double> detectMs;
+        int missed = 0;
+        for (int round = 0; round < config.zapRounds; round++) {
+            {
+                std::lock_guard<std::mutex> lock(outcomeMutex);
+                outcome = 0;
+            }
+            auto started = std::chrono::steady_clock::now();
+            if (!player.play(deadCase.url)) {
+                detectMs.push_back(0);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(outcomeMutex);
+            outcomeChanged.wait_for(lock, std::chrono::milliseconds(config.zapTimeoutMs), [&] { return outcome != 0; });
+            if (outcome == -1) {
+                detectMs.push_back(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+            } else {
+                missed++;
+            }
+        }
+        json.beginObject(deadCase.name);
+        json.number("detected", static_cast<double>(detectMs.size()));
+        json.number("missed", missed);
+        json.number("p50", percentile(detectMs, 50));
+        json.number("max", detectMs.empty() ? 0 : *std::max_element(detectMs.begin(), detectMs.end()));
+        json.endObject();
+    }
+    player.stop();
+    json.endObject();
+    DestroyWindow(window);
+}
+
+// ---------------------------------------------------------------------------
+// Stream relay
+// ---------------------------------------------------------------------------
+
+// Reads the relay until `running` clears; a slow client takes 4 KB every
+// 50 ms through a small receive buffer, so TCP stalls it for real
+static void readRelay(int port, bool slow, const std::atomic<bool>& running, uint64_t& received) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        return;
+    }
+    DWORD timeoutMs = 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+    if (slow) {
+        int bufferSize = 16 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+    }
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    target.sin_port = htons(static_cast<u_short>(port));
+    const char* request = "GET /bench.ts HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    if (connect(sock, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0 ||
+        send(sock, request, static_cast<int>(strlen(request)), 0) <= 0) {
+        closesocket(sock);
+        return;
+    }
+
+    std::vector<char> buffer(slow ? 4096 : 65536);
+    while (running) {
+        int n = recv(sock, buffer.data(), static_cast<int>(buffer.size()), 0);
+        if (n == 0 || (n < 0 && WSAGetLastError() != WSAETIMEDOUT)) {
+            break;
+        }
+        if (n > 0) {
+            received += n;
+        }
+        if (slow) {
+            Sleep(50);
+        }
+    }
+    closesocket(sock);
+}
+
+static void runRelayScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    json.beginObject("relay");
+    json.number("clients", config.streams);
+
+    StreamRelay& relay = StreamRelay::instance();
+    std::string error;
+    int port = relay.start(0, false, "bench", error);
+    if (port == 0) {
+        json.string("error", error);
+        json.endObject();
+        return;
+    }
+    relay.setChannel(server.httpUrl(0));
+
+    std::atomic<bool> running{true};
+    std::vector<uint64_t> received(config.streams, 0);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < config.streams; i++) {
+        clients.emplace_back(readRelay, port, i == 0, std::cref(running), std::ref(received[i]));
+        if (i == 0) {
+            Sleep(500);             // Connected first, so first in the relay's client list
+        }
+    }
+
+    pumpFor(5000);
+    uint64_t upstreamBefore = relay.stats().upstreamBytes;
+    ProcessSample before = sampleProcess();
+    pumpFor(config.durationSeconds * 1000);
+    ProcessSample after = sampleProcess();
+    StreamRelayStats stats = relay.stats();
+
+    running = false;
+    relay.stop();
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(after.wall - before.wall).count();
+    uint64_t slowSkipped = 0;
+    uint64_t fastSkipped = 0;
+    for (size_t i = 0; i < stats.clients.size(); i++) {
+        (i == 0 ? slowSkipped : fastSkipped) += stats.clients[i].skippedBytes;
+    }
+    uint64_t fastReceived = 0;
+    for (int i = 1; i < config.streams; i++) {
+        fastReceived += received[i];
+    }
+
+    json.number("cpuPercent", cpuPercent(before, after));
+    json.number("upstreamKbps", seconds > 0 ? (stats.upstreamBytes - upstreamBefore) * 8 / 1000.0 / seconds : 0);
+    json.number("targetKbps", config.bitrateKbps);
+    json.number("upstreamRestarts", static_cast<double>(stats.upstreamRestarts));
+    json.number("connectedClients", static_cast<double>(stats.clients.size()));
+    json.number("fastClientBytes", static_cast<double>(fastReceived));
+    json.number("fastClientSkippedBytes", static_cast<double>(fastSkipped));
+    json.number("slowClientBytes", static_cast<double>(received[0]));
+    json.number("slowClientSkippedBytes", static_cast<double>(slowSkipped));
+    json.endObject();
+}
+
+// ---------------------------------------------------------------------------
+// Recording server
+// ---------------------------------------------------------------------------
+
+// Fetches random 1 MB ranges of `expected` (served as /bench/<name>) until
+// `running` clears, comparing each body against it
+static void readRanges(int port, const std::string& name, const std::vector<uint8_t>& expected, unsigned seed,
+                       const std::atomic<bool>& running, uint64_t& received, int& mismatches) {
+    const size_t rangeBytes = std::min<size_t>(1 << 20, expected.size());
+    std::vector<char> buffer(65536);
+    srand(seed);
+    while (running) {
+        SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == INVALID_SOCKET) {
+            return;
+        }
+        sockaddr_in target = {};
+        target.sin_family = AF_INET;
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        target.sin_port = htons(static_cast<u_short>(port));
+        size_t start = (static_cast<size_t>(rand()) * 4096) % (expected.size() - rangeBytes + 1);
+        std::string request = "GET /bench/" + name + " HTTP/1.1\r\nHost: 127.0.0.1\r\nRange: bytes=" +
+                              std::to_string(start) + "-" + std::to_string(start + rangeBytes - 1) + "\r\n\r\n";
+        if (connect(sock, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0 ||
+            send(sock, request.data(), static_cast<int>(request.size()), 0) <= 0) {
+            closesocket(sock);
+            return;
+        }
+
+        std::string response;
+        int n;
+        while ((n = recv(sock, buffer.data(), static_cast<int>(buffer.size()), 0)) > 0) {
+            response.append(buffer.data(), n);
+        }
+        closesocket(sock);
+        size_t body = response.find("\r\n\r\n");
+        if (response.compare(0, 12, "HTTP/1.1 206") != 0 || body == std::string::npos ||
+            response.size() - body - 4 != rangeBytes ||
+            memcmp(response.data() + body + 4, expected.data() + start, rangeBytes) != 0) {
+            mismatches++;
+            continue;
+        }
+        received += rangeBytes;
+    }
+}
+
+static void runRecordingsScenario(const BenchConfig& config, FixtureServer& server, JsonWriter& json) {
+    json.beginObject("recordings");
+    json.number("clients", config.streams);
+
+    wchar_t tempDir[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempDir);
+    std::string root = wideToUtf8(tempDir) + "vlc_player_bench_recordings";
+    std::string name = "bench.ts";
+    CreateDirectoryW(utf8ToWide(root).c_str(), nullptr);
+    const std::vector<uint8_t>& expected = server.fixture(0);
+    FILE* file = _wfopen(utf8ToWide(root + "\\" + name).c_str(), L"wb");
+    bool written = file && fwrite(expected.data(), 1, expected.size(), file) == expected.size();
+    if (file) {
+        fclose(file);
+    }
+
+    RecordingServer& recordings = RecordingServer::instance();
+    std::string error;
+    int port = written ? recordings.start(root, 0, false, "bench", error) : 0;
+    if (port == 0) {
+        json.string("error", written ? error : "cannot write the recording");
+        json.endObject();
+        return;
+    }
+
+    std::atomic<bool> running{true};
+    std::vector<uint64_t> received(config.streams, 0);
+    std::vector<int> mismatches(config.streams, 0);
+    std::vector<std::thread> clients;
+    ProcessSample before = sampleProcess();
+    for (int i = 0; i < config.streams; i++) {
+        clients.emplace_back(readRanges, port, name, std::cref(expected), static_cast<unsigned>(i + 1),
+                             std::cref(running), std::ref(received[i]), std::ref(mismatches[i]));
+    }
+    pumpFor(config.durationSeconds * 1000);
+    running = false;
+    for (auto& t : clients) {
+        t.join();
+    }
+    ProcessSample after = sampleProcess();
+    RecordingServerStats stats = recordings.stats();
+    recordings.stop();
+
+    double seconds = std::chrono::duration<double>(after.wall - before.wall).count();
+    uint64_t total = 0;
+    int badResponses = 0;
+    for (int i = 0; i < config.streams; i++) {
+        total += received[i];
+        badResponses += mismatches[i];
+    }
+    json.number("requests", static_cast<double>(stats.requests));
+    json.number("badResponses", badResponses);
+    json.number("throughputBytesPerSecond", seconds > 0 ? total / seconds : 0);
+    json.number("cpuPercent", cpuPercent(before, after));
+    json.endObject();
+
+    DeleteFileW(utf8ToWide(root + "\\" + name).c_str());
+    RemoveDirectoryW(utf8ToWide(root).c_str());
+}
+
+// ---------------------------------------------------------------------------
+
+static void printUsage() {
+    fprintf(stderr,
+            "usage: vlc_player_bench --fixture <file.ts> [--fixture ...]\n"
+            "  --scenarios zap,multiview,recording,deadurl,multicast,relay,recordings[,soak]\n"
+            "  --bitrate <kbps>      pacing rate (default 4500)\n"
+            "  --zap-rounds <n>      passes over the zap list and dead URLs (default 3)\n"
+            "  --dwell-ms <ms>       time on each channel (default 2000)\n"
+            "  --streams <n>         multiview players, multicast inputs, relay/recordings clients (default 4)\n"
+            "  --duration <s>        multiview/recording/multicast/relay/recordings/soak run time (default 30)\n"
+            "  --sample-seconds <s>  soak sampling interval (default 60)\n"
+            "  --udp-port <port>     first UDP port (default 51234; multicast uses +100)\n"
+            "  --out <file.json>     write results to a file instead of stdout\n");
+}
+
+static bool parseArgs(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--fixture") {
+            config.fixtures.push_back(value);
+        } else if (arg == "--scenarios") {
+            config.scenarios.clear();
+            size_t start = 0;
+            while (start <= value.size()) {
+                size_t end = value.find(',', start);
+                if (end == std::string::npos) end = value.size();
+                if (end > start) config.scenarios.push_back(value.substr(start, end - start));
+                start = end + 1;
+            }
+        } else if (arg == "--bitrate") {
+            config.bitrateKbps = atoi(value.c_str());
+        } else if (arg == "--zap-rounds") {
+            config.zapRounds = atoi(value.c_str());
+        } else if (arg == "--dwell-ms") {
+            config.dwellMs = atoi(value.c_str());
+        } else if (arg == "--streams") {
+            config.streams = atoi(value.c_str());
+        } else if (arg == "--duration") {
+            config.durationSeconds = atoi(value.c_str());
+        } else if (arg == "--sample-seconds") {
+            config.sampleSeconds = atoi(value.c_str());
+        } else if (arg == "--udp-port") {
+            config.udpBasePort = atoi(value.c_str());
+        } else if (arg == "--out") {
+            config.outPath = value;
+        } else {
+            return false;
+        }
+    }
+    return !config.fixtures.empty() && config.bitrateKbps > 0 && config.streams > 0 && config.sampleSeconds > 0;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage();
+        return 2;
+    }
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed\n");
+        return 1;
+    }
+    timeBeginPeriod(1);
+
+    FixtureServer server;
+    for (const auto& fixture : config.fixtures) {
+        if (!server.loadFixture(fixture)) {
+            fprintf(stderr, "Cannot load TS fixture: %s\n", fixture.c_str());
+            return 1;
+        }
+    }
+    if (!server.start(config.bitrateKbps, config.udpBasePort)) {
+        fprintf(stderr, "Cannot start fixture server\n");
+        return 1;
+    }
+
+    JsonWriter json;
+    json.beginObject();
+    json.number("version", 1);
+    json.number("timestamp", static_cast<double>(time(nullptr)));
+    json.beginObject("config");
+    json.number("fixtures", static_cast<double>(config.fixtures.size()));
+    json.number("bitrateKbps", config.bitrateKbps);
+    json.number("zapRounds", config.zapRounds);
+    json.number("dwellMs", config.dwellMs);
+    json.number("streams", config.streams);
+    json.number("durationSeconds", config.durationSeconds);
+    json.endObject();
+
+    bool passed = true;
+    json.beginObject("scenarios");
+    for (const auto& scenario : config.scenarios) {
+        fprintf(stderr, "Running %s...\n", scenario.c_str());
+        if (scenario == "zap") {
+            runZapScenario(config, server, json);
+        } else if (scenario == "multiview") {
+            runMultiviewScenario(config, server, json);
+        } else if (scenario == "recording") {
+            passed = runRecordingScenario(config, server, json) && passed;
+        } else if (scenario == "deadurl") {
+            runDeadUrlScenario(config, server, json);
+        } else if (scenario == "multicast") {
+            runMulticastScenario(config, server, json);
+        } else if (scenario == "relay") {
+            runRelayScenario(config, server, json);
+        } else if (scenario == "recordings") {
+            runRecordingsScenario(config, server, json);
+        } else if (scenario == "soak") {
+            passed = runSoakScenario(config, server, json) && passed;
+        } else {
+            fprintf(stderr, "Unknown scenario: %s\n", scenario.c_str());
+        }
+    }
+    json.endObject();
+
+    json.beginObject("metrics");
+    json.string("prometheus", MetricsRegistry::instance().render());
+    json.endObject();
+    json.endObject();
+
+    server.stop();
+    timeEndPeriod(1);
+    WSACleanup();
+
+    if (config.outPath.empty()) {
+        printf("%s\n", json.str().c_str());
+    } else {
+        FILE* f = _wfopen(utf8ToWide(config.outPath).c_str(), L"wb");
+        if (!f) {
+            fprintf(stderr, "Cannot write %s\n", config.outPath.c_str());
+            return 1;
+        }
+        fwrite(json.str().data(), 1, json.str().size(), f);
+        fclose(f);
+    }
+    return passed ? 0 : 3;
+}
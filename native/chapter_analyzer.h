@@ -0,0 +1,389 @@
+#pragma once
+
+// Offline chapter detection for finished recordings: black frames and
+// silence, and breaks where the two coincide (the usual shape of a cut to
+// adverts), stored as markers in the recording's seek index.
+//
+// Each recording is decoded by its own libvlc input through the smem sout
+// module with time sync off, so it runs as fast as one core decodes rather
+// than at playback speed. Only keyframes are decoded - breaks are almost
+// always cut on one - and only their luma plane is read: mean and variance
+// per frame, summed 16 pixels at a time in SSE2. Audio is downmixed to mono
+// at 16 kHz and reduced to RMS over WINDOW_MS windows. Recordings are
+// spread over a few threads, each running one input with a single decoder
+// thread.
+
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shared_libvlc.h"
+#include "ts_scanner.h"
+#include "win_util.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CHAPTER_ANALYZER_SSE2 1
+#endif
+
+struct ChapterReport {
+    std::string path;
+    bool ok = false;
+    std::string error;
+    std::vector<TsSeekIndex::Marker> markers;
+    uint32_t keyframes = 0;
+    uint32_t blackFrames = 0;
+    double mediaMs = 0;             // Recording time covered
+    double elapsedMs = 0;
+};
+
+class ChapterAnalyzer {
+private:
+    static constexpr int AUDIO_RATE = 16000;
+    static constexpr int WINDOW_MS = 100;
+    static constexpr double BLACK_MEAN = 32;           // Studio-range black is 16
+    static constexpr double BLACK_STDDEV = 10;         // Logos and noise keep it above 0
+    static constexpr double SILENCE_DBFS = -50;
+    static constexpr uint32_t MIN_SILENCE_MS = 300;
+    static constexpr uint32_t BREAK_SLACK_MS = 1000;   // Black and silence this close are one break
+    static constexpr int STALL_TIMEOUT_MS = 30000;
+    static constexpr unsigned MAX_THREADS = 4;
+
+    struct LumaSample {
+        int64_t pts;
+        double mean;
+        double variance;
+    };
+
+    struct AudioWindow {
+        int64_t pts;
+        double dbfs;
+    };
+
+    // One input's state; the video and audio callbacks come from different
+    // decoder threads and touch only their own half
+    struct Run {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool ended = false;
+        bool failed = false;
+        std::chrono::steady_clock::time_point lastData = std::chrono::steady_clock::now();
+
+        std::vector<uint8_t> videoBuffer;
+        std::vector<LumaSample> luma;
+
+        std::vector<uint8_t> audioBuffer;
+        std::vector<AudioWindow> windows;
+        uint64_t squareSum = 0;         // Of the window being filled
+        uint32_t windowSamples = 0;
+        int64_t windowPts = -1;
+
+        void touch() {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastData = std::chrono::steady_clock::now();
+        }
+    };
+
+    // Sum and sum of squares of width x height bytes
+    static void lumaStats(const uint8_t* plane, unsigned width, unsigned height, uint64_t& sum, uint64_t& squares) {
+        sum = 0;
+        squares = 0;
+        for (unsigned y = 0; y < height; y++) {
+            const uint8_t* row = plane + static_cast<size_t>(y) * width;
+            unsigned x = 0;
+#ifdef CHAPTER_ANALYZER_SSE2
+            // Squares in 32-bit lanes, flushed per row: 4096 pixels stay
+            // well under 2^32
+            const __m128i zero = _mm_setzero_si128();
+            __m128i rowSum = _mm_setzero_si128();
+            __m128i rowSquares = _mm_setzero_si128();
+            for (; x + 16 <= width; x += 16) {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+                rowSum = _mm_add_epi64(rowSum, _mm_sad_epu8(pixels, zero));
+                __m128i low = _mm_unpacklo_epi8(pixels, zero);
+                __m128i high = _mm_unpackhi_epi8(pixels, zero);
+                rowSquares = _mm_add_epi32(rowSquares, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+            }
+            alignas(16) uint64_t sums[2];
+            alignas(16) uint32_t squareLanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(sums), rowSum);
+            _mm_store_si128(reinterpret_cast<__m128i*>(squareLanes), rowSquares);
+            sum += sums[0] + sums[1];
+            squares += static_cast<uint64_t>(squareLanes[0]) + squareLanes[1] + squareLanes[2] + squareLanes[3];
+#endif
+            for (; x < width; x++) {
+                sum += row[x];
+                squares += static_cast<uint32_t>(row[x]) * row[x];
+            }
+        }
+    }
+
+    // Sum of squares of 16-bit samples
+    static uint64_t sampleSquares(const int16_t* samples, size_t count) {
+        uint64_t total = 0;
+        size_t i = 0;
+#ifdef CHAPTER_ANALYZER_SSE2
+        // madd pairs stay under 2^31; a 32-bit lane takes 16 of them safely
+        while (i + 8 <= count) {
+            __m128i lanes = _mm_setzero_si128();
+            for (int n = 0; n < 16 && i + 8 <= count; n++, i += 8) {
+                __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+                __m128i squares = _mm_madd_epi16(s, s);
+                // Unsigned halves so 2 * 32768^2 does not wrap negative
+                lanes = _mm_add_epi64(lanes, _mm_unpacklo_epi32(squares, _mm_setzero_si128()));
+                lanes = _mm_add_epi64(lanes, _mm_unpackhi_epi32(squares, _mm_setzero_si128()));
+            }
+            alignas(16) uint64_t parts[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(parts), lanes);
+            total += parts[0] + parts[1];
+        }
+#endif
+        for (; i < count; i++) total += static_cast<uint64_t>(static_cast<int32_t>(samples[i]) * samples[i]);
+        return total;
+    }
+
+    // smem callbacks (addresses passed in the sout chain)
+    static void videoPrerender(void* data, uint8_t** buffer, size_t size) {
+        Run* run = static_cast<Run*>(data);
+        if (run->videoBuffer.size() < size) run->videoBuffer.resize(size);
+        *buffer = run->videoBuffer.data();
+    }
+
+    static void videoPostrender(void* data, uint8_t* buffer, int width, int height, int, size_t, int64_t pts) {
+        Run* run = static_cast<Run*>(data);
+        if (width <= 0 || height <= 0) return;
+        uint64_t sum, squares;
+        lumaStats(buffer, static_cast<unsigned>(width), static_cast<unsigned>(height), sum, squares);
+        double pixels = static_cast<double>(width) * height;
+        double mean = sum / pixels;
+        run->luma.push_back({pts, mean, std::max(0.0, squares / pixels - mean * mean)});
+        run->touch();
+    }
+
+    static void audioPrerender(void* data, uint8_t** buffer, size_t size) {
+        Run* run = static_cast<Run*>(data);
+        if (run->audioBuffer.size() < size) run->audioBuffer.resize(size);
+        *buffer = run->audioBuffer.data();
+    }
+
+    static void audioPostrender(void* data, uint8_t* buffer, unsigned channels, unsigned rate, unsigned samples,
+                                unsigned bits, size_t, int64_t pts) {
+        Run* run = static_cast<Run*>(data);
+        if (bits != 16 || channels == 0 || rate == 0) return;
+        const int16_t* pcm = reinterpret_cast<const int16_t*>(buffer);
+        const uint32_t perWindow = rate * WINDOW_MS / 1000 * channels;
+        size_t total = static_cast<size_t>(samples) * channels;
+        size_t done = 0;
+        while (done < total) {
+            if (run->windowSamples == 0) {
+                run->windowPts = pts + static_cast<int64_t>(done / channels) * 1000000 / rate;
+            }
+            size_t take = std::min<size_t>(total - done, perWindow - run->windowSamples);
+            run->squareSum += sampleSquares(pcm + done, take);
+            run->windowSamples += static_cast<uint32_t>(take);
+            done += take;
+            if (run->windowSamples == perWindow) {
+                double rms = std::sqrt(static_cast<double>(run->squareSum) / perWindow) / 32768.0;
+                run->windows.push_back({run->windowPts, rms > 0 ? 20 * std::log10(rms) : -120.0});
+                run->squareSum = 0;
+                run->windowSamples = 0;
+            }
+        }
+        run->touch();
+    }
+
+    static void onEvent(const libvlc_event_t* event, void* data) {
+        Run* run = static_cast<Run*>(data);
+        std::lock_guard<std::mutex> lock(run->mutex);
+        if (event->type == libvlc_MediaPlayerEncounteredError) run->failed = true;
+        run->ended = true;
+        run->changed.notify_all();
+    }
+
+    static std::string address(const void* pointer) {
+        return std::to_string(reinterpret_cast<intptr_t>(pointer));
+    }
+
+    static uint32_t toMs(int64_t pts, int64_t origin) {
+        return static_cast<uint32_t>(std::max<int64_t>(0, (pts - origin) / 1000));
+    }
+
+    // Black runs, silences and the breaks where they meet, in time order
+    static std::vector<TsSeekIndex::Marker> findMarkers(const Run& run, ChapterReport& report) {
+        using Marker = TsSeekIndex::Marker;
+        int64_t origin = run.luma.empty() ? (run.windows.empty() ? 0 : run.windows.front().pts) : run.luma.front().pts;
+
+        std::vector<Marker> black;
+        bool previousBlack = false;
+        for (const LumaSample& sample : run.luma) {
+            bool isBlack = sample.mean <= BLACK_MEAN && std::sqrt(sample.variance) <= BLACK_STDDEV;
+            if (isBlack) {
+                report.blackFrames++;
+                uint32_t ms = toMs(sample.pts, origin);
+                // Consecutive black keyframes are one run
+                if (previousBlack) {
+                    black.back().endMs = ms;
+                } else {
+                    black.push_back({ms, ms, TsSeekIndex::MARKER_BLACK});
+                }
+            }
+            previousBlack = isBlack;
+        }
+
+        std::vector<Marker> silence;
+        uint32_t windowMs = static_cast<uint32_t>(WINDOW_MS);
+        for (const AudioWindow& window : run.windows) {
+            if (window.dbfs > SILENCE_DBFS) continue;
+            uint32_t ms = toMs(window.pts, origin);
+            if (!silence.empty() && ms <= silence.back().endMs + windowMs / 2) {
+                silence.back().endMs = ms + windowMs;
+            } else {
+                silence.push_back({ms, ms + windowMs, TsSeekIndex::MARKER_SILENCE});
+            }
+        }
+        silence.erase(std::remove_if(silence.begin(), silence.end(), [](const Marker& marker) {
+            return marker.endMs - marker.startMs < MIN_SILENCE_MS;
+        }), silence.end());
+
+        // A black run next to a silence makes both one break
+        std::vector<Marker> markers;
+        std::vector<bool> silenceUsed(silence.size(), false);
+        size_t first = 0;
+        for (Marker span : black) {
+            while (first < silence.size() && silence[first].endMs + BREAK_SLACK_MS < span.startMs) first++;
+            for (size_t j = first; j < silence.size() && silence[j].startMs <= span.endMs + BREAK_SLACK_MS; j++) {
+                span.kind = TsSeekIndex::MARKER_BREAK;
+                span.startMs = std::min(span.startMs, silence[j].startMs);
+                span.endMs = std::max(span.endMs, silence[j].endMs);
+                silenceUsed[j] = true;
+            }
+            markers.push_back(span);
+        }
+        for (size_t j = 0; j < silence.size(); j++) {
+            if (!silenceUsed[j]) markers.push_back(silence[j]);
+        }
+        std::sort(markers.begin(), markers.end(), [](const Marker& a, const Marker& b) {
+            return a.startMs < b.startMs;
+        });
+        if (markers.size() > TsSeekIndex::MAX_MARKERS) markers.resize(TsSeekIndex::MAX_MARKERS);
+
+        int64_t last = std::max(run.luma.empty() ? origin : run.luma.back().pts,
+                                run.windows.empty() ? origin : run.windows.back().pts);
+        report.mediaMs = (last - origin) / 1000.0;
+        report.keyframes = static_cast<uint32_t>(run.luma.size());
+        return markers;
+    }
+
+public:
+    // Analyses one recording and writes its markers into "<path>.idx" (which
+    // a scan must have written). Blocks for the length of the decode.
+    static ChapterReport analyze(const std::string& path, const std::atomic<bool>& cancelled) {
+        ChapterReport report;
+        report.path = path;
+        auto started = std::chrono::steady_clock::now();
+
+        TsSeekIndex index;
+        if (!TsScanner::loadIndex(path, index)) {
+            report.error = "No seek index";
+            return report;
+        }
+        std::shared_ptr<libvlc_instance_t> vlc = SharedLibvlc::instance().acquire();
+        if (!vlc) {
+            report.error = "libvlc unavailable";
+            return report;
+        }
+
+        std::unique_ptr<Run> run(new Run());
+        std::string chain = ":sout=#transcode{vcodec=I420,acodec=s16l,channels=1,samplerate=" +
+            std::to_string(AUDIO_RATE) + ",threads=1}:smem{time-sync=false" +
+            ",video-prerender-callback=" + address(reinterpret_cast<void*>(&ChapterAnalyzer::videoPrerender)) +
+            ",video-postrender-callback=" + address(reinterpret_cast<void*>(&ChapterAnalyzer::videoPostrender)) +
+            ",audio-prerender-callback=" + address(reinterpret_cast<void*>(&ChapterAnalyzer::audioPrerender)) +
+            ",audio-postrender-callback=" + address(reinterpret_cast<void*>(&ChapterAnalyzer::audioPostrender)) +
+            ",video-data=" + address(run.get()) + ",audio-data=" + address(run.get()) + "}";
+
+        libvlc_media_t* media = libvlc_media_new_path(vlc.get(), path.c_str());
+        if (!media) {
+            report.error = "Cannot open recording";
+            return report;
+        }
+        libvlc_media_add_option(media, chain.c_str());
+        libvlc_media_add_option(media, ":avcodec-skip-frame=3");
+        libvlc_media_add_option(media, ":avcodec-hw=none");
+        libvlc_media_add_option(media, ":avcodec-threads=1");
+        libvlc_media_add_option(media, ":no-sout-spu");
+        libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!player) {
+            report.error = "Cannot create player";
+            return report;
+        }
+
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(player);
+        libvlc_event_attach(events, libvlc_MediaPlayerEndReached, &ChapterAnalyzer::onEvent, run.get());
+        libvlc_event_attach(events, libvlc_MediaPlayerEncounteredError, &ChapterAnalyzer::onEvent, run.get());
+        libvlc_media_player_play(player);
+
+        bool stalled = false;
+        {
+            std::unique_lock<std::mutex> lock(run->mutex);
+            while (!run->ended && !cancelled.load()) {
+                run->changed.wait_for(lock, std::chrono::milliseconds(500));
+                if (std::chrono::steady_clock::now() - run->lastData > std::chrono::milliseconds(STALL_TIMEOUT_MS)) {
+                    stalled = true;
+                    break;
+                }
+            }
+        }
+        libvlc_event_detach(events, libvlc_MediaPlayerEndReached, &ChapterAnalyzer::onEvent, run.get());
+        libvlc_event_detach(events, libvlc_MediaPlayerEncounteredError, &ChapterAnalyzer::onEvent, run.get());
+        libvlc_media_player_stop(player);           // Joins the decoders: no more callbacks
+        libvlc_media_player_release(player);
+
+        if (cancelled.load()) {
+            report.error = "Cancelled";
+        } else if (run->failed || stalled) {
+            report.error = stalled ? "Decoding stalled" : "Decoding failed";
+        } else if (run->luma.empty() && run->windows.empty()) {
+            report.error = "Nothing decoded";
+        }
+        if (!report.error.empty()) return report;
+
+        report.markers = findMarkers(*run, report);
+        if (!TsScanner::writeMarkers(path, report.markers)) {
+            report.error = "Cannot write markers";
+            return report;
+        }
+        report.ok = true;
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return report;
+    }
+
+    // Analyses recordings on up to `threads` threads, one recording each at
+    // a time. Reports come back in the order of paths.
+    static std::vector<ChapterReport> analyzeAll(const std::vector<std::string>& paths, unsigned threads,
+                                                 const std::atomic<bool>& cancelled) {
+        std::vector<ChapterReport> reports(paths.size());
+        std::atomic<size_t> next{0};
+        unsigned count = std::max(1u, std::min({threads, MAX_THREADS, static_cast<unsigned>(paths.size())}));
+        auto work = [&]() {
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                reports[i] = analyze(paths[i], cancelled);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < count; t++) workers.emplace_back(work);
+        work();
+        for (std::thread& worker : workers) worker.join();
+        return reports;
+    }
+};
@@ -0,0 +1,353 @@
+#pragma once
+
+// Player commands (play/stop/pause/resume/seek/trick play) serialised on a
+// control thread.
+//
+// Commands are ordered by intent rather than strictly by arrival:
+//  - a play replaces a play that has not started yet (coalesced);
+//  - a stop drops everything still queued and runs next;
+//  - a pause/resume replaces a pause/resume queued right before it, and
+//    otherwise runs ahead of anything except a play queued earlier, since
+//    that play is the stream it is meant for;
+//  - a seek replaces a seek queued right before it (scrubbing sends many),
+//    and a trick-play speed one queued right before it; both run in order.
+// A play completes once libvlc reports the input open (or failed). If a
+// newer play or stop arrives while it is still opening, the wait ends at
+// once and the play is superseded (not a success: the stream never showed);
+// that play or stop then stops the player, which interrupts libvlc's open
+// instead of letting it run to its network timeout. Other commands wait for
+// the open, since they are meant for the stream being opened.
+//
+// Completions run on the control thread (or the enqueuing thread for
+// commands dropped on arrival) and must not block.
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "vlc_player.h"
+
+enum class PlayerCommandType { Play, Stop, Pause, Resume, Seek, TrickPlay };
+
+enum class PlayerCommandStatus {
+    Done,           // Ran; for play, the input opened
+    Failed,         // Ran and failed, or the input failed to open
+    Coalesced,      // Replaced by a newer command of the same kind before it ran
+    Cancelled,      // Dropped by a stop or by shutdown before it ran
+    Superseded,     // Play started but a newer play/stop (or shutdown) came before it opened
+    TimedOut        // Play started but had not opened within OPEN_TIMEOUT_MS
+};
+
+struct PlayerCommandResult {
+    uint64_t id = 0;
+    PlayerCommandType type = PlayerCommandType::Play;
+    PlayerCommandStatus status = PlayerCommandStatus::Cancelled;
+    bool success = false;
+    double queueMs = 0;         // Enqueue to start of execution (or drop)
+    double execMs = 0;          // Start of execution to completion
+};
+
+inline const char* commandTypeName(PlayerCommandType type) {
+    switch (type) {
+        case PlayerCommandType::Play: return "play";
+        case PlayerCommandType::Stop: return "stop";
+        case PlayerCommandType::Pause: return "pause";
+        case PlayerCommandType::Resume: return "resume";
+        case PlayerCommandType::Seek: return "seek";
+        case PlayerCommandType::TrickPlay: return "trickPlay";
+    }
+    return "unknown";
+}
+
+inline const char* commandStatusName(PlayerCommandStatus status) {
+    switch (status) {
+        case PlayerCommandStatus::Done: return "done";
+        case PlayerCommandStatus::Failed: return "failed";
+        case PlayerCommandStatus::Coalesced: return "coalesced";
+        case PlayerCommandStatus::Cancelled: return "cancelled";
+        case PlayerCommandStatus::Superseded: return "superseded";
+        case PlayerCommandStatus::TimedOut: return "timeout";
+    }
+    return "unknown";
+}
+
+class PlayerCommandQueue {
+public:
+    using Completion = std::function<void(const PlayerCommandResult&)>;
+
+private:
+    static constexpr int OPEN_TIMEOUT_MS = 15000;
+
+    enum OpenState { OPEN_IDLE, OPEN_PENDING, OPEN_OK, OPEN_FAILED };
+
+    struct Command {
+        uint64_t id;
+        PlayerCommandType type;
+        std::string url;
+        double value;               // Seek: time (ms); trick play: speed
+        std::chrono::steady_clock::time_point enqueued;
+        Completion done;
+    };
+
+    VlcPlayer& player;
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::deque<Command> commands;
+    uint64_t nextId = 0;
+    bool running = false;
+    OpenState openState = OPEN_IDLE;
+    std::thread control;
+
+    static double msSince(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    static bool isPauseOrResume(PlayerCommandType type) {
+        return type == PlayerCommandType::Pause || type == PlayerCommandType::Resume;
+    }
+
+    // A newer play or stop is queued. Must hold queueMutex.
+    bool openInterrupted() const {
+        for (const Command& queued : commands) {
+            if (queued.type == PlayerCommandType::Play || queued.type == PlayerCommandType::Stop) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void finish(Command& command, PlayerCommandStatus status, bool success,
+                       std::chrono::steady_clock::time_point started) {
+        auto now = std::chrono::steady_clock::now();
+        PlayerCommandResult result;
+        result.id = command.id;
+        result.type = command.type;
+        result.status = status;
+        result.success = success;
+        result.queueMs = msSince(command.enqueued, started);
+        result.execMs = msSince(started, now);
+
+        auto& metrics = PlayerMetrics::get();
+        metrics.commandQueueTime.observe(result.queueMs / 1000.0);
+        if (status == PlayerCommandStatus::Coalesced || status == PlayerCommandStatus::Cancelled) {
+            metrics.commandsCoalesced.inc();
+        }
+        NativeLog::instance().write(LogLevel::Debug, LOG_EVENT_COMMAND_DONE, {result.queueMs, result.execMs},
+                                    NativeLog::jsonField("command", commandTypeName(command.type)) + "," +
+                                    NativeLog::jsonField("status", commandStatusName(status)));
+
+        if (command.done) {
+            command.done(result);
+        }
+    }
+
+    // libvlc event thread; queueMutex is a leaf lock
+    void onOpenOutcome(bool opened) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (openState != OPEN_PENDING) return;
+            openState = opened ? OPEN_OK : OPEN_FAILED;
+        }
+        wake.notify_all();
+    }
+
+    void execute(Command& command) {
+        auto started = std::chrono::steady_clock::now();
+
+        switch (command.type) {
+            case PlayerCommandType::Play: {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    openState = OPEN_PENDING;
+                }
+                if (!player.play(command.url)) {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    openState = OPEN_IDLE;
+                    break;
+                }
+
+                std::unique_lock<std::mutex> lock(queueMutex);
+                bool settled = wake.wait_for(lock, std::chrono::milliseconds(OPEN_TIMEOUT_MS), [this] {
+                    return openState != OPEN_PENDING || openInterrupted() || !running;
+                });
+                OpenState outcome = openState;
+                openState = OPEN_IDLE;
+                lock.unlock();
+
+                if (outcome == OPEN_OK) {
+                    finish(command, PlayerCommandStatus::Done, true, started);
+                } else if (outcome == OPEN_FAILED) {
+                    finish(command, PlayerCommandStatus::Failed, false, started);
+                } else if (settled) {
+                    finish(command, PlayerCommandStatus::Superseded, false, started);
+                } else {
+                    player.abandonZap();
+                    finish(command, PlayerCommandStatus::TimedOut, player.isPlaying(), started);
+                }
+                return;
+            }
+            case PlayerCommandType::Stop: {
+                bool ok = player.stop();
+                finish(command, ok ? PlayerCommandStatus::Done : PlayerCommandStatus::Failed, ok, started);
+                return;
+            }
+            case PlayerCommandType::Pause:
+            case PlayerCommandType::Resume: {
+                bool ok = command.type == PlayerCommandType::Pause ? player.pause() : player.resume();
+                finish(command, ok ? PlayerCommandStatus::Done : PlayerCommandStatus::Failed, ok, started);
+                return;
+            }
+            case PlayerCommandType::Seek:
+            case PlayerCommandType::TrickPlay: {
+                bool ok = command.type == PlayerCommandType::Seek
+                    ? player.seek(static_cast<int64_t>(command.value))
+                    : player.setTrickPlay(command.value);
+                finish(command, ok ? PlayerCommandStatus::Done : PlayerCommandStatus::Failed, ok, started);
+                return;
+            }
+        }
+
+        finish(command, PlayerCommandStatus::Failed, false, started);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true) {
+            wake.wait(lock, [this] { return !running || !commands.empty(); });
+            if (!running) break;
+
+            Command command = std::move(commands.front());
+            commands.pop_front();
+            lock.unlock();
+            execute(command);
+            lock.lock();
+        }
+    }
+
+public:
+    explicit PlayerCommandQueue(VlcPlayer& target) : player(target) {
+        player.setOpenListener([this](bool opened) { onOpenOutcome(opened); });
+    }
+
+    PlayerCommandQueue(const PlayerCommandQueue&) = delete;
+    PlayerCommandQueue& operator=(const PlayerCommandQueue&) = delete;
+
+    ~PlayerCommandQueue() {
+        shutdown();
+        join();
+    }
+
+    void start() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (running || control.joinable()) return;
+        running = true;
+        control = std::thread(&PlayerCommandQueue::run, this);
+    }
+
+    // Returns the command id, or 0 if the queue is not running (the
+    // completion is then called with Cancelled before returning). value is
+    // the seek time (ms) or trick-play speed.
+    uint64_t enqueue(PlayerCommandType type, const std::string& url, Completion done, double value = 0) {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::pair<Command, PlayerCommandStatus>> dropped;
+        uint64_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            Command command{++nextId, type, url, value, now, std::move(done)};
+
+            if (!running) {
+                dropped.emplace_back(std::move(command), PlayerCommandStatus::Cancelled);
+            } else {
+                id = command.id;
+                switch (type) {
+                    case PlayerCommandType::Play:
+                        for (auto it = commands.begin(); it != commands.end();) {
+                            if (it->type == PlayerCommandType::Play) {
+                                dropped.emplace_back(std::move(*it), PlayerCommandStatus::Coalesced);
+                                it = commands.erase(it);
+                            } else {
+                                ++it;
+                            }
+                        }
+                        commands.push_back(std::move(command));
+                        break;
+                    case PlayerCommandType::Stop:
+                        for (Command& queued : commands) {
+                            PlayerCommandStatus status = queued.type == PlayerCommandType::Stop
+                                ? PlayerCommandStatus::Coalesced
+                                : PlayerCommandStatus::Cancelled;
+                            dropped.emplace_back(std::move(queued), status);
+                        }
+                        commands.clear();
+                        commands.push_back(std::move(command));
+                        break;
+                    case PlayerCommandType::Pause:
+                    case PlayerCommandType::Resume: {
+                        if (!commands.empty() && isPauseOrResume(commands.back().type)) {
+                            dropped.emplace_back(std::move(commands.back()), PlayerCommandStatus::Coalesced);
+                            commands.pop_back();
+                        }
+                        // Ahead of everything but a stop or an earlier play
+                        auto at = commands.begin();
+                        for (auto it = commands.begin(); it != commands.end(); ++it) {
+                            if (it->type == PlayerCommandType::Play || it->type == PlayerCommandType::Stop) {
+                                at = it + 1;
+                            }
+                        }
+                        commands.insert(at, std::move(command));
+                        break;
+                    }
+                    case PlayerCommandType::Seek:
+                    case PlayerCommandType::TrickPlay:
+                        if (!commands.empty() && commands.back().type == type) {
+                            dropped.emplace_back(std::move(commands.back()), PlayerCommandStatus::Coalesced);
+                            commands.pop_back();
+                        }
+                        commands.push_back(std::move(command));
+                        break;
+                }
+            }
+        }
+        wake.notify_all();
+
+        for (auto& entry : dropped) {
+            finish(entry.first, entry.second, false, now);
+        }
+        return id;
+    }
+
+    // Stops accepting commands and cancels the queued ones. A command already
+    // executing finishes on its own; the control thread is not joined here
+    // because a stop in progress may need the calling (UI) thread
+    void shutdown() {
+        std::deque<Command> pending;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            running = false;
+            pending.swap(commands);
+        }
+        wake.notify_all();
+
+        auto now = std::chrono::steady_clock::now();
+        for (Command& command : pending) {
+            finish(command, PlayerCommandStatus::Cancelled, false, now);
+        }
+    }
+
+    // Waits for the command in progress after shutdown(). Not from the UI
+    // thread while that command may be stopping the player
+    void join() {
+        if (control.joinable()) {
+            control.join();
+        }
+    }
+
+    size_t depth() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return commands.size();
+    }
+};
@@ -0,0 +1,1151 @@
+#pragma once
+
+// Remuxes a finished MPEG-TS recording into fragmented MP4 without
+// transcoding: the first video stream (H.264 or MPEG-2) and the first AAC
+// audio stream are repackaged as they are.
+//
+// The output is written in one pass, front to back:
+//   ftyp | moov | sidx + free (reserved) | moof mdat | moof mdat | ...
+// The moov carries no samples, so it is written before the first fragment
+// and only its mehd (total duration) is patched at the end. The sidx space
+// is reserved from the duration read off the head and tail of the input and
+// filled in once the fragments are known; if the estimate falls short the
+// space stays a free box and the file is still valid, only without an index.
+//
+// Reads and writes go through an IoThrottle shared by every remux, and the
+// caller runs this on a background-mode thread, so a remux yields disk and
+// CPU to playback and recordings.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "win_util.h"
+
+// Token bucket over bytes read and written, shared by all remux workers
+class IoThrottle {
+private:
+    std::mutex throttleMutex;
+    double bytesPerSecond = 0;      // 0 = unlimited
+    double tokens = 0;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+public:
+    void setRate(double rate) {
+        std::lock_guard<std::mutex> lock(throttleMutex);
+        bytesPerSecond = rate > 0 ? rate : 0;
+        tokens = 0;
+        last = std::chrono::steady_clock::now();
+    }
+
+    // Blocks until `bytes` fit under the rate (bursts up to a quarter second)
+    void consume(size_t bytes) {
+        double waitSeconds = 0;
+        {
+            std::lock_guard<std::mutex> lock(throttleMutex);
+            if (bytesPerSecond <= 0) return;
+            auto now = std::chrono::steady_clock::now();
+            tokens = std::min(bytesPerSecond / 4,
+                              tokens + std::chrono::duration<double>(now - last).count() * bytesPerSecond);
+            last = now;
+            tokens -= static_cast<double>(bytes);
+            if (tokens < 0) waitSeconds = -tokens / bytesPerSecond;
+        }
+        if (waitSeconds > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(waitSeconds));
+        }
+    }
+};
+
+enum class RemuxResult { Done, Busy, Cancelled, Failed };
+
+class Fmp4Remuxer {
+private:
+    static constexpr size_t PACKET = 188;
+    static constexpr size_t READ_CHUNK = 1 << 20;
+    static constexpr size_t PROBE_BYTES = 4 << 20;
+    static constexpr int64_t PTS_WRAP = int64_t(1) << 33;
+    static constexpr uint32_t VIDEO_TRACK = 1;
+    static constexpr uint32_t AUDIO_TRACK = 2;
+
+    enum class Codec { None, H264, Mpeg2Video, Mpeg1Video, Aac };
+
+    struct Sample {
+        size_t offset;              // Into the track's fragment data
+        uint32_t size;
+        int64_t dts;                // 90 kHz, from the timeline origin
+        int32_t ctsOffset;
+        bool sync;
+    };
+
+    struct Track {
+        Codec codec = Codec::None;
+        uint16_t pid = 0x1FFF;
+        std::vector<uint8_t> pes;           // PES being assembled
+        bool pesStarted = false;
+        int64_t lastRaw = -1;               // 33-bit unwrapping
+        int64_t wrapOffset = 0;
+
+        // Decoder configuration, from the first keyframe / ADTS header
+        std::vector<uint8_t> sps;
+        std::vector<uint8_t> pps;
+        std::vector<uint8_t> sequenceHeader;
+        int width = 0;
+        int height = 0;
+        int sampleRate = 0;
+        int channels = 0;
+        uint8_t audioConfig[2] = {0, 0};
+        bool configured = false;
+
+        std::vector<uint8_t> data;          // Current fragment's samples
+        std::vector<Sample> samples;
+        std::vector<uint8_t> adtsCarry;     // ADTS frame split across PES
+        int64_t adtsPts = -1;
+        uint32_t lastDuration = 0;
+    };
+
+    struct Fragment {
+        uint64_t size;
+        int64_t earliestPts;
+        int64_t duration;
+    };
+
+    IoThrottle& throttle;
+    std::atomic<bool>& cancelled;
+    std::function<void(double)> progress;
+    int fragmentMs;
+
+    HANDLE input = INVALID_HANDLE_VALUE;
+    HANDLE output = INVALID_HANDLE_VALUE;
+    std::vector<uint8_t> writeBuffer;
+    uint64_t outputOffset = 0;
+    bool writeFailed = false;
+    std::string error;
+
+    uint16_t pmtPid = 0x1FFF;
+    bool havePmt = false;
+    Track video;
+    Track audio;
+    int64_t origin = -1;                    // Timeline zero (90 kHz, unwrapped)
+    int64_t fragmentStart = -1;
+    uint32_t sequence = 0;
+    std::vector<Fragment> fragments;
+    int64_t lastVideoEnd = 0;
+    bool initWritten = false;
+    bool audioInInit = false;               // Audio configured too late is dropped
+
+    uint64_t sidxOffset = 0;
+    uint64_t sidxReserved = 0;
+    uint64_t mehdOffset = 0;
+
+    // Box writing
+    static void put8(std::vector<uint8_t>& b, uint32_t v) { b.push_back(static_cast<uint8_t>(v)); }
+    static void put16(std::vector<uint8_t>& b, uint32_t v) { put8(b, v >> 8); put8(b, v); }
+    static void put24(std::vector<uint8_t>& b, uint32_t v) { put8(b, v >> 16); put16(b, v); }
+    static void put32(std::vector<uint8_t>& b, uint32_t v) { put16(b, v >> 16); put16(b, v); }
+    static void put64(std::vector<uint8_t>& b, uint64_t v) { put32(b, static_cast<uint32_t>(v >> 32)); put32(b, static_cast<uint32_t>(v)); }
+    static void putBytes(std::vector<uint8_t>& b, const void* p, size_t n) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(p);
+        b.insert(b.end(), bytes, bytes + n);
+    }
+    static void set32(std::vector<uint8_t>& b, size_t at, uint32_t v) {
+        b[at] = static_cast<uint8_t>(v >> 24);
+        b[at + 1] = static_cast<uint8_t>(v >> 16);
+        b[at + 2] = static_cast<uint8_t>(v >> 8);
+        b[at + 3] = static_cast<uint8_t>(v);
+    }
+    static size_t open(std::vector<uint8_t>& b, const char* type) {
+        size_t at = b.size();
+        put32(b, 0);
+        putBytes(b, type, 4);
+        return at;
+    }
+    static size_t openFull(std::vector<uint8_t>& b, const char* type, uint8_t version, uint32_t flags) {
+        size_t at = open(b, type);
+        put8(b, version);
+        put24(b, flags);
+        return at;
+    }
+    static void close(std::vector<uint8_t>& b, size_t at) {
+        set32(b, at, static_cast<uint32_t>(b.size() - at));
+    }
+    static void putMatrix(std::vector<uint8_t>& b) {
+        const uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+        for (uint32_t v : matrix) put32(b, v);
+    }
+    // Descriptor with a fixed four-byte length
+    static size_t openDescriptor(std::vector<uint8_t>& b, uint8_t tag) {
+        put8(b, tag);
+        size_t at = b.size();
+        put32(b, 0x80808000);
+        return at;
+    }
+    static void closeDescriptor(std::vector<uint8_t>& b, size_t at) {
+        uint32_t length = static_cast<uint32_t>(b.size() - at - 4);
+        b[at] = static_cast<uint8_t>(0x80 | ((length >> 21) & 0x7F));
+        b[at + 1] = static_cast<uint8_t>(0x80 | ((length >> 14) & 0x7F));
+        b[at + 2] = static_cast<uint8_t>(0x80 | ((length >> 7) & 0x7F));
+        b[at + 3] = static_cast<uint8_t>(length & 0x7F);
+    }
+
+    // Output
+    bool flushWrites() {
+        if (writeBuffer.empty() || writeFailed) return !writeFailed;
+        throttle.consume(writeBuffer.size());
+        DWORD written = 0;
+        if (!WriteFile(output, writeBuffer.data(), static_cast<DWORD>(writeBuffer.size()), &written, nullptr) ||
+            written != writeBuffer.size()) {
+            writeFailed = true;
+            error = "Write failed";
+        }
+        writeBuffer.clear();
+        return !writeFailed;
+    }
+
+    void write(const std::vector<uint8_t>& bytes) {
+        writeBuffer.insert(writeBuffer.end(), bytes.begin(), bytes.end());
+        outputOffset += bytes.size();
+        if (writeBuffer.size() >= READ_CHUNK) flushWrites();
+    }
+
+    bool patch(uint64_t offset, const std::vector<uint8_t>& bytes) {
+        if (!flushWrites()) return false;
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        DWORD written = 0;
+        bool ok = SetFilePointerEx(output, position, nullptr, FILE_BEGIN) &&
+                  WriteFile(output, bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr) &&
+                  written == bytes.size();
+        position.QuadPart = static_cast<LONGLONG>(outputOffset);
+        return SetFilePointerEx(output, position, nullptr, FILE_BEGIN) && ok;
+    }
+
+    bool readAt(uint64_t offset, std::vector<uint8_t>& buffer, size_t length) {
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        buffer.resize(length);
+        DWORD got = 0;
+        if (!SetFilePointerEx(input, position, nullptr, FILE_BEGIN) ||
+            !ReadFile(input, buffer.data(), static_cast<DWORD>(length), &got, nullptr)) {
+            return false;
+        }
+        buffer.resize(got);
+        return true;
+    }
+
+    // Timestamps
+    static int64_t readTimestamp(const uint8_t* p) {
+        return (static_cast<int64_t>(p[0] & 0x0E) << 29) | (static_cast<int64_t>(p[1]) << 22) |
+               (static_cast<int64_t>(p[2] & 0xFE) << 14) | (static_cast<int64_t>(p[3]) << 7) | (p[4] >> 1);
+    }
+
+    static int64_t unwrap(Track& track, int64_t raw) {
+        if (track.lastRaw >= 0) {
+            int64_t delta = raw - track.lastRaw;
+            if (delta < -PTS_WRAP / 2) track.wrapOffset += PTS_WRAP;
+            else if (delta > PTS_WRAP / 2) track.wrapOffset -= PTS_WRAP;
+        }
+        track.lastRaw = raw;
+        return raw + track.wrapOffset;
+    }
+
+    // PSI
+    static bool isVideoType(uint8_t type, Codec& codec) {
+        switch (type) {
+            case 0x1B: codec = Codec::H264; return true;
+            case 0x02: codec = Codec::Mpeg2Video; return true;
+            case 0x01: codec = Codec::Mpeg1Video; return true;
+        }
+        return false;
+    }
+
+    void handleSection(const uint8_t* payload, size_t length, bool pat) {
+        if (length < 1 || payload[0] >= length) return;
+        const uint8_t* s = payload + 1 + payload[0];
+        size_t available = length - 1 - payload[0];
+        if (available < 12) return;
+        size_t sectionLength = 3 + (((s[1] & 0x0F) << 8) | s[2]);
+        if (sectionLength > available || sectionLength < 16) return;   // Single-packet tables only
+        size_t end = sectionLength - 4;
+
+        if (pat) {
+            if (s[0] != 0x00) return;
+            for (size_t i = 8; i + 4 <= end; i += 4) {
+                uint16_t number = static_cast<uint16_t>((s[i] << 8) | s[i + 1]);
+                if (number != 0) {
+                    pmtPid = static_cast<uint16_t>(((s[i + 2] & 0x1F) << 8) | s[i + 3]);
+                    return;
+                }
+            }
+            return;
+        }
+
+        if (s[0] != 0x02 || havePmt) return;
+        size_t i = 12 + (((s[10] & 0x0F) << 8) | s[11]);
+        for (; i + 5 <= end; i += 5 + (((s[i + 3] & 0x0F) << 8) | s[i + 4])) {
+            uint16_t pid = static_cast<uint16_t>(((s[i + 1] & 0x1F) << 8) | s[i + 2]);
+            Codec codec;
+            if (video.codec == Codec::None && isVideoType(s[i], codec)) {
+                video.codec = codec;
+                video.pid = pid;
+            } else if (audio.codec == Codec::None && s[i] == 0x0F) {
+                audio.codec = Codec::Aac;
+                audio.pid = pid;
+            }
+        }
+        havePmt = true;
+    }
+
+    // H.264
+    struct BitReader {
+        const uint8_t* data;
+        size_t size;
+        size_t bit = 0;
+        uint32_t bits(int n) {
+            uint32_t v = 0;
+            for (int i = 0; i < n; i++) {
+                size_t byte = bit >> 3;
+                v = (v << 1) | (byte < size ? (data[byte] >> (7 - (bit & 7))) & 1 : 0);
+                bit++;
+            }
+            return v;
+        }
+        uint32_t ue() {
+            int zeros = 0;
+            while (bits(1) == 0 && zeros < 32) zeros++;
+            return zeros ? ((1u << zeros) - 1 + bits(zeros)) : 0;
+        }
+        int32_t se() {
+            uint32_t v = ue();
+            return (v & 1) ? static_cast<int32_t>((v + 1) / 2) : -static_cast<int32_t>(v / 2);
+        }
+    };
+
+    static std::vector<uint8_t> unescape(const uint8_t* p, size_t n) {
+        std::vector<uint8_t> out;
+        out.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            if (i >= 2 && p[i] == 3 && p[i - 1] == 0 && p[i - 2] == 0) continue;
+            out.push_back(p[i]);
+        }
+        return out;
+    }
+
+    static void parseSps(const std::vector<uint8_t>& sps, int& width, int& height) {
+        std::vector<uint8_t> rbsp = unescape(sps.data() + 1, sps.size() - 1);
+        BitReader r{rbsp.data(), rbsp.size()};
+        uint32_t profile = r.bits(8);
+        r.bits(16);
+        r.ue();
+        uint32_t chromaFormat = 1;
+        if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 ||
+            profile == 83 || profile == 86 || profile == 118 || profile == 128) {
+            chromaFormat = r.ue();
+            if (chromaFormat == 3) r.bits(1);
+            r.ue();
+            r.ue();
+            r.bits(1);
+            if (r.bits(1)) {
+                for (int i = 0; i < (chromaFormat != 3 ? 8 : 12); i++) {
+                    if (!r.bits(1)) continue;
+                    int last = 8, next = 8;
+                    for (int j = 0; j < (i < 6 ? 16 : 64) && next != 0; j++) {
+                        next = (last + r.se() + 256) % 256;
+                        if (next != 0) last = next;
+                    }
+                }
+            }
+        }
+        r.ue();
+        uint32_t pocType = r.ue();
+        if (pocType == 0) {
+            r.ue();
+        } else if (pocType == 1) {
+            r.bits(1);
+            r.se();
+            r.se();
+            uint32_t cycle = r.ue();
+            for (uint32_t i = 0; i < cycle && i < 256; i++) r.se();
+        }
+        r.ue();
+        r.bits(1);
+        uint32_t mbWidth = r.ue() + 1;
+        uint32_t mapHeight = r.ue() + 1;
+        uint32_t frameMbsOnly = r.bits(1);
+        if (!frameMbsOnly) r.bits(1);
+        r.bits(1);
+        uint32_t cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+        if (r.bits(1)) {
+            cropLeft = r.ue();
+            cropRight = r.ue();
+            cropTop = r.ue();
+            cropBottom = r.ue();
+        }
+        uint32_t cropX = chromaFormat == 0 || chromaFormat == 3 ? 1 : 2;
+        uint32_t cropY = (chromaFormat == 1 ? 2 : 1) * (2 - frameMbsOnly);
+        width = static_cast<int>(mbWidth * 16 - (cropLeft + cropRight) * cropX);
+        height = static_cast<int>((2 - frameMbsOnly) * mapHeight * 16 - (cropTop + cropBottom) * cropY);
+    }
+
+    // Annex B access unit to length-prefixed NAL units; drops delimiters and filler
+    void handleH264(const std::vector<uint8_t>& es, int64_t pts, int64_t dts) {
+        std::vector<std::pair<size_t, size_t>> nals;
+        size_t start = SIZE_MAX;
+        for (size_t i = 0; i + 3 <= es.size();) {
+            if (es[i] == 0 && es[i + 1] == 0 && es[i + 2] == 1) {
+                if (start != SIZE_MAX) {
+                    size_t end = i;
+                    while (end > start && es[end - 1] == 0) end--;
+                    nals.emplace_back(start, end);
+                }
+                start = i + 3;
+                i += 3;
+            } else {
+                i++;
+            }
+        }
+        if (start != SIZE_MAX && start < es.size()) nals.emplace_back(start, es.size());
+
+        bool sync = false;
+        std::vector<uint8_t> sample;
+        for (const auto& nal : nals) {
+            if (nal.second <= nal.first) continue;
+            const uint8_t* p = es.data() + nal.first;
+            size_t n = nal.second - nal.first;
+            int type = p[0] & 0x1F;
+            if (type == 9 || type == 12) continue;
+            if (type == 7 && video.sps.empty()) {
+                video.sps.assign(p, p + n);
+                parseSps(video.sps, video.width, video.height);
+            } else if (type == 8 && video.pps.empty()) {
+                video.pps.assign(p, p + n);
+            } else if (type == 5) {
+                sync = true;
+            } else if (type == 1 && n > 1) {
+                // Streams without IDRs: an I slice starts a GOP too
+                std::vector<uint8_t> header = unescape(p + 1, std::min<size_t>(n - 1, 16));
+                BitReader r{header.data(), header.size()};
+                r.ue();
+                uint32_t sliceType = r.ue();
+                if (sliceType == 2 || sliceType == 7) sync = true;
+            }
+            put32(sample, static_cast<uint32_t>(n));
+            putBytes(sample, p, n);
+        }
+
+        if (!video.configured) {
+            if (!sync || video.sps.empty() || video.pps.empty()) return;
+            video.configured = true;
+        }
+        addVideoSample(sample, pts, dts, sync);
+    }
+
+    // MPEG-1/2 video: one picture per PES
+    void handleMpegVideo(const std::vector<uint8_t>& es, int64_t pts, int64_t dts) {
+        bool sync = false;
+        for (size_t i = 0; i + 6 <= es.size(); i++) {
+            if (es[i] != 0 || es[i + 1] != 0 || es[i + 2] != 1) continue;
+            uint8_t code = es[i + 3];
+            if (code == 0xB3 && video.sequenceHeader.empty() && i + 8 <= es.size()) {
+                video.width = (es[i + 4] << 4) | (es[i + 5] >> 4);
+                video.height = ((es[i + 5] & 0x0F) << 8) | es[i + 6];
+                // Sequence header and extensions, up to the GOP or picture
+                size_t end = i + 4;
+                while (end + 4 <= es.size() &&
+                       !(es[end] == 0 && es[end + 1] == 0 && es[end + 2] == 1 && (es[end + 3] == 0xB8 || es[end + 3] == 0x00))) {
+                    end++;
+                }
+                video.sequenceHeader.assign(es.begin() + i, es.begin() + end);
+            } else if (code == 0x00) {
+                sync = ((es[i + 5] >> 3) & 0x07) == 1;
+                break;
+            }
+        }
+
+        if (!video.configured) {
+            if (!sync || video.sequenceHeader.empty()) return;
+            video.configured = true;
+        }
+        addVideoSample(es, pts, dts, sync);
+    }
+
+    void addVideoSample(const std::vector<uint8_t>& bytes, int64_t pts, int64_t dts, bool sync) {
+        if (bytes.empty()) return;
+        if (origin < 0) origin = dts;
+        if (dts < origin) return;
+
+        // A keyframe past the fragment length closes the fragment (once the
+        // init segment is out; until then the first fragment just grows)
+        if (sync && initWritten && fragmentStart >= 0 &&
+            dts - fragmentStart >= static_cast<int64_t>(fragmentMs) * 90) {
+            flushFragment(dts);
+        }
+        if (fragmentStart < 0) fragmentStart = dts;
+
+        Sample sample;
+        sample.offset = video.data.size();
+        sample.size = static_cast<uint32_t>(bytes.size());
+        sample.dts = dts - origin;
+        sample.ctsOffset = static_cast<int32_t>(pts - dts);
+        sample.sync = sync;
+        video.data.insert(video.data.end(), bytes.begin(), bytes.end());
+        video.samples.push_back(sample);
+    }
+
+    // AAC: ADTS frames, which may straddle PES packets
+    void handleAac(const std::vector<uint8_t>& es, int64_t pts) {
+        if (pts >= 0 && audio.adtsCarry.empty()) audio.adtsPts = pts;
+        std::vector<uint8_t> data;
+        data.swap(audio.adtsCarry);
+        data.insert(data.end(), es.begin(), es.end());
+
+        size_t i = 0;
+        while (i + 7 <= data.size()) {
+            const uint8_t* h = data.data() + i;
+            if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0) {
+                i++;
+                continue;
+            }
+            size_t frameLength = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+            size_t headerLength = (h[1] & 0x01) ? 7 : 9;
+            if (frameLength <= headerLength) {
+                i++;
+                continue;
+            }
+            if (i + frameLength > data.size()) break;
+
+            static const int rates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+                                        16000, 12000, 11025, 8000, 7350, 0, 0, 0};
+            int profile = h[2] >> 6;
+            int rateIndex = (h[2] >> 2) & 0x0F;
+            int channelConfig = ((h[2] & 0x01) << 2) | (h[3] >> 6);
+            if (!audio.configured && rates[rateIndex] > 0) {
+                audio.sampleRate = rates[rateIndex];
+                audio.channels = channelConfig ? channelConfig : 2;
+                uint16_t config = static_cast<uint16_t>(((profile + 1) << 11) | (rateIndex << 7) | (channelConfig << 3));
+                audio.audioConfig[0] = static_cast<uint8_t>(config >> 8);
+                audio.audioConfig[1] = static_cast<uint8_t>(config);
+                audio.configured = true;
+            }
+            if (audio.configured && (!initWritten || audioInInit) && audio.adtsPts >= 0 && origin >= 0 &&
+                audio.adtsPts >= origin) {
+                Sample sample;
+                sample.offset = audio.data.size();
+                sample.size = static_cast<uint32_t>(frameLength - headerLength);
+                sample.dts = audio.adtsPts - origin;
+                sample.ctsOffset = 0;
+                sample.sync = true;
+                audio.data.insert(audio.data.end(), h + headerLength, h + frameLength);
+                audio.samples.push_back(sample);
+            }
+            if (audio.adtsPts >= 0 && audio.sampleRate > 0) {
+                audio.adtsPts += 1024 * 90000 / audio.sampleRate;
+            }
+            i += frameLength;
+        }
+        audio.adtsCarry.assign(data.begin() + i, data.end());
+        if (audio.adtsCarry.size() > 8192) audio.adtsCarry.clear();
+    }
+
+    void handlePes(Track& track) {
+        std::vector<uint8_t>& pes = track.pes;
+        if (pes.size() < 9 || pes[0] != 0 || pes[1] != 0 || pes[2] != 1) return;
+        size_t headerLength = 9 + pes[8];
+        if (headerLength > pes.size()) return;
+
+        int64_t pts = -1;
+        int64_t dts = -1;
+        uint8_t flags = pes[7] >> 6;
+        if ((flags & 0x02) && pes[8] >= 5) pts = unwrap(track, readTimestamp(&pes[9]));
+        if (flags == 0x03 && pes[8] >= 10) dts = pts - ((readTimestamp(&pes[9]) - readTimestamp(&pes[14]) + PTS_WRAP) % PTS_WRAP);
+        if (dts < 0) dts = pts;
+
+        std::vector<uint8_t> es(pes.begin() + headerLength, pes.end());
+        if (&track == &video) {
+            if (pts < 0) return;
+            if (video.codec == Codec::H264) handleH264(es, pts, dts);
+            else handleMpegVideo(es, pts, dts);
+        } else {
+            handleAac(es, pts);
+        }
+    }
+
+    void handlePacket(const uint8_t* p) {
+        uint16_t pid = static_cast<uint16_t>(((p[1] & 0x1F) << 8) | p[2]);
+        bool unitStart = (p[1] & 0x40) != 0;
+        uint8_t adaptation = (p[3] >> 4) & 0x03;
+        size_t offset = 4;
+        if (adaptation & 0x02) offset += 1 + p[4];
+        if (!(adaptation & 0x01) || offset >= PACKET || (p[1] & 0x80)) return;
+
+        if (pid == 0 && unitStart && pmtPid == 0x1FFF) {
+            handleSection(p + offset, PACKET - offset, true);
+            return;
+        }
+        if (pid == pmtPid && unitStart && !havePmt) {
+            handleSection(p + offset, PACKET - offset, false);
+            return;
+        }
+
+        Track* track = pid == video.pid && video.codec != Codec::None ? &video
+                     : pid == audio.pid && audio.codec != Codec::None ? &audio : nullptr;
+        if (!track) return;
+        if (unitStart) {
+            if (track->pesStarted) handlePes(*track);
+            track->pes.assign(p + offset, p + PACKET);
+            track->pesStarted = true;
+        } else if (track->pesStarted) {
+            track->pes.insert(track->pes.end(), p + offset, p + PACKET);
+        }
+    }
+
+    // Duration from the first and last video PTS, for the sidx reservation
+    int64_t estimateDuration(uint64_t fileSize) {
+        std::vector<uint8_t> head;
+        std::vector<uint8_t> tail;
+        if (!readAt(0, head, static_cast<size_t>(std::min<uint64_t>(fileSize, PROBE_BYTES))) ||
+            !readAt(fileSize > PROBE_BYTES ? fileSize - PROBE_BYTES : 0, tail,
+                    static_cast<size_t>(std::min<uint64_t>(fileSize, PROBE_BYTES)))) {
+            return -1;
+        }
+
+        // The head also yields the PIDs the demux pass then follows
+        for (size_t i = syncOffset(head, 0); i + PACKET <= head.size() && !havePmt; i += PACKET) {
+            uint16_t pid = static_cast<uint16_t>(((head[i + 1] & 0x1F) << 8) | head[i + 2]);
+            if (head[i] == 0x47 && (pid == 0 || pid == pmtPid)) handlePacket(head.data() + i);
+        }
+        if (!havePmt || video.codec == Codec::None) return -1;
+
+        auto firstPts = [this](const std::vector<uint8_t>& buffer, bool last) {
+            int64_t found = -1;
+            for (size_t i = syncOffset(buffer, 0); i + PACKET <= buffer.size(); i += PACKET) {
+                const uint8_t* p = buffer.data() + i;
+                if (p[0] != 0x47 || !(p[1] & 0x40)) continue;
+                if ((((p[1] & 0x1F) << 8) | p[2]) != video.pid) continue;
+                size_t offset = 4;
+                if ((p[3] >> 4) & 0x02) offset += 1 + p[4];
+                if (offset + 14 > PACKET || p[offset] != 0 || p[offset + 1] != 0 || p[offset + 2] != 1) continue;
+                if (!(p[offset + 7] & 0x80)) continue;
+                found = readTimestamp(p + offset + 9);
+                if (!last) break;
+            }
+            return found;
+        };
+        int64_t first = firstPts(head, false);
+        int64_t last = firstPts(tail, true);
+        if (first < 0 || last < 0) return -1;
+        return (last - first + PTS_WRAP) % PTS_WRAP;
+    }
+
+    static size_t syncOffset(const std::vector<uint8_t>& buffer, size_t from) {
+        for (size_t i = from; i + 2 * PACKET < buffer.size(); i++) {
+            if (buffer[i] == 0x47 && buffer[i + PACKET] == 0x47 && buffer[i + 2 * PACKET] == 0x47) return i;
+        }
+        return buffer.size();
+    }
+
+    // Init segment
+    void writeVisualEntry(std::vector<uint8_t>& b, const char* type) {
+        size_t entry = open(b, type);
+        put32(b, 0);
+        put16(b, 0);
+        put16(b, 1);                        // data_reference_index
+        for (int i = 0; i < 4; i++) put32(b, 0);
+        put16(b, static_cast<uint32_t>(video.width));
+        put16(b, static_cast<uint32_t>(video.height));
+        put32(b, 0x00480000);
+        put32(b, 0x00480000);
+        put32(b, 0);
+        put16(b, 1);                        // frame_count
+        for (int i = 0; i < 8; i++) put32(b, 0);
+        put16(b, 0x0018);
+        put16(b, 0xFFFF);
+
+        if (video.codec == Codec::H264) {
+            size_t avcC = open(b, "avcC");
+            put8(b, 1);
+            put8(b, video.sps[1]);
+            put8(b, video.sps[2]);
+            put8(b, video.sps[3]);
+            put8(b, 0xFF);                  // 4-byte NAL lengths
+            put8(b, 0xE1);
+            put16(b, static_cast<uint32_t>(video.sps.size()));
+            putBytes(b, video.sps.data(), video.sps.size());
+            put8(b, 1);
+            put16(b, static_cast<uint32_t>(video.pps.size()));
+            putBytes(b, video.pps.data(), video.pps.size());
+            close(b, avcC);
+        } else {
+            writeEsds(b, video.codec == Codec::Mpeg2Video ? 0x61 : 0x6A, 0x04,
+                      video.sequenceHeader.data(), video.sequenceHeader.size());
+        }
+        close(b, entry);
+    }
+
+    static void writeEsds(std::vector<uint8_t>& b, uint8_t objectType, uint8_t streamType,
+                          const uint8_t* config, size_t configLength) {
+        size_t esds = openFull(b, "esds", 0, 0);
+        size_t es = openDescriptor(b, 0x03);
+        put16(b, 0);                        // ES_ID
+        put8(b, 0);
+        size_t decoder = openDescriptor(b, 0x04);
+        put8(b, objectType);
+        put8(b, (streamType << 2) | 0x01);
+        put24(b, 0);
+        put32(b, 0);
+        put32(b, 0);
+        size_t specific = openDescriptor(b, 0x05);
+        putBytes(b, config, configLength);
+        closeDescriptor(b, specific);
+        closeDescriptor(b, decoder);
+        size_t sl = openDescriptor(b, 0x06);
+        put8(b, 0x02);
+        closeDescriptor(b, sl);
+        closeDescriptor(b, es);
+        close(b, esds);
+    }
+
+    void writeTrak(std::vector<uint8_t>& b, Track& track, uint32_t id, uint32_t timescale) {
+        bool isVideo = &track == &video;
+        size_t trak = open(b, "trak");
+
+        size_t tkhd = openFull(b, "tkhd", 0, 0x03);
+        put32(b, 0);
+        put32(b, 0);
+        put32(b, id);
+        put32(b, 0);
+        put32(b, 0);                        // duration: fragments carry it
+        put32(b, 0);
+        put32(b, 0);
+        put16(b, 0);
+        put16(b, 0);
+        put16(b, isVideo ? 0 : 0x0100);
+        put16(b, 0);
+        putMatrix(b);
+        put32(b, isVideo ? static_cast<uint32_t>(track.width) << 16 : 0);
+        put32(b, isVideo ? static_cast<uint32_t>(track.height) << 16 : 0);
+        close(b, tkhd);
+
+        // B-frame reordering delays the first picture; start the edit there
+        if (isVideo && !track.samples.empty() && track.samples[0].ctsOffset > 0) {
+            size_t edts = open(b, "edts");
+            size_t elst = openFull(b, "elst", 0, 0);
+            put32(b, 1);
+            put32(b, 0);
+            put32(b, static_cast<uint32_t>(track.samples[0].ctsOffset));
+            put32(b, 0x00010000);
+            close(b, elst);
+            close(b, edts);
+        }
+
+        size_t mdia = open(b, "mdia");
+        size_t mdhd = openFull(b, "mdhd", 0, 0);
+        put32(b, 0);
+        put32(b, 0);
+        put32(b, timescale);
+        put32(b, 0);
+        put16(b, 0x55C4);                   // "und"
+        put16(b, 0);
+        close(b, mdhd);
+
+        size_t hdlr = openFull(b, "hdlr", 0, 0);
+        put32(b, 0);
+        putBytes(b, isVideo ? "vide" : "soun", 4);
+        put32(b, 0);
+        put32(b, 0);
+        put32(b, 0);
+        const char* name = isVideo ? "VideoHandler" : "SoundHandler";
+        putBytes(b, name, strlen(name) + 1);
+        close(b, hdlr);
+
+        size_t minf = open(b, "minf");
+        if (isVideo) {
+            size_t vmhd = openFull(b, "vmhd", 0, 1);
+            put16(b, 0);
+            put16(b, 0);
+            put16(b, 0);
+            put16(b, 0);
+            close(b, vmhd);
+        } else {
+            size_t smhd = openFull(b, "smhd", 0, 0);
+            put16(b, 0);
+            put16(b, 0);
+            close(b, smhd);
+        }
+        size_t dinf = open(b, "dinf");
+        size_t dref = openFull(b, "dref", 0, 0);
+        put32(b, 1);
+        size_t url = openFull(b, "url ", 0, 1);
+        close(b, url);
+        close(b, dref);
+        close(b, dinf);
+
+        size_t stbl = open(b, "stbl");
+        size_t stsd = openFull(b, "stsd", 0, 0);
+        put32(b, 1);
+        if (isVideo) {
+            writeVisualEntry(b, track.codec == Codec::H264 ? "avc1" : "mp4v");
+        } else {
+            size_t entry = open(b, "mp4a");
+            put32(b, 0);
+            put16(b, 0);
+            put16(b, 1);
+            put32(b, 0);
+            put32(b, 0);
+            put16(b, static_cast<uint32_t>(track.channels));
+            put16(b, 16);
+            put16(b, 0);
+            put16(b, 0);
+            put32(b, static_cast<uint32_t>(track.sampleRate) << 16);
+            writeEsds(b, 0x40, 0x05, track.audioConfig, sizeof(track.audioConfig));
+            close(b, entry);
+        }
+        close(b, stsd);
+        const char* empty[] = {"stts", "stsc", "stco"};
+        for (const char* type : empty) {
+            size_t box = openFull(b, type, 0, 0);
+            put32(b, 0);
+            close(b, box);
+        }
+        size_t stsz = openFull(b, "stsz", 0, 0);
+        put32(b, 0);
+        put32(b, 0);
+        close(b, stsz);
+        close(b, stbl);
+        close(b, minf);
+        close(b, mdia);
+        close(b, trak);
+    }
+
+    void writeInit(int64_t estimatedDuration) {
+        std::vector<uint8_t> b;
+        size_t ftyp = open(b, "ftyp");
+        putBytes(b, "iso6", 4);
+        put32(b, 0);
+        putBytes(b, "iso6", 4);
+        putBytes(b, "isom", 4);
+        putBytes(b, "dash", 4);
+        putBytes(b, "mp41", 4);
+        close(b, ftyp);
+
+        bool hasAudio = audio.configured;
+        audioInInit = hasAudio;
+        initWritten = true;
+        size_t moov = open(b, "moov");
+        size_t mvhd = openFull(b, "mvhd", 0, 0);
+        put32(b, 0);
+        put32(b, 0);
+        put32(b, 1000);
+        put32(b, 0);
+        put32(b, 0x00010000);
+        put16(b, 0x0100);
+        put16(b, 0);
+        put32(b, 0);
+        put32(b, 0);
+        putMatrix(b);
+        for (int i = 0; i < 6; i++) put32(b, 0);
+        put32(b, hasAudio ? AUDIO_TRACK + 1 : VIDEO_TRACK + 1);
+        close(b, mvhd);
+
+        writeTrak(b, video, VIDEO_TRACK, 90000);
+        if (hasAudio) writeTrak(b, audio, AUDIO_TRACK, static_cast<uint32_t>(audio.sampleRate));
+
+        size_t mvex = open(b, "mvex");
+        size_t mehd = openFull(b, "mehd", 1, 0);
+        mehdOffset = outputOffset + b.size();
+        put64(b, 0);                        // Patched at the end (ms)
+        close(b, mehd);
+        for (uint32_t id = VIDEO_TRACK; id <= (hasAudio ? AUDIO_TRACK : VIDEO_TRACK); id++) {
+            size_t trex = openFull(b, "trex", 0, 0);
+            put32(b, id);
+            put32(b, 1);
+            put32(b, 0);
+            put32(b, 0);
+            put32(b, 0);
+            close(b, trex);
+        }
+        close(b, mvex);
+        close(b, moov);
+        write(b);
+
+        // sidx reservation: 40 bytes plus 12 per fragment, with slack for
+        // fragments cut short by a late keyframe
+        sidxOffset = outputOffset;
+        uint64_t entries = estimatedDuration > 0
+            ? static_cast<uint64_t>(estimatedDuration / (static_cast<int64_t>(fragmentMs) * 90)) * 5 / 4 + 16
+            : 0;
+        sidxReserved = entries ? 40 + 12 * entries + 8 : 0;
+        if (sidxReserved) {
+            std::vector<uint8_t> space;
+            size_t free = open(space, "free");
+            space.resize(static_cast<size_t>(sidxReserved), 0);
+            close(space, free);
+            write(space);
+        }
+    }
+
+    // Fragments
+    void writeTraf(std::vector<uint8_t>& b, Track& track, uint32_t id, int64_t baseTime, size_t& dataOffsetAt) {
+        bool isVideo = &track == &video;
+        size_t traf = open(b, "traf");
+        size_t tfhd = openFull(b, "tfhd", 0, 0x020000);        // default-base-is-moof
+        put32(b, id);
+        close(b, tfhd);
+        size_t tfdt = openFull(b, "tfdt", 1, 0);
+        put64(b, static_cast<uint64_t>(baseTime));
+        close(b, tfdt);
+
+        uint32_t flags = 0x000001 | 0x000100 | 0x000200 | 0x000400 | (isVideo ? 0x000800 : 0);
+        size_t trun = openFull(b, "trun", 1, flags);
+        put32(b, static_cast<uint32_t>(track.samples.size()));
+        dataOffsetAt = b.size();
+        put32(b, 0);
+        for (size_t i = 0; i < track.samples.size(); i++) {
+            const Sample& sample = track.samples[i];
+            // Video: the gap to the next picture, the last one the gap to the
+            // fragment end. Audio: one AAC frame in its own timescale.
+            uint32_t duration = 1024;
+            if (isVideo) {
+                int64_t next = i + 1 < track.samples.size() ? track.samples[i + 1].dts
+                                                            : sample.dts + (track.lastDuration ? track.lastDuration : 3003);
+                duration = static_cast<uint32_t>(std::max<int64_t>(next - sample.dts, 1));
+            }
+            put32(b, duration);
+            put32(b, sample.size);
+            put32(b, sample.sync ? 0x02000000 : 0x01010000);
+            if (isVideo) put32(b, static_cast<uint32_t>(sample.ctsOffset));
+        }
+        close(b, trun);
+        close(b, traf);
+    }
+
+    void flushFragment(int64_t nextVideoDts) {
+        if (video.samples.empty()) return;
+        int64_t end = nextVideoDts >= 0 ? nextVideoDts - origin : -1;
+        if (end >= 0) {
+            video.lastDuration = static_cast<uint32_t>(end - video.samples.back().dts);
+        }
+
+        // Audio up to the video boundary goes in this fragment
+        size_t audioCount = audio.samples.size();
+        if (end >= 0) {
+            audioCount = 0;
+            while (audioCount < audio.samples.size() && audio.samples[audioCount].dts < end) audioCount++;
+        }
+        std::vector<Sample> laterAudio(audio.samples.begin() + audioCount, audio.samples.end());
+        audio.samples.resize(audioCount);
+        size_t audioBytes = audioCount ? audio.samples.back().offset + audio.samples.back().size : 0;
+        bool hasAudio = audioInInit && audioCount > 0;
+
+        std::vector<uint8_t> b;
+        size_t moof = open(b, "moof");
+        size_t mfhd = openFull(b, "mfhd", 0, 0);
+        put32(b, ++sequence);
+        close(b, mfhd);
+        size_t videoOffsetAt = 0;
+        size_t audioOffsetAt = 0;
+        writeTraf(b, video, VIDEO_TRACK, video.samples.front().dts, videoOffsetAt);
+        if (hasAudio) {
+            writeTraf(b, audio, AUDIO_TRACK, audio.samples.front().dts * audio.sampleRate / 90000, audioOffsetAt);
+        }
+        close(b, moof);
+
+        uint32_t moofSize = static_cast<uint32_t>(b.size());
+        set32(b, videoOffsetAt, moofSize + 8);
+        if (hasAudio) set32(b, audioOffsetAt, static_cast<uint32_t>(moofSize + 8 + video.data.size()));
+
+        uint64_t mdatSize = 8 + video.data.size() + (hasAudio ? audioBytes : 0);
+        put32(b, static_cast<uint32_t>(mdatSize));
+        putBytes(b, "mdat", 4);
+        write(b);
+        write(video.data);
+        if (hasAudio) {
+            std::vector<uint8_t> audioData(audio.data.begin(), audio.data.begin() + audioBytes);
+            write(audioData);
+        }
+
+        Fragment fragment;
+        fragment.size = moofSize + mdatSize;
+        fragment.earliestPts = video.samples.front().dts + video.samples.front().ctsOffset;
+        int64_t videoEnd = end >= 0 ? end : video.samples.back().dts + (video.lastDuration ? video.lastDuration : 3003);
+        fragment.duration = videoEnd - video.samples.front().dts;
+        fragments.push_back(fragment);
+        lastVideoEnd = videoEnd;
+
+        // Keep what belongs to the next fragment, rebased
+        video.data.clear();
+        video.samples.clear();
+        std::vector<uint8_t> remaining(audio.data.begin() + audioBytes, audio.data.end());
+        for (Sample& sample : laterAudio) sample.offset -= audioBytes;
+        audio.data.swap(remaining);
+        audio.samples.swap(laterAudio);
+        fragmentStart = nextVideoDts;
+    }
+
+    bool finish() {
+        flushFragment(-1);
+        if (fragments.empty()) {
+            error = "No video found";
+            return false;
+        }
+
+        std::vector<uint8_t> mehd;
+        put64(mehd, static_cast<uint64_t>(lastVideoEnd / 90));
+        if (!patch(mehdOffset, mehd)) return false;
+
+        uint64_t needed = 40 + 12 * fragments.size();
+        if (sidxReserved && needed + 8 <= sidxReserved) {
+            std::vector<uint8_t> b;
+            size_t sidx = openFull(b, "sidx", 1, 0);
+            put32(b, VIDEO_TRACK);
+            put32(b, 90000);
+            put64(b, static_cast<uint64_t>(std::max<int64_t>(fragments.front().earliestPts, 0)));
+            put64(b, sidxReserved - needed);            // first_offset: the free box after it
+            put16(b, 0);
+            put16(b, static_cast<uint32_t>(fragments.size()));
+            for (const Fragment& fragment : fragments) {
+                put32(b, static_cast<uint32_t>(fragment.size & 0x7FFFFFFF));
+                put32(b, static_cast<uint32_t>(fragment.duration));
+                put32(b, 0x90000000);                   // starts_with_SAP, SAP type 1
+            }
+            close(b, sidx);
+            size_t free = open(b, "free");
+            b.resize(static_cast<size_t>(sidxReserved), 0);
+            close(b, free);
+            if (!patch(sidxOffset, b)) return false;
+        }
+        return flushWrites();
+    }
+
+public:
+    Fmp4Remuxer(IoThrottle& ioThrottle, std::atomic<bool>& cancel, std::function<void(double)> onProgress,
+                int fragmentMillis = 2000)
+        : throttle(ioThrottle), cancelled(cancel), progress(std::move(onProgress)),
+          fragmentMs(fragmentMillis > 0 ? fragmentMillis : 2000) {}
+
+    Fmp4Remuxer(const Fmp4Remuxer&) = delete;
+    Fmp4Remuxer& operator=(const Fmp4Remuxer&) = delete;
+
+    ~Fmp4Remuxer() {
+        if (input != INVALID_HANDLE_VALUE) CloseHandle(input);
+        if (output != INVALID_HANDLE_VALUE) CloseHandle(output);
+    }
+
+    const std::string& getError() const { return error; }
+
+    // Busy: the input is still open for writing (recording in progress).
+    // The output appears under its name only when complete.
+    RemuxResult run(const std::string& inputPath, const std::string& outputPath) {
+        // No write sharing: fails while a recorder still has the file open
+        input = CreateFileW(utf8ToWide(inputPath).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (input == INVALID_HANDLE_VALUE) {
+            if (GetLastError() == ERROR_SHARING_VIOLATION) return RemuxResult::Busy;
+            error = "Cannot open input";
+            return RemuxResult::Failed;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(input, &size) || size.QuadPart < static_cast<LONGLONG>(PACKET * 3)) {
+            error = "Input too small";
+            return RemuxResult::Failed;
+        }
+        uint64_t fileSize = static_cast<uint64_t>(size.QuadPart);
+
+        int64_t estimated = estimateDuration(fileSize);
+        if (!havePmt || video.codec == Codec::None) {
+            error = "No supported video stream";
+            return RemuxResult::Failed;
+        }
+
+        std::string partPath = outputPath + ".part";
+        output = CreateFileW(utf8ToWide(partPath).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (output == INVALID_HANDLE_VALUE) {
+            error = "Cannot create output";
+            return RemuxResult::Failed;
+        }
+
+        RemuxResult result = demux(fileSize, estimated);
+        CloseHandle(output);
+        output = INVALID_HANDLE_VALUE;
+
+        if (result == RemuxResult::Done &&
+            MoveFileExW(utf8ToWide(partPath).c_str(), utf8ToWide(outputPath).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            return RemuxResult::Done;
+        }
+        DeleteFileW(utf8ToWide(partPath).c_str());
+        if (result == RemuxResult::Done) {
+            error = "Cannot rename output";
+            return RemuxResult::Failed;
+        }
+        return result;
+    }
+
+private:
+    RemuxResult demux(uint64_t fileSize, int64_t estimated) {
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> carry;
+        uint64_t position = 0;
+        double reported = -1;
+
+        while (position < fileSize) {
+            if (cancelled.load()) return RemuxResult::Cancelled;
+
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(READ_CHUNK, fileSize - position));
+            throttle.consume(chunk);
+            if (!readAt(position, buffer, chunk) || buffer.empty()) {
+                error = "Read failed";
+                return RemuxResult::Failed;
+            }
+            position += buffer.size();
+            if (!carry.empty()) {
+                buffer.insert(buffer.begin(), carry.begin(), carry.end());
+                carry.clear();
+            }
+
+            size_t i = syncOffset(buffer, 0);
+            while (i + PACKET <= buffer.size()) {
+                if (buffer[i] != 0x47) {
+                    i = syncOffset(buffer, i + 1);
+                    continue;
+                }
+                handlePacket(buffer.data() + i);
+                i += PACKET;
+
+                // The init segment needs both decoder configurations (or
+                // enough video to know there is no audio)
+                if (!initWritten && video.configured &&
+                    (audio.codec == Codec::None || audio.configured || video.samples.size() > 100)) {
+                    writeInit(estimated);
+                }
+            }
+            if (i < buffer.size() && position < fileSize) {
+                carry.assign(buffer.begin() + std::min(i, buffer.size()), buffer.end());
+            }
+            if (writeFailed) return RemuxResult::Failed;
+
+            double fraction = static_cast<double>(position) / fileSize;
+            if (progress && fraction - reported >= 0.01) {
+                reported = fraction;
+                progress(fraction);
+            }
+        }
+
+        if (video.pesStarted) handlePes(video);
+        if (audio.pesStarted) handlePes(audio);
+        if (!initWritten) {
+            if (!video.configured) {
+                error = "No decodable video";
+                return RemuxResult::Failed;
+            }
+            writeInit(estimated);
+        }
+        return finish() ? RemuxResult::Done : RemuxResult::Failed;
+    }
+};
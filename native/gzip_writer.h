@@ -0,0 +1,201 @@
+#pragma once
+
+// Minimal gzip encoder (RFC 1951/1952) used to compress rotated log files.
+//
+// The addon does not link zlib, so this implements deflate with fixed
+// Huffman codes and a hash-chain LZ77 matcher. Text logs are highly
+// repetitive, which is where fixed-code deflate does well; the output is
+// standard gzip readable by any tool.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class GzipWriter {
+private:
+    static constexpr int WINDOW_SIZE = 32768;
+    static constexpr int HASH_BITS = 15;
+    static constexpr int HASH_SIZE = 1 << HASH_BITS;
+    static constexpr int MIN_MATCH = 3;
+    static constexpr int MAX_MATCH = 258;
+    static constexpr int MAX_CHAIN = 32;
+
+    std::vector<uint8_t> out;
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+
+    static const uint32_t* crcTable() {
+        // Magic static: built once, thread-safe
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // Deflate packs bits LSB-first
+    void putBits(uint32_t value, int count) {
+        bitBuffer |= value << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back(static_cast<uint8_t>(bitBuffer & 0xFF));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    // Huffman codes are defined MSB-first, so they are reversed on output
+    void putCode(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        putBits(reversed, length);
+    }
+
+    void flushBits() {
+        if (bitCount > 0) {
+            out.push_back(static_cast<uint8_t>(bitBuffer & 0xFF));
+        }
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+
+    void putLiteralOrLength(int symbol) {
+        if (symbol <= 143) {
+            putCode(0x30 + symbol, 8);
+        } else if (symbol <= 255) {
+            putCode(0x190 + (symbol - 144), 9);
+        } else if (symbol <= 279) {
+            putCode(symbol - 256, 7);
+        } else {
+            putCode(0xC0 + (symbol - 280), 8);
+        }
+    }
+
+    void putMatch(int length, int distance) {
+        static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                         257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                         8193, 12289, 16385, 24577};
+        static const int distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                          7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        int li = 28;
+        while (lengthBase[li] > length) li--;
+        putLiteralOrLength(257 + li);
+        if (lengthExtra[li]) putBits(length - lengthBase[li], lengthExtra[li]);
+
+        int di = 29;
+        while (distBase[di] > distance) di--;
+        putCode(di, 5);
+        if (distExtra[di]) putBits(distance - distBase[di], distExtra[di]);
+    }
+
+    static uint32_t hash3(const uint8_t* p) {
+        return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+    }
+
+    void deflate(const uint8_t* data, size_t size) {
+        // Single final block with fixed Huffman codes
+        putBits(1, 1);
+        putBits(1, 2);
+
+        std::vector<int32_t> head(HASH_SIZE, -1);
+        std::vector<int32_t> prev(WINDOW_SIZE, -1);
+
+        auto insert = [&](size_t pos) {
+            if (pos + MIN_MATCH > size) return;
+            uint32_t h = hash3(data + pos);
+            prev[pos & (WINDOW_SIZE - 1)] = head[h];
+            head[h] = static_cast<int32_t>(pos);
+        };
+
+        size_t pos = 0;
+        while (pos < size) {
+            int bestLength = 0;
+            int bestDistance = 0;
+
+            if (pos + MIN_MATCH <= size) {
+                int32_t candidate = head[hash3(data + pos)];
+                int chain = MAX_CHAIN;
+                size_t maxLength = size - pos < MAX_MATCH ? size - pos : MAX_MATCH;
+
+                while (candidate >= 0 && chain-- > 0) {
+                    size_t distance = pos - static_cast<size_t>(candidate);
+                    if (distance > WINDOW_SIZE - 1) break;
+
+                    const uint8_t* a = data + candidate;
+                    const uint8_t* b = data + pos;
+                    size_t length = 0;
+                    while (length < maxLength && a[length] == b[length]) length++;
+
+                    if (static_cast<int>(length) > bestLength) {
+                        bestLength = static_cast<int>(length);
+                        bestDistance = static_cast<int>(distance);
+                        if (length == maxLength) break;
+                    }
+
+                    int32_t next = prev[candidate & (WINDOW_SIZE - 1)];
+                    if (next >= candidate) break; // Slot reused by a newer position
+                    candidate = next;
+                }
+            }
+
+            if (bestLength >= MIN_MATCH) {
+                putMatch(bestLength, bestDistance);
+                for (int i = 0; i < bestLength; i++) insert(pos + i);
+                pos += bestLength;
+            } else {
+                putLiteralOrLength(data[pos]);
+                insert(pos);
+                pos++;
+            }
+        }
+
+        putLiteralOrLength(256); // End of block
+        flushBits();
+    }
+
+public:
+    static uint32_t crc32(const uint8_t* data, size_t size) {
+        const uint32_t* table = crcTable();
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        }
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    // Compress a whole buffer into a gzip member
+    std::vector<uint8_t> compress(const uint8_t* data, size_t size) {
+        out.clear();
+        out.reserve(size / 4 + 64);
+        bitBuffer = 0;
+        bitCount = 0;
+
+        static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+        for (uint8_t b : header) out.push_back(b);
+
+        deflate(data, size);
+
+        uint32_t crc = crc32(data, size);
+        uint32_t isize = static_cast<uint32_t>(size);
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(crc >> (8 * i)));
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(isize >> (8 * i)));
+
+        return std::move(out);
+    }
+};
@@ -0,0 +1,505 @@
+#pragma once
+
+// Metrics registry with Prometheus text exposition.
+//
+// Hot paths (player callbacks, stats polling) only touch atomics. Rendering
+// the text format, the optional loopback HTTP endpoint and the periodic file
+// dump all run on a background exporter thread.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "win_util.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+class MetricCounter {
+private:
+    std::atomic<uint64_t> value{0};
+
+public:
+    void inc(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+class MetricGauge {
+private:
+    std::atomic<double> value{0.0};
+
+public:
+    void set(double v) {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    void add(double delta) {
+        double current = value.load(std::memory_order_relaxed);
+        while (!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+
+    double get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+class MetricHistogram {
+private:
+    std::vector<double> bounds;                     // Upper bounds, ascending, +Inf implicit
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets; // Non-cumulative per-bucket counts
+    std::atomic<uint64_t> count{0};
+    std::atomic<double> sum{0.0};
+
+public:
+    explicit MetricHistogram(std::vector<double> upperBounds)
+        : bounds(std::move(upperBounds)),
+          buckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds.size() && v > bounds[i]) {
+            i++;
+        }
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        double current = sum.load(std::memory_order_relaxed);
+        while (!sum.compare_exchange_weak(current, current + v, std::memory_order_relaxed)) {
+        }
+    }
+
+    const std::vector<double>& getBounds() const { return bounds; }
+    uint64_t getBucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    double getSum() const { return sum.load(std::memory_order_relaxed); }
+};
+
+class MetricsRegistry {
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Kind kind;
+        void* metric;
+    };
+
+    // Deques keep metric addresses stable as more are registered
+    std::deque<MetricCounter> counters;
+    std::deque<MetricGauge> gauges;
+    std::deque<MetricHistogram> histograms;
+    std::vector<Entry> entries;
+    std::mutex registryMutex;
+
+    static std::string formatValue(double v) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.17g", v);
+        return buf;
+    }
+
+public:
+    static MetricsRegistry& instance() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    // Registration happens once at startup; the returned reference is what
+    // hot paths keep and update.
+    MetricCounter& counter(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        counters.emplace_back();
+        entries.push_back({name, help, Kind::Counter, &counters.back()});
+        return counters.back();
+    }
+
+    MetricGauge& gauge(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        gauges.emplace_back();
+        entries.push_back({name, help, Kind::Gauge, &gauges.back()});
+        return gauges.back();
+    }
+
+    MetricHistogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        histograms.emplace_back(std::move(bounds));
+        entries.push_back({name, help, Kind::Histogram, &histograms.back()});
+        return histograms.back();
+    }
+
+    // Render all metrics in Prometheus text exposition format (version 0.0.4)
+    std::string render() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::ostringstream out;
+
+        for (const auto& e : entries) {
+            out << "# HELP " << e.name << " " << e.help << "\n";
+            switch (e.kind) {
+                case Kind::Counter:
+                    out << "# TYPE " << e.name << " counter\n";
+                    out << e.name << " " << static_cast<MetricCounter*>(e.metric)->get() << "\n";
+                    break;
+                case Kind::Gauge:
+                    out << "# TYPE " << e.name << " gauge\n";
+                    out << e.name << " " << formatValue(static_cast<MetricGauge*>(e.metric)->get()) << "\n";
+                    break;
+                case Kind::Histogram: {
+                    auto* h = static_cast<MetricHistogram*>(e.metric);
+                    out << "# TYPE " << e.name << " histogram\n";
+                    uint64_t cumulative = 0;
+                    const auto& bounds = h->getBounds();
+                    for (size_t i = 0; i < bounds.size(); i++) {
+                        cumulative += h->getBucket(i);
+                        out << e.name << "_bucket{le=\"" << formatValue(bounds[i]) << "\"} " << cumulative << "\n";
+                    }
+                    cumulative += h->getBucket(bounds.size());
+                    out << e.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+                    out << e.name << "_sum " << formatValue(h->getSum()) << "\n";
+                    out << e.name << "_count " << h->getCount() << "\n";
+                    break;
+                }
+            }
+        }
+
+        return out.str();
+    }
+};
+
+// Well-known player metrics, registered once
+struct PlayerMetrics {
+    MetricCounter& zaps;
+    MetricCounter& zapFailures;
+    MetricHistogram& zapLatency;
+    MetricGauge& inputBitrate;
+    MetricGauge& demuxBitrate;
+    MetricHistogram& inputBitrateSamples;
+    MetricCounter& framesDisplayed;
+    MetricCounter& framesDropped;
+    MetricCounter& audioBuffersLost;
+    MetricCounter& freezes;
+    MetricCounter& restarts;
+    MetricCounter& playerRecreations;
+    MetricGauge& recordingActive;
+    MetricCounter& recordingBytes;
+    MetricGauge& recordingThroughput;
+    MetricGauge& libvlcInstances;
+    MetricGauge& libvlcMediaPlayers;
+    MetricGauge& libvlcInitTime;
+    MetricGauge& bufferLevel;
+    MetricCounter& stallPredictions;
+    MetricCounter& standbySwitches;
+    MetricHistogram& commandQueueTime;
+    MetricCounter& commandsCoalesced;
+    MetricGauge& recordingsArmed;
+    MetricGauge& recordingCaptures;
+    MetricCounter& recordingCaptureFailures;
+    MetricCounter& recordingFilteredBytes;
+    MetricGauge& remuxQueued;
+    MetricCounter& remuxBytes;
+    MetricCounter& remuxFailures;
+    MetricCounter& recordingRepairs;
+    MetricGauge& storageUsedBytes;
+    MetricCounter& storageEvictions;
+    MetricCounter& previewStrips;
+    MetricCounter& chapterAnalyses;
+    MetricCounter& archivedRecordings;
+    MetricCounter& archiveSavedBytes;
+    MetricCounter& multicastDatagrams;
+    MetricCounter& multicastLost;
+    MetricCounter& multicastReordered;
+    MetricGauge& relayClients;
+    MetricCounter& relayUpstreamBytes;
+    MetricCounter& relaySentBytes;
+    MetricCounter& relaySkippedBytes;
+    MetricGauge& recordingServerConnections;
+    MetricCounter& recordingServerBytes;
+    MetricCounter& streamFailures;
+
+    static PlayerMetrics& get() {
+        static PlayerMetrics metrics(MetricsRegistry::instance());
+        return metrics;
+    }
+
+private:
+    explicit PlayerMetrics(MetricsRegistry& r)
+        : zaps(r.counter("jptv_zaps_total", "Channel zaps started")),
+          zapFailures(r.counter("jptv_zap_failures_total", "Zaps that failed to open or hit a player error")),
+          zapLatency(r.histogram("jptv_zap_latency_seconds", "Time from play request to first video output",
+                                 {0.25, 0.5, 0.75, 1, 1.5, 2, 3, 5, 8, 13})),
+          inputBitrate(r.gauge("jptv_input_bitrate", "Current input bitrate as reported by libvlc (KB/s)")),
+          demuxBitrate(r.gauge("jptv_demux_bitrate", "Current demux bitrate as reported by libvlc (KB/s)")),
+          inputBitrateSamples(r.histogram("jptv_input_bitrate_samples", "Distribution of polled input bitrate (KB/s)",
+                                          {50, 100, 250, 500, 1000, 2000, 4000, 8000})),
+          framesDisplayed(r.counter("jptv_frames_displayed_total", "Video frames displayed")),
+          framesDropped(r.counter("jptv_frames_dropped_total", "Video frames lost or dropped")),
+          audioBuffersLost(r.counter("jptv_audio_buffers_lost_total", "Audio buffers lost")),
+          freezes(r.counter("jptv_stream_freezes_total", "Stream freezes detected")),
+          restarts(r.counter("jptv_stream_restarts_total", "Restarts of a stream after a freeze")),
+          playerRecreations(r.counter("jptv_player_recreations_total", "Media player recreations after errors")),
+          recordingActive(r.gauge("jptv_recording_active", "1 while a recording is in progress")),
+          recordingBytes(r.counter("jptv_recording_bytes_total", "Bytes written to recording files")),
+          recordingThroughput(r.gauge("jptv_recording_throughput_bytes_per_second", "Recent recording write rate")),
+          libvlcInstances(r.gauge("jptv_libvlc_instances", "Live libvlc instances")),
+          libvlcMediaPlayers(r.gauge("jptv_libvlc_media_players", "Live libvlc media players")),
+          libvlcInitTime(r.gauge("jptv_libvlc_init_seconds", "Time libvlc_new took, including the plugin scan")),
+          bufferLevel(r.gauge("jptv_buffer_level_ms", "Estimated media buffered ahead of playback")),
+          stallPredictions(r.counter("jptv_stall_predictions_total", "Underruns predicted from the buffer trend")),
+          standbySwitches(r.counter("jptv_standby_switches_total", "Switches to a pre-opened standby player")),
+          commandQueueTime(r.histogram("jptv_command_queue_seconds", "Time player commands waited on the control thread",
+                                       {0.001, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2, 5})),
+          commandsCoalesced(r.counter("jptv_commands_coalesced_total", "Player commands dropped in favour of a newer one")),
+          recordingsArmed(r.gauge("jptv_recordings_armed", "Scheduled recordings waiting for their start time")),
+          recordingCaptures(r.gauge("jptv_recording_captures", "Scheduled recordings currently capturing")),
+          recordingCaptureFailures(r.counter("jptv_recording_capture_failures_total",
+                                             "Scheduled recording inputs that failed or ended early")),
+          recordingFilteredBytes(r.counter("jptv_recording_filtered_bytes_total",
+                                           "Stream bytes the PID filter kept out of recordings")),
+          remuxQueued(r.gauge("jptv_remux_queued", "Recordings waiting for MP4 remux")),
+          remuxBytes(r.counter("jptv_remux_bytes_total", "Recording bytes remuxed to MP4")),
+          remuxFailures(r.counter("jptv_remux_failures_total", "Recording remuxes that failed")),
+          recordingRepairs(r.counter("jptv_recording_repairs_total", "Recordings truncated after a torn last packet")),
+          storageUsedBytes(r.gauge("jptv_recording_storage_bytes", "Bytes used by the recordings folder")),
+          storageEvictions(r.counter("jptv_recording_evictions_total",
+                                     "Recording files deleted to stay within storage limits")),
+          previewStrips(r.counter("jptv_preview_strips_total", "Scrub-preview strips built for recordings")),
+          chapterAnalyses(r.counter("jptv_chapter_analyses_total", "Recordings analysed for black frames and silence")),
+          archivedRecordings(r.counter("jptv_archived_recordings_total", "Recordings re-encoded to the archive bitrate")),
+          archiveSavedBytes(r.counter("jptv_archive_saved_bytes_total", "Disk space freed by archiving recordings")),
+          multicastDatagrams(r.counter("jptv_multicast_datagrams_total", "Datagrams received by the native UDP/RTP input")),
+          multicastLost(r.counter("jptv_multicast_lost_total", "RTP packets lost (sequence gaps not filled in time)")),
+          multicastReordered(r.counter("jptv_multicast_reordered_total", "RTP packets that arrived out of order")),
+          relayClients(r.gauge("jptv_relay_clients", "Clients receiving the relayed channel")),
+          relayUpstreamBytes(r.counter("jptv_relay_upstream_bytes_total", "Bytes pulled from the relayed channel")),
+          relaySentBytes(r.counter("jptv_relay_sent_bytes_total", "Bytes sent to relay clients")),
+          relaySkippedBytes(r.counter("jptv_relay_skipped_bytes_total",
+                                      "Relay bytes skipped by clients that fell a whole ring behind")),
+          recordingServerConnections(r.gauge("jptv_recording_server_connections",
+                                             "Open connections to the recordings HTTP server")),
+          recordingServerBytes(r.counter("jptv_recording_server_sent_bytes_total",
+                                         "Recording bytes sent by the recordings HTTP server")),
+          streamFailures(r.counter("jptv_stream_failures_total",
+                                   "Streams failed from libvlc's log or error event, before any freeze")) {}
+};
+
+// Serves the registry over loopback HTTP and/or dumps it to a file on an
+// interval. Both are optional and run on one background thread.
+class MetricsExporter {
+private:
+    std::thread worker;
+    std::mutex exporterMutex;
+    std::condition_variable wakeup;
+    bool running = false;
+
+    SOCKET listenSocket = INVALID_SOCKET;
+    bool wsaStarted = false;
+    std::string dumpPath;
+    std::chrono::milliseconds dumpInterval{0};
+
+    static constexpr int ACCEPT_POLL_MS = 250;
+    static constexpr DWORD CLIENT_TIMEOUT_MS = 2000;    // Scrapes are loopback and small
+
+    void serveClient(SOCKET client) {
+        // A client that connects and sends nothing must not hold up the
+        // only exporter thread (or stop() joining it)
+        DWORD timeoutMs = CLIENT_TIMEOUT_MS;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+
+        // Read and discard the request head; only the path matters
+        char request[2048];
+        int received = recv(client, request, sizeof(request) - 1, 0);
+        if (received <= 0) {
+            closesocket(client);
+            return;
+        }
+        request[received] = '\0';
+
+        std::string head(request);
+        bool isMetrics = head.rfind("GET /metrics", 0) == 0 || head.rfind("GET / ", 0) == 0;
+
+        std::string body = isMetrics ? MetricsRegistry::instance().render() : "Not Found\n";
+        std::string response = std::string(isMetrics ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n") +
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Connection: close\r\n\r\n" + body;
+
+        size_t sent = 0;
+        while (sent < response.size()) {
+            int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+
+        shutdown(client, SD_SEND);
+        closesocket(client);
+    }
+
+    void writeDump() {
+        // Write-then-rename so scrapers never see a partial file
+        std::string body = MetricsRegistry::instance().render();
+        std::string tempPath = dumpPath + ".tmp";
+
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) return;
+        size_t written = fwrite(body.data(), 1, body.size(), f);
+        fclose(f);
+
+        if (written == body.size()) {
+            MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(dumpPath).c_str(), MOVEFILE_REPLACE_EXISTING);
+        } else {
+            DeleteFileW(utf8ToWide(tempPath).c_str());
+        }
+    }
+
+    void run() {
+        auto nextDump = std::chrono::steady_clock::now();
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(exporterMutex);
+                if (!running) break;
+
+                if (listenSocket == INVALID_SOCKET) {
+                    // File dump only: sleep until the next interval or stop()
+                    wakeup.wait_until(lock, nextDump, [this] { return !running; });
+                    if (!running) break;
+                }
+            }
+
+            if (listenSocket != INVALID_SOCKET) {
+                fd_set readSet;
+                FD_ZERO(&readSet);
+                FD_SET(listenSocket, &readSet);
+                timeval timeout{0, ACCEPT_POLL_MS * 1000};
+
+                if (select(0, &readSet, nullptr, nullptr, &timeout) > 0) {
+                    SOCKET client = accept(listenSocket, nullptr, nullptr);
+                    if (client != INVALID_SOCKET) {
+                        serveClient(client);
+                    }
+                }
+            }
+
+            if (!dumpPath.empty() && std::chrono::steady_clock::now() >= nextDump) {
+                writeDump();
+                nextDump = std::chrono::steady_clock::now() + dumpInterval;
+            }
+        }
+
+        // Final dump so the file reflects the state at shutdown
+        if (!dumpPath.empty()) {
+            writeDump();
+        }
+    }
+
+    bool openListener(int port) {
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            return false;
+        }
+        wsaStarted = true;
+
+        listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listenSocket == INVALID_SOCKET) {
+            return false;
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<u_short>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Loopback only, never exposed on the LAN
+
+        if (bind(listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR ||
+            listen(listenSocket, 8) == SOCKET_ERROR) {
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
+            return false;
+        }
+
+        return true;
+    }
+
+public:
+    ~MetricsExporter() {
+        stop();
+    }
+
+    // port <= 0 disables the HTTP endpoint; empty path disables the file dump
+    bool start(int port, const std::string& filePath, int intervalMs) {
+        std::lock_guard<std::mutex> lock(exporterMutex);
+
+        if (running) {
+            return false;
+        }
+
+        if (port > 0 && !openListener(port)) {
+            if (wsaStarted) {
+                WSACleanup();
+                wsaStarted = false;
+            }
+            return false;
+        }
+
+        dumpPath = filePath;
+        dumpInterval = std::chrono::milliseconds(intervalMs > 0 ? intervalMs : 15000);
+
+        if (listenSocket == INVALID_SOCKET && dumpPath.empty()) {
+            return false;
+        }
+
+        running = true;
+        worker = std::thread(&MetricsExporter::run, this);
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(exporterMutex);
+            if (!running) return;
+            running = false;
+        }
+        wakeup.notify_all();
+
+        if (worker.joinable()) {
+            worker.join();
+        }
+
+        if (listenSocket != INVALID_SOCKET) {
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
+        }
+        if (wsaStarted) {
+            WSACleanup();
+            wsaStarted = false;
+        }
+        dumpPath.clear();
+    }
+
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(exporterMutex);
+        return running;
+    }
+};
@@ -0,0 +1,655 @@
+#pragma once
+
+// Native UDP/RTP input for multicast IPTV. libvlc gets it through media
+// callbacks instead of using its own udp/rtp access.
+//
+// Receives are batched. Windows has no recvmmsg, so RECEIVES overlapped
+// WSARecv calls stay posted on an I/O completion port, backed by an 8 MB
+// socket buffer. One thread collects up to RECEIVES of them per
+// GetQueuedCompletionStatusEx call and reposts them.
+//
+// RTP datagrams go through a reorder buffer keyed on sequence number. A gap
+// is held open for up to REORDER_MS waiting for the missing packet, then
+// counted lost and skipped. Plain UDP is passed straight through. Either
+// way the TS continuity counters are checked, so loss shows even without
+// RTP.
+//
+// Payload is written to a byte ring, one lock per batch, and libvlc's read
+// callback drains it. When the player falls behind and the ring is full,
+// new packets are dropped and counted rather than stalling receives.
+
+#include <vlc/vlc.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "native_log.h"
+
+struct MulticastStats {
+    bool rtp = false;
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;             // TS delivered to the player
+    uint64_t batches = 0;           // Completion batches; datagrams / batches = batch size
+    uint64_t lost = 0;              // RTP packets given up on
+    uint64_t reordered = 0;         // Arrived after a later sequence number
+    uint64_t duplicates = 0;
+    uint64_t late = 0;              // Arrived after they were delivered or given up on
+    uint64_t resyncs = 0;           // Sequence jumps taken as a sender restart
+    uint64_t malformed = 0;
+    uint64_t continuityErrors = 0;  // TS continuity counter jumps
+    uint64_t overflows = 0;         // TS packets dropped because the player fell behind
+    double jitterMs = 0;            // RFC 3550 interarrival jitter
+    int socketBuffer = 0;           // Receive buffer the system granted
+};
+
+class MulticastInput {
+private:
+    static constexpr int RECEIVES = 64;
+    static constexpr size_t DATAGRAM = 2048;            // 7 TS packets and an RTP header
+    static constexpr int SOCKET_BUFFER = 8 << 20;
+    static constexpr uint16_t REORDER_SLOTS = 128;      // Power of two
+    static constexpr int64_t REORDER_MS = 50;
+    static constexpr int RESYNC_DISTANCE = 1000;
+    static constexpr size_t RING_BYTES = 8 << 20;       // Three seconds of 20 Mbit/s
+    static constexpr int NO_DATA_TIMEOUT_MS = 10000;
+    static constexpr DWORD POLL_MS = 200;
+    static constexpr ULONG_PTR WAKE_KEY = 1;
+    static constexpr size_t TS_PACKET = 188;
+
+    struct Receive {
+        OVERLAPPED overlapped;
+        WSABUF buffer;
+        DWORD flags;
+        uint8_t data[DATAGRAM];
+    };
+
+    struct Slot {
+        bool used = false;
+        uint16_t length = 0;
+        int64_t arrivalUs = 0;
+        uint8_t data[DATAGRAM];
+    };
+
+    std::string url;
+    bool valid = false;
+    in_addr group = {};
+    in_addr source = {};
+    bool hasSource = false;
+    uint16_t port = 0;
+
+    SOCKET sock = INVALID_SOCKET;
+    HANDLE completionPort = nullptr;
+    std::thread receiver;
+    std::unique_ptr<Receive[]> receives;
+    std::atomic<bool> stopRequested{false};
+    int outstanding = 0;                        // Receiver thread only
+
+    // Receiver thread only
+    bool formatKnown = false;
+    bool isRtp = false;
+    bool sequenceStarted = false;
+    uint16_t expected = 0;
+    uint16_t highest = 0;
+    int buffered = 0;
+    std::vector<Slot> slots;
+    bool haveTransit = false;
+    int32_t lastTransit = 0;
+    double jitter = 0;                          // RTP clock units
+    uint8_t continuity[8192];
+    std::vector<uint8_t> staging;               // This batch's payload
+    MulticastStats counters;
+    MulticastStats reported;                    // As last added to the metrics
+
+    std::mutex ringMutex;
+    std::condition_variable ringReady;
+    std::vector<uint8_t> ring;
+    size_t ringHead = 0;
+    size_t ringFilled = 0;
+    bool interrupted = false;
+
+    std::mutex statsMutex;
+    MulticastStats published;
+
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint16_t be16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static uint32_t be32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    static bool parseAddress(const std::string& text, in_addr& address) {
+        if (text.empty()) {
+            address.s_addr = htonl(INADDR_ANY);
+            return true;
+        }
+        return inet_pton(AF_INET, text.c_str(), &address) == 1;
+    }
+
+    // udp://[source@]group[:port] and rtp://..., as libvlc takes them.
+    // Only IPv4 literals; anything else stays with libvlc's access.
+    bool parse() {
+        size_t scheme = url.find("://");
+        if (scheme == std::string::npos) return false;
+        std::string rest = url.substr(scheme + 3);
+        port = url.compare(0, 3, "rtp") == 0 ? 5004 : 1234;
+        size_t at = rest.find('@');
+        if (at != std::string::npos) {
+            hasSource = at > 0;
+            if (hasSource && !parseAddress(rest.substr(0, at), source)) return false;
+            rest = rest.substr(at + 1);
+        }
+        size_t colon = rest.find(':');
+        if (colon != std::string::npos) {
+            char* end = nullptr;
+            unsigned long value = strtoul(rest.c_str() + colon + 1, &end, 10);
+            if (value == 0 || value > 65535 || *end != '\0') return false;
+            port = static_cast<uint16_t>(value);
+            rest.resize(colon);
+        }
+        return parseAddress(rest, group);
+    }
+
+    bool isMulticast() const {
+        return (ntohl(group.s_addr) >> 28) == 0xE;
+    }
+
+    void post(Receive& receive) {
+        if (stopRequested.load()) return;
+        memset(&receive.overlapped, 0, sizeof(receive.overlapped));
+        receive.buffer.buf = reinterpret_cast<char*>(receive.data);
+        receive.buffer.len = static_cast<ULONG>(DATAGRAM);
+        receive.flags = 0;
+        if (WSARecv(sock, &receive.buffer, 1, nullptr, &receive.flags, &receive.overlapped, nullptr) == 0 ||
+            WSAGetLastError() == WSA_IO_PENDING) {
+            outstanding++;
+        }
+    }
+
+    void checkContinuity(const uint8_t* payload, size_t length) {
+        if (length % TS_PACKET != 0) return;
+        for (size_t offset = 0; offset < length; offset += TS_PACKET) {
+            const uint8_t* packet = payload + offset;
+            if (packet[0] != 0x47) continue;
+            uint16_t pid = static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+            if (pid == 0x1FFF || !(packet[3] & 0x10)) continue;     // Null, or no payload
+            uint8_t cc = packet[3] & 0x0F;
+            uint8_t last = continuity[pid];
+            // A repeat of the last counter is a legal duplicate
+            if (last != 0xFF && cc != last && cc != ((last + 1) & 0x0F)) counters.continuityErrors++;
+            continuity[pid] = cc;
+        }
+    }
+
+    void deliver(const uint8_t* payload, size_t length) {
+        checkContinuity(payload, length);
+        staging.insert(staging.end(), payload, payload + length);
+    }
+
+    Slot& slotFor(uint16_t sequence) {
+        return slots[sequence & (REORDER_SLOTS - 1)];
+    }
+
+    // Hands over buffered packets from `expected` on until the next gap
+    void flushReady() {
+        while (buffered > 0 && slotFor(expected).used) {
+            Slot& slot = slotFor(expected);
+            deliver(slot.data, slot.length);
+            slot.used = false;
+            buffered--;
+            expected++;
+        }
+    }
+
+    // Gives up on the packet at `expected`
+    void skipOne(bool countLost) {
+        Slot& slot = slotFor(expected);
+        if (slot.used) {
+            deliver(slot.data, slot.length);
+            slot.used = false;
+            buffered--;
+        } else if (countLost) {
+            counters.lost++;
+        }
+        expected++;
+    }
+
+    // The sender restarted (or the stream switched): flush and start over
+    void resync(uint16_t sequence) {
+        while (buffered > 0) skipOne(false);
+        counters.resyncs++;
+        expected = sequence;
+        highest = sequence;
+    }
+
+    void reorder(uint16_t sequence, const uint8_t* payload, size_t length, int64_t now) {
+        if (!sequenceStarted) {
+            sequenceStarted = true;
+            expected = sequence;
+            highest = sequence;
+        }
+        int delta = static_cast<int16_t>(sequence - expected);
+        if (delta < -RESYNC_DISTANCE || delta > RESYNC_DISTANCE) {
+            resync(sequence);
+            delta = 0;
+        } else if (delta < 0) {
+            counters.late++;
+            return;
+        }
+        while (delta >= REORDER_SLOTS) {
+            skipOne(true);
+            delta--;
+        }
+
+        if (static_cast<int16_t>(sequence - highest) > 0) {
+            highest = sequence;
+        } else if (sequence != highest) {
+            counters.reordered++;
+        }
+
+        if (delta == 0 && buffered == 0) {
+            deliver(payload, length);
+            expected++;
+            return;
+        }
+        Slot& slot = slotFor(sequence);
+        if (slot.used) {
+            counters.duplicates++;
+            return;
+        }
+        memcpy(slot.data, payload, length);
+        slot.length = static_cast<uint16_t>(length);
+        slot.arrivalUs = now;
+        slot.used = true;
+        buffered++;
+        flushReady();
+    }
+
+    // Gaps whose later packets have waited REORDER_MS are given up on
+    void releaseGaps(int64_t now) {
+        while (buffered > 0) {
+            int64_t oldest = now;
+            for (const Slot& slot : slots) {
+                if (slot.used) oldest = std::min(oldest, slot.arrivalUs);
+            }
+            if (now - oldest < REORDER_MS * 1000) return;
+            skipOne(true);
+            flushReady();
+        }
+    }
+
+    // RFC 3550 section 6.4.1, in the 90 kHz clock of MP2T over RTP
+    void updateJitter(uint32_t timestamp, int64_t now) {
+        int32_t transit = static_cast<int32_t>(static_cast<uint32_t>(now * 9 / 100) - timestamp);
+        if (haveTransit) {
+            double d = std::abs(static_cast<double>(transit - lastTransit));
+            jitter += (d - jitter) / 16;
+        }
+        lastTransit = transit;
+        haveTransit = true;
+    }
+
+    void handleDatagram(const uint8_t* data, size_t length, int64_t now) {
+        counters.datagrams++;
+        if (length == 0) return;
+        if (!formatKnown) {
+            if (data[0] == 0x47) {
+                isRtp = false;
+            } else if ((data[0] >> 6) == 2) {
+                isRtp = true;
+            } else {
+                counters.malformed++;
+                return;
+            }
+            formatKnown = true;
+            counters.rtp = isRtp;
+        }
+        if (!isRtp) {
+            deliver(data, length);
+            return;
+        }
+
+        // Fixed header, CSRCs, extension, padding
+        if (length < 12 || (data[0] >> 6) != 2) {
+            counters.malformed++;
+            return;
+        }
+        size_t header = 12 + 4 * static_cast<size_t>(data[0] & 0x0F);
+        if ((data[0] & 0x10) && header + 4 <= length) {
+            header += 4 + 4 * static_cast<size_t>(be16(data + header + 2));
+        }
+        if (data[0] & 0x20) {
+            length -= std::min<size_t>(length, data[length - 1]);
+        }
+        if (header >= length) {
+            counters.malformed++;
+            return;
+        }
+        updateJitter(be32(data + 4), now);
+        reorder(be16(data + 2), data + header, length - header, now);
+    }
+
+    // Ring write for the whole batch, in whole TS packets
+    void publish() {
+        if (!staging.empty()) {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            size_t space = (RING_BYTES - ringFilled) / TS_PACKET * TS_PACKET;
+            size_t length = std::min(staging.size(), space);
+            counters.overflows += (staging.size() - length) / TS_PACKET;
+            size_t tail = (ringHead + ringFilled) % RING_BYTES;
+            size_t first = std::min(length, RING_BYTES - tail);
+            memcpy(ring.data() + tail, staging.data(), first);
+            memcpy(ring.data(), staging.data() + first, length - first);
+            ringFilled += length;
+            counters.bytes += length;
+            ringReady.notify_one();
+        }
+        staging.clear();
+
+        counters.jitterMs = jitter / 90.0;
+        PlayerMetrics& metrics = PlayerMetrics::get();
+        metrics.multicastDatagrams.inc(static_cast<double>(counters.datagrams - reported.datagrams));
+        metrics.multicastLost.inc(static_cast<double>(counters.lost - reported.lost));
+        metrics.multicastReordered.inc(static_cast<double>(counters.reordered - reported.reordered));
+        reported = counters;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        published = counters;
+    }
+
+    void receiveLoop() {
+        // Receives must keep up with the sender whatever the decoder does
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+        OVERLAPPED_ENTRY entries[RECEIVES];
+        while (!stopRequested.load() || outstanding > 0) {
+            ULONG count = 0;
+            if (!GetQueuedCompletionStatusEx(completionPort, entries, RECEIVES, &count, POLL_MS, FALSE)) {
+                count = 0;
+            }
+            int64_t now = nowUs();
+            for (ULONG i = 0; i < count; i++) {
+                if (!entries[i].lpOverlapped) continue;             // Wake-up
+                Receive* receive = CONTAINING_RECORD(entries[i].lpOverlapped, Receive, overlapped);
+                outstanding--;
+                if (entries[i].Internal == 0) {                     // NTSTATUS of the receive
+                    handleDatagram(receive->data, entries[i].dwNumberOfBytesTransferred, now);
+                }
+                post(*receive);
+            }
+            if (count > 0) counters.batches++;
+            if (isRtp) releaseGaps(now);
+            publish();
+        }
+    }
+
+    void resetState() {
+        formatKnown = false;
+        isRtp = false;
+        sequenceStarted = false;
+        buffered = 0;
+        for (Slot& slot : slots) slot.used = false;
+        haveTransit = false;
+        jitter = 0;
+        memset(continuity, 0xFF, sizeof(continuity));
+        counters = MulticastStats();
+        reported = MulticastStats();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            published = MulticastStats();
+        }
+        std::lock_guard<std::mutex> lock(ringMutex);
+        ringHead = 0;
+        ringFilled = 0;
+        interrupted = false;
+    }
+
+    // libvlc media callbacks; opaque is the input
+    static int openCallback(void* opaque, void** data, uint64_t* size) {
+        MulticastInput* input = static_cast<MulticastInput*>(opaque);
+        *data = input;
+        *size = UINT64_MAX;
+        std::string error;
+        return input->start(error) ? 0 : -1;
+    }
+
+    static ssize_t readCallback(void* opaque, unsigned char* buffer, size_t length) {
+        return static_cast<MulticastInput*>(opaque)->read(buffer, length);
+    }
+
+    static void closeCallback(void* opaque) {
+        static_cast<MulticastInput*>(opaque)->stop();
+    }
+
+    static void onMediaFreed(const libvlc_event_t*, void* data) {
+        MulticastInput* input = static_cast<MulticastInput*>(data);
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            for (auto it = registry().begin(); it != registry().end(); ++it) {
+                if (it->second == input) {
+                    registry().erase(it);
+                    break;
+                }
+            }
+        }
+        input->stop();
+        delete input;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Inputs by the media they feed
+    static std::map<libvlc_media_t*, MulticastInput*>& registry() {
+        static std::map<libvlc_media_t*, MulticastInput*> inputs;
+        return inputs;
+    }
+
+    static std::atomic<bool>& enabledFlag() {
+        static std::atomic<bool> enabled{false};
+        return enabled;
+    }
+
+public:
+    explicit MulticastInput(const std::string& inputUrl) : url(inputUrl), slots(REORDER_SLOTS), ring(RING_BYTES) {
+        valid = parse();
+        memset(continuity, 0xFF, sizeof(continuity));
+    }
+
+    ~MulticastInput() {
+        stop();
+    }
+
+    MulticastInput(const MulticastInput&) = delete;
+    MulticastInput& operator=(const MulticastInput&) = delete;
+
+    // udp:// and rtp:// URLs, when the native input is switched on
+    static bool handles(const std::string& location) {
+        if (!enabledFlag().load()) return false;
+        std::string scheme = location.substr(0, 6);
+        for (char& c : scheme) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return (scheme == "udp://" || scheme == "rtp://") && location.find('[') == std::string::npos;
+    }
+
+    static void setEnabled(bool enabled) {
+        enabledFlag().store(enabled);
+    }
+
+    // A media reading from a new input, or nullptr if the URL is not one
+    // this input can take. The input lives until libvlc frees the media.
+    static libvlc_media_t* newMedia(libvlc_instance_t* vlc, const std::string& location) {
+        std::unique_ptr<MulticastInput> input(new MulticastInput(location));
+        if (!input->valid) return nullptr;
+        libvlc_media_t* media = libvlc_media_new_callbacks(vlc, &MulticastInput::openCallback,
+                                                           &MulticastInput::readCallback, nullptr,
+                                                           &MulticastInput::closeCallback, input.get());
+        if (!media) return nullptr;
+        libvlc_media_add_option(media, ":demux=ts");
+        libvlc_event_attach(libvlc_media_event_manager(media), libvlc_MediaFreed, &MulticastInput::onMediaFreed,
+                            input.get());
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry()[media] = input.release();
+        return media;
+    }
+
+    // Unblocks the read of the input feeding `media`, so a player stop does
+    // not wait on the network; a no-op for other media
+    static void interrupt(libvlc_media_t* media) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto it = registry().find(media);
+        if (it != registry().end()) it->second->interrupt();
+    }
+
+    static bool statsFor(libvlc_media_t* media, MulticastStats& stats) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto it = registry().find(media);
+        if (it == registry().end()) return false;
+        stats = it->second->stats();
+        return true;
+    }
+
+    bool start(std::string& error) {
+        if (receiver.joinable()) return true;
+        if (!valid) {
+            error = "Unsupported URL";
+            return false;
+        }
+        resetState();
+
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            error = "Winsock unavailable";
+            return false;
+        }
+        sock = WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+        if (sock == INVALID_SOCKET) {
+            error = "Cannot create socket";
+            WSACleanup();
+            return false;
+        }
+
+        BOOL reuse = TRUE;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        int bufferSize = SOCKET_BUFFER;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+        int optionLength = sizeof(bufferSize);
+        if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<char*>(&bufferSize), &optionLength) == 0) {
+            counters.socketBuffer = bufferSize;
+        }
+
+        // Multicast binds the wildcard address and joins; unicast binds its own
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = isMulticast() ? htonl(INADDR_ANY) : group.s_addr;
+        bool ok = bind(sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0;
+        if (ok && isMulticast()) {
+            if (hasSource) {
+                ip_mreq_source request = {};
+                request.imr_multiaddr = group;
+                request.imr_sourceaddr = source;
+                request.imr_interface.s_addr = htonl(INADDR_ANY);
+                ok = setsockopt(sock, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
+                                reinterpret_cast<const char*>(&request), sizeof(request)) == 0;
+            } else {
+                ip_mreq request = {};
+                request.imr_multiaddr = group;
+                request.imr_interface.s_addr = htonl(INADDR_ANY);
+                ok = setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                                reinterpret_cast<const char*>(&request), sizeof(request)) == 0;
+            }
+        }
+        completionPort = ok ? CreateIoCompletionPort(reinterpret_cast<HANDLE>(sock), nullptr, 0, 1) : nullptr;
+        if (!completionPort) {
+            error = ok ? "Cannot create completion port" : "Cannot bind or join " + url;
+            closesocket(sock);
+            sock = INVALID_SOCKET;
+            WSACleanup();
+            return false;
+        }
+
+        stopRequested.store(false);
+        outstanding = 0;
+        receives.reset(new Receive[RECEIVES]);
+        for (int i = 0; i < RECEIVES; i++) post(receives[i]);
+        receiver = std::thread(&MulticastInput::receiveLoop, this);
+        return true;
+    }
+
+    void stop() {
+        interrupt();
+        if (!receiver.joinable()) return;
+
+        // Closing the socket completes the posted receives with errors;
+        // the thread ends once all of them are back
+        stopRequested.store(true);
+        closesocket(sock);
+        PostQueuedCompletionStatus(completionPort, 0, WAKE_KEY, nullptr);
+        receiver.join();
+        CloseHandle(completionPort);
+        completionPort = nullptr;
+        sock = INVALID_SOCKET;
+        receives.reset();
+        WSACleanup();
+
+        MulticastStats summary = stats();
+        if (summary.datagrams > 0) {
+            NativeLog::instance().write(LogLevel::Info, LOG_EVENT_MULTICAST_CLOSED,
+                                        {static_cast<double>(summary.datagrams), static_cast<double>(summary.lost),
+                                         static_cast<double>(summary.reordered), summary.jitterMs},
+                                        NativeLog::jsonField("url", url));
+        }
+    }
+
+    // Blocks until payload is buffered. 0 at the end (interrupted), -1 when
+    // nothing has arrived for NO_DATA_TIMEOUT_MS.
+    ssize_t read(uint8_t* buffer, size_t length) {
+        std::unique_lock<std::mutex> lock(ringMutex);
+        if (!ringReady.wait_for(lock, std::chrono::milliseconds(NO_DATA_TIMEOUT_MS),
+                                [this] { return ringFilled > 0 || interrupted; })) {
+            return -1;
+        }
+        if (ringFilled == 0) return 0;
+        size_t count = std::min(length, ringFilled);
+        size_t first = std::min(count, RING_BYTES - ringHead);
+        memcpy(buffer, ring.data() + ringHead, first);
+        memcpy(buffer + first, ring.data(), count - first);
+        ringHead = (ringHead + count) % RING_BYTES;
+        ringFilled -= count;
+        return static_cast<ssize_t>(count);
+    }
+
+    void interrupt() {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        interrupted = true;
+        ringReady.notify_all();
+    }
+
+    MulticastStats stats() {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return published;
+    }
+};
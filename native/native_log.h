@@ -0,0 +1,576 @@
+#pragma once
+
+// Asynchronous binary logger.
+//
+// Producers (native call sites and the JS RotatingLogger) push fixed-size
+// binary records into a lock-free MPSC ring: a timestamp, level, event id,
+// up to four numeric arguments and an optional short text fragment. A
+// background thread drains the ring, formats lines, writes them with
+// buffered I/O, rotates by size and gzips rotated files. Producers never
+// block or touch the filesystem; if the ring is full the record is dropped
+// and counted.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "gzip_writer.h"
+#include "metrics.h"
+#include "win_util.h"
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3
+};
+
+// Event ids used by native call sites. Ids from FIRST_DYNAMIC_LOG_EVENT up
+// are handed out by defineEvent() (the JS logger defines one per message).
+enum NativeLogEvent : uint16_t {
+    LOG_EVENT_TEXT = 0,           // Preformatted line, text only
+    LOG_EVENT_ZAP_STARTED,        // text: url
+    LOG_EVENT_FIRST_FRAME,        // latencyMs
+    LOG_EVENT_PLAYER_ERROR,       // text: url
+    LOG_EVENT_STREAM_FROZEN,      // elapsedSeconds; text: url
+    LOG_EVENT_PLAYER_RECREATED,
+    LOG_EVENT_RECORDS_DROPPED,    // count
+    LOG_EVENT_STALL_PREDICTED,    // bufferedMs, trendMsPerSec; text: url
+    LOG_EVENT_STANDBY_PROMOTED,   // text: url
+    LOG_EVENT_COMMAND_DONE,       // queueMs, execMs; text: type, status
+    LOG_EVENT_CAPTURE_STARTED,    // part; text: channel, file
+    LOG_EVENT_CAPTURE_ENDED,      // minutes, parts; text: channel, status
+    LOG_EVENT_CAPTURE_FAILED,     // part; text: channel
+    LOG_EVENT_REMUX_DONE,         // seconds, inputMB, outputMB; text: file
+    LOG_EVENT_REMUX_FAILED,       // text: file, error
+    LOG_EVENT_RECORDING_SCANNED,  // syncErrors, continuityErrors, truncatedBytes, seconds; text: file
+    LOG_EVENT_RECORDING_EVICTED,  // sizeMB, ageHours; text: file
+    LOG_EVENT_PREVIEWS_BUILT,     // thumbnails, missing, seconds; text: file
+    LOG_EVENT_RECORDING_ANALYSED, // markers, breaks, speed; text: file
+    LOG_EVENT_RECORDING_ARCHIVED, // inputMB, outputMB, hours; text: file
+    LOG_EVENT_ARCHIVE_FAILED,     // text: file, error
+    LOG_EVENT_MULTICAST_CLOSED,   // datagrams, lost, reordered, jitterMs; text: url
+    LOG_EVENT_RELAY_CLIENT_CLOSED, // bytes, skippedBytes, seconds; text: address
+    LOG_EVENT_RELAY_UPSTREAM_FAILED, // text: url
+    LOG_EVENT_STREAM_FAILED,      // msSinceZap; text: reason, detail
+    FIRST_DYNAMIC_LOG_EVENT = 64
+};
+
+class NativeLog {
+public:
+    static constexpr int MAX_ARGS = 4;
+
+private:
+    static constexpr size_t RING_CAPACITY = 4096;    // Power of two
+    static constexpr size_t TEXT_PER_RECORD = 200;
+    static constexpr size_t MAX_CHUNKS = 16;         // Longer text is truncated
+    static constexpr int DRAIN_INTERVAL_MS = 50;
+
+    struct LogRecord {
+        int64_t timestampUs;      // Unix epoch, microseconds
+        double args[MAX_ARGS];
+        uint16_t eventId;
+        uint8_t level;
+        uint8_t argCount;
+        uint8_t chunkIndex;       // Long text spans consecutive records
+        uint8_t chunkCount;
+        uint16_t textLength;
+        char text[TEXT_PER_RECORD];
+    };
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    struct EventDef {
+        std::string message;
+        std::vector<std::string> argNames;
+    };
+
+    // Ring state (Vyukov bounded queue, single consumer)
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;
+    std::atomic<size_t> drainedPos{0};      // Consumer progress, read by producers as a hint
+    std::atomic<bool> accepting{false};
+    std::atomic<uint64_t> dropped{0};
+    MetricCounter& droppedMetric;
+
+    // Event definitions (rarely written, read by the drain thread)
+    std::mutex eventsMutex;
+    std::vector<EventDef> events;
+    std::unordered_map<std::string, uint16_t> eventIds;
+
+    // Output state, owned by the drain thread while running
+    std::thread drainer;
+    std::mutex controlMutex;
+    std::condition_variable wakeup;
+    bool running = false;
+    std::string logDir;
+    std::string baseName;
+    uint64_t maxSize = 5 * 1024 * 1024;
+    int maxFiles = 5;
+    FILE* file = nullptr;
+    uint64_t fileSize = 0;
+    std::vector<char> fileBuffer;
+    std::string line;
+
+    NativeLog()
+        : cells(new Cell[RING_CAPACITY]),
+          droppedMetric(MetricsRegistry::instance().counter(
+              "jptv_log_records_dropped_total", "Log records dropped because the ring was full")) {
+        for (size_t i = 0; i < RING_CAPACITY; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        events.resize(FIRST_DYNAMIC_LOG_EVENT);
+        events[LOG_EVENT_TEXT] = {"", {}};
+        events[LOG_EVENT_ZAP_STARTED] = {"Zap started", {}};
+        events[LOG_EVENT_FIRST_FRAME] = {"First frame", {"latencyMs"}};
+        events[LOG_EVENT_PLAYER_ERROR] = {"Player error", {}};
+        events[LOG_EVENT_STREAM_FROZEN] = {"Stream frozen", {"elapsedSeconds"}};
+        events[LOG_EVENT_PLAYER_RECREATED] = {"Media player recreated", {}};
+        events[LOG_EVENT_RECORDS_DROPPED] = {"Log records dropped", {"count"}};
+        events[LOG_EVENT_STALL_PREDICTED] = {"Stall predicted", {"bufferedMs", "trendMsPerSec"}};
+        events[LOG_EVENT_STANDBY_PROMOTED] = {"Standby player promoted", {}};
+        events[LOG_EVENT_COMMAND_DONE] = {"Player command done", {"queueMs", "execMs"}};
+        events[LOG_EVENT_CAPTURE_STARTED] = {"Scheduled recording started", {"part"}};
+        events[LOG_EVENT_CAPTURE_ENDED] = {"Scheduled recording ended", {"minutes", "parts"}};
+        events[LOG_EVENT_CAPTURE_FAILED] = {"Scheduled recording input failed", {"part"}};
+        events[LOG_EVENT_REMUX_DONE] = {"Recording remuxed", {"seconds", "inputMB", "outputMB"}};
+        events[LOG_EVENT_REMUX_FAILED] = {"Recording remux failed", {}};
+        events[LOG_EVENT_RECORDING_SCANNED] = {"Recording scanned",
+                                               {"syncErrors", "continuityErrors", "truncatedBytes", "seconds"}};
+        events[LOG_EVENT_RECORDING_EVICTED] = {"Recording evicted", {"sizeMB", "ageHours"}};
+        events[LOG_EVENT_PREVIEWS_BUILT] = {"Preview strip built", {"thumbnails", "missing", "seconds"}};
+        events[LOG_EVENT_RECORDING_ANALYSED] = {"Recording chapters found", {"markers", "breaks", "speed"}};
+        events[LOG_EVENT_RECORDING_ARCHIVED] = {"Recording archived", {"inputMB", "outputMB", "hours"}};
+        events[LOG_EVENT_ARCHIVE_FAILED] = {"Recording archive failed", {}};
+        events[LOG_EVENT_MULTICAST_CLOSED] = {"Multicast input closed", {"datagrams", "lost", "reordered", "jitterMs"}};
+        events[LOG_EVENT_RELAY_CLIENT_CLOSED] = {"Relay client disconnected", {"bytes", "skippedBytes", "seconds"}};
+        events[LOG_EVENT_RELAY_UPSTREAM_FAILED] = {"Relay upstream failed", {}};
+        events[LOG_EVENT_STREAM_FAILED] = {"Stream failed", {"msSinceZap"}};
+    }
+
+    static int64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Reserve `count` consecutive cells. Cells are released in order by the
+    // single consumer, so if the last one is free all of them are.
+    bool reserve(size_t count, size_t& pos) {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& last = cells[(pos + count - 1) & (RING_CAPACITY - 1)];
+            size_t seq = last.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + count - 1);
+
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // ISO 8601 UTC timestamp without platform time APIs (civil-from-days)
+    static void appendTimestamp(std::string& out, int64_t us) {
+        int64_t secs = us / 1000000;
+        int millis = static_cast<int>((us / 1000) % 1000);
+        int64_t days = secs / 86400;
+        int secOfDay = static_cast<int>(secs % 86400);
+
+        days += 719468;
+        int64_t era = days / 146097;
+        int64_t doe = days - era * 146097;
+        int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int64_t mp = (5 * doy + 2) / 153;
+        int day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+        int month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+        int year = static_cast<int>(yoe + era * 400 + (month <= 2 ? 1 : 0));
+
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                 year, month, day, secOfDay / 3600, (secOfDay / 60) % 60, secOfDay % 60, millis);
+        out += buf;
+    }
+
+    static void appendNumber(std::string& out, double v) {
+        char buf[32];
+        if (v == static_cast<double>(static_cast<int64_t>(v)) && v > -9e15 && v < 9e15) {
+            snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+        } else {
+            snprintf(buf, sizeof(buf), "%.6g", v);
+        }
+        out += buf;
+    }
+
+    // Same line layout as RotatingLogger: [ts] [LEVEL] message {meta}
+    void formatRecord(const LogRecord& head, const std::string& text) {
+        static const char* levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+        line.clear();
+        line += '[';
+        appendTimestamp(line, head.timestampUs);
+        line += "] [";
+        line += levelNames[head.level & 3];
+        line += "] ";
+
+        if (head.eventId == LOG_EVENT_TEXT) {
+            line += text;
+            line += '\n';
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            if (head.eventId < events.size()) {
+                const EventDef& def = events[head.eventId];
+                line += def.message;
+
+                if (head.argCount > 0 || !text.empty()) {
+                    line += " {";
+                    for (int i = 0; i < head.argCount; i++) {
+                        if (i > 0) line += ',';
+                        line += '"';
+                        line += i < static_cast<int>(def.argNames.size()) ? def.argNames[i] : "arg" + std::to_string(i);
+                        line += "\":";
+                        appendNumber(line, head.args[i]);
+                    }
+                    if (!text.empty()) {
+                        if (head.argCount > 0) line += ',';
+                        line += text;
+                    }
+                    line += '}';
+                }
+            } else {
+                line += "Unknown event " + std::to_string(head.eventId);
+            }
+        }
+        line += '\n';
+    }
+
+    std::wstring pathFor(int index, bool compressed) const {
+        std::string name = baseName + (index > 0 ? "." + std::to_string(index) : "") + ".log";
+        if (compressed) name += ".gz";
+        return utf8ToWide(logDir + "\\" + name);
+    }
+
+    bool openFile() {
+        file = _wfopen(pathFor(0, false).c_str(), L"ab");
+        if (!file) {
+            return false;
+        }
+        fileBuffer.resize(64 * 1024);
+        setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+        // Size is read once here and tracked in memory from then on
+        uint64_t size = 0;
+        fileSize = getFileSize(wideToUtf8(pathFor(0, false)), size) ? size : 0;
+        return true;
+    }
+
+    void compressFile(const std::wstring& source, const std::wstring& target) {
+        FILE* in = _wfopen(source.c_str(), L"rb");
+        if (!in) return;
+
+        std::vector<uint8_t> data;
+        uint8_t chunk[64 * 1024];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+            data.insert(data.end(), chunk, chunk + n);
+        }
+        fclose(in);
+
+        GzipWriter gzip;
+        std::vector<uint8_t> compressed = gzip.compress(data.data(), data.size());
+
+        std::wstring temp = target + L".tmp";
+        FILE* out = _wfopen(temp.c_str(), L"wb");
+        if (!out) return;
+        bool ok = fwrite(compressed.data(), 1, compressed.size(), out) == compressed.size();
+        ok = (fclose(out) == 0) && ok;
+
+        if (ok && MoveFileExW(temp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileW(source.c_str());
+        } else {
+            DeleteFileW(temp.c_str());
+        }
+    }
+
+    // vlc-player.log -> vlc-player.1.log.gz, shifting older archives up
+    void rotate() {
+        fclose(file);
+        file = nullptr;
+
+        DeleteFileW(pathFor(maxFiles, true).c_str());
+        for (int i = maxFiles - 1; i > 0; i--) {
+            MoveFileExW(pathFor(i, true).c_str(), pathFor(i + 1, true).c_str(), MOVEFILE_REPLACE_EXISTING);
+        }
+
+        std::wstring rotated = pathFor(1, false);
+        bool moved = MoveFileExW(pathFor(0, false).c_str(), rotated.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+
+        // Reopen before compressing so a slow compress only delays draining
+        openFile();
+        if (moved) {
+            compressFile(rotated, pathFor(1, true));
+        }
+    }
+
+    void writeLine() {
+        if (!file) return;
+        fwrite(line.data(), 1, line.size(), file);
+        fileSize += line.size();
+        if (fileSize >= maxSize) {
+            rotate();
+        }
+    }
+
+    // Drain everything currently published. Returns number of lines written.
+    size_t drain() {
+        size_t written = 0;
+        std::string text;
+
+        while (true) {
+            Cell& headCell = cells[dequeuePos & (RING_CAPACITY - 1)];
+            size_t seq = headCell.sequence.load(std::memory_order_acquire);
+            if (seq != dequeuePos + 1) {
+                break; // Empty (or head not yet published)
+            }
+
+            const LogRecord& head = headCell.record;
+            size_t chunks = head.chunkCount > 0 ? head.chunkCount : 1;
+            text.assign(head.text, head.textLength);
+
+            // Continuation cells were reserved together with the head and
+            // are published by the same producer momentarily
+            for (size_t i = 1; i < chunks; i++) {
+                Cell& cell = cells[(dequeuePos + i) & (RING_CAPACITY - 1)];
+                while (cell.sequence.load(std::memory_order_acquire) != dequeuePos + i + 1) {
+                    std::this_thread::yield();
+                }
+                text.append(cell.record.text, cell.record.textLength);
+            }
+
+            formatRecord(head, text);
+
+            for (size_t i = 0; i < chunks; i++) {
+                Cell& cell = cells[(dequeuePos + i) & (RING_CAPACITY - 1)];
+                cell.sequence.store(dequeuePos + i + RING_CAPACITY, std::memory_order_release);
+            }
+            dequeuePos += chunks;
+
+            writeLine();
+            written++;
+        }
+        drainedPos.store(dequeuePos, std::memory_order_relaxed);
+
+        uint64_t lost = dropped.exchange(0);
+        if (lost > 0) {
+            LogRecord note{};
+            note.timestampUs = nowUs();
+            note.eventId = LOG_EVENT_RECORDS_DROPPED;
+            note.level = static_cast<uint8_t>(LogLevel::Warn);
+            note.argCount = 1;
+            note.args[0] = static_cast<double>(lost);
+            formatRecord(note, std::string());
+            writeLine();
+            written++;
+        }
+
+        return written;
+    }
+
+    void run() {
+        while (true) {
+            if (drain() > 0 && file) {
+                fflush(file);
+            }
+
+            std::unique_lock<std::mutex> lock(controlMutex);
+            if (!running) break;
+            wakeup.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS), [this] { return !running; });
+        }
+
+        // Final drain after producers have been cut off
+        drain();
+        if (file) {
+            fflush(file);
+        }
+    }
+
+public:
+    static NativeLog& instance() {
+        static NativeLog log;
+        return log;
+    }
+
+    bool open(const std::string& dir, const std::string& name, uint64_t maxLogSize, int maxLogFiles) {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        if (running) {
+            return true;
+        }
+
+        logDir = dir;
+        baseName = name;
+        maxSize = maxLogSize > 0 ? maxLogSize : maxSize;
+        maxFiles = maxLogFiles > 0 ? maxLogFiles : maxFiles;
+
+        CreateDirectoryW(utf8ToWide(logDir).c_str(), nullptr);
+        if (!openFile()) {
+            return false;
+        }
+
+        running = true;
+        accepting.store(true, std::memory_order_release);
+        drainer = std::thread(&NativeLog::run, this);
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(controlMutex);
+            if (!running) return;
+            accepting.store(false, std::memory_order_release);
+            running = false;
+        }
+        wakeup.notify_all();
+
+        if (drainer.joinable()) {
+            drainer.join();
+        }
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    bool isOpen() const {
+        return accepting.load(std::memory_order_acquire);
+    }
+
+    // Define (or look up) an event; the same message and argument names
+    // always map to the same id.
+    uint16_t defineEvent(const std::string& message, const std::vector<std::string>& argNames) {
+        std::string key = message;
+        for (const auto& name : argNames) {
+            key += '\0';
+            key += name;
+        }
+
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        auto it = eventIds.find(key);
+        if (it != eventIds.end()) {
+            return it->second;
+        }
+        if (events.size() >= 0xFFFF) {
+            return LOG_EVENT_TEXT;
+        }
+
+        uint16_t id = static_cast<uint16_t>(events.size());
+        events.push_back({message, argNames});
+        eventIds.emplace(key, id);
+        return id;
+    }
+
+    // Hot path: lock-free, never blocks, never allocates
+    void write(LogLevel level, uint16_t eventId, const double* args, int argCount,
+               const char* text = nullptr, size_t textLength = 0) {
+        if (!accepting.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        if (argCount > MAX_ARGS) argCount = MAX_ARGS;
+        if (textLength > TEXT_PER_RECORD * MAX_CHUNKS) textLength = TEXT_PER_RECORD * MAX_CHUNKS;
+        size_t chunks = textLength > 0 ? (textLength + TEXT_PER_RECORD - 1) / TEXT_PER_RECORD : 1;
+
+        size_t pos;
+        if (!reserve(chunks, pos)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            droppedMetric.inc();
+            return;
+        }
+
+        int64_t timestamp = nowUs();
+        for (size_t i = 0; i < chunks; i++) {
+            Cell& cell = cells[(pos + i) & (RING_CAPACITY - 1)];
+            LogRecord& r = cell.record;
+            r.timestampUs = timestamp;
+            r.eventId = eventId;
+            r.level = static_cast<uint8_t>(level);
+            r.argCount = static_cast<uint8_t>(i == 0 ? argCount : 0);
+            for (int a = 0; a < argCount && i == 0; a++) {
+                r.args[a] = args[a];
+            }
+            r.chunkIndex = static_cast<uint8_t>(i);
+            r.chunkCount = static_cast<uint8_t>(chunks);
+
+            size_t offset = i * TEXT_PER_RECORD;
+            size_t length = textLength > offset ? textLength - offset : 0;
+            if (length > TEXT_PER_RECORD) length = TEXT_PER_RECORD;
+            if (length > 0) {
+                memcpy(r.text, text + offset, length);
+            }
+            r.textLength = static_cast<uint16_t>(length);
+
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+
+        // Bursts: wake the drainer early instead of waiting for its tick
+        if (pos + chunks - drainedPos.load(std::memory_order_relaxed) > RING_CAPACITY / 2) {
+            wakeup.notify_one();
+        }
+    }
+
+    void write(LogLevel level, uint16_t eventId, std::initializer_list<double> args = {},
+               const std::string& text = std::string()) {
+        write(level, eventId, args.begin(), static_cast<int>(args.size()), text.data(), text.size());
+    }
+
+    // Helper for native call sites that attach a string field
+    static std::string jsonField(const char* name, const std::string& value) {
+        std::string out = "\"";
+        out += name;
+        out += "\":\"";
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buf[8];
+                        snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+        return out;
+    }
+};
@@ -0,0 +1,334 @@
+#pragma once
+
+// Scrub-preview strips for recordings: one small thumbnail every N seconds
+// in "<recording>.thumbs", so a seek bar can show the picture under the
+// cursor straight from disk instead of seeking a player.
+//
+// A strip is built off screen by a libvlc player with no audio, no vout
+// window (vmem callbacks) and only keyframes decoded. Each thumbnail is a
+// byte-position seek to the keyframe the recording's seek index lists for
+// that time - no time-based seek, which has the TS demuxer bisect the file
+// - followed by the first picture out of the decoder. Pictures arrive as
+// BGRA at the source size and are box-filtered down (row sums in SSE2)
+// straight into RGB565, which halves the strip against BGRA at no visible
+// cost at thumbnail size.
+
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "shared_libvlc.h"
+#include "ts_scanner.h"
+#include "win_util.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PREVIEW_STRIP_SSE2 1
+#endif
+
+struct PreviewStripOptions {
+    uint32_t intervalMs = 10000;
+    uint16_t width = 160;
+    uint16_t height = 90;
+};
+
+struct PreviewStripReport {
+    bool ok = false;
+    std::string error;
+    uint32_t count = 0;             // Thumbnails in the strip
+    uint32_t missing = 0;           // Filled from the previous one (no picture in time)
+    double elapsedMs = 0;
+};
+
+class PreviewStrip {
+private:
+    static constexpr char MAGIC[8] = {'J', 'P', 'T', 'V', 'T', 'H', 'M', '1'};
+    static constexpr int FRAME_TIMEOUT_MS = 3000;
+    static constexpr uint32_t MAX_MISSES = 5;          // In a row: the file has no decodable video
+    static constexpr unsigned MAX_SOURCE_WIDTH = 1920; // Larger sources are scaled by VLC first
+    static constexpr unsigned MAX_ROWS = 256;          // 16-bit row sums hold 256 * 255
+
+#pragma pack(push, 1)
+    struct Header {
+        char magic[8];
+        uint32_t count;
+        uint32_t intervalMs;
+        uint16_t width;
+        uint16_t height;
+        uint32_t durationMs;
+    };
+#pragma pack(pop)
+
+    // Frame hand-off between the vmem callbacks (decoder thread) and build()
+    struct Capture {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::vector<uint8_t> frame;
+        unsigned width = 0;
+        unsigned height = 0;
+        uint16_t* target = nullptr;     // Set while a thumbnail is wanted
+        bool captured = false;
+        uint16_t thumbWidth = 0;
+        uint16_t thumbHeight = 0;
+        std::vector<uint16_t> rowSums;
+    };
+
+    static unsigned setup(void** opaque, char* chroma, unsigned* width, unsigned* height,
+                          unsigned* pitches, unsigned* lines) {
+        Capture* capture = static_cast<Capture*>(*opaque);
+        memcpy(chroma, "RV32", 4);
+        while (*width > MAX_SOURCE_WIDTH) {
+            *width /= 2;
+            *height /= 2;
+        }
+        std::lock_guard<std::mutex> lock(capture->mutex);
+        capture->width = *width;
+        capture->height = *height;
+        capture->frame.assign(static_cast<size_t>(*width) * *height * 4, 0);
+        pitches[0] = *width * 4;
+        lines[0] = *height;
+        return 1;
+    }
+
+    static void* lock(void* opaque, void** planes) {
+        planes[0] = static_cast<Capture*>(opaque)->frame.data();
+        return nullptr;
+    }
+
+    static void display(void* opaque, void*) {
+        Capture* capture = static_cast<Capture*>(opaque);
+        std::lock_guard<std::mutex> lock(capture->mutex);
+        if (!capture->target || capture->captured) return;
+        downscale(capture->frame.data(), capture->width, capture->height, capture->width * 4,
+                  capture->target, capture->thumbWidth, capture->thumbHeight, capture->rowSums);
+        capture->captured = true;
+        capture->ready.notify_all();
+    }
+
+    // Adds one row of bytes into 16-bit sums
+    static void addRow(const uint8_t* row, uint16_t* sums, size_t bytes) {
+        size_t i = 0;
+#ifdef PREVIEW_STRIP_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            __m128i* low = reinterpret_cast<__m128i*>(sums + i);
+            __m128i* high = reinterpret_cast<__m128i*>(sums + i + 8);
+            _mm_storeu_si128(low, _mm_add_epi16(_mm_loadu_si128(low), _mm_unpacklo_epi8(pixels, zero)));
+            _mm_storeu_si128(high, _mm_add_epi16(_mm_loadu_si128(high), _mm_unpackhi_epi8(pixels, zero)));
+        }
+#endif
+        for (; i < bytes; i++) sums[i] = static_cast<uint16_t>(sums[i] + row[i]);
+    }
+
+    // Box filter from BGRA to RGB565: each output row sums its band of source
+    // rows, then each pixel averages its span of columns in that sum
+    static void downscale(const uint8_t* source, unsigned sourceWidth, unsigned sourceHeight, size_t pitch,
+                          uint16_t* target, unsigned width, unsigned height, std::vector<uint16_t>& rowSums) {
+        rowSums.resize(static_cast<size_t>(sourceWidth) * 4);
+        for (unsigned y = 0; y < height; y++) {
+            unsigned y0 = y * sourceHeight / height;
+            unsigned y1 = std::max(y0 + 1, (y + 1) * sourceHeight / height);
+            unsigned rows = std::min(y1 - y0, MAX_ROWS);
+            std::fill(rowSums.begin(), rowSums.end(), 0);
+            for (unsigned row = 0; row < rows; row++) {
+                addRow(source + (y0 + row) * pitch, rowSums.data(), rowSums.size());
+            }
+
+            for (unsigned x = 0; x < width; x++) {
+                unsigned x0 = x * sourceWidth / width;
+                unsigned x1 = std::max(x0 + 1, (x + 1) * sourceWidth / width);
+                uint32_t b = 0, g = 0, r = 0;
+                for (unsigned column = x0; column < x1; column++) {
+                    b += rowSums[column * 4];
+                    g += rowSums[column * 4 + 1];
+                    r += rowSums[column * 4 + 2];
+                }
+                uint32_t count = rows * (x1 - x0);
+                b /= count;
+                g /= count;
+                r /= count;
+                target[y * width + x] = static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+            }
+        }
+    }
+
+    static std::string stripPath(const std::string& recording) {
+        return recording + ".thumbs";
+    }
+
+public:
+    // Builds "<recording>.thumbs" from the recording and its seek index
+    // (written by a scan). Slow - a seek and a decode per thumbnail - so it
+    // belongs on a worker thread; cancelled is polled between thumbnails.
+    static PreviewStripReport build(const std::string& recording, const PreviewStripOptions& options,
+                                    std::atomic<uint32_t>& progress, const std::atomic<bool>& cancelled) {
+        PreviewStripReport report;
+        auto started = std::chrono::steady_clock::now();
+
+        TsSeekIndex index;
+        if (!TsScanner::loadIndex(recording, index) || index.points.empty() || index.fileSize == 0) {
+            report.error = "No seek index";
+            return report;
+        }
+        if (options.intervalMs == 0 || options.width == 0 || options.height == 0) {
+            report.error = "Invalid strip size";
+            return report;
+        }
+        std::shared_ptr<libvlc_instance_t> vlc = SharedLibvlc::instance().acquire();
+        if (!vlc) {
+            report.error = "libvlc unavailable";
+            return report;
+        }
+
+        uint32_t count = index.durationMs / options.intervalMs + 1;
+        size_t thumbPixels = static_cast<size_t>(options.width) * options.height;
+        std::vector<uint16_t> thumbs(thumbPixels * count, 0);
+
+        libvlc_media_t* media = libvlc_media_new_path(vlc.get(), recording.c_str());
+        if (!media) {
+            report.error = "Cannot open recording";
+            return report;
+        }
+        // Keyframes only, one decoder thread, no audio, subtitles or caching
+        libvlc_media_add_option(media, ":no-audio");
+        libvlc_media_add_option(media, ":no-spu");
+        libvlc_media_add_option(media, ":avcodec-skip-frame=3");
+        libvlc_media_add_option(media, ":avcodec-hw=none");
+        libvlc_media_add_option(media, ":avcodec-threads=1");
+        libvlc_media_add_option(media, ":file-caching=0");
+        libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!player) {
+            report.error = "Cannot create player";
+            return report;
+        }
+
+        Capture capture;
+        capture.thumbWidth = options.width;
+        capture.thumbHeight = options.height;
+        libvlc_video_set_callbacks(player, &PreviewStrip::lock, nullptr, &PreviewStrip::display, &capture);
+        libvlc_video_set_format_callbacks(player, &PreviewStrip::setup, nullptr);
+
+        // The first thumbnail is the first picture; the rest are seeks
+        {
+            std::lock_guard<std::mutex> lock(capture.mutex);
+            capture.target = thumbs.data();
+        }
+        libvlc_media_player_play(player);
+
+        uint32_t misses = 0;
+        for (uint32_t i = 0; i < count && !cancelled.load(); i++) {
+            uint16_t* slot = thumbs.data() + thumbPixels * i;
+            if (i > 0) {
+                const TsSeekIndex::Point* point = index.find(i * options.intervalMs);
+                {
+                    std::lock_guard<std::mutex> lock(capture.mutex);
+                    capture.target = slot;
+                    capture.captured = false;
+                }
+                libvlc_media_player_set_position(player, static_cast<float>(
+                    static_cast<double>(point->offset) / index.fileSize));
+            }
+
+            std::unique_lock<std::mutex> lock(capture.mutex);
+            bool captured = capture.ready.wait_for(lock, std::chrono::milliseconds(FRAME_TIMEOUT_MS),
+                                                   [&capture] { return capture.captured; });
+            capture.target = nullptr;
+            lock.unlock();
+
+            if (!captured) {
+                report.missing++;
+                if (i > 0) memcpy(slot, slot - thumbPixels, thumbPixels * sizeof(uint16_t));
+                if (++misses >= MAX_MISSES) {
+                    report.error = "No video pictures";
+                    break;
+                }
+            } else {
+                misses = 0;
+            }
+            progress.store(i + 1);
+        }
+        libvlc_media_player_stop(player);
+        libvlc_media_player_release(player);
+        if (!report.error.empty()) return report;
+        if (cancelled.load()) {
+            report.error = "Cancelled";
+            return report;
+        }
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.count = count;
+        header.intervalMs = options.intervalMs;
+        header.width = options.width;
+        header.height = options.height;
+        header.durationMs = index.durationMs;
+
+        // Write-then-rename so a reader never sees half a strip
+        std::string path = stripPath(recording);
+        std::string tempPath = path + ".tmp";
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) {
+            report.error = "Cannot write strip";
+            return report;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  fwrite(thumbs.data(), sizeof(uint16_t), thumbs.size(), f) == thumbs.size();
+        ok = fclose(f) == 0 && ok;
+        if (!ok || !MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileW(utf8ToWide(tempPath).c_str());
+            report.error = "Cannot write strip";
+            return report;
+        }
+
+        report.ok = true;
+        report.count = count;
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return report;
+    }
+
+    // The thumbnail for timeMs as BGRA (what a bitmap wants), or false if the
+    // recording has no strip. Reads just that thumbnail.
+    static bool read(const std::string& recording, uint32_t timeMs, std::vector<uint8_t>& bgra,
+                     uint16_t& width, uint16_t& height) {
+        FILE* f = _wfopen(utf8ToWide(stripPath(recording)).c_str(), L"rb");
+        if (!f) return false;
+        Header header;
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                  header.count > 0 && header.intervalMs > 0;
+        std::vector<uint16_t> pixels;
+        if (ok) {
+            size_t thumbPixels = static_cast<size_t>(header.width) * header.height;
+            uint32_t slot = std::min(timeMs / header.intervalMs, header.count - 1);
+            pixels.resize(thumbPixels);
+            ok = _fseeki64(f, static_cast<int64_t>(sizeof(header) + thumbPixels * sizeof(uint16_t) * slot),
+                           SEEK_SET) == 0 &&
+                 fread(pixels.data(), sizeof(uint16_t), thumbPixels, f) == thumbPixels;
+        }
+        fclose(f);
+        if (!ok) return false;
+
+        width = header.width;
+        height = header.height;
+        bgra.resize(pixels.size() * 4);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            uint16_t p = pixels[i];
+            uint8_t r = static_cast<uint8_t>(p >> 11), g = static_cast<uint8_t>((p >> 5) & 0x3F),
+                    b = static_cast<uint8_t>(p & 0x1F);
+            bgra[i * 4] = static_cast<uint8_t>((b << 3) | (b >> 2));
+            bgra[i * 4 + 1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+            bgra[i * 4 + 2] = static_cast<uint8_t>((r << 3) | (r >> 2));
+            bgra[i * 4 + 3] = 255;
+        }
+        return true;
+    }
+};
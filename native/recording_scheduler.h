@@ -0,0 +1,914 @@
+#pragma once
+
+// Scheduled recordings, driven by EPG programmes and a persisted rule set.
+//
+// Rules:
+//  - series: every programme with a given title (ASCII case and spacing
+//    folded), on one channel or any;
+//  - slot: a channel at a local time of day on selected weekdays;
+//  - once: a channel between two instants ("record this programme").
+// Each match becomes a job whose start (minus pre-padding) and stop (plus
+// post-padding) are armed on a TimerWheel. Series rules are indexed by title
+// and so are programmes, so an EPG refresh only looks at the programmes
+// that changed - one hash lookup each - and a new rule only at programmes
+// with its title; rules are never rescanned against the whole guide.
+//
+// Captures are headless players on the shared libvlc instance with a file
+// sout: passthrough, no decoding and no window, so they run whatever the
+// main player is doing. A channel with a PID selection goes through a
+// TsPipeRecorder that keeps only its programme, fed the input as it arrives
+// (demux dump) where that is TS, remuxed to TS where it is not (HLS, RTP).
+// An input that fails or ends before the stop time is reopened into a new
+// part file after CAPTURE_RETRY_MS.
+
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+#include "native_log.h"
+#include "recording_storage.h"
+#include "reliability_store.h"
+#include "remux_queue.h"
+#include "shared_libvlc.h"
+#include "stream_failure.h"
+#include "timer_wheel.h"
+#include "ts_pipe_recorder.h"
+#include "win_util.h"
+
+enum class ScheduleRuleKind : uint8_t { Series = 0, Slot = 1, Once = 2 };
+
+struct ScheduleRule {
+    uint32_t id = 0;
+    ScheduleRuleKind kind = ScheduleRuleKind::Series;
+    bool enabled = true;
+    std::string channelId;      // Series: "" = any channel
+    std::string title;          // Series: title to match; others: used in file names
+    int64_t startMs = 0;        // Once (Unix epoch)
+    int64_t stopMs = 0;
+    uint8_t weekdays = 0;       // Slot: bit 0 = Sunday, local time
+    int32_t slotMinute = 0;     // Slot: minutes after local midnight
+    int32_t durationMin = 0;    // Slot
+    int32_t prePadSec = 60;
+    int32_t postPadSec = 300;
+};
+
+enum class RecordingJobState : uint8_t { Armed, Recording, Done, Failed, Cancelled };
+
+inline const char* recordingJobStateName(RecordingJobState state) {
+    switch (state) {
+        case RecordingJobState::Armed: return "armed";
+        case RecordingJobState::Recording: return "recording";
+        case RecordingJobState::Done: return "done";
+        case RecordingJobState::Failed: return "failed";
+        case RecordingJobState::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+struct RecordingJobInfo {
+    uint64_t id = 0;
+    uint32_t ruleId = 0;
+    std::string channelId;
+    std::string title;
+    int64_t startMs = 0;        // Padded
+    int64_t stopMs = 0;
+    RecordingJobState state = RecordingJobState::Armed;
+    std::string filePath;       // Latest part
+    int parts = 0;
+};
+
+struct ScheduleProgramme {
+    std::string title;
+    int64_t startMs = 0;
+    int64_t stopMs = 0;
+};
+
+class RecordingScheduler {
+private:
+    static constexpr char MAGIC[8] = {'J', 'P', 'T', 'V', 'S', 'C', 'H', '1'};
+    static constexpr uint32_t MAX_RULES = 100000;
+    static constexpr uint32_t MAX_FIELD = 4096;
+    static constexpr int TICK_MS = 1000;
+    static constexpr int64_t CAPTURE_RETRY_MS = 10000;
+    static constexpr size_t RECENT_LIMIT = 100;
+
+#pragma pack(push, 1)
+    struct RuleRecord {
+        uint32_t id;
+        uint8_t kind;
+        uint8_t enabled;
+        uint8_t weekdays;
+        uint8_t reserved;
+        int64_t startMs;
+        int64_t stopMs;
+        int32_t slotMinute;
+        int32_t durationMin;
+        int32_t prePadSec;
+        int32_t postPadSec;
+        uint32_t channelLength;
+        uint32_t titleLength;
+    };
+#pragma pack(pop)
+
+    struct Programme {
+        std::string title;
+        std::string key;            // Folded title
+        int64_t stopMs;
+    };
+
+    struct Channel {
+        std::string name;
+        std::vector<std::string> urls;
+        TsPidSelection pids;
+    };
+
+    struct Capture {
+        libvlc_media_player_t* player = nullptr;
+        std::unique_ptr<TsPipeRecorder> filter;
+        std::string path;
+        std::atomic<bool> broken{false};        // Set from libvlc's event thread
+        uint64_t failureWatch = 0;              // Claims its log lines from the main player's watch
+    };
+
+    struct Job {
+        RecordingJobInfo info;
+        std::string key;            // channel + programme start
+        int64_t programmeStartMs = 0;
+        int64_t recordingSinceMs = 0;
+        int64_t retryAtMs = 0;
+        std::unique_ptr<Capture> capture;
+    };
+
+    std::mutex schedulerMutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running = false;
+    std::string rulesPath;
+    std::string recordingsPath;
+
+    std::map<uint32_t, ScheduleRule> rules;
+    uint32_t nextRuleId = 1;
+    std::unordered_map<std::string, std::vector<uint32_t>> seriesByTitle;
+
+    std::unordered_map<std::string, Channel> channels;
+    std::unordered_map<std::string, std::map<int64_t, Programme>> programmes;     // channel -> start ->
+    std::unordered_map<std::string, std::set<std::pair<std::string, int64_t>>> programmesByTitle;
+
+    std::unique_ptr<TimerWheel> wheel;
+    std::unordered_map<uint64_t, std::unique_ptr<Job>> jobs;
+    std::unordered_map<std::string, uint64_t> jobByKey;
+    std::unordered_map<uint32_t, std::set<uint64_t>> jobsByRule;
+    std::vector<RecordingJobInfo> recent;
+    uint64_t nextJobId = 1;
+    int captures = 0;
+    std::shared_ptr<libvlc_instance_t> libvlc;       // Held while anything is capturing
+
+    RecordingScheduler() = default;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Series titles match ignoring ASCII case and runs of whitespace
+    static std::string foldTitle(const std::string& title) {
+        std::string folded;
+        folded.reserve(title.size());
+        bool space = false;
+        for (unsigned char c : title) {
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                space = !folded.empty();
+                continue;
+            }
+            if (space) {
+                folded.push_back(' ');
+                space = false;
+            }
+            folded.push_back(static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c));
+        }
+        return folded;
+    }
+
+    static std::string jobKey(const std::string& channelId, int64_t programmeStartMs) {
+        return channelId + '\n' + std::to_string(programmeStartMs);
+    }
+
+    static std::string sanitize(const std::string& name) {
+        std::string out;
+        for (unsigned char c : name) {
+            if (strchr("<>:\"/\\|?*", c) || c < 0x20) {
+                out.push_back('_');
+            } else if (c == ' ') {
+                out.push_back('_');
+            } else {
+                out.push_back(static_cast<char>(c));
+            }
+        }
+        // Cut on a UTF-8 boundary
+        size_t limit = 50;
+        if (out.size() > limit) {
+            while (limit > 0 && (static_cast<unsigned char>(out[limit]) & 0xC0) == 0x80) limit--;
+            out.resize(limit);
+        }
+        return out;
+    }
+
+    // Must hold schedulerMutex
+    void indexRule(const ScheduleRule& rule) {
+        if (rule.kind == ScheduleRuleKind::Series) {
+            seriesByTitle[foldTitle(rule.title)].push_back(rule.id);
+        }
+    }
+
+    void unindexRule(const ScheduleRule& rule) {
+        if (rule.kind != ScheduleRuleKind::Series) return;
+        auto it = seriesByTitle.find(foldTitle(rule.title));
+        if (it == seriesByTitle.end()) return;
+        it->second.erase(std::remove(it->second.begin(), it->second.end(), rule.id), it->second.end());
+        if (it->second.empty()) seriesByTitle.erase(it);
+    }
+
+    // Must hold schedulerMutex
+    void armJob(const ScheduleRule& rule, const std::string& channelId, const std::string& title,
+                int64_t programmeStartMs, int64_t programmeStopMs, int64_t now) {
+        std::string key = jobKey(channelId, programmeStartMs);
+        int64_t startMs = programmeStartMs - static_cast<int64_t>(rule.prePadSec) * 1000;
+        int64_t stopMs = programmeStopMs + static_cast<int64_t>(rule.postPadSec) * 1000;
+        if (stopMs <= now || stopMs <= startMs || jobByKey.count(key)) {
+            return;
+        }
+
+        std::unique_ptr<Job> job(new Job());
+        uint64_t id = nextJobId++;
+        job->info.id = id;
+        job->info.ruleId = rule.id;
+        job->info.channelId = channelId;
+        job->info.title = title;
+        job->info.startMs = startMs;
+        job->info.stopMs = stopMs;
+        job->key = key;
+        job->programmeStartMs = programmeStartMs;
+
+        wheel->schedule(id << 1, startMs);
+        wheel->schedule((id << 1) | 1, stopMs);
+        jobByKey[key] = id;
+        jobsByRule[rule.id].insert(id);
+        jobs[id] = std::move(job);
+        PlayerMetrics::get().recordingsArmed.add(1);
+    }
+
+    // A programme may match several series rules; the first one enabled for
+    // its channel owns the job. Must hold schedulerMutex.
+    void evaluateProgramme(const std::string& channelId, int64_t startMs, const Programme& programme, int64_t now) {
+        auto it = seriesByTitle.find(programme.key);
+        if (it == seriesByTitle.end()) return;
+        for (uint32_t ruleId : it->second) {
+            const ScheduleRule& rule = rules[ruleId];
+            if (rule.enabled && (rule.channelId.empty() || rule.channelId == channelId)) {
+                armJob(rule, channelId, programme.title, startMs, programme.stopMs, now);
+                return;
+            }
+        }
+    }
+
+    // Next occurrence of a slot rule that has not ended yet (local time)
+    void armNextSlot(const ScheduleRule& rule, int64_t now) {
+        if (!rule.enabled || rule.weekdays == 0 || rule.durationMin <= 0) return;
+
+        time_t seconds = static_cast<time_t>(now / 1000);
+        std::tm today = {};
+        localtime_s(&today, &seconds);
+        for (int day = -1; day <= 7; day++) {
+            std::tm occurrence = today;
+            occurrence.tm_mday += day;
+            occurrence.tm_hour = 0;
+            occurrence.tm_min = rule.slotMinute;
+            occurrence.tm_sec = 0;
+            occurrence.tm_isdst = -1;
+            time_t start = mktime(&occurrence);
+            if (start == static_cast<time_t>(-1) || !(rule.weekdays & (1 << occurrence.tm_wday))) {
+                continue;
+            }
+            int64_t startMs = static_cast<int64_t>(start) * 1000;
+            int64_t stopMs = startMs + static_cast<int64_t>(rule.durationMin) * 60000;
+            if (stopMs + static_cast<int64_t>(rule.postPadSec) * 1000 > now &&
+                !jobByKey.count(jobKey(rule.channelId, startMs))) {
+                armJob(rule, rule.channelId, rule.title, startMs, stopMs, now);
+                return;
+            }
+        }
+    }
+
+    // Must hold schedulerMutex
+    void activateRule(const ScheduleRule& rule, int64_t now) {
+        if (!rule.enabled) return;
+        switch (rule.kind) {
+            case ScheduleRuleKind::Series: {
+                auto it = programmesByTitle.find(foldTitle(rule.title));
+                if (it == programmesByTitle.end()) return;
+                for (const auto& entry : it->second) {
+                    if (!rule.channelId.empty() && rule.channelId != entry.first) continue;
+                    const Programme& programme = programmes[entry.first][entry.second];
+                    armJob(rule, entry.first, programme.title, entry.second, programme.stopMs, now);
+                }
+                break;
+            }
+            case ScheduleRuleKind::Slot:
+                armNextSlot(rule, now);
+                break;
+            case ScheduleRuleKind::Once:
+                armJob(rule, rule.channelId, rule.title, rule.startMs, rule.stopMs, now);
+                break;
+        }
+    }
+
+    // Drops a job from the indexes; a capture is handed to `retired` for the
+    // caller to stop outside the lock. Must hold schedulerMutex.
+    void retireJob(uint64_t id, RecordingJobState state, std::vector<std::unique_ptr<Capture>>& retired) {
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        Job& job = *it->second;
+
+        wheel->cancel(id << 1);
+        wheel->cancel((id << 1) | 1);
+        if (job.info.state == RecordingJobState::Armed) {
+            PlayerMetrics::get().recordingsArmed.add(-1);
+        }
+        if (job.capture) {
+            retired.push_back(std::move(job.capture));
+        }
+        if (job.info.state == RecordingJobState::Recording) {
+            double minutes = (nowMs() - job.recordingSinceMs) / 60000.0;
+            NativeLog::instance().write(LogLevel::Info, LOG_EVENT_CAPTURE_ENDED, {minutes, static_cast<double>(job.info.parts)},
+                                        NativeLog::jsonField("channel", job.info.channelId) + "," +
+                                        NativeLog::jsonField("status", recordingJobStateName(state)));
+        }
+
+        job.info.state = state;
+        if (state != RecordingJobState::Cancelled || job.info.parts > 0) {
+            if (recent.size() >= RECENT_LIMIT) recent.erase(recent.begin());
+            recent.push_back(job.info);
+        }
+
+        jobByKey.erase(job.key);
+        auto byRule = jobsByRule.find(job.info.ruleId);
+        if (byRule != jobsByRule.end()) {
+            byRule->second.erase(id);
+            if (byRule->second.empty()) jobsByRule.erase(byRule);
+        }
+        jobs.erase(it);
+    }
+
+    std::string partPath(const Job& job, int64_t now) const {
+        time_t seconds = static_cast<time_t>(now / 1000);
+        std::tm local = {};
+        localtime_s(&local, &seconds);
+        char date[16];
+        char time[16];
+        strftime(date, sizeof(date), "%Y-%m-%d", &local);
+        strftime(time, sizeof(time), "%H%M%S", &local);
+
+        std::string folder = recordingsPath + "\\" + date;
+        CreateDirectoryW(utf8ToWide(recordingsPath).c_str(), nullptr);
+        CreateDirectoryW(utf8ToWide(folder).c_str(), nullptr);
+
+        auto channel = channels.find(job.info.channelId);
+        std::string name = sanitize(channel != channels.end() && !channel->second.name.empty()
+                                        ? channel->second.name : job.info.channelId);
+        std::string path = folder + "\\" + name + "_" + time;
+        if (!job.info.title.empty()) path += "_" + sanitize(job.info.title);
+        if (job.info.parts > 0) path += "_part" + std::to_string(job.info.parts + 1);
+        return path + ".ts";
+    }
+
+    // Runs on libvlc's event thread
+    static void handleCaptureEvent(const libvlc_event_t*, void* opaque) {
+        static_cast<Capture*>(opaque)->broken.store(true);
+    }
+
+    static void setCaptureEvents(Capture& capture, bool attach) {
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(capture.player);
+        if (attach) {
+            libvlc_event_attach(events, libvlc_MediaPlayerEncounteredError, handleCaptureEvent, &capture);
+            libvlc_event_attach(events, libvlc_MediaPlayerEndReached, handleCaptureEvent, &capture);
+        } else {
+            libvlc_event_detach(events, libvlc_MediaPlayerEncounteredError, handleCaptureEvent, &capture);
+            libvlc_event_detach(events, libvlc_MediaPlayerEndReached, handleCaptureEvent, &capture);
+        }
+    }
+
+    // Stopping waits for the input thread, so never under schedulerMutex.
+    // The player goes first so the filter sees the end of the stream; the
+    // closed part is then handed to the remux queue.
+    static void stopCapture(std::unique_ptr<Capture>& capture) {
+        if (!capture) return;
+        bool started = capture->player != nullptr;
+        if (capture->player) {
+            setCaptureEvents(*capture, false);
+            libvlc_media_player_stop(capture->player);
+            StreamFailureMonitor::instance().unwatch(capture->failureWatch);
+            libvlc_media_player_release(capture->player);
+            PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+        }
+        if (capture->filter) {
+            capture->filter->stop();
+        }
+        uint64_t size = 0;
+        if (started && getFileSize(capture->path, size) && size > 0) {
+            RemuxQueue::instance().recordingFinished(capture->path);
+        }
+        capture.reset();
+    }
+
+    // Opens the next part of a job; a failure is retried like a broken
+    // input. Must hold schedulerMutex (libvlc is already acquired).
+    void openCapture(Job& job, int64_t now) {
+        job.retryAtMs = now + CAPTURE_RETRY_MS;
+
+        auto channel = channels.find(job.info.channelId);
+        if (channel == channels.end() || channel->second.urls.empty() || !libvlc) {
+            return;
+        }
+        // Most reliable mirror first, as for playback
+        std::string url = ReliabilityStore::instance().rank(channel->second.urls).front();
+        std::string path = partPath(job, now);
+        RecordingStorage::instance().requestSpace();
+
+        std::unique_ptr<Capture> capture(new Capture());
+        capture->path = path;
+        if (channel->second.pids.enabled) {
+            capture->filter.reset(new TsPipeRecorder(path, channel->second.pids));
+            if (!capture->filter->start()) return;
+        }
+
+        libvlc_media_t* media = libvlc_media_new_location(libvlc.get(), url.c_str());
+        if (!media) {
+            stopCapture(capture);
+            return;
+        }
+        std::string destination = capture->filter ? capture->filter->getPipePath() : path;
+        if (capture->filter && rawTsInput(url)) {
+            // The input as received, before any demuxing
+            std::string dump = ":demuxdump-file=" + destination;
+            libvlc_media_add_option(media, ":demux=dump");
+            libvlc_media_add_option(media, dump.c_str());
+        } else {
+            std::string sout = ":sout=#std{access=file,mux=ts,dst=" + soutString(destination) + "}";
+            libvlc_media_add_option(media, sout.c_str());
+            libvlc_media_add_option(media, ":sout-all");
+            libvlc_media_add_option(media, ":no-sout-keep");
+        }
+
+        capture->player = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!capture->player) {
+            stopCapture(capture);
+            return;
+        }
+        PlayerMetrics::get().libvlcMediaPlayers.add(1);
+        setCaptureEvents(*capture, true);
+        capture->failureWatch = StreamFailureMonitor::instance().watch(
+            url, true, [](StreamFailureReason, const std::string&) {});
+        if (libvlc_media_player_play(capture->player) != 0) {
+            capture->broken.store(true);
+        }
+
+        job.info.parts++;
+        job.info.filePath = path;
+        job.capture = std::move(capture);
+        NativeLog::instance().write(LogLevel::Info, LOG_EVENT_CAPTURE_STARTED, {static_cast<double>(job.info.parts)},
+                                    NativeLog::jsonField("channel", job.info.channelId) + "," +
+                                    NativeLog::jsonField("file", path));
+    }
+
+    // Must hold schedulerMutex
+    void startJob(Job& job, int64_t now) {
+        if (job.info.state != RecordingJobState::Armed) return;
+        job.info.state = RecordingJobState::Recording;
+        job.recordingSinceMs = now;
+        captures++;
+        PlayerMetrics::get().recordingsArmed.add(-1);
+        PlayerMetrics::get().recordingCaptures.set(captures);
+        openCapture(job, now);
+    }
+
+    // Must hold schedulerMutex
+    void finishJob(uint64_t id, std::vector<std::unique_ptr<Capture>>& retired, int64_t now) {
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        Job& job = *it->second;
+        uint32_t ruleId = job.info.ruleId;
+        bool wasRecording = job.info.state == RecordingJobState::Recording;
+
+        retireJob(id, job.info.parts > 0 ? RecordingJobState::Done : RecordingJobState::Failed, retired);
+        if (wasRecording) {
+            captures--;
+            PlayerMetrics::get().recordingCaptures.set(captures);
+        }
+
+        auto rule = rules.find(ruleId);
+        if (rule != rules.end() && rule->second.kind == ScheduleRuleKind::Slot) {
+            armNextSlot(rule->second, now);
+        }
+    }
+
+    // Must hold schedulerMutex
+    void cancelJob(uint64_t id, std::vector<std::unique_ptr<Capture>>& retired) {
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        bool wasRecording = it->second->info.state == RecordingJobState::Recording;
+        retireJob(id, RecordingJobState::Cancelled, retired);
+        if (wasRecording) {
+            captures--;
+            PlayerMetrics::get().recordingCaptures.set(captures);
+        }
+    }
+
+    void releaseRetired(std::vector<std::unique_ptr<Capture>>& retired) {
+        for (auto& capture : retired) {
+            stopCapture(capture);
+        }
+        retired.clear();
+    }
+
+    void run() {
+        std::vector<uint64_t> fired;
+        std::vector<std::unique_ptr<Capture>> retired;
+        std::unique_lock<std::mutex> lock(schedulerMutex);
+        while (running) {
+            wake.wait_for(lock, std::chrono::milliseconds(TICK_MS));
+            if (!running) break;
+
+            int64_t now = nowMs();
+            fired.clear();
+            wheel->advance(now, fired);
+
+            // libvlc_new can take a while the first time; not under the lock
+            bool starting = std::any_of(fired.begin(), fired.end(), [](uint64_t timer) { return (timer & 1) == 0; });
+            if ((starting || captures > 0) && !libvlc) {
+                lock.unlock();
+                std::shared_ptr<libvlc_instance_t> instance = SharedLibvlc::instance().acquire();
+                lock.lock();
+                if (!libvlc) libvlc = instance;
+                if (!running) break;
+            }
+
+            for (uint64_t timer : fired) {
+                uint64_t id = timer >> 1;
+                if (timer & 1) {
+                    finishJob(id, retired, now);
+                } else {
+                    auto it = jobs.find(id);
+                    if (it != jobs.end()) startJob(*it->second, now);
+                }
+            }
+
+            // Reopen inputs that failed or ended before their stop time
+            for (auto& entry : jobs) {
+                Job& job = *entry.second;
+                if (job.info.state != RecordingJobState::Recording) continue;
+                if (job.capture && job.capture->broken.load()) {
+                    PlayerMetrics::get().recordingCaptureFailures.inc();
+                    NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_CAPTURE_FAILED,
+                                                {static_cast<double>(job.info.parts)},
+                                                NativeLog::jsonField("channel", job.info.channelId));
+                    retired.push_back(std::move(job.capture));
+                    job.retryAtMs = now + CAPTURE_RETRY_MS;
+                } else if (!job.capture && now >= job.retryAtMs) {
+                    openCapture(job, now);
+                }
+            }
+
+            bool idle = captures == 0;
+            if (!retired.empty() || (idle && libvlc)) {
+                std::shared_ptr<libvlc_instance_t> released = idle ? std::move(libvlc) : nullptr;
+                lock.unlock();
+                releaseRetired(retired);
+                released.reset();
+                lock.lock();
+            }
+        }
+    }
+
+    // Must hold schedulerMutex
+    bool saveRules() const {
+        if (rulesPath.empty()) return false;
+
+        std::string tempPath = rulesPath + ".tmp";
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) return false;
+
+        uint32_t count = static_cast<uint32_t>(rules.size());
+        bool ok = fwrite(MAGIC, sizeof(MAGIC), 1, f) == 1 && fwrite(&count, sizeof(count), 1, f) == 1;
+        for (auto it = rules.begin(); ok && it != rules.end(); ++it) {
+            const ScheduleRule& rule = it->second;
+            RuleRecord record = {};
+            record.id = rule.id;
+            record.kind = static_cast<uint8_t>(rule.kind);
+            record.enabled = rule.enabled ? 1 : 0;
+            record.weekdays = rule.weekdays;
+            record.startMs = rule.startMs;
+            record.stopMs = rule.stopMs;
+            record.slotMinute = rule.slotMinute;
+            record.durationMin = rule.durationMin;
+            record.prePadSec = rule.prePadSec;
+            record.postPadSec = rule.postPadSec;
+            record.channelLength = static_cast<uint32_t>(rule.channelId.size());
+            record.titleLength = static_cast<uint32_t>(rule.title.size());
+            ok = fwrite(&record, sizeof(record), 1, f) == 1 &&
+                 fwrite(rule.channelId.data(), 1, rule.channelId.size(), f) == rule.channelId.size() &&
+                 fwrite(rule.title.data(), 1, rule.title.size(), f) == rule.title.size();
+        }
+        ok = fclose(f) == 0 && ok;
+
+        // Write-then-rename so a crash mid-write keeps the previous rules
+        if (ok && MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(rulesPath).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            return true;
+        }
+        DeleteFileW(utf8ToWide(tempPath).c_str());
+        return false;
+    }
+
+    // Must hold schedulerMutex; a damaged file loads nothing
+    bool loadRules(std::vector<ScheduleRule>& loaded) const {
+        FILE* f = _wfopen(utf8ToWide(rulesPath).c_str(), L"rb");
+        if (!f) return false;
+
+        char magic[8];
+        uint32_t count = 0;
+        bool ok = fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                  fread(&count, sizeof(count), 1, f) == 1 && count <= MAX_RULES;
+        for (uint32_t i = 0; ok && i < count; i++) {
+            RuleRecord record;
+            ok = fread(&record, sizeof(record), 1, f) == 1 && record.id != 0 && record.kind <= 2 &&
+                 record.channelLength <= MAX_FIELD && record.titleLength <= MAX_FIELD;
+            if (!ok) break;
+
+            ScheduleRule rule;
+            rule.id = record.id;
+            rule.kind = static_cast<ScheduleRuleKind>(record.kind);
+            rule.enabled = record.enabled != 0;
+            rule.weekdays = record.weekdays;
+            rule.startMs = record.startMs;
+            rule.stopMs = record.stopMs;
+            rule.slotMinute = record.slotMinute;
+            rule.durationMin = record.durationMin;
+            rule.prePadSec = record.prePadSec;
+            rule.postPadSec = record.postPadSec;
+            rule.channelId.assign(record.channelLength, '\0');
+            rule.title.assign(record.titleLength, '\0');
+            ok = (rule.channelId.empty() || fread(&rule.channelId[0], 1, rule.channelId.size(), f) == rule.channelId.size()) &&
+                 (rule.title.empty() || fread(&rule.title[0], 1, rule.title.size(), f) == rule.title.size());
+            if (ok) loaded.push_back(std::move(rule));
+        }
+        fclose(f);
+
+        if (!ok) loaded.clear();
+        return ok;
+    }
+
+    // Cancels the rule's jobs (stopping its recordings) and lets other
+    // series rules pick up the programmes it had claimed
+    void removeLocked(uint32_t id, std::vector<std::unique_ptr<Capture>>& retired, int64_t now) {
+        auto rule = rules.find(id);
+        if (rule == rules.end()) return;
+
+        std::vector<std::pair<std::string, int64_t>> released;
+        auto owned = jobsByRule.find(id);
+        if (owned != jobsByRule.end()) {
+            std::set<uint64_t> ids = owned->second;
+            for (uint64_t jobId : ids) {
+                const Job& job = *jobs[jobId];
+                if (rule->second.kind == ScheduleRuleKind::Series && job.info.state == RecordingJobState::Armed) {
+                    released.emplace_back(job.info.channelId, job.programmeStartMs);
+                }
+                cancelJob(jobId, retired);
+            }
+        }
+
+        unindexRule(rule->second);
+        rules.erase(rule);
+
+        for (const auto& programme : released) {
+            auto channel = programmes.find(programme.first);
+            if (channel == programmes.end()) continue;
+            auto it = channel->second.find(programme.second);
+            if (it != channel->second.end()) {
+                evaluateProgramme(programme.first, programme.second, it->second, now);
+            }
+        }
+    }
+
+public:
+    RecordingScheduler(const RecordingScheduler&) = delete;
+    RecordingScheduler& operator=(const RecordingScheduler&) = delete;
+
+    static RecordingScheduler& instance() {
+        static RecordingScheduler scheduler;
+        return scheduler;
+    }
+
+    // Loads the rules, arms the slot and one-off ones and starts the timer
+    // thread. Series rules arm as programmes arrive through updateProgrammes().
+    bool open(const std::string& rulesFile, const std::string& recordingsDir) {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        if (running) return true;
+
+        rulesPath = rulesFile;
+        recordingsPath = recordingsDir;
+        int64_t now = nowMs();
+        wheel.reset(new TimerWheel(TICK_MS, now));
+
+        std::vector<ScheduleRule> loaded;
+        loadRules(loaded);
+        for (ScheduleRule& rule : loaded) {
+            nextRuleId = std::max(nextRuleId, rule.id + 1);
+            uint32_t id = rule.id;
+            rules[id] = std::move(rule);
+            indexRule(rules[id]);
+            activateRule(rules[id], now);
+        }
+
+        running = true;
+        worker = std::thread(&RecordingScheduler::run, this);
+        return true;
+    }
+
+    // Stops every capture; armed jobs are rebuilt from the rules next time
+    void close() {
+        std::vector<std::unique_ptr<Capture>> retired;
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            if (!running) return;
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+
+        std::shared_ptr<libvlc_instance_t> released;
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            std::vector<uint64_t> ids;
+            for (const auto& entry : jobs) ids.push_back(entry.first);
+            for (uint64_t id : ids) cancelJob(id, retired);
+            released = std::move(libvlc);
+            wheel.reset();
+            rules.clear();
+            seriesByTitle.clear();
+            programmes.clear();
+            programmesByTitle.clear();
+        }
+        releaseRetired(retired);
+    }
+
+    // Channel names and stream URLs, as the playlist knows them, and the
+    // streams to keep when recording it (from the next capture part on)
+    void setChannel(const std::string& channelId, const std::string& name, const std::vector<std::string>& urls,
+                    const TsPidSelection& pids = TsPidSelection()) {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        Channel& channel = channels[channelId];
+        channel.name = name;
+        channel.urls = urls;
+        channel.pids = pids;
+    }
+
+    // Replaces a channel's guide. Only programmes that are new or whose
+    // title or end changed are matched against the series rules; armed jobs
+    // of programmes that disappeared are dropped (a recording in progress
+    // runs to its stop time).
+    void updateProgrammes(const std::string& channelId, const std::vector<ScheduleProgramme>& fresh) {
+        std::vector<std::unique_ptr<Capture>> retired;      // Stays empty: only armed jobs are dropped
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        if (!running) return;
+        int64_t now = nowMs();
+
+        std::map<int64_t, Programme> next;
+        for (const ScheduleProgramme& p : fresh) {
+            if (p.stopMs <= now || p.stopMs <= p.startMs) continue;
+            next[p.startMs] = Programme{p.title, foldTitle(p.title), p.stopMs};
+        }
+
+        std::map<int64_t, Programme>& current = programmes[channelId];
+        std::vector<int64_t> added;
+        std::vector<uint64_t> dropped;
+        for (const auto& entry : current) {
+            auto match = next.find(entry.first);
+            if (match != next.end() && match->second.key == entry.second.key && match->second.stopMs == entry.second.stopMs) {
+                continue;
+            }
+            auto byTitle = programmesByTitle.find(entry.second.key);
+            if (byTitle != programmesByTitle.end()) {
+                byTitle->second.erase({channelId, entry.first});
+                if (byTitle->second.empty()) programmesByTitle.erase(byTitle);
+            }
+            auto job = jobByKey.find(jobKey(channelId, entry.first));
+            if (job != jobByKey.end()) {
+                auto it = jobs.find(job->second);
+                auto rule = rules.find(it->second->info.ruleId);
+                if (it->second->info.state == RecordingJobState::Armed &&
+                    rule != rules.end() && rule->second.kind == ScheduleRuleKind::Series) {
+                    dropped.push_back(job->second);
+                }
+            }
+        }
+        for (uint64_t id : dropped) {
+            cancelJob(id, retired);
+        }
+        for (const auto& entry : next) {
+            auto old = current.find(entry.first);
+            if (old != current.end() && old->second.key == entry.second.key && old->second.stopMs == entry.second.stopMs) {
+                continue;
+            }
+            programmesByTitle[entry.second.key].insert({channelId, entry.first});
+            added.push_back(entry.first);
+        }
+
+        current.swap(next);
+        for (int64_t startMs : added) {
+            evaluateProgramme(channelId, startMs, current[startMs], now);
+        }
+    }
+
+    // Adds or replaces a rule; returns its id (0 if it is not valid)
+    uint32_t putRule(ScheduleRule rule) {
+        std::vector<std::unique_ptr<Capture>> retired;
+        uint32_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            if (!running) return 0;
+            bool valid = rule.kind == ScheduleRuleKind::Series ? !foldTitle(rule.title).empty() : !rule.channelId.empty();
+            if (!valid || rule.channelId.size() > MAX_FIELD || rule.title.size() > MAX_FIELD ||
+                (rule.id == 0 && rules.size() >= MAX_RULES)) {
+                return 0;
+            }
+            rule.prePadSec = std::max(0, rule.prePadSec);
+            rule.postPadSec = std::max(0, rule.postPadSec);
+
+            int64_t now = nowMs();
+            if (rule.id != 0 && rules.count(rule.id)) {
+                removeLocked(rule.id, retired, now);
+            } else if (rule.id == 0) {
+                rule.id = nextRuleId++;
+            } else {
+                nextRuleId = std::max(nextRuleId, rule.id + 1);
+            }
+
+            id = rule.id;
+            rules[id] = std::move(rule);
+            indexRule(rules[id]);
+            activateRule(rules[id], now);
+            saveRules();
+        }
+        releaseRetired(retired);
+        return id;
+    }
+
+    bool removeRule(uint32_t id) {
+        std::vector<std::unique_ptr<Capture>> retired;
+        bool removed = false;
+        {
+            std::lock_guard<std::mutex> lock(schedulerMutex);
+            if (!rules.count(id)) return false;
+            removeLocked(id, retired, nowMs());
+            saveRules();
+            removed = true;
+        }
+        releaseRetired(retired);
+        return removed;
+    }
+
+    std::vector<ScheduleRule> listRules() {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        std::vector<ScheduleRule> out;
+        out.reserve(rules.size());
+        for (const auto& entry : rules) out.push_back(entry.second);
+        return out;
+    }
+
+    // Armed and running jobs by start time, then the most recent finished ones
+    std::vector<RecordingJobInfo> listJobs() {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        std::vector<RecordingJobInfo> out;
+        out.reserve(jobs.size() + recent.size());
+        for (const auto& entry : jobs) out.push_back(entry.second->info);
+        std::sort(out.begin(), out.end(), [](const RecordingJobInfo& a, const RecordingJobInfo& b) {
+            return a.startMs < b.startMs;
+        });
+        out.insert(out.end(), recent.rbegin(), recent.rend());
+        return out;
+    }
+};
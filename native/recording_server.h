@@ -0,0 +1,505 @@
+#pragma once
+
+// Serves the recordings folder over HTTP so other devices (or a browser or
+// curl here) can watch what was recorded on this machine:
+//
+//   GET /<token>/recordings.m3u     every recording, newest first
+//   GET|HEAD /<token>/<path>        a .ts or .mp4 under the root, with ranges
+//
+// A recording still being written (touched in the last GROWING_MS) doubles
+// as a time-shift buffer: a request without a range starts at the beginning
+// and follows the file as it grows, one with a range gets what is on disk.
+//
+// Bodies go out from mapped views of the file, WINDOW_BYTES at a time,
+// handed to WSASend without passing through a buffer of ours. TransmitFile
+// would do the same but client editions of Windows run at most two of them
+// at once, and a stalled viewer would hold one for as long as it stalls.
+// A connection is a thread mostly asleep in send; MAX_CLIENTS bound them.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "recording_storage.h"
+#include "win_util.h"
+
+struct RecordingServerStats {
+    bool running = false;
+    int port = 0;
+    int connections = 0;
+    uint64_t requests = 0;
+    uint64_t bytesSent = 0;
+};
+
+class RecordingServer {
+private:
+    static constexpr size_t WINDOW_BYTES = 4 << 20;
+    static constexpr int MAX_CLIENTS = 64;
+    static constexpr DWORD REQUEST_TIMEOUT_MS = 10000;
+    static constexpr DWORD SEND_TIMEOUT_MS = 30000;
+    static constexpr int64_t GROWING_MS = 5000;
+    static constexpr DWORD FOLLOW_POLL_MS = 500;
+    static constexpr int64_t FOLLOW_IDLE_MS = 15000;       // A followed file that stops growing ends the body
+    static constexpr long POLL_US = 250000;
+
+    struct Connection {
+        SOCKET sock = INVALID_SOCKET;
+        std::atomic<bool> done{false};
+        std::thread thread;
+    };
+
+    struct Request {
+        std::string method;
+        std::string target;         // Decoded path, no query
+        std::string host;
+        std::string range;
+    };
+
+    std::mutex serverMutex;
+    bool running = false;
+    std::atomic<bool> stopping{false};
+    std::string token;
+    std::string root;
+    int boundPort = 0;
+    SOCKET listener = INVALID_SOCKET;
+    std::thread acceptor;
+    std::list<std::unique_ptr<Connection>> connections;
+    std::atomic<int> active{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> bytesSent{0};
+    DWORD granularity = 65536;
+
+    RecordingServer() = default;
+
+    static int64_t unixMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t fileTimeToUnixMs(const FILETIME& time) {
+        uint64_t ticks = (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return static_cast<int64_t>(ticks / 10000) - 11644473600000LL;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static std::string percentDecode(const std::string& text) {
+        std::string out;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+                out.push_back(static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2])));
+                i += 2;
+            } else {
+                out.push_back(text[i]);
+            }
+        }
+        return out;
+    }
+
+    static std::string percentEncode(const std::string& text) {
+        static const char* hex = "0123456789ABCDEF";
+        std::string out;
+        for (unsigned char c : text) {
+            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/') {
+                out.push_back(static_cast<char>(c));
+            } else {
+                out.push_back('%');
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 15]);
+            }
+        }
+        return out;
+    }
+
+    static std::string headerValue(const std::string& headers, const char* name) {
+        size_t length = strlen(name);
+        size_t line = headers.find("\r\n");
+        while (line != std::string::npos && line + 2 < headers.size()) {
+            size_t start = line + 2;
+            size_t end = headers.find("\r\n", start);
+            if (end == std::string::npos) end = headers.size();
+            if (end - start > length && headers[start + length] == ':' &&
+                _strnicmp(headers.c_str() + start, name, length) == 0) {
+                size_t value = headers.find_first_not_of(' ', start + length + 1);
+                return value < end ? headers.substr(value, end - value) : std::string();
+            }
+            line = end < headers.size() ? end : std::string::npos;
+        }
+        return std::string();
+    }
+
+    static bool readRequest(SOCKET sock, Request& request) {
+        std::string headers;
+        char buffer[2048];
+        while (headers.find("\r\n\r\n") == std::string::npos) {
+            if (headers.size() > 16384) return false;
+            int received = recv(sock, buffer, sizeof(buffer), 0);
+            if (received <= 0) return false;
+            headers.append(buffer, received);
+        }
+        size_t methodEnd = headers.find(' ');
+        size_t targetEnd = methodEnd == std::string::npos ? std::string::npos : headers.find(' ', methodEnd + 1);
+        if (targetEnd == std::string::npos) return false;
+        request.method = headers.substr(0, methodEnd);
+        std::string target = headers.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+        target = target.substr(0, target.find('?'));
+        request.target = percentDecode(target);
+        request.host = headerValue(headers, "Host");
+        request.range = headerValue(headers, "Range");
+        return true;
+    }
+
+    // A recording below the root, or empty: no parent or drive references,
+    // and only the media files (not indexes or previews)
+    std::string resolve(const std::string& relative) const {
+        if (relative.empty() || relative.find("..") != std::string::npos ||
+            relative.find_first_of(":\\") != std::string::npos || relative[0] == '/') {
+            return std::string();
+        }
+        size_t dot = relative.rfind('.');
+        std::string extension = dot == std::string::npos ? std::string() : relative.substr(dot);
+        for (char& c : extension) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        if (extension != ".ts" && extension != ".mp4") return std::string();
+        std::string path = root + "\\" + relative;
+        std::replace(path.begin(), path.end(), '/', '\\');
+        return path;
+    }
+
+    std::string relativeTo(const std::string& path) const {
+        if (path.size() <= root.size() + 1 || _strnicmp(path.c_str(), root.c_str(), root.size()) != 0) {
+            return std::string();
+        }
+        std::string relative = path.substr(root.size() + 1);
+        std::replace(relative.begin(), relative.end(), '\\', '/');
+        return relative;
+    }
+
+    static bool sendAll(SOCKET sock, const std::string& text) {
+        WSABUF buffer = {static_cast<ULONG>(text.size()), const_cast<char*>(text.data())};
+        DWORD sent = 0;
+        return WSASend(sock, &buffer, 1, &sent, 0, nullptr, nullptr) == 0;
+    }
+
+    static void sendStatus(SOCKET sock, const char* status, const char* extra = "") {
+        sendAll(sock, std::string("HTTP/1.1 ") + status + "\r\nContent-Length: 0\r\n" + extra +
+                      "Connection: close\r\n\r\n");
+    }
+
+    // [start, end) of the file from one mapped view per window. The
+    // headers ride along with the first window in the same send.
+    bool sendRange(SOCKET sock, HANDLE file, uint64_t start, uint64_t end, std::string headers) {
+        if (start >= end) return headers.empty() || sendAll(sock, headers);
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, static_cast<DWORD>(end >> 32),
+                                           static_cast<DWORD>(end), nullptr);
+        if (!mapping) return false;
+
+        bool ok = true;
+        PlayerMetrics& metrics = PlayerMetrics::get();
+        for (uint64_t offset = start; ok && offset < end && !stopping.load();) {
+            uint64_t base = offset / granularity * granularity;
+            size_t length = static_cast<size_t>(std::min<uint64_t>(WINDOW_BYTES, end - offset));
+            size_t viewLength = static_cast<size_t>(offset - base) + length;
+            uint8_t* view = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(base >> 32),
+                                                                static_cast<DWORD>(base), viewLength));
+            if (!view) {
+                ok = false;
+                break;
+            }
+            WSABUF buffers[2];
+            DWORD count = 0;
+            if (!headers.empty()) {
+                buffers[count++] = {static_cast<ULONG>(headers.size()), const_cast<char*>(headers.data())};
+            }
+            buffers[count++] = {static_cast<ULONG>(length), reinterpret_cast<char*>(view + (offset - base))};
+            DWORD sent = 0;
+            ok = WSASend(sock, buffers, count, &sent, 0, nullptr, nullptr) == 0;
+            UnmapViewOfFile(view);
+            headers.clear();
+            if (ok) {
+                offset += length;
+                bytesSent.fetch_add(length);
+                metrics.recordingServerBytes.inc(static_cast<double>(length));
+            }
+        }
+        CloseHandle(mapping);
+        return ok;
+    }
+
+    // "bytes=a-b", "bytes=a-" or "bytes=-n" against `size`; false if the
+    // header is there but cannot be satisfied. Several ranges are answered
+    // with the whole file, which HTTP allows.
+    static bool parseRange(const std::string& header, uint64_t size, bool& partial, uint64_t& start, uint64_t& end) {
+        partial = false;
+        start = 0;
+        end = size;
+        if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) return true;
+        std::string spec = header.substr(6);
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos) return true;
+        std::string first = spec.substr(0, dash);
+        std::string last = spec.substr(dash + 1);
+        if (first.empty()) {
+            uint64_t suffix = strtoull(last.c_str(), nullptr, 10);
+            if (suffix == 0) return false;
+            start = size - std::min(suffix, size);
+        } else {
+            start = strtoull(first.c_str(), nullptr, 10);
+            if (!last.empty()) end = std::min<uint64_t>(size, strtoull(last.c_str(), nullptr, 10) + 1);
+        }
+        if (start >= size || start >= end) return false;
+        partial = true;
+        return true;
+    }
+
+    void servePlaylist(SOCKET sock, const Request& request) {
+        std::string base = "http://" + (request.host.empty() ? "127.0.0.1:" + std::to_string(boundPort) : request.host) +
+                           "/" + token + "/";
+        std::vector<StoredRecording> recordings = RecordingStorage::instance().list();
+        std::string body = "#EXTM3U\n";
+        for (auto it = recordings.rbegin(); it != recordings.rend(); ++it) {
+            std::string relative = relativeTo(it->path);
+            if (relative.empty() || resolve(relative).empty()) continue;
+            std::string name = relative.substr(relative.rfind('/') + 1);
+            body += "#EXTINF:-1," + name.substr(0, name.rfind('.')) + "\n" + base + percentEncode(relative) + "\n";
+        }
+        std::string headers = "HTTP/1.1 200 OK\r\nContent-Type: audio/x-mpegurl; charset=utf-8\r\n"
+                              "Cache-Control: no-cache\r\nContent-Length: " + std::to_string(body.size()) +
+                              "\r\nConnection: close\r\n\r\n";
+        if (request.method != "HEAD") headers += body;
+        sendAll(sock, headers);
+    }
+
+    void serveFile(SOCKET sock, const Request& request, const std::string& path) {
+        HANDLE file = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            sendStatus(sock, "404 Not Found");
+            return;
+        }
+        LARGE_INTEGER fileSize = {};
+        FILETIME written = {};
+        GetFileSizeEx(file, &fileSize);
+        GetFileTime(file, nullptr, nullptr, &written);
+        uint64_t size = static_cast<uint64_t>(fileSize.QuadPart);
+        bool growing = unixMs() - fileTimeToUnixMs(written) < GROWING_MS;
+        const char* type = path.compare(path.size() - 4, 4, ".mp4") == 0 ? "video/mp4" : "video/mp2t";
+
+        bool partial = false;
+        uint64_t start = 0;
+        uint64_t end = size;
+        if (!request.range.empty() && !parseRange(request.range, size, partial, start, end)) {
+            sendStatus(sock, "416 Range Not Satisfiable",
+                       ("Content-Range: bytes */" + std::to_string(size) + "\r\n").c_str());
+            CloseHandle(file);
+            return;
+        }
+
+        std::string headers = std::string("HTTP/1.1 ") + (partial ? "206 Partial Content" : "200 OK") +
+                              "\r\nContent-Type: " + type + "\r\nAccept-Ranges: bytes\r\n";
+        bool follow = growing && !partial;
+        if (partial) {
+            headers += "Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end - 1) + "/" +
+                       (growing ? "*" : std::to_string(size)) + "\r\n";
+        }
+        if (!follow) headers += "Content-Length: " + std::to_string(end - start) + "\r\n";
+        headers += "Connection: close\r\n\r\n";
+
+        if (request.method == "HEAD") {
+            sendAll(sock, headers);
+        } else if (sendRange(sock, file, start, end, headers) && follow) {
+            // The live edge: send what was appended until it stops growing
+            int64_t idleSince = unixMs();
+            while (!stopping.load() && unixMs() - idleSince < FOLLOW_IDLE_MS) {
+                Sleep(FOLLOW_POLL_MS);
+                GetFileSizeEx(file, &fileSize);
+                uint64_t grown = static_cast<uint64_t>(fileSize.QuadPart);
+                if (grown <= end) continue;
+                if (!sendRange(sock, file, end, grown, std::string())) break;
+                end = grown;
+                idleSince = unixMs();
+            }
+        }
+        CloseHandle(file);
+    }
+
+    void serve(Connection* connection) {
+        SOCKET sock = connection->sock;
+        DWORD timeout = REQUEST_TIMEOUT_MS;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        timeout = SEND_TIMEOUT_MS;
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+        Request request;
+        std::string prefix = "/" + token + "/";
+        if (active.load() > MAX_CLIENTS) {
+            sendStatus(sock, "503 Service Unavailable");
+        } else if (!readRequest(sock, request)) {
+            // Timed out or not HTTP
+        } else if (request.target.compare(0, prefix.size(), prefix) != 0) {
+            sendStatus(sock, "404 Not Found");
+        } else if (request.method != "GET" && request.method != "HEAD") {
+            sendStatus(sock, "405 Method Not Allowed", "Allow: GET, HEAD\r\n");
+        } else {
+            requests.fetch_add(1);
+            std::string relative = request.target.substr(prefix.size());
+            std::string path = resolve(relative);
+            if (relative == "recordings.m3u") {
+                servePlaylist(sock, request);
+            } else if (path.empty()) {
+                sendStatus(sock, "404 Not Found");
+            } else {
+                serveFile(sock, request, path);
+            }
+        }
+
+        PlayerMetrics::get().recordingServerConnections.set(active.fetch_sub(1) - 1);
+        connection->done.store(true);
+    }
+
+    // Joins finished connections; all of them when stopping
+    void reap(bool all) {
+        std::list<std::unique_ptr<Connection>> finished;
+        {
+            std::lock_guard<std::mutex> lock(serverMutex);
+            for (auto it = connections.begin(); it != connections.end();) {
+                if (all || (*it)->done.load()) {
+                    finished.push_back(std::move(*it));
+                    it = connections.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& connection : finished) {
+            shutdown(connection->sock, SD_BOTH);    // Ends a blocked send
+            if (connection->thread.joinable()) connection->thread.join();
+            closesocket(connection->sock);
+        }
+    }
+
+    void acceptLoop() {
+        while (!stopping.load()) {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(listener, &readSet);
+            timeval timeout = {0, POLL_US};
+            if (select(0, &readSet, nullptr, nullptr, &timeout) > 0) {
+                SOCKET sock = accept(listener, nullptr, nullptr);
+                if (sock != INVALID_SOCKET) {
+                    std::unique_ptr<Connection> connection(new Connection());
+                    connection->sock = sock;
+                    PlayerMetrics::get().recordingServerConnections.set(active.fetch_add(1) + 1);
+                    connection->thread = std::thread(&RecordingServer::serve, this, connection.get());
+                    std::lock_guard<std::mutex> lock(serverMutex);
+                    connections.push_back(std::move(connection));
+                }
+            }
+            reap(false);
+        }
+        reap(true);
+    }
+
+public:
+    RecordingServer(const RecordingServer&) = delete;
+    RecordingServer& operator=(const RecordingServer&) = delete;
+
+    static RecordingServer& instance() {
+        static RecordingServer server;
+        return server;
+    }
+
+    // Serves recordingsDir on `port` (0 picks one), on every interface when
+    // `lan` is set and on loopback only otherwise. Returns the port, 0 on
+    // failure.
+    int start(const std::string& recordingsDir, int port, bool lan, const std::string& accessToken,
+              std::string& error) {
+        std::lock_guard<std::mutex> lock(serverMutex);
+        if (running) return boundPort;
+        if (accessToken.empty()) {
+            error = "Access token required";
+            return 0;
+        }
+
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            error = "Winsock unavailable";
+            return 0;
+        }
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(lan ? INADDR_ANY : INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<u_short>(port));
+        int addressLength = sizeof(address);
+        if (listener == INVALID_SOCKET ||
+            bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0 ||
+            getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+            error = "Cannot listen on port " + std::to_string(port);
+            if (listener != INVALID_SOCKET) closesocket(listener);
+            listener = INVALID_SOCKET;
+            WSACleanup();
+            return 0;
+        }
+
+        SYSTEM_INFO system;
+        GetSystemInfo(&system);
+        granularity = system.dwAllocationGranularity;
+        root = recordingsDir;
+        while (root.size() > 3 && (root.back() == '\\' || root.back() == '/')) root.pop_back();
+        token = accessToken;
+        boundPort = ntohs(address.sin_port);
+        running = true;
+        stopping.store(false);
+        acceptor = std::thread(&RecordingServer::acceptLoop, this);
+        return boundPort;
+    }
+
+    // Closes every connection, followed ones included
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(serverMutex);
+            if (!running) return;
+            running = false;
+        }
+        stopping.store(true);
+        if (acceptor.joinable()) acceptor.join();
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+        WSACleanup();
+        std::lock_guard<std::mutex> lock(serverMutex);
+        boundPort = 0;
+    }
+
+    RecordingServerStats stats() {
+        std::lock_guard<std::mutex> lock(serverMutex);
+        RecordingServerStats result;
+        result.running = running;
+        result.port = boundPort;
+        result.connections = active.load();
+        result.requests = requests.load();
+        result.bytesSent = bytesSent.load();
+        return result;
+    }
+};
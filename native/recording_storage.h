@@ -0,0 +1,520 @@
+#pragma once
+
+// Storage policy for the recordings tree (recordings/YYYY-MM-DD/...).
+//
+// A live index of every file under the root is built by an initial scan -
+// one thread per group of date folders - and kept current by a
+// ReadDirectoryChangesW watch on the whole tree, so usage is known without
+// walking the disk again. A buffer overflow in the watch falls back to a
+// rescan.
+//
+// An eviction thread enforces two limits: a quota on the tree's total size
+// and a minimum of free space on its volume. When either is exceeded it
+// deletes whole recordings (a .ts and its .idx/.thumbs/.mp4 siblings) oldest
+// first, skipping protected ones and anything written to recently, at no
+// more than unlinksPerSecond - a burst of deletes would compete with the
+// recordings being written. Checks run every EVICT_CHECK_MS and whenever a
+// capture starts, so space is made before the disk is full rather than
+// after a write fails.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+#include "native_log.h"
+#include "win_util.h"
+
+struct StoragePolicy {
+    uint64_t quotaBytes = 0;        // 0 = no quota
+    uint64_t minFreeBytes = 0;      // 0 = no free-space floor
+    double unlinksPerSecond = 2;
+};
+
+struct StoredRecording {
+    std::string path;               // The .ts (or whatever the group has)
+    uint64_t bytes = 0;             // All files of the recording
+    int64_t modifiedMs = 0;         // Unix epoch, newest file
+    bool isProtected = false;
+};
+
+struct RecordingStorageStats {
+    uint64_t usedBytes = 0;
+    uint64_t files = 0;
+    uint64_t freeBytes = 0;         // On the volume
+    uint64_t totalBytes = 0;
+    uint64_t evictedFiles = 0;
+    uint64_t evictedBytes = 0;
+    bool watching = false;
+};
+
+class RecordingStorage {
+private:
+    static constexpr int64_t EVICT_CHECK_MS = 30000;
+    static constexpr int64_t RECENT_WRITE_MS = 120000;     // Skipped: may still be recording
+    static constexpr unsigned MAX_SCAN_THREADS = 4;
+    static constexpr DWORD WATCH_BUFFER = 64 * 1024;
+
+    struct Entry {
+        std::string path;
+        uint64_t size = 0;
+        int64_t modifiedMs = 0;
+    };
+
+    std::mutex storageMutex;
+    std::condition_variable wake;
+    std::thread watcher;
+    std::thread evictor;
+    HANDLE stopEvent = nullptr;
+    bool running = false;
+    bool evictRequested = false;
+    bool watching = false;
+
+    std::string root;
+    StoragePolicy policy;
+    std::unordered_map<std::string, Entry> files;   // By key()
+    uint64_t usedBytes = 0;
+    std::set<std::string> protectedStems;
+    uint64_t evictedFiles = 0;
+    uint64_t evictedBytes = 0;
+
+    RecordingStorage() = default;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t fileTimeToMs(const FILETIME& time) {
+        uint64_t ticks = (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return static_cast<int64_t>(ticks / 10000) - 11644473600000LL;
+    }
+
+    // Case-insensitive map key: NTFS names are, for ASCII at least
+    static std::string key(const std::string& path) {
+        std::string k = path;
+        for (char& c : k) {
+            if (c == '/') c = '\\';
+            else if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return k;
+    }
+
+    // Files of one recording share a stem: X.ts, X.ts.idx, X.ts.thumbs,
+    // X.ts.arc, X.ts.arc.part, X.mp4, X.mp4.part
+    static std::string stem(const std::string& k) {
+        static const char* suffixes[] = {".part", ".arc", ".idx", ".thumbs", ".mp4", ".ts"};
+        std::string s = k;
+        for (const char* suffix : suffixes) {
+            size_t length = strlen(suffix);
+            if (s.size() > length && s.compare(s.size() - length, length, suffix) == 0) {
+                s.resize(s.size() - length);
+            }
+        }
+        return s;
+    }
+
+    // Must hold storageMutex
+    void setEntry(const std::string& path, uint64_t size, int64_t modifiedMs) {
+        Entry& entry = files[key(path)];
+        usedBytes = usedBytes - entry.size + size;
+        entry.path = path;
+        entry.size = size;
+        entry.modifiedMs = modifiedMs;
+    }
+
+    // Must hold storageMutex. A removed directory takes its files with it.
+    void removeEntry(const std::string& path) {
+        std::string k = key(path);
+        auto it = files.find(k);
+        if (it != files.end()) {
+            usedBytes -= it->second.size;
+            files.erase(it);
+            return;
+        }
+        std::string prefix = k + "\\";
+        for (auto entry = files.begin(); entry != files.end();) {
+            if (entry->first.compare(0, prefix.size(), prefix) == 0) {
+                usedBytes -= entry->second.size;
+                entry = files.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+    }
+
+    static void scanDirectory(const std::string& dir, std::vector<Entry>& found) {
+        WIN32_FIND_DATAW data;
+        HANDLE find = FindFirstFileW(utf8ToWide(dir + "\\*").c_str(), &data);
+        if (find == INVALID_HANDLE_VALUE) return;
+        do {
+            if (data.cFileName[0] == L'.' &&
+                (data.cFileName[1] == 0 || (data.cFileName[1] == L'.' && data.cFileName[2] == 0))) {
+                continue;
+            }
+            std::string path = dir + "\\" + wideToUtf8(data.cFileName);
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                scanDirectory(path, found);
+            } else {
+                Entry entry;
+                entry.path = path;
+                entry.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                entry.modifiedMs = fileTimeToMs(data.ftLastWriteTime);
+                found.push_back(entry);
+            }
+        } while (FindNextFileW(find, &data));
+        FindClose(find);
+    }
+
+    // Root files inline, date folders spread over a few threads
+    void scanAll() {
+        std::vector<Entry> found;
+        std::vector<std::string> folders;
+        WIN32_FIND_DATAW data;
+        HANDLE find = FindFirstFileW(utf8ToWide(root + "\\*").c_str(), &data);
+        if (find != INVALID_HANDLE_VALUE) {
+            do {
+                std::string name = wideToUtf8(data.cFileName);
+                if (name == "." || name == "..") continue;
+                if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                    folders.push_back(root + "\\" + name);
+                } else {
+                    Entry entry;
+                    entry.path = root + "\\" + name;
+                    entry.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                    entry.modifiedMs = fileTimeToMs(data.ftLastWriteTime);
+                    found.push_back(entry);
+                }
+            } while (FindNextFileW(find, &data));
+            FindClose(find);
+        }
+
+        unsigned count = std::min<unsigned>(MAX_SCAN_THREADS, static_cast<unsigned>(folders.size()));
+        std::vector<std::vector<Entry>> results(count);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < count; t++) {
+            threads.emplace_back([&folders, &results, t, count]() {
+                for (size_t i = t; i < folders.size(); i += count) {
+                    scanDirectory(folders[i], results[t]);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        std::lock_guard<std::mutex> lock(storageMutex);
+        files.clear();
+        usedBytes = 0;
+        for (const Entry& entry : found) setEntry(entry.path, entry.size, entry.modifiedMs);
+        for (const auto& list : results) {
+            for (const Entry& entry : list) setEntry(entry.path, entry.size, entry.modifiedMs);
+        }
+        PlayerMetrics::get().storageUsedBytes.set(static_cast<double>(usedBytes));
+    }
+
+    // Re-reads one changed path: a file's size, or a folder moved in
+    void refresh(const std::string& path) {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(utf8ToWide(path).c_str(), GetFileExInfoStandard, &data)) {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            removeEntry(path);
+            return;
+        }
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            std::vector<Entry> found;
+            scanDirectory(path, found);
+            std::lock_guard<std::mutex> lock(storageMutex);
+            for (const Entry& entry : found) setEntry(entry.path, entry.size, entry.modifiedMs);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(storageMutex);
+        setEntry(path, (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow,
+                 fileTimeToMs(data.ftLastWriteTime));
+    }
+
+    void watch() {
+        HANDLE directory = CreateFileW(utf8ToWide(root).c_str(), FILE_LIST_DIRECTORY,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                       FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (directory == INVALID_HANDLE_VALUE) return;
+        {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            watching = true;
+        }
+
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        std::vector<DWORD> buffer(WATCH_BUFFER / sizeof(DWORD));     // DWORD-aligned records
+        const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                             FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+        while (true) {
+            ResetEvent(overlapped.hEvent);
+            if (!ReadDirectoryChangesW(directory, buffer.data(), WATCH_BUFFER, TRUE, filter, nullptr,
+                                       &overlapped, nullptr)) {
+                break;
+            }
+            HANDLE handles[2] = {overlapped.hEvent, stopEvent};
+            DWORD transferred = 0;
+            if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+                CancelIo(directory);
+                GetOverlappedResult(directory, &overlapped, &transferred, TRUE);
+                break;
+            }
+            if (!GetOverlappedResult(directory, &overlapped, &transferred, FALSE)) break;
+
+            if (transferred == 0) {
+                scanAll();                  // Too many changes for the buffer
+                continue;
+            }
+
+            // Several notifications for one file (size, then time) are
+            // refreshed once
+            std::set<std::string> changed;
+            const uint8_t* record = reinterpret_cast<const uint8_t*>(buffer.data());
+            while (true) {
+                const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+                std::string path = root + "\\" +
+                    wideToUtf8(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+                if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME) {
+                    changed.erase(path);
+                    std::lock_guard<std::mutex> lock(storageMutex);
+                    removeEntry(path);
+                } else {
+                    changed.insert(path);
+                }
+                if (info->NextEntryOffset == 0) break;
+                record += info->NextEntryOffset;
+            }
+            for (const std::string& path : changed) refresh(path);
+
+            std::lock_guard<std::mutex> lock(storageMutex);
+            PlayerMetrics::get().storageUsedBytes.set(static_cast<double>(usedBytes));
+        }
+
+        CloseHandle(overlapped.hEvent);
+        CloseHandle(directory);
+        std::lock_guard<std::mutex> lock(storageMutex);
+        watching = false;
+    }
+
+    // Must hold storageMutex. Bytes to free under the policy, 0 if none.
+    uint64_t excess() const {
+        uint64_t need = 0;
+        if (policy.quotaBytes && usedBytes > policy.quotaBytes) {
+            need = usedBytes - policy.quotaBytes;
+        }
+        if (policy.minFreeBytes) {
+            ULARGE_INTEGER available, total, free;
+            if (GetDiskFreeSpaceExW(utf8ToWide(root).c_str(), &available, &total, &free) &&
+                available.QuadPart < policy.minFreeBytes) {
+                need = std::max<uint64_t>(need, policy.minFreeBytes - available.QuadPart);
+            }
+        }
+        return need;
+    }
+
+    // Must hold storageMutex. Recordings by stem, oldest first.
+    std::vector<StoredRecording> groups(std::map<std::string, std::vector<std::string>>* members) const {
+        std::map<std::string, StoredRecording> byStem;
+        for (const auto& entry : files) {
+            std::string s = stem(entry.first);
+            StoredRecording& group = byStem[s];
+            // The .ts names the recording when there is one
+            if (group.path.empty() || entry.first.compare(s.size(), std::string::npos, ".ts") == 0) {
+                group.path = entry.second.path;
+            }
+            group.bytes += entry.second.size;
+            group.modifiedMs = std::max(group.modifiedMs, entry.second.modifiedMs);
+            group.isProtected = protectedStems.count(s) > 0;
+            if (members) (*members)[s].push_back(entry.second.path);
+        }
+
+        std::vector<StoredRecording> result;
+        result.reserve(byStem.size());
+        for (auto& entry : byStem) result.push_back(std::move(entry.second));
+        std::sort(result.begin(), result.end(), [](const StoredRecording& a, const StoredRecording& b) {
+            return a.modifiedMs < b.modifiedMs;
+        });
+        return result;
+    }
+
+    void evict() {
+        std::vector<std::vector<std::string>> victims;
+        uint64_t need;
+        double unlinksPerSecond;
+        {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            need = excess();
+            if (need == 0) return;
+            unlinksPerSecond = std::max(0.1, policy.unlinksPerSecond);
+
+            std::map<std::string, std::vector<std::string>> members;
+            int64_t recent = nowMs() - RECENT_WRITE_MS;
+            uint64_t planned = 0;
+            for (const StoredRecording& group : groups(&members)) {
+                if (planned >= need) break;
+                if (group.isProtected || group.modifiedMs > recent) continue;
+                victims.push_back(members[stem(key(group.path))]);
+                planned += group.bytes;
+            }
+        }
+
+        auto interval = std::chrono::duration<double>(1.0 / unlinksPerSecond);
+        uint64_t freed = 0;
+        for (const auto& victim : victims) {
+            for (const std::string& path : victim) {
+                if (WaitForSingleObject(stopEvent, 0) == WAIT_OBJECT_0) return;
+
+                uint64_t size = 0;
+                int64_t modifiedMs = 0;
+                {
+                    std::lock_guard<std::mutex> lock(storageMutex);
+                    auto it = files.find(key(path));
+                    if (it == files.end()) continue;
+                    size = it->second.size;
+                    modifiedMs = it->second.modifiedMs;
+                }
+                // Fails harmlessly on a file something still has open
+                if (DeleteFileW(utf8ToWide(path).c_str())) {
+                    std::lock_guard<std::mutex> lock(storageMutex);
+                    removeEntry(path);
+                    evictedFiles++;
+                    evictedBytes += size;
+                    freed += size;
+                    PlayerMetrics::get().storageEvictions.inc();
+                    PlayerMetrics::get().storageUsedBytes.set(static_cast<double>(usedBytes));
+                    NativeLog::instance().write(LogLevel::Info, LOG_EVENT_RECORDING_EVICTED,
+                                                {size / 1048576.0, (nowMs() - modifiedMs) / 3600000.0},
+                                                NativeLog::jsonField("file", path));
+                }
+                std::this_thread::sleep_for(interval);
+            }
+            // Drop the date folder once its last recording is gone
+            if (!victim.empty()) {
+                size_t slash = victim.front().find_last_of('\\');
+                if (slash != std::string::npos && key(victim.front().substr(0, slash)) != key(root)) {
+                    RemoveDirectoryW(utf8ToWide(victim.front().substr(0, slash)).c_str());
+                }
+            }
+            if (freed >= need) break;
+        }
+    }
+
+    void runEvictor() {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        scanAll();
+
+        std::unique_lock<std::mutex> lock(storageMutex);
+        while (running) {
+            lock.unlock();
+            evict();
+            lock.lock();
+            wake.wait_for(lock, std::chrono::milliseconds(EVICT_CHECK_MS),
+                          [this] { return !running || evictRequested; });
+            evictRequested = false;
+        }
+    }
+
+public:
+    RecordingStorage(const RecordingStorage&) = delete;
+    RecordingStorage& operator=(const RecordingStorage&) = delete;
+
+    static RecordingStorage& instance() {
+        static RecordingStorage storage;
+        return storage;
+    }
+
+    // Starts the scan, the watch and the eviction thread
+    bool open(const std::string& recordingsDir, const StoragePolicy& limits) {
+        std::lock_guard<std::mutex> lock(storageMutex);
+        if (running) return true;
+
+        CreateDirectoryW(utf8ToWide(recordingsDir).c_str(), nullptr);
+        stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!stopEvent) return false;
+
+        root = recordingsDir;
+        while (root.size() > 3 && (root.back() == '\\' || root.back() == '/')) root.pop_back();
+        policy = limits;
+        running = true;
+        evictor = std::thread(&RecordingStorage::runEvictor, this);
+        watcher = std::thread(&RecordingStorage::watch, this);
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            if (!running) return;
+            running = false;
+        }
+        SetEvent(stopEvent);
+        wake.notify_all();
+        if (watcher.joinable()) watcher.join();
+        if (evictor.joinable()) evictor.join();
+
+        std::lock_guard<std::mutex> lock(storageMutex);
+        CloseHandle(stopEvent);
+        stopEvent = nullptr;
+        files.clear();
+        usedBytes = 0;
+    }
+
+    void configure(const StoragePolicy& limits) {
+        {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            policy = limits;
+            evictRequested = true;
+        }
+        wake.notify_all();
+    }
+
+    // Recordings (any of their files) never evicted
+    void setProtected(const std::vector<std::string>& paths) {
+        std::lock_guard<std::mutex> lock(storageMutex);
+        protectedStems.clear();
+        for (const std::string& path : paths) protectedStems.insert(stem(key(path)));
+    }
+
+    // A recording is starting: check the limits now rather than at the
+    // next interval
+    void requestSpace() {
+        {
+            std::lock_guard<std::mutex> lock(storageMutex);
+            if (!running) return;
+            evictRequested = true;
+        }
+        wake.notify_all();
+    }
+
+    RecordingStorageStats stats() {
+        std::lock_guard<std::mutex> lock(storageMutex);
+        RecordingStorageStats result;
+        result.usedBytes = usedBytes;
+        result.files = files.size();
+        result.evictedFiles = evictedFiles;
+        result.evictedBytes = evictedBytes;
+        result.watching = watching;
+        ULARGE_INTEGER available, total, free;
+        if (running && GetDiskFreeSpaceExW(utf8ToWide(root).c_str(), &available, &total, &free)) {
+            result.freeBytes = available.QuadPart;
+            result.totalBytes = total.QuadPart;
+        }
+        return result;
+    }
+
+    // Recordings oldest first, as eviction would take them
+    std::vector<StoredRecording> list() {
+        std::lock_guard<std::mutex> lock(storageMutex);
+        return groups(nullptr);
+    }
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+// Per-URL stream reliability model.
+//
+// A fixed-size open-addressing table keyed by a 64-bit FNV-1a hash of the
+// URL, memory-mapped from a file so it survives restarts without a load or
+// save step. Each slot keeps exponentially decayed counters (zap attempts,
+// successes, stalls, watch time) plus an EWMA of time-to-first-frame. A
+// lookup probes at most PROBE_LIMIT slots, so ranking a channel's mirrors
+// costs a handful of cache lines per URL regardless of how many URLs are
+// tracked. When a probe window is full the stalest slot in it is reused.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "win_util.h"
+
+#pragma pack(push, 1)
+struct ReliabilityEntry {
+    uint64_t urlHash;             // 0 = empty slot
+    int64_t updatedMs;            // Unix epoch of the last decay
+    float attempts;               // Decayed zap attempts
+    float successes;              // Decayed zaps that reached a first frame
+    float firstFrameMs;           // EWMA of successful zap latency
+    float stalls;                 // Decayed freezes / mid-stream errors
+    float watchSeconds;           // Decayed playback time
+    uint32_t reserved;
+};
+#pragma pack(pop)
+static_assert(sizeof(ReliabilityEntry) == 40, "reliability slots are fixed-size on disk");
+
+class ReliabilityStore {
+private:
+    static constexpr char MAGIC[8] = {'J', 'P', 'T', 'V', 'R', 'E', 'L', 'S'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CAPACITY = 8192;      // Power of two, ~320 KB mapped
+    static constexpr uint32_t PROBE_LIMIT = 16;
+    static constexpr double FIRST_FRAME_ALPHA = 0.3;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t entrySize;
+        uint32_t reserved[5];
+    };
+    static_assert(sizeof(Header) == 40, "header matches slot size");
+
+    std::mutex storeMutex;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    Header* header = nullptr;
+    ReliabilityEntry* entries = nullptr;
+    double halfLifeMs = 7.0 * 86400000.0;
+
+    ReliabilityStore() = default;
+
+    static size_t fileSize() {
+        return sizeof(Header) + static_cast<size_t>(CAPACITY) * sizeof(ReliabilityEntry);
+    }
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void unmapLocked() {
+        if (header) {
+            FlushViewOfFile(header, 0);
+            UnmapViewOfFile(header);
+            header = nullptr;
+            entries = nullptr;
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    // Bring a slot's counters forward to `now`
+    void decay(ReliabilityEntry& e, int64_t now) const {
+        if (now <= e.updatedMs) return;
+        float factor = static_cast<float>(std::exp2(-(now - e.updatedMs) / halfLifeMs));
+        e.attempts *= factor;
+        e.successes *= factor;
+        e.stalls *= factor;
+        e.watchSeconds *= factor;
+        e.updatedMs = now;
+    }
+
+    // Must hold storeMutex
+    ReliabilityEntry* find(uint64_t hash) const {
+        for (uint32_t i = 0; i < PROBE_LIMIT; i++) {
+            ReliabilityEntry& e = entries[(hash + i) & (CAPACITY - 1)];
+            if (e.urlHash == hash) return &e;
+            if (e.urlHash == 0) return nullptr;
+        }
+        return nullptr;
+    }
+
+    // Must hold storeMutex
+    ReliabilityEntry* findOrInsert(uint64_t hash, int64_t now) {
+        ReliabilityEntry* stalest = nullptr;
+        for (uint32_t i = 0; i < PROBE_LIMIT; i++) {
+            ReliabilityEntry& e = entries[(hash + i) & (CAPACITY - 1)];
+            if (e.urlHash == hash) {
+                decay(e, now);
+                return &e;
+            }
+            if (e.urlHash == 0) {
+                stalest = &e;
+                break;
+            }
+            if (!stalest || e.updatedMs < stalest->updatedMs) stalest = &e;
+        }
+
+        memset(stalest, 0, sizeof(ReliabilityEntry));
+        stalest->urlHash = hash;
+        stalest->updatedMs = now;
+        return stalest;
+    }
+
+    // Higher is better. Unknown URLs get the prior (~0.67) so a mirror with
+    // a poor record drops below untried ones but a good one stays ahead.
+    double scoreOf(const ReliabilityEntry* e, int64_t now) const {
+        if (!e) return 2.0 / 3.0;
+
+        ReliabilityEntry copy = *e;
+        decay(copy, now);
+
+        double successRate = (copy.successes + 2.0) / (copy.attempts + 3.0);
+        double zapPenalty = std::min(0.2, copy.firstFrameMs / 50000.0);
+        double hours = copy.watchSeconds / 3600.0;
+        double stallsPerHour = copy.stalls / std::max(hours, 0.25);
+        double stallPenalty = std::min(0.3, stallsPerHour * 0.05);
+        return successRate - zapPenalty - stallPenalty;
+    }
+
+public:
+    static ReliabilityStore& instance() {
+        static ReliabilityStore store;
+        return store;
+    }
+
+    static uint64_t hashUrl(const std::string& url) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : url) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h != 0 ? h : 1;
+    }
+
+    bool open(const std::string& path, double halfLifeDays) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (header) {
+            return true;
+        }
+        if (halfLifeDays > 0) halfLifeMs = halfLifeDays * 86400000.0;
+
+        file = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                           nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER existing;
+        bool fresh = !GetFileSizeEx(file, &existing) || static_cast<size_t>(existing.QuadPart) != fileSize();
+
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(fileSize()), nullptr);
+        if (!mapping) {
+            unmapLocked();
+            return false;
+        }
+        header = static_cast<Header*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, fileSize()));
+        if (!header) {
+            unmapLocked();
+            return false;
+        }
+        entries = reinterpret_cast<ReliabilityEntry*>(header + 1);
+
+        // Size or layout mismatch (new file, older version): start over
+        if (fresh || memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+            header->capacity != CAPACITY || header->entrySize != sizeof(ReliabilityEntry)) {
+            memset(header, 0, fileSize());
+            memcpy(header->magic, MAGIC, sizeof(MAGIC));
+            header->version = VERSION;
+            header->capacity = CAPACITY;
+            header->entrySize = sizeof(ReliabilityEntry);
+        }
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        unmapLocked();
+    }
+
+    bool isOpen() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return header != nullptr;
+    }
+
+    // Safe from libvlc event threads: storeMutex never nests with other locks
+    void recordZap(uint64_t hash, bool success, double firstFrameMs) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (!entries || hash == 0) return;
+
+        ReliabilityEntry* e = findOrInsert(hash, nowMs());
+        e->attempts += 1.0f;
+        if (success) {
+            e->successes += 1.0f;
+            e->firstFrameMs = e->firstFrameMs == 0
+                ? static_cast<float>(firstFrameMs)
+                : static_cast<float>(FIRST_FRAME_ALPHA * firstFrameMs + (1.0 - FIRST_FRAME_ALPHA) * e->firstFrameMs);
+        }
+    }
+
+    void recordStall(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (!entries || hash == 0) return;
+        findOrInsert(hash, nowMs())->stalls += 1.0f;
+    }
+
+    void recordWatch(uint64_t hash, double seconds) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (!entries || hash == 0 || seconds <= 0) return;
+        findOrInsert(hash, nowMs())->watchSeconds += static_cast<float>(seconds);
+    }
+
+    // Best-first order; ties (e.g. all unknown) keep the playlist order
+    std::vector<std::string> rank(const std::vector<std::string>& urls) {
+        std::vector<std::pair<double, size_t>> scored;
+        scored.reserve(urls.size());
+        {
+            std::lock_guard<std::mutex> lock(storeMutex);
+            int64_t now = nowMs();
+            for (size_t i = 0; i < urls.size(); i++) {
+                const ReliabilityEntry* e = entries ? find(hashUrl(urls[i])) : nullptr;
+                scored.emplace_back(scoreOf(e, now), i);
+            }
+        }
+
+        std::stable_sort(scored.begin(), scored.end(),
+                         [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+                             return a.first > b.first;
+                         });
+
+        std::vector<std::string> ordered;
+        ordered.reserve(urls.size());
+        for (const auto& s : scored) {
+            ordered.push_back(urls[s.second]);
+        }
+        return ordered;
+    }
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+// Post-processing queue that remuxes finished recordings to fragmented MP4
+// (see Fmp4Remuxer). Workers run in Windows background mode - lowest CPU
+// priority and very low I/O and memory priority - and share one byte-rate
+// throttle, so a remux never competes with playback or a recording in
+// progress for the disk.
+//
+// A file still open for writing is not remuxed: the remuxer's open fails
+// with a sharing violation and the job waits BUSY_RETRY_MS before trying
+// again. Progress and state changes go to a listener on the worker thread.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fmp4_remuxer.h"
+#include "metrics.h"
+#include "native_log.h"
+#include "win_util.h"
+
+enum class RemuxState : uint8_t { Queued = 0, Running, Waiting, Done, Failed, Cancelled };
+
+inline const char* remuxStateName(RemuxState state) {
+    switch (state) {
+        case RemuxState::Queued: return "queued";
+        case RemuxState::Running: return "running";
+        case RemuxState::Waiting: return "waiting";
+        case RemuxState::Done: return "done";
+        case RemuxState::Failed: return "failed";
+        case RemuxState::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+struct RemuxJobInfo {
+    uint32_t id = 0;
+    std::string inputPath;
+    std::string outputPath;
+    RemuxState state = RemuxState::Queued;
+    double progress = 0;        // 0..1
+    bool deleteSource = false;
+    std::string error;
+};
+
+class RemuxQueue {
+private:
+    static constexpr int64_t BUSY_RETRY_MS = 30000;
+    static constexpr size_t MAX_FINISHED = 50;
+    static constexpr int MAX_WORKERS = 4;
+
+    struct Job {
+        RemuxJobInfo info;
+        int64_t retryAtMs = 0;
+        std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>(false);
+    };
+
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::vector<std::thread> workers;
+    bool running = false;
+    bool autoEnqueue = false;
+    bool autoDeleteSource = false;
+    IoThrottle throttle;
+    std::map<uint32_t, Job> jobs;
+    std::deque<uint32_t> pending;           // Queued and waiting, in order
+    std::deque<uint32_t> finished;
+    uint32_t nextId = 1;
+    std::function<void(const RemuxJobInfo&)> listener;
+
+    RemuxQueue() = default;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static std::string defaultOutput(const std::string& input) {
+        size_t slash = input.find_last_of("\\/");
+        size_t dot = input.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return input + ".mp4";
+        return input.substr(0, dot) + ".mp4";
+    }
+
+    void notify(const RemuxJobInfo& info) {
+        std::function<void(const RemuxJobInfo&)> callback;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            callback = listener;
+        }
+        if (callback) callback(info);
+    }
+
+    // Must hold queueMutex
+    void retire(uint32_t id) {
+        finished.push_back(id);
+        while (finished.size() > MAX_FINISHED) {
+            jobs.erase(finished.front());
+            finished.pop_front();
+        }
+        PlayerMetrics::get().remuxQueued.set(static_cast<double>(pending.size()));
+    }
+
+    // Must hold queueMutex. The first job due, or 0 with the time to wait.
+    uint32_t takeNext(int64_t now, int64_t& waitMs) {
+        waitMs = -1;
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            Job& job = jobs[*it];
+            if (job.retryAtMs <= now) {
+                uint32_t id = *it;
+                pending.erase(it);
+                return id;
+            }
+            int64_t wait = job.retryAtMs - now;
+            waitMs = waitMs < 0 ? wait : std::min(waitMs, wait);
+        }
+        return 0;
+    }
+
+    void run() {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        PlayerMetrics& metrics = PlayerMetrics::get();
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (running) {
+            int64_t waitMs;
+            uint32_t id = takeNext(nowMs(), waitMs);
+            if (!id) {
+                if (waitMs < 0) wake.wait(lock);
+                else wake.wait_for(lock, std::chrono::milliseconds(waitMs));
+                continue;
+            }
+
+            Job& job = jobs[id];
+            job.info.state = RemuxState::Running;
+            job.info.progress = 0;
+            RemuxJobInfo info = job.info;
+            std::shared_ptr<std::atomic<bool>> cancel = job.cancel;
+            lock.unlock();
+
+            notify(info);
+            auto started = std::chrono::steady_clock::now();
+            Fmp4Remuxer remuxer(throttle, *cancel, [this, &info](double fraction) {
+                info.progress = fraction;
+                {
+                    std::lock_guard<std::mutex> progressLock(queueMutex);
+                    auto it = jobs.find(info.id);
+                    if (it != jobs.end()) it->second.info.progress = fraction;
+                }
+                notify(info);
+            });
+            RemuxResult result = remuxer.run(info.inputPath, info.outputPath);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+            uint64_t inputSize = 0;
+            uint64_t outputSize = 0;
+            if (result == RemuxResult::Done) {
+                getFileSize(info.inputPath, inputSize);
+                getFileSize(info.outputPath, outputSize);
+                metrics.remuxBytes.inc(static_cast<double>(inputSize));
+                if (info.deleteSource) DeleteFileW(utf8ToWide(info.inputPath).c_str());
+                NativeLog::instance().write(LogLevel::Info, LOG_EVENT_REMUX_DONE,
+                                            {seconds, inputSize / 1048576.0, outputSize / 1048576.0},
+                                            NativeLog::jsonField("file", info.outputPath));
+            } else if (result == RemuxResult::Failed) {
+                metrics.remuxFailures.inc();
+                NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_REMUX_FAILED, {},
+                                            NativeLog::jsonField("file", info.inputPath) + "," +
+                                            NativeLog::jsonField("error", remuxer.getError()));
+            }
+
+            lock.lock();
+            Job& done = jobs[id];
+            done.info.error = remuxer.getError();
+            switch (result) {
+                case RemuxResult::Done:
+                    done.info.state = RemuxState::Done;
+                    done.info.progress = 1;
+                    break;
+                case RemuxResult::Busy:
+                    // Still being recorded: back of the queue, later
+                    done.info.state = cancel->load() ? RemuxState::Cancelled : RemuxState::Waiting;
+                    done.retryAtMs = nowMs() + BUSY_RETRY_MS;
+                    break;
+                case RemuxResult::Cancelled:
+                    done.info.state = RemuxState::Cancelled;
+                    break;
+                case RemuxResult::Failed:
+                    done.info.state = RemuxState::Failed;
+                    break;
+            }
+            if (done.info.state == RemuxState::Waiting && running) {
+                pending.push_back(id);
+            } else {
+                retire(id);
+            }
+            info = done.info;
+            lock.unlock();
+            notify(info);
+            lock.lock();
+        }
+    }
+
+public:
+    RemuxQueue(const RemuxQueue&) = delete;
+    RemuxQueue& operator=(const RemuxQueue&) = delete;
+
+    static RemuxQueue& instance() {
+        static RemuxQueue queue;
+        return queue;
+    }
+
+    // workerCount: parallel remuxes (1 keeps the disk sequential);
+    // bytesPerSecond: read plus write budget shared by all, 0 = unlimited
+    bool start(int workerCount, double bytesPerSecond, std::function<void(const RemuxJobInfo&)> onEvent) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (running) return true;
+
+        throttle.setRate(bytesPerSecond);
+        listener = std::move(onEvent);
+        running = true;
+        int count = std::max(1, std::min(workerCount, MAX_WORKERS));
+        for (int i = 0; i < count; i++) {
+            workers.emplace_back(&RemuxQueue::run, this);
+        }
+        return true;
+    }
+
+    // Cancels the running remuxes (their partial output is deleted) and
+    // forgets the queue
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!running) return;
+            running = false;
+            for (auto& entry : jobs) entry.second.cancel->store(true);
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        workers.clear();
+        jobs.clear();
+        pending.clear();
+        finished.clear();
+        listener = nullptr;
+        PlayerMetrics::get().remuxQueued.set(0);
+    }
+
+    void configure(bool enqueueRecordings, bool deleteSource, double bytesPerSecond) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        autoEnqueue = enqueueRecordings;
+        autoDeleteSource = deleteSource;
+        throttle.setRate(bytesPerSecond);
+    }
+
+    // Returns the job id (an existing one if the input is already queued),
+    // or 0 if the queue is not running. outputPath "" = input name, .mp4.
+    uint32_t enqueue(const std::string& inputPath, const std::string& outputPath, bool deleteSource) {
+        RemuxJobInfo info;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!running) return 0;
+            for (uint32_t id : pending) {
+                if (jobs[id].info.inputPath == inputPath) return id;
+            }
+            for (auto& entry : jobs) {
+                if (entry.second.info.state == RemuxState::Running && entry.second.info.inputPath == inputPath) {
+                    return entry.first;
+                }
+            }
+
+            Job job;
+            job.info.id = nextId++;
+            job.info.inputPath = inputPath;
+            job.info.outputPath = outputPath.empty() ? defaultOutput(inputPath) : outputPath;
+            job.info.deleteSource = deleteSource;
+            info = job.info;
+            jobs[info.id] = std::move(job);
+            pending.push_back(info.id);
+            PlayerMetrics::get().remuxQueued.set(static_cast<double>(pending.size()));
+        }
+        wake.notify_one();
+        notify(info);
+        return info.id;
+    }
+
+    // A recording file was closed; queued when configured to do so
+    void recordingFinished(const std::string& filePath) {
+        bool deleteSource;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!running || !autoEnqueue) return;
+            deleteSource = autoDeleteSource;
+        }
+        enqueue(filePath, "", deleteSource);
+    }
+
+    bool cancel(uint32_t id) {
+        RemuxJobInfo info;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            auto it = jobs.find(id);
+            if (it == jobs.end()) return false;
+            Job& job = it->second;
+            if (job.info.state == RemuxState::Running) {
+                job.cancel->store(true);        // The worker reports it
+                return true;
+            }
+            if (job.info.state != RemuxState::Queued && job.info.state != RemuxState::Waiting) return false;
+            pending.erase(std::remove(pending.begin(), pending.end(), id), pending.end());
+            job.info.state = RemuxState::Cancelled;
+            info = job.info;
+            retire(id);
+        }
+        notify(info);
+        return true;
+    }
+
+    // Running and queued jobs in queue order, then finished ones newest first
+    std::vector<RemuxJobInfo> list() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        std::vector<RemuxJobInfo> result;
+        for (const auto& entry : jobs) {
+            if (entry.second.info.state == RemuxState::Running) result.push_back(entry.second.info);
+        }
+        for (uint32_t id : pending) result.push_back(jobs[id].info);
+        for (auto it = finished.rbegin(); it != finished.rend(); ++it) result.push_back(jobs[*it].info);
+        return result;
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+// Last stream played, kept in a tiny file next to the settings so the next
+// launch can start opening it before the renderer has loaded the playlist.
+// Rewritten (write-then-rename) whenever a different URL starts playing;
+// read once at warm-up.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "win_util.h"
+
+class ResumeState {
+private:
+    static constexpr char MAGIC[8] = {'J', 'P', 'T', 'V', 'R', 'S', 'M', '1'};
+    static constexpr uint32_t MAX_FIELD = 8192;
+
+#pragma pack(push, 1)
+    struct Header {
+        char magic[8];
+        uint32_t urlLength;
+        uint32_t channelLength;
+        int64_t savedMs;
+    };
+#pragma pack(pop)
+
+public:
+    std::string url;
+    std::string channel;        // Telemetry channel key at the time, may be ""
+    int64_t savedMs = 0;        // Unix epoch
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool load(const std::string& path) {
+        FILE* f = _wfopen(utf8ToWide(path).c_str(), L"rb");
+        if (!f) return false;
+
+        Header header;
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+                  memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                  header.urlLength > 0 && header.urlLength <= MAX_FIELD &&
+                  header.channelLength <= MAX_FIELD;
+        if (ok) {
+            url.assign(header.urlLength, '\0');
+            channel.assign(header.channelLength, '\0');
+            ok = fread(&url[0], 1, url.size(), f) == url.size() &&
+                 (channel.empty() || fread(&channel[0], 1, channel.size(), f) == channel.size());
+            savedMs = header.savedMs;
+        }
+        fclose(f);
+
+        if (!ok) {
+            url.clear();
+            channel.clear();
+            savedMs = 0;
+        }
+        return ok;
+    }
+
+    bool save(const std::string& path) const {
+        if (url.empty() || url.size() > MAX_FIELD || channel.size() > MAX_FIELD) return false;
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.urlLength = static_cast<uint32_t>(url.size());
+        header.channelLength = static_cast<uint32_t>(channel.size());
+        header.savedMs = savedMs;
+
+        // Write-then-rename so a crash mid-write keeps the previous state
+        std::string tempPath = path + ".tmp";
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) return false;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  fwrite(url.data(), 1, url.size(), f) == url.size() &&
+                  fwrite(channel.data(), 1, channel.size(), f) == channel.size();
+        ok = fclose(f) == 0 && ok;
+
+        if (ok && MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            return true;
+        }
+        DeleteFileW(utf8ToWide(tempPath).c_str());
+        return false;
+    }
+};
@@ -0,0 +1,534 @@
+#pragma once
+
+// Playback telemetry journal.
+//
+// Fixed-size binary records (session start/stop, zap phases, stalls, bitrate
+// summaries) are appended to one file per local day through a buffered
+// FILE*. Channel ids and URLs are interned in an append-only string table so
+// records stay 32 bytes. Queries scan the day files in range and aggregate
+// per channel and per mirror URL; a month of heavy viewing is a few MB.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "win_util.h"
+
+enum JournalRecordType : uint8_t {
+    JOURNAL_PADDING = 0,          // Alignment filler after a torn write, skipped
+    JOURNAL_SESSION_START = 1,
+    JOURNAL_SESSION_STOP,         // value1: watched seconds
+    JOURNAL_ZAP_PHASE,            // value1: JournalZapPhase, value2: ms since request
+    JOURNAL_STALL,                // value1: stall duration ms
+    JOURNAL_BITRATE               // value1/2/3: avg/min/max kbps, extra: dropped frames
+};
+
+enum JournalZapPhase : uint32_t {
+    ZAP_PHASE_REQUESTED = 0,
+    ZAP_PHASE_OPENED,
+    ZAP_PHASE_FIRST_FRAME,
+    ZAP_PHASE_FAILED
+};
+
+#pragma pack(push, 1)
+struct JournalRecord {
+    int64_t timestampMs;          // Unix epoch
+    uint32_t channelId;           // String table ids, 0 = unknown
+    uint32_t urlId;
+    uint32_t value1;
+    uint32_t value2;
+    uint32_t value3;
+    uint8_t type;
+    uint8_t extra[3];             // Type-specific 24-bit value
+};
+#pragma pack(pop)
+static_assert(sizeof(JournalRecord) == 32, "journal records are fixed-size on disk");
+
+struct JournalMirrorStats {
+    std::string url;
+    uint64_t zaps = 0;
+    uint64_t zapSuccesses = 0;
+    uint64_t zapFailures = 0;
+    double zapMsTotal = 0;
+    uint64_t stalls = 0;
+    double stallMs = 0;
+    double watchSeconds = 0;
+    double bitrateTotal = 0;
+    uint64_t bitrateSamples = 0;
+
+    double availability() const { return zaps > 0 ? static_cast<double>(zapSuccesses) / zaps : 0; }
+    double meanZapMs() const { return zapSuccesses > 0 ? zapMsTotal / zapSuccesses : 0; }
+    double meanBitrateKbps() const { return bitrateSamples > 0 ? bitrateTotal / bitrateSamples : 0; }
+};
+
+struct JournalChannelStats : JournalMirrorStats {
+    std::string channel;
+    uint64_t sessions = 0;
+    std::vector<JournalMirrorStats> mirrors;
+};
+
+class SessionJournal {
+private:
+    static constexpr char MAGIC[8] = {'J', 'P', 'T', 'V', 'J', 'R', 'N', 'L'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr int64_t FLUSH_INTERVAL_MS = 30000;
+
+    std::mutex journalMutex;
+    std::string dir;
+    int retentionDays = 400;
+    FILE* file = nullptr;
+    FILE* stringsFile = nullptr;
+    int currentDay = 0;           // YYYYMMDD of the open file
+    int64_t lastFlushMs = 0;
+
+    std::vector<std::string> strings = {""};
+    std::unordered_map<std::string, uint32_t> stringIds;
+
+    SessionJournal() = default;
+
+    static int dayOf(int64_t timestampMs) {
+        time_t seconds = static_cast<time_t>(timestampMs / 1000);
+        struct tm local;
+        localtime_s(&local, &seconds);
+        return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+    }
+
+    std::string pathFor(int day) const {
+        return dir + "\\journal-" + std::to_string(day) + ".bin";
+    }
+
+    void loadStrings() {
+        std::wstring path = utf8ToWide(dir + "\\strings.dat");
+        FILE* f = _wfopen(path.c_str(), L"r+b");
+        if (f) {
+            uint32_t id;
+            uint16_t length;
+            long long validBytes = 0;
+            while (fread(&id, sizeof(id), 1, f) == 1 && fread(&length, sizeof(length), 1, f) == 1) {
+                std::string value(length, '\0');
+                if (length > 0 && fread(&value[0], 1, length, f) != length) break;
+                if (id != strings.size()) break;        // Torn tail from a crash
+                stringIds.emplace(value, id);
+                strings.push_back(std::move(value));
+                validBytes += sizeof(id) + sizeof(length) + length;
+            }
+            // Drop the torn tail, or new entries would land behind it and
+            // every later load would stop before them
+            fflush(f);
+            _chsize_s(_fileno(f), validBytes);
+            fclose(f);
+        }
+        stringsFile = _wfopen(path.c_str(), L"ab");
+    }
+
+    // Must hold journalMutex
+    bool openDay(int day) {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+
+        std::wstring path = utf8ToWide(pathFor(day));
+        file = _wfopen(path.c_str(), L"ab");
+        if (!file) {
+            return false;
+        }
+        setvbuf(file, nullptr, _IOFBF, 64 * 1024);
+
+        uint64_t size = 0;
+        getFileSize(pathFor(day), size);
+        if (size == 0) {
+            uint32_t header[2] = {VERSION, sizeof(JournalRecord)};
+            fwrite(MAGIC, 1, sizeof(MAGIC), file);
+            fwrite(header, sizeof(header), 1, file);
+        } else if (size > HEADER_SIZE && (size - HEADER_SIZE) % sizeof(JournalRecord) != 0) {
+            // Realign after a torn write; zero bytes read back as padding
+            static const uint8_t zeros[sizeof(JournalRecord)] = {};
+            fwrite(zeros, 1, sizeof(JournalRecord) - (size - HEADER_SIZE) % sizeof(JournalRecord), file);
+        }
+
+        currentDay = day;
+        pruneOldFiles(day);
+        return true;
+    }
+
+    void pruneOldFiles(int today) {
+        struct tm cutoff = {};
+        cutoff.tm_year = today / 10000 - 1900;
+        cutoff.tm_mon = (today / 100) % 100 - 1;
+        cutoff.tm_mday = today % 100 - retentionDays;
+        cutoff.tm_hour = 12;
+        mktime(&cutoff);
+        int cutoffDay = (cutoff.tm_year + 1900) * 10000 + (cutoff.tm_mon + 1) * 100 + cutoff.tm_mday;
+
+        for (int day : listDays()) {
+            if (day < cutoffDay) {
+                DeleteFileW(utf8ToWide(pathFor(day)).c_str());
+            }
+        }
+    }
+
+    std::vector<int> listDays() const {
+        std::vector<int> days;
+        WIN32_FIND_DATAW data;
+        HANDLE find = FindFirstFileW(utf8ToWide(dir + "\\journal-*.bin").c_str(), &data);
+        if (find == INVALID_HANDLE_VALUE) {
+            return days;
+        }
+        do {
+            int day = _wtoi(data.cFileName + 8);            // After "journal-"
+            if (day > 19700101) days.push_back(day);
+        } while (FindNextFileW(find, &data));
+        FindClose(find);
+        std::sort(days.begin(), days.end());
+        return days;
+    }
+
+    struct Accumulator {
+        JournalChannelStats channel;
+        std::map<uint32_t, JournalMirrorStats> mirrors;
+    };
+
+    static void applyRecord(const JournalRecord& r, JournalMirrorStats& stats) {
+        switch (r.type) {
+            case JOURNAL_SESSION_STOP:
+                stats.watchSeconds += r.value1;
+                break;
+            case JOURNAL_ZAP_PHASE:
+                if (r.value1 == ZAP_PHASE_REQUESTED) {
+                    stats.zaps++;
+                } else if (r.value1 == ZAP_PHASE_FIRST_FRAME) {
+                    stats.zapSuccesses++;
+                    stats.zapMsTotal += r.value2;
+                } else if (r.value1 == ZAP_PHASE_FAILED) {
+                    stats.zapFailures++;
+                }
+                break;
+            case JOURNAL_STALL:
+                stats.stalls++;
+                stats.stallMs += r.value1;
+                break;
+            case JOURNAL_BITRATE:
+                stats.bitrateTotal += r.value1;
+                stats.bitrateSamples++;
+                break;
+            default:
+                break;
+        }
+    }
+
+public:
+    static SessionJournal& instance() {
+        static SessionJournal journal;
+        return journal;
+    }
+
+    bool open(const std::string& directory, int keepDays) {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (file) {
+            return true;
+        }
+
+        dir = directory;
+        if (keepDays > 0) retentionDays = keepDays;
+        CreateDirectoryW(utf8ToWide(dir).c_str(), nullptr);
+
+        loadStrings();
+        lastFlushMs = nowMs();
+        return openDay(dayOf(lastFlushMs));
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+        if (stringsFile) {
+            fclose(stringsFile);
+            stringsFile = nullptr;
+        }
+    }
+
+    bool isOpen() {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        return file != nullptr;
+    }
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    uint32_t intern(const std::string& value) {
+        if (value.empty()) {
+            return 0;
+        }
+        std::string key = value.size() > 0xFFFF ? value.substr(0, 0xFFFF) : value;
+
+        std::lock_guard<std::mutex> lock(journalMutex);
+        auto it = stringIds.find(key);
+        if (it != stringIds.end()) {
+            return it->second;
+        }
+
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        strings.push_back(key);
+        stringIds.emplace(key, id);
+
+        if (stringsFile) {
+            uint16_t length = static_cast<uint16_t>(key.size());
+            fwrite(&id, sizeof(id), 1, stringsFile);
+            fwrite(&length, sizeof(length), 1, stringsFile);
+            fwrite(key.data(), 1, key.size(), stringsFile);
+            fflush(stringsFile);        // Records must never reference an unwritten id
+        }
+        return id;
+    }
+
+    void append(JournalRecord record) {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (!file) {
+            return;
+        }
+
+        int day = dayOf(record.timestampMs);
+        if (day != currentDay && !openDay(day)) {
+            return;
+        }
+
+        fwrite(&record, sizeof(record), 1, file);
+
+        // Session boundaries are flushed right away, the rest in batches
+        if (record.type == JOURNAL_SESSION_STOP || record.timestampMs - lastFlushMs >= FLUSH_INTERVAL_MS) {
+            fflush(file);
+            lastFlushMs = record.timestampMs;
+        }
+    }
+
+    // Aggregate [fromMs, toMs); safe to run on a worker thread
+    std::vector<JournalChannelStats> query(int64_t fromMs, int64_t toMs) {
+        std::vector<std::string> names;
+        std::vector<int> days;
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            if (file) fflush(file);
+            names = strings;
+            days = listDays();
+        }
+
+        // Local-day file names; one day of slack covers timezone edges
+        int firstDay = dayOf(fromMs - 86400000LL);
+        int lastDay = dayOf(toMs + 86400000LL);
+
+        std::map<uint32_t, Accumulator> channels;
+        std::vector<JournalRecord> block(4096);
+
+        for (int day : days) {
+            if (day < firstDay || day > lastDay) continue;
+
+            FILE* f = _wfopen(utf8ToWide(pathFor(day)).c_str(), L"rb");
+            if (!f) continue;
+
+            char magic[sizeof(MAGIC)];
+            uint32_t header[2];
+            if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                fread(header, sizeof(header), 1, f) != 1 || header[1] != sizeof(JournalRecord)) {
+                fclose(f);
+                continue;
+            }
+
+            size_t n;
+            while ((n = fread(block.data(), sizeof(JournalRecord), block.size(), f)) > 0) {
+                for (size_t i = 0; i < n; i++) {
+                    const JournalRecord& r = block[i];
+                    if (r.type == JOURNAL_PADDING || r.timestampMs < fromMs || r.timestampMs >= toMs) continue;
+
+                    // Sessions without a channel are keyed by their URL
+                    uint32_t key = r.channelId != 0 ? r.channelId : r.urlId;
+                    Accumulator& acc = channels[key];
+                    if (r.type == JOURNAL_SESSION_START) {
+                        acc.channel.sessions++;
+                    }
+                    applyRecord(r, acc.channel);
+                    applyRecord(r, acc.mirrors[r.urlId]);
+                }
+            }
+            fclose(f);
+        }
+
+        auto nameOf = [&](uint32_t id) { return id < names.size() ? names[id] : std::string(); };
+
+        std::vector<JournalChannelStats> result;
+        result.reserve(channels.size());
+        for (auto& entry : channels) {
+            JournalChannelStats stats = entry.second.channel;
+            stats.channel = nameOf(entry.first);
+            for (auto& mirror : entry.second.mirrors) {
+                mirror.second.url = nameOf(mirror.first);
+                stats.mirrors.push_back(mirror.second);
+            }
+            result.push_back(std::move(stats));
+        }
+        std::sort(result.begin(), result.end(), [](const JournalChannelStats& a, const JournalChannelStats& b) {
+            return a.watchSeconds > b.watchSeconds;
+        });
+        return result;
+    }
+};
+
+// Per-player session state; turns player events into journal records.
+// Called from the JS thread and libvlc's event thread.
+class JournalSession {
+private:
+    std::mutex sessionMutex;
+    std::string pendingChannel;
+    bool active = false;
+    uint32_t channelId = 0;
+    uint32_t urlId = 0;
+    int64_t startMs = 0;
+    int64_t zapRequestMs = 0;
+    bool awaitingFirstFrame = false;
+    int64_t stallStartMs = 0;
+
+    // Bitrate summary window
+    static constexpr int64_t BITRATE_WINDOW_MS = 60000;
+    int64_t windowStartMs = 0;
+    double bitrateTotal = 0;
+    double bitrateMin = 0;
+    double bitrateMax = 0;
+    uint32_t bitrateSamples = 0;
+    uint64_t droppedFrames = 0;
+
+    JournalRecord record(JournalRecordType type, int64_t now, uint32_t v1 = 0, uint32_t v2 = 0, uint32_t v3 = 0) const {
+        JournalRecord r = {};
+        r.timestampMs = now;
+        r.channelId = channelId;
+        r.urlId = urlId;
+        r.value1 = v1;
+        r.value2 = v2;
+        r.value3 = v3;
+        r.type = type;
+        return r;
+    }
+
+    static uint32_t clampMs(int64_t ms) {
+        return ms <= 0 ? 0 : (ms > 0xFFFFFFFFLL ? 0xFFFFFFFFu : static_cast<uint32_t>(ms));
+    }
+
+    // Must hold sessionMutex
+    void flushBitrate(int64_t now) {
+        if (bitrateSamples > 0) {
+            JournalRecord r = record(JOURNAL_BITRATE, now, static_cast<uint32_t>(bitrateTotal / bitrateSamples),
+                                     static_cast<uint32_t>(bitrateMin), static_cast<uint32_t>(bitrateMax));
+            uint32_t dropped = droppedFrames > 0xFFFFFF ? 0xFFFFFF : static_cast<uint32_t>(droppedFrames);
+            r.extra[0] = dropped & 0xFF;
+            r.extra[1] = (dropped >> 8) & 0xFF;
+            r.extra[2] = (dropped >> 16) & 0xFF;
+            SessionJournal::instance().append(r);
+        }
+        windowStartMs = now;
+        bitrateTotal = bitrateMin = bitrateMax = 0;
+        bitrateSamples = 0;
+        droppedFrames = 0;
+    }
+
+    // Must hold sessionMutex
+    void endLocked(int64_t now) {
+        if (!active) return;
+        if (stallStartMs != 0) {
+            SessionJournal::instance().append(record(JOURNAL_STALL, now, clampMs(now - stallStartMs)));
+            stallStartMs = 0;
+        }
+        flushBitrate(now);
+        SessionJournal::instance().append(record(JOURNAL_SESSION_STOP, now, clampMs((now - startMs) / 1000)));
+        active = false;
+        awaitingFirstFrame = false;
+    }
+
+public:
+    // Sticky: applies to every play() until changed ("" = key by URL)
+    void setChannel(const std::string& channel) {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        pendingChannel = channel;
+    }
+
+    void begin(const std::string& url) {
+        SessionJournal& journal = SessionJournal::instance();
+        if (!journal.isOpen()) return;
+
+        uint32_t newUrlId = journal.intern(url);
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        uint32_t newChannelId = journal.intern(pendingChannel);
+        int64_t now = SessionJournal::nowMs();
+        endLocked(now);
+
+        active = true;
+        channelId = newChannelId;
+        urlId = newUrlId;
+        startMs = zapRequestMs = windowStartMs = now;
+        awaitingFirstFrame = true;
+        journal.append(record(JOURNAL_SESSION_START, now));
+        journal.append(record(JOURNAL_ZAP_PHASE, now, ZAP_PHASE_REQUESTED));
+    }
+
+    void zapPhase(JournalZapPhase phase) {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        if (!active) return;
+        if (phase == ZAP_PHASE_FIRST_FRAME || phase == ZAP_PHASE_FAILED) {
+            if (!awaitingFirstFrame) return;        // Only the first outcome per zap counts
+            awaitingFirstFrame = false;
+        }
+        int64_t now = SessionJournal::nowMs();
+        SessionJournal::instance().append(record(JOURNAL_ZAP_PHASE, now, phase, clampMs(now - zapRequestMs)));
+    }
+
+    void stallStarted() {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        if (active && stallStartMs == 0) {
+            stallStartMs = SessionJournal::nowMs();
+        }
+    }
+
+    void stallEnded() {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        if (!active || stallStartMs == 0) return;
+        int64_t now = SessionJournal::nowMs();
+        SessionJournal::instance().append(record(JOURNAL_STALL, now, clampMs(now - stallStartMs)));
+        stallStartMs = 0;
+    }
+
+    void sampleBitrate(double kbps, uint64_t dropped) {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        if (!active) return;
+
+        bitrateTotal += kbps;
+        bitrateMin = bitrateSamples == 0 ? kbps : std::min(bitrateMin, kbps);
+        bitrateMax = std::max(bitrateMax, kbps);
+        bitrateSamples++;
+        droppedFrames += dropped;
+
+        int64_t now = SessionJournal::nowMs();
+        if (now - windowStartMs >= BITRATE_WINDOW_MS) {
+            flushBitrate(now);
+        }
+    }
+
+    void end() {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        endLocked(SessionJournal::nowMs());
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+// The process-wide libvlc instance. libvlc_new loads the plugin bank (or
+// reads plugins.dat), which is the slow part of starting a player, and the
+// bank stays loaded per process anyway, so every VlcPlayer - the main one,
+// multiview tiles, probes, the bench's players - takes a reference to the
+// same instance instead of creating its own. The instance is released with
+// the last reference; the next acquire() starts a new one.
+
+#include <vlc/vlc.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "metrics.h"
+#include "stream_failure.h"
+
+// A value for a sout chain option (dst=...). Chain values are unescaped, so
+// a path's backslashes and quotes are escaped here, then quoted.
+inline std::string soutString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"' || c == '\'') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out + "\"";
+}
+
+// Whether demux dump can take the input as received: only where the access
+// delivers TS itself. HLS and RTP need a sout ts mux instead.
+inline bool rawTsInput(const std::string& url) {
+    if (url.find(".m3u8") != std::string::npos) return false;
+    return url.compare(0, 7, "http://") == 0 || url.compare(0, 8, "https://") == 0 ||
+           url.compare(0, 6, "udp://") == 0;
+}
+
+class SharedLibvlc {
+private:
+    std::mutex createMutex;                         // Held while libvlc_new runs
+    std::weak_ptr<libvlc_instance_t> current;
+
+    SharedLibvlc() = default;
+
+    static void release(libvlc_instance_t* instance) {
+        libvlc_release(instance);
+        PlayerMetrics::get().libvlcInstances.add(-1);
+    }
+
+public:
+    SharedLibvlc(const SharedLibvlc&) = delete;
+    SharedLibvlc& operator=(const SharedLibvlc&) = delete;
+
+    static SharedLibvlc& instance() {
+        static SharedLibvlc shared;
+        return shared;
+    }
+
+    // The live instance, or a new one; null if libvlc failed to start. A
+    // caller arriving while another thread is creating it waits for that one.
+    // resetPluginCache only has an effect when a new instance is created.
+    std::shared_ptr<libvlc_instance_t> acquire(bool resetPluginCache = false) {
+        std::lock_guard<std::mutex> lock(createMutex);
+        std::shared_ptr<libvlc_instance_t> instance = current.lock();
+        if (instance) {
+            return instance;
+        }
+
+        // Initialize libVLC with common options
+        std::vector<const char*> vlcArgs = {
+            "--no-video-title-show",     // Don't show filename on video
+            "--no-xlib",                  // Don't use Xlib
+            "--no-snapshot-preview",      // No snapshot preview
+            "--quiet",                    // Less verbose
+            "--network-caching=3000",     // 3s network cache for IPTV
+            "--clock-jitter=0",           // Reduce jitter
+            "--clock-synchro=0"           // Disable clock sync issues
+        };
+        if (resetPluginCache) {
+            vlcArgs.push_back("--reset-plugins-cache");
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        libvlc_instance_t* created = libvlc_new(static_cast<int>(vlcArgs.size()), vlcArgs.data());
+        if (!created) {
+            return nullptr;
+        }
+        PlayerMetrics::get().libvlcInstances.add(1);
+        PlayerMetrics::get().libvlcInitTime.set(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        StreamFailureMonitor::instance().install(created);
+
+        instance.reset(created, &SharedLibvlc::release);
+        current = instance;
+        return instance;
+    }
+
+    // Rebuild plugins.dat from a full scan with a throwaway instance. Only
+    // works while no instance is alive, since libvlc keeps the plugin bank
+    // loaded until the last one is released.
+    bool regeneratePluginCache() {
+        std::lock_guard<std::mutex> lock(createMutex);
+        if (!current.expired()) {
+            return false;
+        }
+
+        const char* vlcArgs[] = {"--quiet", "--reset-plugins-cache"};
+        libvlc_instance_t* instance = libvlc_new(sizeof(vlcArgs) / sizeof(vlcArgs[0]), vlcArgs);
+        if (!instance) {
+            return false;
+        }
+        libvlc_release(instance);
+        return true;
+    }
+};
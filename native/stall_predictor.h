@@ -0,0 +1,226 @@
+#pragma once
+
+// Buffer model used to predict playback underruns before they happen.
+//
+// libvlc does not expose its buffer level, so it is reconstructed from the
+// per-media byte counters: every byte the demuxer consumes adds media time
+// to the buffer (at the stream's long-run byte rate) and playback drains it
+// in real time. Bytes read by the access but not yet demuxed sit in the
+// stream cache and count too. The level is re-anchored from libvlc's
+// Buffering events, which report the fill of the network-caching window.
+//
+// Fed from the player's sampler thread; not thread-safe on its own.
+
+#include <algorithm>
+#include <cstdint>
+
+class StallPredictor {
+private:
+    static constexpr int HISTORY = 12;                  // Trend window (3 s at 250 ms)
+    static constexpr int64_t WARMUP_SKIP_MS = 1000;     // Initial fill burst after first frame
+    static constexpr int64_t WARMUP_MS = 3000;
+    static constexpr double RATE_TAU_MS = 30000.0;
+    static constexpr double HORIZON_MS = 5000.0;        // Act if the buffer empties sooner
+    static constexpr int64_t INPUT_SILENCE_MS = 1500;
+    static constexpr int64_t PICTURE_SILENCE_MS = 1000;
+    static constexpr int64_t RECOVERY_MS = 5000;
+
+    double targetMs = 3000;
+    bool started = false;
+    int64_t lastMs = 0;
+    uint32_t lastRead = 0;
+    uint32_t lastDemux = 0;
+    uint32_t lastDisplayed = 0;
+
+    int64_t sinceStartMs = 0;
+    int64_t warmupMs = 0;
+    uint64_t warmupBytes = 0;
+    double mediaRate = 0;               // Bytes of stream per ms of media
+    double inputRate = 0;               // Short-term access rate, bytes/ms
+    double levelMs = 0;                 // Media buffered past the demuxer
+    int64_t backlogBytes = 0;           // Read by the access, not yet demuxed
+
+    int64_t inputSilentMs = 0;
+    int64_t pictureSilentMs = 0;
+    bool rebuffering = false;
+
+    double historyT[HISTORY] = {};
+    double historyLevel[HISTORY] = {};
+    int historyCount = 0;
+    int historyNext = 0;
+
+    int riskSamples = 0;
+    bool atRisk = false;
+    int64_t healthySinceMs = 0;
+
+    static uint32_t delta(uint32_t now, uint32_t before) {
+        return now - before;                            // libvlc counters are 32-bit and wrap
+    }
+
+    void pushHistory(int64_t nowMs, double level) {
+        historyT[historyNext] = static_cast<double>(nowMs);
+        historyLevel[historyNext] = level;
+        historyNext = (historyNext + 1) % HISTORY;
+        if (historyCount < HISTORY) historyCount++;
+    }
+
+    void evaluate(int64_t nowMs) {
+        double level = bufferedMs();
+        double trend = trendMsPerSecond();
+        double untilEmpty = underrunInMs();
+
+        bool raw = inputSilentMs >= INPUT_SILENCE_MS ||
+                   rebuffering ||
+                   (trend < -100 && untilEmpty >= 0 && untilEmpty < HORIZON_MS) ||
+                   (level < 0.3 * targetMs && trend <= 0);
+
+        if (raw) {
+            healthySinceMs = 0;
+            if (++riskSamples >= 2) {
+                atRisk = true;
+            }
+        } else {
+            riskSamples = 0;
+            if (atRisk && level >= 0.8 * targetMs) {
+                if (healthySinceMs == 0) healthySinceMs = nowMs;
+                if (nowMs - healthySinceMs >= RECOVERY_MS) {
+                    atRisk = false;
+                    healthySinceMs = 0;
+                }
+            }
+        }
+    }
+
+public:
+    // Start over once a new input shows its first frame; cachingMs is the
+    // network-caching in effect
+    void reset(double cachingMs) {
+        *this = StallPredictor();
+        targetMs = cachingMs > 0 ? cachingMs : 3000;
+    }
+
+    void sample(int64_t nowMs, uint32_t readBytes, uint32_t demuxBytes, uint32_t displayedPictures) {
+        if (!started) {
+            started = true;
+            lastMs = nowMs;
+            lastRead = readBytes;
+            lastDemux = demuxBytes;
+            lastDisplayed = displayedPictures;
+            return;
+        }
+
+        int64_t dt = nowMs - lastMs;
+        if (dt <= 0) return;
+
+        uint32_t read = delta(readBytes, lastRead);
+        uint32_t demuxed = delta(demuxBytes, lastDemux);
+        bool picturesAdvanced = delta(displayedPictures, lastDisplayed) > 0;
+        lastMs = nowMs;
+        lastRead = readBytes;
+        lastDemux = demuxBytes;
+        lastDisplayed = displayedPictures;
+
+        inputSilentMs = read == 0 ? inputSilentMs + dt : 0;
+        pictureSilentMs = picturesAdvanced ? 0 : pictureSilentMs + dt;
+        backlogBytes = std::max<int64_t>(0, backlogBytes + static_cast<int64_t>(read) - demuxed);
+        inputRate += (read / static_cast<double>(dt) - inputRate) * std::min(1.0, dt / 1000.0);
+
+        sinceStartMs += dt;
+        if (mediaRate == 0) {
+            // The stream's byte rate is unknown until a few seconds have played
+            if (sinceStartMs <= WARMUP_SKIP_MS) return;
+            warmupMs += dt;
+            warmupBytes += demuxed;
+            if (warmupMs >= WARMUP_MS && warmupBytes > 0) {
+                mediaRate = warmupBytes / static_cast<double>(warmupMs);
+                levelMs = targetMs;
+            }
+            return;
+        }
+
+        // Long-run rate tracks the stream, ignoring stretches where input starved
+        double instant = demuxed / static_cast<double>(dt);
+        if (instant >= 0.8 * mediaRate) {
+            mediaRate += (instant - mediaRate) * (dt / (dt + RATE_TAU_MS));
+        }
+
+        levelMs += demuxed / mediaRate;
+        if (picturesAdvanced) {
+            levelMs -= dt;
+            rebuffering = false;
+        }
+        levelMs = std::min(std::max(levelMs, 0.0), 2.0 * targetMs);
+
+        pushHistory(nowMs, bufferedMs());
+        evaluate(nowMs);
+    }
+
+    // libvlc_MediaPlayerBuffering: percent of the caching window filled
+    void onBuffering(float percent) {
+        if (percent >= 100.0f) {
+            levelMs = targetMs;
+            rebuffering = false;
+        } else if (mediaRate > 0) {
+            levelMs = targetMs * percent / 100.0;
+            rebuffering = true;
+        }
+    }
+
+    bool ready() const {
+        return mediaRate > 0;
+    }
+
+    double bufferedMs() const {
+        double backlogMs = mediaRate > 0 ? backlogBytes / mediaRate : 0;
+        return levelMs + backlogMs;
+    }
+
+    // Least-squares slope of the buffer level over the trend window
+    double trendMsPerSecond() const {
+        if (historyCount < 4) return 0;
+
+        double meanT = 0, meanL = 0;
+        for (int i = 0; i < historyCount; i++) {
+            meanT += historyT[i];
+            meanL += historyLevel[i];
+        }
+        meanT /= historyCount;
+        meanL /= historyCount;
+
+        double num = 0, den = 0;
+        for (int i = 0; i < historyCount; i++) {
+            num += (historyT[i] - meanT) * (historyLevel[i] - meanL);
+            den += (historyT[i] - meanT) * (historyT[i] - meanT);
+        }
+        return den > 0 ? num / den * 1000.0 : 0;
+    }
+
+    // Projected time until the buffer runs dry, -1 if it is not draining
+    double underrunInMs() const {
+        double trend = trendMsPerSecond();
+        if (trend >= 0) return -1;
+        return bufferedMs() / (-trend / 1000.0);
+    }
+
+    // Sustained risk of an underrun within the horizon (with hysteresis)
+    bool isAtRisk() const {
+        return atRisk;
+    }
+
+    // The buffer is empty and nothing new is being displayed
+    bool isUnderrun() const {
+        return ready() && pictureSilentMs >= PICTURE_SILENCE_MS && (bufferedMs() < 100 || rebuffering);
+    }
+
+    double inputKbps() const {
+        return inputRate * 8.0;
+    }
+
+    double mediaKbps() const {
+        return mediaRate * 8.0;
+    }
+
+    double targetBufferMs() const {
+        return targetMs;
+    }
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+// Reads libvlc's log as it is written and turns the messages that mean a
+// stream is dead - an HTTP error status, a refused connection, an unknown
+// host, an input nothing can open or demux - into a failure of the player
+// watching that stream. libvlc only raises its error event once every
+// access and demux module has given up, and a live stream that dies after
+// opening raises nothing at all until the freeze check notices, seconds
+// later; the log says so within milliseconds.
+//
+// The log is one per libvlc instance, and every player shares the instance,
+// so messages are attributed with care:
+//   - one naming a watched URL (or its directory, for HLS segments) belongs
+//     to that watch
+//   - while opening, one naming the watched host does too
+//   - while opening, one naming no URL belongs to the only watch opening,
+//     if there is exactly one
+// Anything else is left to the freeze check. After the first frame only
+// errors count; warnings there are often recovered from (a skipped segment).
+// Headless inputs on the instance (scheduled captures, the relay upstream)
+// are watched with a listener that does nothing, for as long as they run:
+// they show no frame, so they stay opening, and a line naming no URL is
+// never pinned on a player opening alongside them.
+
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+enum class StreamFailureReason : uint8_t {
+    HttpStatus,             // 4xx/5xx from the server
+    Refused,                // Connection refused or reset
+    HostNotFound,
+    Timeout,
+    OpenFailed,             // No access module could open the URL
+    NoDemuxer,              // Opened, but the format is not recognised
+    Decoder,                // A codec is not supported; may be a subtitle track only
+    PlayerError,            // libvlc's error event, nothing more specific logged
+};
+
+inline const char* streamFailureReasonName(StreamFailureReason reason) {
+    switch (reason) {
+        case StreamFailureReason::HttpStatus:   return "http";
+        case StreamFailureReason::Refused:      return "refused";
+        case StreamFailureReason::HostNotFound: return "dns";
+        case StreamFailureReason::Timeout:      return "timeout";
+        case StreamFailureReason::OpenFailed:   return "open";
+        case StreamFailureReason::NoDemuxer:    return "demux";
+        case StreamFailureReason::Decoder:      return "decoder";
+        case StreamFailureReason::PlayerError:  return "error";
+    }
+    return "error";
+}
+
+struct StreamFailure {
+    StreamFailureReason reason = StreamFailureReason::PlayerError;
+    std::string detail;             // The log line, "" for the error event
+    std::string url;
+    bool firstFrame = false;        // The stream had shown a picture
+};
+
+class StreamFailureMonitor {
+public:
+    // Runs on the libvlc thread that logged, under the monitor's lock: set
+    // flags and hand off, never call back into the monitor
+    using Listener = std::function<void(StreamFailureReason, const std::string& detail)>;
+
+private:
+    static constexpr size_t MESSAGE_BYTES = 512;
+
+    struct Watch {
+        std::string url;
+        std::string host;
+        std::string directory;      // host[:port]/path/ up to the last '/', "" for the root
+        bool opening = true;        // Until the first frame
+        Listener listener;
+    };
+
+    std::mutex watchMutex;
+    std::map<uint64_t, Watch> watches;
+    std::atomic<int> watchCount{0};
+    uint64_t nextId = 0;
+
+    StreamFailureMonitor() = default;
+
+    static std::string lowercase(const char* text) {
+        std::string out(text);
+        for (char& c : out) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return out;
+    }
+
+    // A 4xx/5xx shortly after "http" ("HTTP 404 error", "HTTP/1.1 403 Forbidden")
+    static bool hasHttpStatus(const std::string& message) {
+        for (size_t at = message.find("http"); at != std::string::npos; at = message.find("http", at + 4)) {
+            size_t end = std::min(message.size(), at + 24);
+            for (size_t i = at + 4; i + 3 <= end; i++) {
+                if (!isdigit(static_cast<unsigned char>(message[i])) ||
+                    (i > 0 && isdigit(static_cast<unsigned char>(message[i - 1])))) {
+                    continue;
+                }
+                if (i + 3 < message.size() && isdigit(static_cast<unsigned char>(message[i + 3]))) continue;
+                int status = atoi(message.substr(i, 3).c_str());
+                if (status >= 400 && status <= 599) return true;
+            }
+        }
+        return false;
+    }
+
+    static bool classify(const std::string& message, StreamFailureReason& reason) {
+        auto has = [&message](const char* text) { return message.find(text) != std::string::npos; };
+        if (has("cannot resolve") || has("host not found") || has("no such host") || has("service not known")) {
+            reason = StreamFailureReason::HostNotFound;
+        } else if (has("refused") || has("connection reset")) {
+            reason = StreamFailureReason::Refused;
+        } else if (has("timed out")) {
+            reason = StreamFailureReason::Timeout;
+        } else if (hasHttpStatus(message)) {
+            reason = StreamFailureReason::HttpStatus;
+        } else if (has("no suitable demux") || has("unknown stream format")) {
+            reason = StreamFailureReason::NoDemuxer;
+        } else if (has("no suitable access") || has("can't be opened") || (has("open of") && has("failed"))) {
+            reason = StreamFailureReason::OpenFailed;
+        } else if (has("no suitable decoder") || (has("codec") && has("not supported"))) {
+            reason = StreamFailureReason::Decoder;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static void onLog(void* data, int level, const libvlc_log_t* context, const char* format, va_list args) {
+        StreamFailureMonitor* self = static_cast<StreamFailureMonitor*>(data);
+        if (level < LIBVLC_WARNING || self->watchCount.load() == 0) {
+            return;                 // Debug chatter, or nobody to tell
+        }
+
+        char text[MESSAGE_BYTES];
+        va_list copy;
+        va_copy(copy, args);
+        vsnprintf(text, sizeof(text), format, copy);
+        va_end(copy);
+
+        std::string message = lowercase(text);
+        StreamFailureReason reason;
+        if (!classify(message, reason)) {
+            return;
+        }
+        const char* module = nullptr;
+        const char* file = nullptr;
+        unsigned line = 0;
+        libvlc_log_get_context(context, &module, &file, &line);
+        self->dispatch(reason, level >= LIBVLC_ERROR, message,
+                       module ? std::string(module) + ": " + text : std::string(text));
+    }
+
+    void dispatch(StreamFailureReason reason, bool error, const std::string& message, const std::string& detail) {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        Watch* only = nullptr;
+        int opening = 0;
+        bool matched = false;
+        for (auto& entry : watches) {
+            Watch& watch = entry.second;
+            bool named = message.find(watch.url) != std::string::npos ||
+                         (!watch.directory.empty() && message.find(watch.directory) != std::string::npos);
+            if (watch.opening) {
+                opening++;
+                only = &watch;
+                named = named || (!watch.host.empty() && message.find(watch.host) != std::string::npos);
+            }
+            if (named && (watch.opening || error)) {
+                watch.listener(reason, detail);
+                matched = true;
+            }
+        }
+        if (!matched && opening == 1 && message.find("://") == std::string::npos) {
+            only->listener(reason, detail);
+        }
+    }
+
+public:
+    StreamFailureMonitor(const StreamFailureMonitor&) = delete;
+    StreamFailureMonitor& operator=(const StreamFailureMonitor&) = delete;
+
+    static StreamFailureMonitor& instance() {
+        static StreamFailureMonitor monitor;
+        return monitor;
+    }
+
+    // Once per libvlc instance, before its first player. --quiet only
+    // silences the console logger; this one still sees every message.
+    void install(libvlc_instance_t* instance) {
+        libvlc_log_set(instance, &StreamFailureMonitor::onLog, this);
+    }
+
+    // Starts attributing failures of `url` to `listener`; returns the id to
+    // pass to opened()/unwatch()
+    uint64_t watch(const std::string& url, bool opening, Listener listener) {
+        Watch watch;
+        watch.url = lowercase(url.c_str());
+        size_t hostStart = watch.url.find("://");
+        hostStart = hostStart == std::string::npos ? 0 : hostStart + 3;
+        size_t hostEnd = watch.url.find_first_of("/?#", hostStart);
+        std::string authority = watch.url.substr(hostStart, hostEnd == std::string::npos ? std::string::npos
+                                                                                      : hostEnd - hostStart);
+        authority = authority.substr(authority.find('@') + 1);      // npos + 1 == 0
+        watch.host = authority.substr(0, authority[0] == '[' ? authority.find(']') + 1 : authority.find(':'));
+        size_t slash = watch.url.rfind('/', watch.url.find('?'));
+        if (hostEnd != std::string::npos && slash != std::string::npos && slash > hostEnd) {
+            watch.directory = authority + watch.url.substr(hostEnd, slash + 1 - hostEnd);
+        }
+        watch.opening = opening;
+        watch.listener = std::move(listener);
+
+        std::lock_guard<std::mutex> lock(watchMutex);
+        uint64_t id = ++nextId;
+        watches[id] = std::move(watch);
+        watchCount.store(static_cast<int>(watches.size()));
+        return id;
+    }
+
+    // The watched stream showed its first frame: from now on only errors
+    // naming it count
+    void opened(uint64_t id) {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        auto it = watches.find(id);
+        if (it != watches.end()) {
+            it->second.opening = false;
+        }
+    }
+
+    // After this returns the listener is never called again
+    void unwatch(uint64_t id) {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        watches.erase(id);
+        watchCount.store(static_cast<int>(watches.size()));
+    }
+};
@@ -0,0 +1,682 @@
+#pragma once
+
+// Re-streams one channel over HTTP to any number of clients on this machine
+// or the LAN: the channel is pulled once, however many devices watch it. A
+// client asks for GET /<token>.ts and gets the TS from wherever the channel
+// is now; switching channels switches every client.
+//
+// The upstream is a headless libvlc input writing into a named pipe, the
+// input as received where the demuxer allows it (demux dump), remuxed to TS
+// otherwise (HLS, RTP). It runs only while a client is connected, and is
+// restarted after RETRY_MS if it fails. A client gets its response once the
+// channel has data, or 502 if the upstream fails first, so a player opening
+// the relay fails like one opening the dead stream itself.
+//
+// The pipe is cut into immutable blocks of whole TS packets kept in a ring
+// of RING_BYTES. Clients share the blocks by reference and send them with
+// gathered WSASend straight from ring memory, so fan-out copies nothing. The
+// ring never waits for a client: one that falls a whole ring behind skips
+// ahead to near the live edge, and one whose socket stops taking data for
+// SEND_TIMEOUT_MS is dropped.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <vlc/vlc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "native_log.h"
+#include "shared_libvlc.h"
+#include "stream_failure.h"
+#include "win_util.h"
+
+struct RelayClientInfo {
+    std::string address;
+    uint64_t bytes = 0;
+    uint64_t skippedBytes = 0;      // Lost to falling a whole ring behind
+    int64_t connectedMs = 0;        // Unix time
+};
+
+struct StreamRelayStats {
+    bool running = false;
+    int port = 0;
+    std::string url;                // Channel being relayed
+    bool upstreamActive = false;
+    uint64_t upstreamBytes = 0;
+    uint64_t upstreamRestarts = 0;
+    std::vector<RelayClientInfo> clients;
+};
+
+class StreamRelay {
+private:
+    static constexpr size_t TS_PACKET = 188;
+    static constexpr size_t BLOCK_BYTES = TS_PACKET * 348;     // About 64 KB
+    static constexpr size_t RING_BYTES = 16 << 20;             // Several seconds of HD
+    static constexpr size_t JOIN_BYTES = 1 << 20;              // Backlog a client starts with
+    static constexpr size_t MAX_GATHER = 16;
+    static constexpr int MAX_CLIENTS = 16;
+    static constexpr DWORD SEND_TIMEOUT_MS = 10000;
+    static constexpr DWORD REQUEST_TIMEOUT_MS = 5000;
+    static constexpr int64_t FIRST_DATA_TIMEOUT_MS = 10000;    // Under the player's open timeout
+    static constexpr int SEND_BUFFER = 512 * 1024;
+    static constexpr int64_t RETRY_MS = 3000;
+    static constexpr int64_t IDLE_MS = 30000;                  // Upstream kept after the last client
+    static constexpr long POLL_US = 100000;
+    static constexpr DWORD PIPE_BUFFER = 1 << 20;
+
+    struct Block {
+        uint64_t sequence = 0;
+        uint64_t offset = 0;        // Of its first byte in everything relayed
+        std::vector<uint8_t> data;
+    };
+    using BlockRef = std::shared_ptr<const Block>;
+
+    struct Client {
+        SOCKET sock = INVALID_SOCKET;
+        std::string address;
+        int64_t connectedMs = 0;
+        std::atomic<bool> streaming{false};
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> skipped{0};
+        std::thread thread;
+    };
+
+    std::mutex relayMutex;          // Everything below up to the ring
+    bool running = false;
+    std::atomic<bool> stopping{false};
+    std::string token;
+    int boundPort = 0;
+    SOCKET listener = INVALID_SOCKET;
+    std::thread acceptor;
+    std::list<std::unique_ptr<Client>> clients;
+    int streamingClients = 0;
+    std::string channelUrl;
+
+    // Accept thread only
+    std::shared_ptr<libvlc_instance_t> vlc;
+    libvlc_media_player_t* upstream = nullptr;
+    std::string upstreamUrl;                    // Also set while a failed open waits to retry
+    uint64_t upstreamWatch = 0;                 // Claims its log lines from the main player's watch
+    int64_t retryAtMs = 0;
+    int64_t idleSinceMs = 0;
+    std::atomic<uint64_t> restarts{0};
+    std::atomic<uint64_t> upstreamFailures{0};  // Wakes clients waiting for the first data
+    std::atomic<bool> upstreamOpen{false};
+
+    std::string pipePath;
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    HANDLE stopEvent = nullptr;
+    std::thread pipeReader;
+    std::atomic<uint64_t> upstreamBytes{0};
+
+    std::mutex ringMutex;
+    std::condition_variable blockReady;
+    std::deque<BlockRef> blocks;
+    size_t ringBytes = 0;
+    uint64_t nextSequence = 0;
+    uint64_t streamOffset = 0;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t unixMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    StreamRelay() = default;
+
+    // Must hold ringMutex. Where a new (or lapped) client starts: the block
+    // JOIN_BYTES back from the live edge
+    uint64_t joinSequence() const {
+        size_t backlog = 0;
+        for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+            backlog += (*it)->data.size();
+            if (backlog >= JOIN_BYTES) return (*it)->sequence;
+        }
+        return blocks.empty() ? nextSequence : blocks.front()->sequence;
+    }
+
+    void publish(std::vector<uint8_t>& pending) {
+        size_t whole = pending.size() / TS_PACKET * TS_PACKET;
+        if (whole == 0) return;
+        std::shared_ptr<Block> block = std::make_shared<Block>();
+        block->data.assign(pending.begin(), pending.begin() + whole);
+        pending.erase(pending.begin(), pending.begin() + whole);
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            block->sequence = nextSequence++;
+            block->offset = streamOffset;
+            streamOffset += whole;
+            ringBytes += whole;
+            blocks.push_back(std::move(block));
+            while (ringBytes > RING_BYTES && blocks.size() > 1) {
+                ringBytes -= blocks.front()->data.size();
+                blocks.pop_front();
+            }
+        }
+        blockReady.notify_all();
+    }
+
+    // A new channel: clients skip whatever of the old one they have not sent
+    void clearRing() {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        blocks.clear();
+        ringBytes = 0;
+    }
+
+    bool await(OVERLAPPED& overlapped, DWORD& transferred) {
+        HANDLE handles[2] = {overlapped.hEvent, stopEvent};
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIo(pipe);
+            GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+            return false;
+        }
+        return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+    }
+
+    // Drops bytes up to the first offset where two packets in a row start
+    // with a sync byte; false until there is enough to tell
+    static bool align(std::vector<uint8_t>& pending) {
+        for (size_t i = 0; i + TS_PACKET < pending.size(); i++) {
+            if (pending[i] == 0x47 && pending[i + TS_PACKET] == 0x47) {
+                pending.erase(pending.begin(), pending.begin() + i);
+                return true;
+            }
+        }
+        if (pending.size() > TS_PACKET) pending.erase(pending.begin(), pending.end() - TS_PACKET);
+        return false;
+    }
+
+    // One writer at a time: each upstream opens the pipe, writes until it is
+    // stopped, and closes it. Reads are gathered into blocks until a block is
+    // full or the pipe has nothing more queued.
+    void readPipe() {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        std::vector<uint8_t> buffer(64 * 1024);
+        std::vector<uint8_t> pending;
+        pending.reserve(BLOCK_BYTES + buffer.size());
+        PlayerMetrics& metrics = PlayerMetrics::get();
+
+        bool reading = true;
+        while (reading) {
+            ResetEvent(overlapped.hEvent);
+            DWORD transferred = 0;
+            if (!ConnectNamedPipe(pipe, &overlapped)) {
+                DWORD error = GetLastError();
+                if (error == ERROR_IO_PENDING) {
+                    if (!await(overlapped, transferred)) break;
+                } else if (error != ERROR_PIPE_CONNECTED) {
+                    break;
+                }
+            }
+
+            pending.clear();
+            bool aligned = false;
+            while (true) {
+                ResetEvent(overlapped.hEvent);
+                if (!ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), nullptr, &overlapped) &&
+                    GetLastError() != ERROR_IO_PENDING) {
+                    break;                  // Writer closed the pipe
+                }
+                if (!await(overlapped, transferred)) {
+                    reading = WaitForSingleObject(stopEvent, 0) != WAIT_OBJECT_0;
+                    break;
+                }
+                upstreamBytes.fetch_add(transferred);
+                metrics.relayUpstreamBytes.inc(transferred);
+                pending.insert(pending.end(), buffer.data(), buffer.data() + transferred);
+                if (!aligned && !(aligned = align(pending))) continue;
+
+                DWORD queued = 0;
+                if (pending.size() >= BLOCK_BYTES ||
+                    !PeekNamedPipe(pipe, nullptr, 0, nullptr, &queued, nullptr) || queued == 0) {
+                    publish(pending);
+                }
+            }
+            publish(pending);
+            DisconnectNamedPipe(pipe);
+        }
+        CloseHandle(overlapped.hEvent);
+    }
+
+    bool openUpstream(const std::string& url) {
+        if (!vlc) vlc = SharedLibvlc::instance().acquire();
+        if (!vlc) return false;
+
+        libvlc_media_t* media = libvlc_media_new_location(vlc.get(), url.c_str());
+        if (!media) return false;
+        if (rawTsInput(url)) {       // Passed through untouched
+            std::string dump = ":demuxdump-file=" + pipePath;
+            libvlc_media_add_option(media, ":demux=dump");
+            libvlc_media_add_option(media, dump.c_str());
+        } else {
+            std::string sout = ":sout=#std{access=file,mux=ts,dst=" + soutString(pipePath) + "}";
+            libvlc_media_add_option(media, sout.c_str());
+            libvlc_media_add_option(media, ":sout-all");
+            libvlc_media_add_option(media, ":no-sout-keep");
+        }
+        upstream = libvlc_media_player_new_from_media(media);
+        libvlc_media_release(media);
+        if (!upstream) return false;
+        PlayerMetrics::get().libvlcMediaPlayers.add(1);
+        upstreamUrl = url;
+        upstreamOpen.store(true);
+        upstreamWatch = StreamFailureMonitor::instance().watch(
+            url, true, [](StreamFailureReason, const std::string&) {});
+        return libvlc_media_player_play(upstream) == 0;
+    }
+
+    void closeUpstream() {
+        if (upstream) {
+            libvlc_media_player_stop(upstream);
+            libvlc_media_player_release(upstream);
+            upstream = nullptr;
+            StreamFailureMonitor::instance().unwatch(upstreamWatch);
+            upstreamWatch = 0;
+            PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+        }
+        upstreamUrl.clear();
+        upstreamOpen.store(false);
+    }
+
+    void upstreamFailed() {
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            upstreamFailures.fetch_add(1);
+        }
+        blockReady.notify_all();
+    }
+
+    // Pulls the channel while anyone watches it, restarts it when it fails
+    // and lets go of libvlc once nobody has for IDLE_MS
+    void superviseUpstream() {
+        std::string wanted;
+        bool watched = false;
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            wanted = channelUrl;
+            watched = streamingClients > 0;
+        }
+        int64_t now = nowMs();
+        if (watched) idleSinceMs = now;
+
+        if (wanted.empty() || (!watched && now - idleSinceMs >= IDLE_MS)) {
+            closeUpstream();
+            vlc.reset();
+            return;
+        }
+        if (!watched) return;
+
+        if (upstreamUrl == wanted) {
+            libvlc_state_t state = upstream ? libvlc_media_player_get_state(upstream) : libvlc_Error;
+            if (state != libvlc_Error && state != libvlc_Ended) return;
+            if (retryAtMs == 0) {
+                retryAtMs = now + RETRY_MS;
+                upstreamFailed();
+                NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_RELAY_UPSTREAM_FAILED, {},
+                                            NativeLog::jsonField("url", wanted));
+            }
+            if (now < retryAtMs) return;
+            restarts.fetch_add(1);
+        }
+
+        bool switching = upstreamUrl != wanted;
+        closeUpstream();
+        if (switching) clearRing();
+        retryAtMs = 0;
+        if (!openUpstream(wanted)) {
+            upstreamUrl = wanted;           // Waits RETRY_MS like a failed input
+            retryAtMs = now + RETRY_MS;
+            upstreamFailed();
+            NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_RELAY_UPSTREAM_FAILED, {},
+                                        NativeLog::jsonField("url", wanted));
+        }
+    }
+
+    // GET /<token>.ts; anything else is answered 404
+    bool readRequest(SOCKET sock) {
+        char request[4096];
+        size_t length = 0;
+        while (length < sizeof(request) - 1) {
+            int received = recv(sock, request + length, static_cast<int>(sizeof(request) - 1 - length), 0);
+            if (received <= 0) return false;
+            length += received;
+            request[length] = '\0';
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+        if (strncmp(request, "GET /", 5) != 0) return false;
+        const char* path = request + 5;
+        size_t end = strcspn(path, " ?\r\n");
+        return std::string(path, end) == token + ".ts";
+    }
+
+    void sendText(SOCKET sock, const char* response) {
+        send(sock, response, static_cast<int>(strlen(response)), 0);
+    }
+
+    // Until the channel has data, a failure of its upstream or the timeout.
+    // A player takes the response headers as the stream opening, so they
+    // wait for this. Returns the error status to answer with, 0 for none.
+    int awaitFirstData() {
+        std::unique_lock<std::mutex> lock(ringMutex);
+        uint64_t failures = upstreamFailures.load();
+        blockReady.wait_for(lock, std::chrono::milliseconds(FIRST_DATA_TIMEOUT_MS), [&] {
+            return stopping.load() || !blocks.empty() || upstreamFailures.load() != failures;
+        });
+        if (!blocks.empty()) return 0;
+        return upstreamFailures.load() != failures ? 502 : 504;
+    }
+
+    void serveClient(Client* client) {
+        SOCKET sock = client->sock;
+        DWORD timeout = REQUEST_TIMEOUT_MS;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+        if (!readRequest(sock)) {
+            sendText(sock, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            client->done.store(true);
+            return;
+        }
+        bool admitted = false;
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            admitted = streamingClients < MAX_CLIENTS;
+            if (admitted) {
+                streamingClients++;
+                PlayerMetrics::get().relayClients.set(streamingClients);
+            }
+        }
+        if (!admitted) {
+            sendText(sock, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            client->done.store(true);
+            return;
+        }
+
+        timeout = SEND_TIMEOUT_MS;
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        int bufferSize = SEND_BUFFER;
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+        int status = awaitFirstData();
+        if (status == 0) {
+            sendText(sock, "HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nCache-Control: no-cache\r\n"
+                           "Connection: close\r\n\r\n");
+            client->streaming.store(true);
+        } else if (!stopping.load()) {
+            sendText(sock, status == 502
+                ? "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+                : "HTTP/1.1 504 Gateway Timeout\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        }
+
+        uint64_t next = 0;
+        uint64_t offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            next = joinSequence();
+            offset = blocks.empty() || next >= nextSequence ? streamOffset
+                                                            : blocks[next - blocks.front()->sequence]->offset;
+        }
+
+        PlayerMetrics& metrics = PlayerMetrics::get();
+        std::vector<BlockRef> batch;
+        WSABUF buffers[MAX_GATHER];
+        while (status == 0 && !stopping.load()) {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock(ringMutex);
+                blockReady.wait_for(lock, std::chrono::microseconds(POLL_US),
+                                    [&] { return stopping.load() || nextSequence > next; });
+                if (stopping.load() || nextSequence <= next) continue;
+
+                uint64_t skippedFrom = offset;
+                if (blocks.empty()) {
+                    next = nextSequence;
+                    offset = streamOffset;
+                } else if (next < blocks.front()->sequence) {
+                    next = joinSequence();
+                    offset = blocks[next - blocks.front()->sequence]->offset;
+                }
+                if (offset > skippedFrom) {
+                    client->skipped.fetch_add(offset - skippedFrom);
+                    metrics.relaySkippedBytes.inc(static_cast<double>(offset - skippedFrom));
+                }
+                for (size_t i = next - (blocks.empty() ? next : blocks.front()->sequence);
+                     i < blocks.size() && batch.size() < MAX_GATHER; i++) {
+                    batch.push_back(blocks[i]);
+                }
+            }
+            if (batch.empty()) continue;
+
+            // The batch holds its blocks, so the ring may move on meanwhile
+            uint64_t total = 0;
+            for (size_t i = 0; i < batch.size(); i++) {
+                buffers[i].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(batch[i]->data.data()));
+                buffers[i].len = static_cast<ULONG>(batch[i]->data.size());
+                total += batch[i]->data.size();
+            }
+            DWORD sent = 0;
+            if (WSASend(sock, buffers, static_cast<DWORD>(batch.size()), &sent, 0, nullptr, nullptr) != 0) {
+                break;                      // Gone, or stalled past SEND_TIMEOUT_MS
+            }
+            next = batch.back()->sequence + 1;
+            offset += total;
+            client->bytes.fetch_add(total);
+            metrics.relaySentBytes.inc(static_cast<double>(total));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            streamingClients--;
+            PlayerMetrics::get().relayClients.set(streamingClients);
+        }
+        client->streaming.store(false);
+        client->done.store(true);
+        NativeLog::instance().write(LogLevel::Info, LOG_EVENT_RELAY_CLIENT_CLOSED,
+                                    {static_cast<double>(client->bytes.load()),
+                                     static_cast<double>(client->skipped.load()),
+                                     (unixMs() - client->connectedMs) / 1000.0},
+                                    NativeLog::jsonField("address", client->address));
+    }
+
+    // Joins finished clients; all of them when stopping
+    void reapClients(bool all) {
+        std::list<std::unique_ptr<Client>> finished;
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            for (auto it = clients.begin(); it != clients.end();) {
+                if (all || (*it)->done.load()) {
+                    finished.push_back(std::move(*it));
+                    it = clients.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& client : finished) {
+            shutdown(client->sock, SD_BOTH);        // Ends a blocked send
+            if (client->thread.joinable()) client->thread.join();
+            closesocket(client->sock);
+        }
+    }
+
+    void acceptLoop() {
+        while (!stopping.load()) {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(listener, &readSet);
+            timeval timeout = {0, POLL_US};
+            if (select(0, &readSet, nullptr, nullptr, &timeout) > 0) {
+                sockaddr_in peer = {};
+                int peerLength = sizeof(peer);
+                SOCKET sock = accept(listener, reinterpret_cast<sockaddr*>(&peer), &peerLength);
+                if (sock != INVALID_SOCKET) {
+                    std::unique_ptr<Client> client(new Client());
+                    char address[INET_ADDRSTRLEN] = {};
+                    inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address));
+                    client->sock = sock;
+                    client->address = address;
+                    client->connectedMs = unixMs();
+                    client->thread = std::thread(&StreamRelay::serveClient, this, client.get());
+                    std::lock_guard<std::mutex> lock(relayMutex);
+                    clients.push_back(std::move(client));
+                }
+            }
+            reapClients(false);
+            superviseUpstream();
+        }
+        reapClients(true);
+        closeUpstream();
+        vlc.reset();
+    }
+
+public:
+    StreamRelay(const StreamRelay&) = delete;
+    StreamRelay& operator=(const StreamRelay&) = delete;
+
+    static StreamRelay& instance() {
+        static StreamRelay relay;
+        return relay;
+    }
+
+    // Listens on `port` (0 picks one), on every interface when `lan` is set
+    // and on loopback only otherwise. Returns the port, 0 on failure.
+    int start(int port, bool lan, const std::string& accessToken, std::string& error) {
+        std::lock_guard<std::mutex> lock(relayMutex);
+        if (running) return boundPort;
+        if (accessToken.empty()) {
+            error = "Access token required";
+            return 0;
+        }
+
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            error = "Winsock unavailable";
+            return 0;
+        }
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(lan ? INADDR_ANY : INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<u_short>(port));
+        int addressLength = sizeof(address);
+        if (listener == INVALID_SOCKET ||
+            bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0 ||
+            getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+            error = "Cannot listen on port " + std::to_string(port);
+            if (listener != INVALID_SOCKET) closesocket(listener);
+            listener = INVALID_SOCKET;
+            WSACleanup();
+            return 0;
+        }
+
+        static std::atomic<uint32_t> counter{0};
+        pipePath = "\\\\.\\pipe\\jptv-relay-" + std::to_string(GetCurrentProcessId()) + "-" +
+                   std::to_string(counter.fetch_add(1));
+        // Duplex: libvlc's file output opens for read and write
+        pipe = CreateNamedPipeW(utf8ToWide(pipePath).c_str(),
+                                PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                1, 0, PIPE_BUFFER, 0, nullptr);
+        stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE || !stopEvent) {
+            error = "Cannot create relay pipe";
+            if (pipe != INVALID_HANDLE_VALUE) CloseHandle(pipe);
+            if (stopEvent) CloseHandle(stopEvent);
+            pipe = INVALID_HANDLE_VALUE;
+            stopEvent = nullptr;
+            closesocket(listener);
+            listener = INVALID_SOCKET;
+            WSACleanup();
+            return 0;
+        }
+
+        token = accessToken;
+        boundPort = ntohs(address.sin_port);
+        running = true;
+        stopping.store(false);
+        pipeReader = std::thread(&StreamRelay::readPipe, this);
+        acceptor = std::thread(&StreamRelay::acceptLoop, this);
+        return boundPort;
+    }
+
+    // Disconnects every client and stops the upstream
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            if (!running) return;
+            running = false;
+            channelUrl.clear();
+        }
+        stopping.store(true);
+        blockReady.notify_all();
+        if (acceptor.joinable()) acceptor.join();
+        SetEvent(stopEvent);
+        if (pipeReader.joinable()) pipeReader.join();
+
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+        CloseHandle(pipe);
+        CloseHandle(stopEvent);
+        pipe = INVALID_HANDLE_VALUE;
+        stopEvent = nullptr;
+        clearRing();
+        WSACleanup();
+        std::lock_guard<std::mutex> lock(relayMutex);
+        boundPort = 0;
+    }
+
+    // The channel clients get; empty ends the upstream (clients stay
+    // connected and receive the next channel set)
+    void setChannel(const std::string& url) {
+        bool switching = false;
+        {
+            std::lock_guard<std::mutex> lock(relayMutex);
+            switching = channelUrl != url;
+            channelUrl = url;
+        }
+        // A client connecting right after must not take the old channel's
+        // backlog as the new one opening
+        if (switching) clearRing();
+    }
+
+    StreamRelayStats stats() {
+        StreamRelayStats result;
+        std::lock_guard<std::mutex> lock(relayMutex);
+        result.running = running;
+        result.port = boundPort;
+        result.url = channelUrl;
+        result.upstreamActive = upstreamOpen.load();
+        result.upstreamBytes = upstreamBytes.load();
+        result.upstreamRestarts = restarts.load();
+        for (const auto& client : clients) {
+            if (!client->streaming.load()) continue;
+            RelayClientInfo info;
+            info.address = client->address;
+            info.bytes = client->bytes.load();
+            info.skippedBytes = client->skipped.load();
+            info.connectedMs = client->connectedMs;
+            result.clients.push_back(info);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+// Hierarchical timer wheel: LEVELS wheels of SLOTS buckets, each level's
+// bucket spanning a whole turn of the level below. With 1 s ticks that is
+// 64 s, ~68 min, ~3 days and ~194 days; anything further out parks in the
+// top level and is re-placed as that bucket comes round. Scheduling and
+// cancelling are O(1); advancing costs one bucket per tick plus the
+// occasional cascade, whatever the number of timers armed.
+//
+// Not thread-safe; the owner serialises access.
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class TimerWheel {
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+
+    struct Entry {
+        int64_t dueTick;
+        int level;
+        int slot;
+        std::list<uint64_t>::iterator position;
+    };
+
+    int64_t tickMs;
+    int64_t currentTick;
+    std::list<uint64_t> buckets[LEVELS][SLOTS];
+    std::unordered_map<uint64_t, Entry> entries;
+
+    int64_t tickOf(int64_t ms) const {
+        return ms / tickMs;
+    }
+
+    // A level-L bucket is emptied (cascaded) when time enters its block, so a
+    // timer goes to the lowest level whose block it is fewer than SLOTS blocks
+    // ahead in; a full turn ahead would alias the block already passed.
+    // A cascade runs before the current tick's level-0 bucket is emptied, so
+    // a timer it re-places due this very tick still fires on time.
+    void place(uint64_t id, Entry& entry, bool cascading = false) {
+        // Overdue timers fire on the next tick
+        int64_t earliest = cascading ? currentTick : currentTick + 1;
+        int64_t at = entry.dueTick >= earliest ? entry.dueTick : earliest;
+
+        int level = 0;
+        if (at - currentTick >= SLOTS) {
+            level = 1;
+            while (level < LEVELS - 1 &&
+                   (at >> (SLOT_BITS * level)) - (currentTick >> (SLOT_BITS * level)) >= SLOTS) {
+                level++;
+            }
+            // Beyond the top level: park in its last block, re-placed from there
+            int shift = SLOT_BITS * level;
+            if ((at >> shift) - (currentTick >> shift) >= SLOTS) {
+                at = ((currentTick >> shift) + SLOTS - 1) << shift;
+            }
+        }
+
+        entry.level = level;
+        entry.slot = static_cast<int>((at >> (SLOT_BITS * level)) & (SLOTS - 1));
+        std::list<uint64_t>& bucket = buckets[level][entry.slot];
+        entry.position = bucket.insert(bucket.end(), id);
+    }
+
+    void cascade(int level) {
+        int slot = static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        std::list<uint64_t> moving;
+        moving.swap(buckets[level][slot]);
+        for (uint64_t id : moving) {
+            place(id, entries[id], true);
+        }
+    }
+
+public:
+    explicit TimerWheel(int64_t tickMillis, int64_t nowMs)
+        : tickMs(tickMillis > 0 ? tickMillis : 1000), currentTick(nowMs / (tickMillis > 0 ? tickMillis : 1000)) {}
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Arms (or re-arms) timer `id` to fire at the first tick at or after dueMs
+    void schedule(uint64_t id, int64_t dueMs) {
+        cancel(id);
+        Entry& entry = entries[id];
+        entry.dueTick = (dueMs + tickMs - 1) / tickMs;
+        place(id, entry);
+    }
+
+    bool cancel(uint64_t id) {
+        auto it = entries.find(id);
+        if (it == entries.end()) return false;
+        buckets[it->second.level][it->second.slot].erase(it->second.position);
+        entries.erase(it);
+        return true;
+    }
+
+    bool contains(uint64_t id) const {
+        return entries.count(id) != 0;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    // Moves time forward to nowMs and appends the timers that came due, in
+    // due order. A clock that went backwards fires nothing until it catches up.
+    void advance(int64_t nowMs, std::vector<uint64_t>& fired) {
+        int64_t target = tickOf(nowMs);
+        while (currentTick < target) {
+            // Nothing armed: jump instead of walking the empty buckets
+            if (entries.empty()) {
+                currentTick = target;
+                break;
+            }
+
+            currentTick++;
+            for (int level = LEVELS - 1; level > 0; level--) {
+                if ((currentTick & ((int64_t(1) << (SLOT_BITS * level)) - 1)) == 0) {
+                    cascade(level);
+                }
+            }
+
+            std::list<uint64_t>& bucket = buckets[0][currentTick & (SLOTS - 1)];
+            while (!bucket.empty()) {
+                uint64_t id = bucket.front();
+                bucket.pop_front();
+                entries.erase(id);
+                fired.push_back(id);
+            }
+        }
+    }
+};
@@ -0,0 +1,412 @@
+#pragma once
+
+// MPEG-TS programme filter for recordings. Multiplexes (ISDB in particular)
+// carry extra audio, data carousels, EIT and other programmes that a
+// recording does not need. The filter follows the PAT and the selected
+// programme's PMT and passes through only that programme's video, chosen
+// audio, captions and PCR, with a PAT and PMT rewritten to list just those.
+// Packets are copied as they are: no re-encoding, no re-timing.
+//
+// Output starts at the first PMT, so a recording always opens with its
+// tables. Not thread-safe; one filter per output file.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct TsPidSelection {
+    bool enabled = false;           // false: keep the whole multiplex
+    uint16_t programNumber = 0;     // 0: first programme in the PAT
+    int audioTrack = 0;             // Index among the audio streams; -1 keeps all
+    bool captions = true;           // ARIB captions/superimpose, DVB subtitles, teletext
+};
+
+class TsPidFilter {
+private:
+    static constexpr size_t PACKET = 188;
+    static constexpr uint16_t PAT_PID = 0x0000;
+    static constexpr uint16_t NO_PID = 0xFFFF;
+
+    // Reassembles one PSI section from the packets of a PID
+    struct SectionBuffer {
+        std::vector<uint8_t> data;
+        bool active = false;
+
+        // Returns true once a whole section is in data
+        bool push(const uint8_t* payload, size_t length, bool unitStart) {
+            if (unitStart) {
+                if (length == 0 || payload[0] >= length) return false;
+                size_t pointer = payload[0];
+                data.assign(payload + 1 + pointer, payload + length);
+                active = true;
+            } else if (active) {
+                data.insert(data.end(), payload, payload + length);
+            } else {
+                return false;
+            }
+
+            if (data.size() < 3) return false;
+            size_t total = 3 + (((data[1] & 0x0F) << 8) | data[2]);
+            if (total > 1024) {
+                active = false;
+                return false;
+            }
+            if (data.size() < total) return false;
+            data.resize(total);
+            active = false;
+            return true;
+        }
+    };
+
+    TsPidSelection selection;
+    std::vector<uint8_t> partial;           // Bytes of a packet split across feeds
+    SectionBuffer patSection;
+    SectionBuffer pmtSection;
+    uint16_t pmtPid = NO_PID;
+    uint16_t programNumber = 0;
+    uint16_t transportStreamId = 0;
+    int patVersion = -1;
+    int pmtVersion = -1;
+    bool keep[8192] = {};
+    bool ready = false;                     // A PMT has been seen
+    std::vector<uint8_t> patOut;            // Regenerated sections
+    std::vector<uint8_t> pmtOut;
+    std::vector<uint8_t> packets;           // Scratch for packetize()
+    uint8_t patContinuity = 0;
+    uint8_t pmtContinuity = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+
+    static uint32_t crc32(const uint8_t* data, size_t length) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < length; i++) {
+            crc ^= static_cast<uint32_t>(data[i]) << 24;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+            }
+        }
+        return crc;
+    }
+
+    static bool sectionValid(const std::vector<uint8_t>& section) {
+        return section.size() >= 12 && (section[1] & 0x80) && crc32(section.data(), section.size()) == 0;
+    }
+
+    static bool isVideo(uint8_t streamType) {
+        switch (streamType) {
+            case 0x01: case 0x02: case 0x10: case 0x1B: case 0x24: case 0x42: case 0xEA:
+                return true;
+        }
+        return false;
+    }
+
+    static bool hasDescriptor(const uint8_t* descriptors, size_t length, uint8_t tag) {
+        for (size_t i = 0; i + 2 <= length; i += 2 + descriptors[i + 1]) {
+            if (descriptors[i] == tag) return true;
+        }
+        return false;
+    }
+
+    // ECM PIDs from CA descriptors, so scrambled recordings stay decryptable
+    void keepCaPids(const uint8_t* descriptors, size_t length) {
+        for (size_t i = 0; i + 2 <= length && i + 2 + descriptors[i + 1] <= length; i += 2 + descriptors[i + 1]) {
+            if (descriptors[i] == 0x09 && descriptors[i + 1] >= 4) {
+                keep[((descriptors[i + 4] & 0x1F) << 8) | descriptors[i + 5]] = true;
+            }
+        }
+    }
+
+    static bool isAudio(uint8_t streamType, const uint8_t* descriptors, size_t length) {
+        switch (streamType) {
+            case 0x03: case 0x04: case 0x0F: case 0x11: case 0x81: case 0x87:
+                return true;
+            case 0x06:
+                // AC-3 / E-AC-3 in private PES (DVB)
+                return hasDescriptor(descriptors, length, 0x6A) || hasDescriptor(descriptors, length, 0x7A);
+        }
+        return false;
+    }
+
+    static bool isCaption(uint8_t streamType, const uint8_t* descriptors, size_t length) {
+        if (streamType != 0x06) return false;
+        // DVB subtitling, teletext
+        if (hasDescriptor(descriptors, length, 0x59) || hasDescriptor(descriptors, length, 0x56)) {
+            return true;
+        }
+        // ARIB: stream identifier component tags 0x30-0x37 captions, 0x38-0x3F superimpose
+        for (size_t i = 0; i + 2 < length; i += 2 + descriptors[i + 1]) {
+            if (descriptors[i] == 0x52 && descriptors[i + 1] >= 1 && descriptors[i + 2] >= 0x30 && descriptors[i + 2] <= 0x3F) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Splits a section into packets on `pid`, pointer field first, 0xFF stuffing
+    static void packetize(const std::vector<uint8_t>& section, uint16_t pid, uint8_t& continuity,
+                          std::vector<uint8_t>& out) {
+        size_t offset = 0;
+        bool first = true;
+        while (offset < section.size()) {
+            uint8_t packet[PACKET];
+            memset(packet, 0xFF, sizeof(packet));
+            packet[0] = 0x47;
+            packet[1] = static_cast<uint8_t>((first ? 0x40 : 0x00) | ((pid >> 8) & 0x1F));
+            packet[2] = static_cast<uint8_t>(pid & 0xFF);
+            packet[3] = static_cast<uint8_t>(0x10 | (continuity & 0x0F));
+            continuity = (continuity + 1) & 0x0F;
+
+            size_t pos = 4;
+            if (first) packet[pos++] = 0;       // pointer_field
+            size_t chunk = std::min(section.size() - offset, PACKET - pos);
+            memcpy(packet + pos, section.data() + offset, chunk);
+            offset += chunk;
+            first = false;
+            out.insert(out.end(), packet, packet + PACKET);
+        }
+    }
+
+    static void finishSection(std::vector<uint8_t>& section) {
+        size_t sectionLength = section.size() + 4 - 3;
+        section[1] = static_cast<uint8_t>(0xB0 | ((sectionLength >> 8) & 0x0F));
+        section[2] = static_cast<uint8_t>(sectionLength & 0xFF);
+        uint32_t crc = crc32(section.data(), section.size());
+        section.push_back(static_cast<uint8_t>(crc >> 24));
+        section.push_back(static_cast<uint8_t>(crc >> 16));
+        section.push_back(static_cast<uint8_t>(crc >> 8));
+        section.push_back(static_cast<uint8_t>(crc));
+    }
+
+    void buildPat() {
+        std::vector<uint8_t> section = {
+            0x00, 0, 0,
+            static_cast<uint8_t>(transportStreamId >> 8), static_cast<uint8_t>(transportStreamId),
+            static_cast<uint8_t>(0xC1 | ((patVersion & 0x1F) << 1)), 0x00, 0x00,
+            static_cast<uint8_t>(programNumber >> 8), static_cast<uint8_t>(programNumber),
+            static_cast<uint8_t>(0xE0 | (pmtPid >> 8)), static_cast<uint8_t>(pmtPid)
+        };
+        finishSection(section);
+        patOut.swap(section);
+    }
+
+    void handlePat(const std::vector<uint8_t>& section) {
+        if (section[0] != 0x00 || !sectionValid(section) || !(section[5] & 0x01)) return;
+        int version = (section[5] >> 1) & 0x1F;
+        if (version == patVersion) return;
+
+        uint16_t chosen = 0;
+        uint16_t chosenPid = NO_PID;
+        for (size_t i = 8; i + 4 <= section.size() - 4; i += 4) {
+            uint16_t number = static_cast<uint16_t>((section[i] << 8) | section[i + 1]);
+            uint16_t pid = static_cast<uint16_t>(((section[i + 2] & 0x1F) << 8) | section[i + 3]);
+            if (number == 0) continue;          // NIT
+            if (selection.programNumber == 0 ? chosenPid == NO_PID : number == selection.programNumber) {
+                chosen = number;
+                chosenPid = pid;
+            }
+        }
+        if (chosenPid == NO_PID) return;
+
+        patVersion = version;
+        transportStreamId = static_cast<uint16_t>((section[3] << 8) | section[4]);
+        if (chosenPid != pmtPid || chosen != programNumber) {
+            pmtPid = chosenPid;
+            programNumber = chosen;
+            pmtVersion = -1;
+            pmtSection = SectionBuffer();
+        }
+        buildPat();
+    }
+
+    void handlePmt(const std::vector<uint8_t>& section) {
+        if (section[0] != 0x02 || !sectionValid(section) || !(section[5] & 0x01)) return;
+        if (static_cast<uint16_t>((section[3] << 8) | section[4]) != programNumber) return;
+        int version = (section[5] >> 1) & 0x1F;
+        if (version == pmtVersion) return;
+
+        size_t end = section.size() - 4;
+        uint16_t pcrPid = static_cast<uint16_t>(((section[8] & 0x1F) << 8) | section[9]);
+        size_t programInfoLength = ((section[10] & 0x0F) << 8) | section[11];
+        size_t first = 12 + programInfoLength;
+        if (first > end) return;
+
+        // A track index past the last audio stream falls back to the first
+        int audioCount = 0;
+        for (size_t i = first; i + 5 <= end; i += 5 + (((section[i + 3] & 0x0F) << 8) | section[i + 4])) {
+            size_t infoLength = ((section[i + 3] & 0x0F) << 8) | section[i + 4];
+            if (i + 5 + infoLength > end) return;
+            if (isAudio(section[i], section.data() + i + 5, infoLength)) audioCount++;
+        }
+        int audioTrack = selection.audioTrack < audioCount ? selection.audioTrack : 0;
+
+        // Header and programme descriptors as they are, then the kept streams
+        std::vector<uint8_t> rebuilt(section.begin(), section.begin() + first);
+        memset(keep, 0, sizeof(keep));
+        keep[pmtPid] = true;
+        keep[pcrPid] = true;
+        keepCaPids(section.data() + 12, programInfoLength);
+
+        bool haveVideo = false;
+        int audioIndex = 0;
+        for (size_t i = first; i + 5 <= end;) {
+            uint8_t streamType = section[i];
+            uint16_t pid = static_cast<uint16_t>(((section[i + 1] & 0x1F) << 8) | section[i + 2]);
+            size_t infoLength = ((section[i + 3] & 0x0F) << 8) | section[i + 4];
+            const uint8_t* descriptors = section.data() + i + 5;
+
+            bool wanted = false;
+            if (isVideo(streamType)) {
+                wanted = !haveVideo;
+                haveVideo = true;
+            } else if (isAudio(streamType, descriptors, infoLength)) {
+                wanted = audioTrack < 0 || audioIndex == audioTrack;
+                audioIndex++;
+            } else if (isCaption(streamType, descriptors, infoLength)) {
+                wanted = selection.captions;
+            }
+            if (wanted) {
+                keep[pid] = true;
+                keepCaPids(descriptors, infoLength);
+                rebuilt.insert(rebuilt.end(), section.begin() + i, section.begin() + i + 5 + infoLength);
+            }
+            i += 5 + infoLength;
+        }
+        keep[PAT_PID] = false;                  // Regenerated, never copied
+
+        pmtVersion = version;
+        finishSection(rebuilt);
+        pmtOut.swap(rebuilt);
+        ready = true;
+    }
+
+    // Tables are packetized per emission so the continuity counters run on
+    void emitTable(const std::vector<uint8_t>& section, uint16_t pid, uint8_t& continuity, std::vector<uint8_t>& out) {
+        packets.clear();
+        packetize(section, pid, continuity, packets);
+        emit(packets.data(), packets.size(), out);
+    }
+
+    void emit(const uint8_t* data, size_t length, std::vector<uint8_t>& out) {
+        out.insert(out.end(), data, data + length);
+        bytesOut += length;
+    }
+
+    // Processes the packets starting before `stop`; returns where it stopped,
+    // which is before `stop` only if no more than a packet is left from
+    // there. A sync byte only counts when the next packet's follows it, so
+    // the last packet waits for more data (or flush()).
+    size_t scan(const uint8_t* buf, size_t length, size_t pos, size_t stop, std::vector<uint8_t>& out) {
+        while (pos < stop) {
+            if (buf[pos] != 0x47) {
+                pos++;
+                continue;
+            }
+            if (length - pos <= PACKET) {
+                break;
+            }
+            if (buf[pos + PACKET] != 0x47) {
+                pos++;
+                continue;
+            }
+            processPacket(buf + pos, out);
+            pos += PACKET;
+        }
+        return pos;
+    }
+
+    void processPacket(const uint8_t* packet, std::vector<uint8_t>& out) {
+        uint16_t pid = static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+        bool unitStart = (packet[1] & 0x40) != 0;
+        uint8_t adaptation = (packet[3] >> 4) & 0x03;
+
+        if (pid == PAT_PID || (pid == pmtPid && pmtPid != NO_PID)) {
+            size_t offset = 4;
+            if (adaptation & 0x02) offset += 1 + packet[4];
+            if (!(adaptation & 0x01) || offset >= PACKET || (packet[1] & 0x80)) return;
+
+            SectionBuffer& buffer = pid == PAT_PID ? patSection : pmtSection;
+            if (buffer.push(packet + offset, PACKET - offset, unitStart)) {
+                // The tables go out where the source carried them, so the
+                // repetition rate is the source's
+                if (pid == PAT_PID) {
+                    handlePat(buffer.data);
+                    if (ready) emitTable(patOut, PAT_PID, patContinuity, out);
+                } else {
+                    bool wasReady = ready;
+                    handlePmt(buffer.data);
+                    if (ready && !wasReady) emitTable(patOut, PAT_PID, patContinuity, out);
+                    if (ready) emitTable(pmtOut, pmtPid, pmtContinuity, out);
+                }
+            }
+            return;
+        }
+
+        if (ready && keep[pid]) {
+            emit(packet, PACKET, out);
+        }
+    }
+
+public:
+    explicit TsPidFilter(const TsPidSelection& pids = TsPidSelection()) : selection(pids) {}
+
+    // Appends the kept packets of `data` to `out`. Input may be split
+    // anywhere; after garbage the filter resynchronises on two sync bytes a
+    // packet apart.
+    void feed(const uint8_t* data, size_t length, std::vector<uint8_t>& out) {
+        bytesIn += length;
+        if (!selection.enabled) {
+            emit(data, length, out);
+            return;
+        }
+
+        size_t pos = 0;
+        if (!partial.empty()) {
+            // Scan the carried bytes joined with the start of this buffer
+            // until the packet grid runs into the new data
+            size_t carried = partial.size();
+            size_t take = std::min(length, 2 * PACKET);
+            partial.insert(partial.end(), data, data + take);
+            size_t done = scan(partial.data(), partial.size(), 0, carried, out);
+            if (done < carried) {
+                // Too little data to tell yet; all of it is in partial
+                partial.erase(partial.begin(), partial.begin() + done);
+                return;
+            }
+            pos = done - carried;
+            partial.clear();
+        }
+
+        pos = scan(data, length, pos, length, out);
+        if (pos < length) {
+            partial.assign(data + pos, data + length);
+        }
+    }
+
+    // Writes out the packet held back for its look-ahead, at end of stream
+    void flush(std::vector<uint8_t>& out) {
+        if (selection.enabled && partial.size() == PACKET && partial[0] == 0x47) {
+            processPacket(partial.data(), out);
+        }
+        partial.clear();
+    }
+
+    // Forget the stream (the writer reconnected); the selection stays
+    void reset() {
+        TsPidSelection pids = selection;
+        uint64_t in = bytesIn;
+        uint64_t kept = bytesOut;
+        uint8_t patCc = patContinuity;
+        uint8_t pmtCc = pmtContinuity;
+        *this = TsPidFilter(pids);
+        bytesIn = in;
+        bytesOut = kept;
+        patContinuity = patCc;
+        pmtContinuity = pmtCc;
+    }
+
+    bool hasProgramme() const { return ready; }
+    uint64_t inputBytes() const { return bytesIn; }
+    uint64_t outputBytes() const { return bytesOut; }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// Recording writer behind a TsPidFilter. libvlc writes the stream into a
+// named pipe (its file access output opens \\.\pipe\ paths like any file),
+// a thread here filters it and writes what is kept to the recording file.
+// The pipe takes new writers after the old one closes - playback restarted
+// or a capture reopened - and each connection starts the filter afresh,
+// appending to the same file.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "ts_pid_filter.h"
+#include "win_util.h"
+
+class TsPipeRecorder {
+private:
+    static constexpr DWORD PIPE_BUFFER = 1 << 20;
+    static constexpr size_t WRITE_CHUNK = 256 * 1024;
+
+    TsPidSelection selection;
+    std::string outputPath;
+    std::string pipePath;
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE stopEvent = nullptr;
+    std::thread worker;
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+
+    // Waits for an overlapped pipe operation; false if stopped or failed
+    bool await(OVERLAPPED& overlapped, DWORD& transferred) {
+        HANDLE handles[2] = {overlapped.hEvent, stopEvent};
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIo(pipe);
+            GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+            return false;
+        }
+        return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+    }
+
+    bool writeOut(std::vector<uint8_t>& pending, bool force) {
+        if (pending.empty() || (!force && pending.size() < WRITE_CHUNK)) {
+            return true;
+        }
+        DWORD written = 0;
+        bool ok = WriteFile(file, pending.data(), static_cast<DWORD>(pending.size()), &written, nullptr) &&
+                  written == pending.size();
+        bytesOut.fetch_add(pending.size());
+        pending.clear();
+        return ok;
+    }
+
+    void run() {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        std::vector<uint8_t> buffer(64 * 1024);
+        std::vector<uint8_t> pending;
+        pending.reserve(WRITE_CHUNK + buffer.size());
+        PlayerMetrics& metrics = PlayerMetrics::get();
+
+        bool running = true;
+        while (running) {
+            // Wait for libvlc to open the pipe
+            ResetEvent(overlapped.hEvent);
+            DWORD transferred = 0;
+            if (!ConnectNamedPipe(pipe, &overlapped)) {
+                DWORD error = GetLastError();
+                if (error == ERROR_IO_PENDING) {
+                    if (!await(overlapped, transferred)) break;
+                } else if (error != ERROR_PIPE_CONNECTED) {
+                    break;
+                }
+            }
+
+            TsPidFilter filter(selection);
+            while (true) {
+                ResetEvent(overlapped.hEvent);
+                if (!ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), nullptr, &overlapped) &&
+                    GetLastError() != ERROR_IO_PENDING) {
+                    break;                  // Writer closed the pipe
+                }
+                if (!await(overlapped, transferred)) {
+                    running = WaitForSingleObject(stopEvent, 0) != WAIT_OBJECT_0;
+                    break;
+                }
+                uint64_t kept = filter.outputBytes();
+                filter.feed(buffer.data(), transferred, pending);
+                kept = filter.outputBytes() - kept;
+                bytesIn.fetch_add(transferred);
+                if (kept < transferred) {
+                    metrics.recordingFilteredBytes.inc(transferred - kept);
+                }
+                writeOut(pending, false);
+            }
+
+            filter.flush(pending);
+            writeOut(pending, true);
+            DisconnectNamedPipe(pipe);
+        }
+
+        writeOut(pending, true);
+        CloseHandle(overlapped.hEvent);
+    }
+
+public:
+    TsPipeRecorder(const std::string& filePath, const TsPidSelection& pids)
+        : selection(pids), outputPath(filePath) {}
+
+    TsPipeRecorder(const TsPipeRecorder&) = delete;
+    TsPipeRecorder& operator=(const TsPipeRecorder&) = delete;
+
+    ~TsPipeRecorder() {
+        stop();
+    }
+
+    // Creates the pipe and the output file; getPipePath() is then what to give
+    // libvlc as the file to write
+    bool start() {
+        static std::atomic<uint32_t> counter{0};
+        pipePath = "\\\\.\\pipe\\jptv-rec-" + std::to_string(GetCurrentProcessId()) + "-" +
+                   std::to_string(counter.fetch_add(1));
+
+        // Duplex: libvlc's file output opens for read and write
+        pipe = CreateNamedPipeW(utf8ToWide(pipePath).c_str(),
+                                PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                1, 0, PIPE_BUFFER, 0, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        file = CreateFileW(utf8ToWide(outputPath).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                           CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (file == INVALID_HANDLE_VALUE || !stopEvent) {
+            stop();
+            return false;
+        }
+
+        worker = std::thread(&TsPipeRecorder::run, this);
+        return true;
+    }
+
+    // Flushes and closes the file. Call after libvlc stopped writing, or the
+    // tail of the stream is lost with the pipe.
+    void stop() {
+        if (stopEvent) SetEvent(stopEvent);
+        if (worker.joinable()) worker.join();
+
+        if (pipe != INVALID_HANDLE_VALUE) CloseHandle(pipe);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        if (stopEvent) CloseHandle(stopEvent);
+        pipe = INVALID_HANDLE_VALUE;
+        file = INVALID_HANDLE_VALUE;
+        stopEvent = nullptr;
+    }
+
+    const std::string& getPipePath() const { return pipePath; }
+    const std::string& getOutputPath() const { return outputPath; }
+    uint64_t inputBytes() const { return bytesIn.load(); }
+    uint64_t outputBytes() const { return bytesOut.load(); }
+};
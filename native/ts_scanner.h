@@ -0,0 +1,560 @@
+#pragma once
+
+// Integrity scan for .ts recordings left behind by a crash or a full disk.
+// The file is split into chunks scanned on parallel threads, each with its
+// own handle and sequential reads, so a scan runs at disk speed. A chunk
+// walks its packets checking the sync byte and per-PID continuity counters;
+// after a sync loss it searches for the next run of three sync bytes 188
+// apart (SSE2 compare over 16 bytes at a time). Chunk boundaries are
+// stitched afterwards: the continuity counters a chunk ends with are
+// checked against the ones the next one starts with.
+//
+// Along the way each chunk collects the video PES starts with their PTS;
+// random access points (or, in streams that never flag them, every video
+// PES start) become the seek index, one entry per INDEX_INTERVAL_MS, in
+// "<recording>.idx".
+//
+// The index can carry a trailer of chapter markers (black frames, silence,
+// breaks) written later by the chapter analyser; readers that predate it
+// stop after the entries.
+//
+// Repair truncates the file after its last complete packet - the torn
+// write at the end that breaks players. Damage mid-file is only counted:
+// players resync over it, and cutting it out would rewrite the recording.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "win_util.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TS_SCANNER_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+struct TsScanReport {
+    bool ok = false;                // The file could be read
+    std::string error;
+    uint64_t fileSize = 0;
+    uint64_t packets = 0;
+    uint64_t syncErrors = 0;        // Sync losses (each followed by a resync)
+    uint64_t droppedBytes = 0;      // Skipped while resyncing, mid-file
+    uint64_t continuityErrors = 0;
+    uint64_t errorPackets = 0;      // transport_error_indicator set
+    uint64_t validEnd = 0;          // End of the last complete packet
+    bool truncated = false;         // Repair cut the file at validEnd
+    double durationMs = 0;          // First to last video PTS
+    uint32_t indexEntries = 0;
+    uint32_t threads = 0;
+    double elapsedMs = 0;
+};
+
+// A recording's seek index as loaded from "<recording>.idx"
+struct TsSeekIndex {
+    struct Point {
+        uint64_t offset;
+        uint32_t timeMs;
+    };
+    static constexpr uint32_t MAX_MARKERS = 10000;
+    enum MarkerKind : uint8_t { MARKER_BLACK = 1, MARKER_SILENCE = 2, MARKER_BREAK = 3 };
+    struct Marker {
+        uint32_t startMs;
+        uint32_t endMs;
+        MarkerKind kind;
+    };
+    std::vector<Point> points;      // In file (and time) order
+    std::vector<Marker> markers;    // In time order
+    bool analysed = false;          // Markers were written (possibly none)
+    uint32_t durationMs = 0;
+    uint64_t fileSize = 0;
+
+    // The last point at or before timeMs (the first if none is)
+    const Point* find(uint32_t timeMs) const {
+        if (points.empty()) return nullptr;
+        auto it = std::upper_bound(points.begin(), points.end(), timeMs,
+                                   [](uint32_t t, const Point& point) { return t < point.timeMs; });
+        return it == points.begin() ? &points.front() : &*(it - 1);
+    }
+};
+
+class TsScanner {
+private:
+    static constexpr size_t PACKET = 188;
+    static constexpr size_t BLOCK = 4 << 20;
+    static constexpr uint64_t MIN_CHUNK = 64ull << 20;
+    static constexpr unsigned MAX_THREADS = 8;
+    static constexpr int64_t INDEX_INTERVAL_MS = 1000;
+    static constexpr int64_t PTS_WRAP = int64_t(1) << 33;
+    static constexpr int8_t NO_CC = -1;
+    static constexpr int8_t RESET_CC = -2;  // First packet flagged discontinuous
+    static constexpr char INDEX_MAGIC[8] = {'J', 'P', 'T', 'V', 'I', 'D', 'X', '1'};
+    static constexpr char MARKER_MAGIC[8] = {'J', 'P', 'T', 'V', 'C', 'H', 'P', '1'};
+
+#pragma pack(push, 1)
+    struct IndexHeader {
+        char magic[8];
+        uint32_t count;
+        uint32_t durationMs;
+        uint64_t fileSize;          // validEnd when written; stale if it differs
+    };
+    struct IndexEntry {
+        uint64_t offset;            // Packet with the PES start
+        uint32_t timeMs;            // From the first indexed PTS
+    };
+    struct MarkerHeader {           // Optional, after the entries
+        char magic[8];
+        uint32_t count;
+    };
+    struct MarkerEntry {
+        uint32_t startMs;
+        uint32_t endMs;
+        uint8_t kind;
+    };
+#pragma pack(pop)
+
+    struct Point {
+        uint64_t offset;
+        int64_t pts;
+        bool randomAccess;
+    };
+
+    struct Chunk {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint64_t firstSync = UINT64_MAX;
+        uint64_t walkEnd = 0;       // Where the walk stopped (>= end, or EOF)
+        uint64_t validEnd = 0;
+        uint64_t packets = 0;
+        uint64_t continuityErrors = 0;
+        uint64_t errorPackets = 0;
+        bool readFailed = false;
+        std::vector<std::pair<uint64_t, uint64_t>> gaps;       // Skipped byte ranges
+        std::vector<int8_t> firstCc = std::vector<int8_t>(8192, NO_CC);
+        std::vector<int8_t> lastCc = std::vector<int8_t>(8192, NO_CC);
+        std::vector<Point> points;
+    };
+
+    // Sequential reads through a window that always holds what is asked for
+    class BlockReader {
+    private:
+        HANDLE file;
+        uint64_t fileSize;
+        std::vector<uint8_t> buffer;
+        uint64_t start = 0;
+        size_t length = 0;
+
+    public:
+        bool failed = false;
+
+        BlockReader(HANDLE handle, uint64_t size) : file(handle), fileSize(size), buffer(BLOCK) {}
+
+        // At least `need` bytes from `offset` unless the file ends first
+        const uint8_t* at(uint64_t offset, size_t need, size_t& available) {
+            if (offset < start || offset + need > start + length) {
+                LARGE_INTEGER position;
+                position.QuadPart = static_cast<LONGLONG>(offset);
+                DWORD want = static_cast<DWORD>(std::min<uint64_t>(std::max(BLOCK, need), fileSize - std::min(offset, fileSize)));
+                if (buffer.size() < want) buffer.resize(want);
+                DWORD got = 0;
+                if (want && (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN) ||
+                             !ReadFile(file, buffer.data(), want, &got, nullptr))) {
+                    failed = true;
+                    got = 0;
+                }
+                start = offset;
+                length = got;
+            }
+            available = static_cast<size_t>(start + length - offset);
+            return buffer.data() + (offset - start);
+        }
+    };
+
+    static int lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // Index of the first 0x47 in p[0, n), or n
+    static size_t findSyncByte(const uint8_t* p, size_t n) {
+        size_t i = 0;
+#ifdef TS_SCANNER_SSE2
+        const __m128i sync = _mm_set1_epi8(0x47);
+        for (; i + 16 <= n; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, sync));
+            if (mask) return i + lowestBit(static_cast<uint32_t>(mask));
+        }
+#endif
+        for (; i < n; i++) {
+            if (p[i] == 0x47) return i;
+        }
+        return n;
+    }
+
+    // First offset in [from, limit) that starts three packets in a row (or
+    // as many as the file still holds); limit if none
+    static uint64_t findSync(BlockReader& reader, uint64_t from, uint64_t limit, uint64_t fileSize) {
+        uint64_t offset = from;
+        while (offset < limit) {
+            size_t available;
+            const uint8_t* p = reader.at(offset, 3 * PACKET, available);
+            if (available == 0) return limit;
+            size_t span = static_cast<size_t>(std::min<uint64_t>(available, limit - offset));
+            size_t i = findSyncByte(p, span);
+            if (i == span) {
+                offset += span;
+                continue;
+            }
+            offset += i;
+            p = reader.at(offset, 3 * PACKET, available);
+            bool confirmed = true;
+            for (size_t k = 1; k < 3 && offset + (k + 1) * PACKET <= fileSize; k++) {
+                if (k * PACKET >= available || p[k * PACKET] != 0x47) {
+                    confirmed = false;
+                    break;
+                }
+            }
+            if (confirmed) return offset;
+            offset++;
+        }
+        return limit;
+    }
+
+    static int64_t readTimestamp(const uint8_t* p) {
+        return (static_cast<int64_t>(p[0] & 0x0E) << 29) | (static_cast<int64_t>(p[1]) << 22) |
+               (static_cast<int64_t>(p[2] & 0xFE) << 14) | (static_cast<int64_t>(p[3]) << 7) | (p[4] >> 1);
+    }
+
+    static void scanChunk(const std::string& path, uint64_t fileSize, Chunk& chunk, std::atomic<uint64_t>& scanned,
+                          const std::atomic<bool>& cancelled) {
+        HANDLE file = CreateFileW(utf8ToWide(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            chunk.readFailed = true;
+            return;
+        }
+        BlockReader reader(file, fileSize);
+        std::vector<int8_t>& lastCc = chunk.lastCc;
+
+        uint64_t offset = findSync(reader, chunk.begin, chunk.end, fileSize);
+        chunk.firstSync = offset;
+        if (offset > chunk.begin) chunk.gaps.emplace_back(chunk.begin, offset);
+        uint64_t reported = chunk.begin;
+
+        while (offset < chunk.end) {
+            size_t available;
+            const uint8_t* p = reader.at(offset, PACKET, available);
+            if (available < PACKET) break;              // Torn last packet
+
+            if (p[0] != 0x47) {
+                uint64_t next = findSync(reader, offset + 1, chunk.end, fileSize);
+                chunk.gaps.emplace_back(offset, next);
+                offset = next;
+                continue;
+            }
+
+            chunk.packets++;
+            if (p[1] & 0x80) chunk.errorPackets++;
+            uint16_t pid = static_cast<uint16_t>(((p[1] & 0x1F) << 8) | p[2]);
+            uint8_t adaptation = (p[3] >> 4) & 0x03;
+            bool discontinuity = (adaptation & 0x02) && p[4] > 0 && (p[5] & 0x80);
+            bool randomAccess = (adaptation & 0x02) && p[4] > 0 && (p[5] & 0x40);
+
+            // Continuity: counts packets with payload, one duplicate allowed
+            if (pid != 0x1FFF && (adaptation & 0x01)) {
+                int8_t cc = static_cast<int8_t>(p[3] & 0x0F);
+                int8_t previous = lastCc[pid];
+                if (previous == NO_CC) {
+                    chunk.firstCc[pid] = discontinuity ? RESET_CC : cc;
+                } else if (!discontinuity && cc != ((previous + 1) & 0x0F) && cc != previous) {
+                    chunk.continuityErrors++;
+                }
+                lastCc[pid] = cc;
+            }
+
+            // Video PES starts for the index
+            if ((p[1] & 0x40) && (adaptation & 0x01)) {
+                size_t payload = 4 + ((adaptation & 0x02) ? 1 + p[4] : 0);
+                if (payload + 14 <= PACKET && p[payload] == 0 && p[payload + 1] == 0 && p[payload + 2] == 1 &&
+                    (p[payload + 3] & 0xF0) == 0xE0 && (p[payload + 7] & 0x80)) {
+                    chunk.points.push_back({offset, readTimestamp(p + payload + 9), randomAccess});
+                }
+            }
+
+            offset += PACKET;
+            chunk.validEnd = offset;
+            if (offset - reported >= BLOCK && offset < chunk.end) {
+                scanned.fetch_add(offset - reported);
+                reported = offset;
+                if (cancelled.load()) break;
+            }
+        }
+        chunk.walkEnd = offset;
+        chunk.readFailed = reader.failed;
+        scanned.fetch_add(std::min(offset, chunk.end) - reported);
+        CloseHandle(file);
+    }
+
+    // Seek index from the video PES starts, in file order
+    static std::vector<IndexEntry> buildIndex(const std::vector<Chunk>& chunks, double& durationMs) {
+        std::vector<IndexEntry> entries;
+        durationMs = 0;
+        bool anyRandomAccess = false;
+        for (const Chunk& chunk : chunks) {
+            for (const Point& point : chunk.points) anyRandomAccess |= point.randomAccess;
+        }
+
+        int64_t first = -1;
+        int64_t last = 0;
+        int64_t previousRaw = -1;
+        int64_t wrapOffset = 0;
+        int64_t nextMs = 0;
+        for (const Chunk& chunk : chunks) {
+            for (const Point& point : chunk.points) {
+                if (previousRaw >= 0) {
+                    int64_t delta = point.pts - previousRaw;
+                    if (delta < -PTS_WRAP / 2) wrapOffset += PTS_WRAP;
+                    else if (delta > PTS_WRAP / 2) wrapOffset -= PTS_WRAP;
+                }
+                previousRaw = point.pts;
+                int64_t pts = point.pts + wrapOffset;
+                if (first < 0) first = pts;
+                last = std::max(last, pts);
+
+                int64_t ms = (pts - first) / 90;
+                if ((point.randomAccess || !anyRandomAccess) && ms >= nextMs) {
+                    entries.push_back({point.offset, static_cast<uint32_t>(ms)});
+                    nextMs = ms + INDEX_INTERVAL_MS;
+                }
+            }
+        }
+        if (first >= 0) durationMs = (last - first) / 90.0;
+        return entries;
+    }
+
+    static bool writeIndex(const std::string& path, const std::vector<IndexEntry>& entries, double durationMs,
+                           uint64_t fileSize, const std::vector<TsSeekIndex::Marker>* markers = nullptr) {
+        IndexHeader header;
+        memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.count = static_cast<uint32_t>(entries.size());
+        header.durationMs = static_cast<uint32_t>(durationMs);
+        header.fileSize = fileSize;
+
+        // Write-then-rename so a reader never sees half an index
+        std::string tempPath = path + ".tmp";
+        FILE* f = _wfopen(utf8ToWide(tempPath).c_str(), L"wb");
+        if (!f) return false;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  (entries.empty() || fwrite(entries.data(), sizeof(IndexEntry), entries.size(), f) == entries.size());
+        if (ok && markers) {
+            MarkerHeader markerHeader;
+            memcpy(markerHeader.magic, MARKER_MAGIC, sizeof(MARKER_MAGIC));
+            markerHeader.count = static_cast<uint32_t>(markers->size());
+            ok = fwrite(&markerHeader, sizeof(markerHeader), 1, f) == 1;
+            for (size_t i = 0; ok && i < markers->size(); i++) {
+                const TsSeekIndex::Marker& marker = (*markers)[i];
+                MarkerEntry entry = {marker.startMs, marker.endMs, static_cast<uint8_t>(marker.kind)};
+                ok = fwrite(&entry, sizeof(entry), 1, f) == 1;
+            }
+        }
+        ok = fclose(f) == 0 && ok;
+
+        if (ok && MoveFileExW(utf8ToWide(tempPath).c_str(), utf8ToWide(path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            return true;
+        }
+        DeleteFileW(utf8ToWide(tempPath).c_str());
+        return false;
+    }
+
+    // The raw header and entries of "<path>.idx", and its markers if any
+    static bool readIndex(const std::string& path, IndexHeader& header, std::vector<IndexEntry>& entries,
+                          TsSeekIndex& index) {
+        FILE* f = _wfopen(utf8ToWide(path + ".idx").c_str(), L"rb");
+        if (!f) return false;
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0;
+        if (ok) {
+            entries.resize(header.count);
+            ok = entries.empty() || fread(entries.data(), sizeof(IndexEntry), entries.size(), f) == entries.size();
+        }
+
+        index.markers.clear();
+        index.analysed = false;
+        MarkerHeader markerHeader;
+        if (ok && fread(&markerHeader, sizeof(markerHeader), 1, f) == 1 &&
+            memcmp(markerHeader.magic, MARKER_MAGIC, sizeof(MARKER_MAGIC)) == 0 &&
+            markerHeader.count <= TsSeekIndex::MAX_MARKERS) {
+            std::vector<MarkerEntry> markers(markerHeader.count);
+            if (markers.empty() || fread(markers.data(), sizeof(MarkerEntry), markers.size(), f) == markers.size()) {
+                index.analysed = true;
+                for (const MarkerEntry& marker : markers) {
+                    index.markers.push_back({marker.startMs, marker.endMs,
+                                             static_cast<TsSeekIndex::MarkerKind>(marker.kind)});
+                }
+            }
+        }
+        fclose(f);
+        return ok;
+    }
+
+    // Needs the file to itself: a recorder still writing keeps it
+    static bool truncate(const std::string& path, uint64_t length) {
+        HANDLE file = CreateFileW(utf8ToWide(path).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(length);
+        bool ok = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+        CloseHandle(file);
+        return ok;
+    }
+
+public:
+    // Reads "<path>.idx". False if it is missing, damaged or covers more than
+    // the recording now holds; an index of a file that grew since still
+    // holds for the part it covers.
+    static bool loadIndex(const std::string& path, TsSeekIndex& index) {
+        IndexHeader header;
+        std::vector<IndexEntry> entries;
+        uint64_t size = 0;
+        if (!readIndex(path, header, entries, index) || !getFileSize(path, size) || size < header.fileSize) {
+            return false;
+        }
+
+        index.points.clear();
+        index.points.reserve(entries.size());
+        for (const IndexEntry& entry : entries) index.points.push_back({entry.offset, entry.timeMs});
+        index.durationMs = header.durationMs;
+        index.fileSize = header.fileSize;
+        return true;
+    }
+
+    // Replaces the markers in "<path>.idx", keeping its entries
+    static bool writeMarkers(const std::string& path, const std::vector<TsSeekIndex::Marker>& markers) {
+        IndexHeader header;
+        std::vector<IndexEntry> entries;
+        TsSeekIndex previous;
+        if (!readIndex(path, header, entries, previous)) return false;
+        return writeIndex(path + ".idx", entries, header.durationMs, header.fileSize, &markers);
+    }
+
+    // Scans `path`; with repair, truncates a torn tail; with writeIndex,
+    // writes "<path>.idx". progress receives bytes scanned so far.
+    static TsScanReport scan(const std::string& path, bool repair, bool writeIndexFile,
+                             std::atomic<uint64_t>& progress, const std::atomic<bool>& cancelled) {
+        TsScanReport report;
+        auto started = std::chrono::steady_clock::now();
+
+        if (!getFileSize(path, report.fileSize)) {
+            report.error = "Cannot open file";
+            return report;
+        }
+
+        // Chunks of at least MIN_CHUNK, one per core
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t byCores = std::max<uint64_t>(1, report.fileSize / MIN_CHUNK);
+        unsigned count = static_cast<unsigned>(std::min<uint64_t>(std::min(cores, MAX_THREADS), byCores));
+        uint64_t chunkSize = (report.fileSize / count / PACKET + 1) * PACKET;
+        std::vector<Chunk> chunks(count);
+        for (unsigned i = 0; i < count; i++) {
+            chunks[i].begin = std::min(report.fileSize, i * chunkSize);
+            chunks[i].end = std::min(report.fileSize, (i + 1) * chunkSize);
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < count; i++) {
+            threads.emplace_back(scanChunk, std::cref(path), report.fileSize, std::ref(chunks[i]),
+                                 std::ref(progress), std::cref(cancelled));
+        }
+        scanChunk(path, report.fileSize, chunks[0], progress, cancelled);
+        for (std::thread& thread : threads) thread.join();
+        report.threads = count;
+
+        for (const Chunk& chunk : chunks) {
+            if (chunk.readFailed) {
+                report.error = "Read failed";
+                return report;
+            }
+            if (chunk.validEnd) report.validEnd = chunk.validEnd;
+            report.packets += chunk.packets;
+        }
+        // A last packet followed by junk rather than the end of the file is
+        // most likely the torn write itself (its tail zero-filled)
+        if (report.validEnd < report.fileSize && report.validEnd >= PACKET) {
+            report.validEnd -= PACKET;
+            report.packets--;
+        }
+        if (cancelled.load()) {
+            report.error = "Cancelled";
+            return report;
+        }
+
+        for (size_t i = 0; i < chunks.size(); i++) {
+            Chunk& chunk = chunks[i];
+            report.continuityErrors += chunk.continuityErrors;
+            report.errorPackets += chunk.errorPackets;
+
+            // Stitch to the previous chunk: its last packet may run into
+            // this one, and counters carry over
+            if (i > 0) {
+                const Chunk& previous = chunks[i - 1];
+                if (!chunk.gaps.empty() && chunk.gaps.front().first == chunk.begin) {
+                    auto& head = chunk.gaps.front();
+                    if (previous.walkEnd > chunk.begin) {
+                        head.first = std::min(head.second, previous.walkEnd);
+                    } else if (!previous.gaps.empty() && previous.gaps.back().second == previous.end) {
+                        head.first = head.second;       // Continues the previous chunk's gap
+                        report.droppedBytes += std::min(head.second, report.validEnd) > chunk.begin
+                            ? std::min(head.second, report.validEnd) - chunk.begin : 0;
+                    }
+                }
+                for (size_t pid = 0; pid < chunk.firstCc.size(); pid++) {
+                    int8_t last = previous.lastCc[pid];
+                    int8_t next = chunk.firstCc[pid];
+                    if (last >= 0 && next >= 0 && next != ((last + 1) & 0x0F) && next != last) {
+                        report.continuityErrors++;
+                    }
+                }
+            }
+
+            // Each gap is one sync loss; past the last packet it is the torn
+            // tail, not mid-file damage
+            for (const auto& gap : chunk.gaps) {
+                uint64_t gapEnd = std::min(gap.second, report.validEnd);
+                if (gapEnd > gap.first) {
+                    report.droppedBytes += gapEnd - gap.first;
+                    report.syncErrors++;
+                }
+            }
+        }
+        uint64_t tail = report.fileSize - report.validEnd;
+
+        std::vector<IndexEntry> entries = buildIndex(chunks, report.durationMs);
+        report.indexEntries = static_cast<uint32_t>(entries.size());
+        report.ok = true;
+
+        if (repair && tail > 0 && report.validEnd > 0) {
+            report.truncated = truncate(path, report.validEnd);
+            if (!report.truncated) report.error = "File in use; not truncated";
+        }
+        if (writeIndexFile && !writeIndex(path + ".idx", entries, report.durationMs, report.validEnd)) {
+            report.error = "Cannot write index";
+        }
+
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return report;
+    }
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+// Two child windows stacked over the host window's client area, one per
+// media player, so a standby player can render out of sight and be swapped
+// in without tearing down the visible vout.
+//
+// The windows are created on (and owned by) the thread that calls create(),
+// which for the addon is Electron's UI thread. swap() may run on any thread,
+// so it only uses the asynchronous window calls: a synchronous SetWindowPos
+// from a worker would block on the UI thread, which may itself be waiting
+// for the player mutex.
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <commctrl.h>
+
+#pragma comment(lib, "comctl32.lib")
+
+class VideoSurfaces {
+private:
+    static constexpr UINT_PTR SUBCLASS_ID = 0x4A505456;   // 'JPTV'
+
+    HWND parent = nullptr;
+    HWND surfaces[2] = {nullptr, nullptr};
+    int activeIndex = 0;
+
+    void fitToParent() {
+        RECT rect;
+        if (!GetClientRect(parent, &rect)) return;
+        for (HWND surface : surfaces) {
+            MoveWindow(surface, 0, 0, rect.right - rect.left, rect.bottom - rect.top, TRUE);
+        }
+    }
+
+    // Keeps both surfaces covering the host as it resizes
+    static LRESULT CALLBACK parentProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam,
+                                       UINT_PTR id, DWORD_PTR data) {
+        VideoSurfaces* self = reinterpret_cast<VideoSurfaces*>(data);
+        if (message == WM_SIZE) {
+            self->fitToParent();
+        } else if (message == WM_NCDESTROY) {
+            RemoveWindowSubclass(window, parentProc, id);
+        }
+        return DefSubclassProc(window, message, wParam, lParam);
+    }
+
+public:
+    VideoSurfaces() = default;
+    VideoSurfaces(const VideoSurfaces&) = delete;
+    VideoSurfaces& operator=(const VideoSurfaces&) = delete;
+
+    ~VideoSurfaces() {
+        destroy();
+    }
+
+    bool create(HWND host) {
+        if (surfaces[0]) return true;
+
+        parent = host;
+        RECT rect = {0, 0, 0, 0};
+        GetClientRect(parent, &rect);
+
+        // Disabled so mouse input falls through to the host like before
+        for (HWND& surface : surfaces) {
+            surface = CreateWindowExW(0, L"STATIC", L"", WS_CHILD | WS_VISIBLE | WS_DISABLED | WS_CLIPSIBLINGS,
+                                      0, 0, rect.right - rect.left, rect.bottom - rect.top,
+                                      parent, nullptr, GetModuleHandleW(nullptr), nullptr);
+            if (!surface) {
+                destroy();
+                return false;
+            }
+        }
+
+        // Standby sits directly beneath the active surface
+        activeIndex = 0;
+        SetWindowPos(surfaces[1], surfaces[0], 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+        SetWindowSubclass(parent, parentProc, SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this));
+        return true;
+    }
+
+    void destroy() {
+        if (parent && surfaces[0]) {
+            RemoveWindowSubclass(parent, parentProc, SUBCLASS_ID);
+        }
+        for (HWND& surface : surfaces) {
+            if (surface) {
+                DestroyWindow(surface);
+                surface = nullptr;
+            }
+        }
+        parent = nullptr;
+    }
+
+    HWND active() const {
+        return surfaces[activeIndex];
+    }
+
+    HWND standby() const {
+        return surfaces[1 - activeIndex];
+    }
+
+    // Raise the standby above the active surface; the old active one keeps
+    // its last frame underneath until its player is stopped
+    void swap() {
+        HWND previous = active();
+        activeIndex = 1 - activeIndex;
+        SetWindowPos(previous, active(), 0, 0, 0, 0,
+                     SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE | SWP_ASYNCWINDOWPOS);
+    }
+};
@@ -1,485 +1,224 @@
 #include <napi.h>
-#include <vlc/vlc.h>
-#include <windows.h>
-#include <string>
-#include <mutex>
-#include <chrono>
-#include <ctime>
-
-class VlcPlayer {
-private:
-    libvlc_instance_t* vlcInstance = nullptr;
-    libvlc_media_player_t* mediaPlayer = nullptr;
-    HWND hwnd = nullptr;
-    std::mutex playerMutex;
-    bool initialized = false;
-    
-    // Freeze detection
-    std::chrono::steady_clock::time_point lastFrameTime;
-    bool freezeDetectionEnabled = false;
-    int64_t lastFrameCount = 0;
-    
-    // Current playback info
-    std::string currentUrl;
-    bool isInErrorState = false;
-    
-    // Stream statistics
-    struct StreamStats {
-        float inputBitrate = 0.0f;      // KB/s
-        float demuxBitrate = 0.0f;      // KB/s
-        int64_t lostBuffers = 0;
-        int64_t displayedPictures = 0;
-        int64_t lostPictures = 0;
-    };
-    StreamStats lastStats;
-    
-    // Recording state
-    bool isRecording = false;
-    std::string recordingPath;
-    
-    // Audio-only mode
-    bool audioOnlyMode = false;
+#include "vlc_player.h"
+#include "archive_transcoder.h"
+#include "chapter_analyzer.h"
+#include "command_queue.h"
+#include "preview_strip.h"
+#include "recording_scheduler.h"
+#include "recording_server.h"
+#include "stream_relay.h"
+#include "ts_scanner.h"
 
-public:
-    VlcPlayer() {
-        lastFrameTime = std::chrono::steady_clock::now();
-    }
+// Global player instance
+static VlcPlayer* globalPlayer = nullptr;
 
-    ~VlcPlayer() {
-        cleanup();
+// Serialises play/stop/pause/resume; created with the player
+static PlayerCommandQueue* commandQueue = nullptr;
+
+// Metrics exporter (optional loopback HTTP endpoint and/or file dump)
+static MetricsExporter* metricsExporter = nullptr;
+
+// onStreamFailed callback; failures arrive on libvlc threads
+static std::mutex streamFailedMutex;
+static Napi::ThreadSafeFunction streamFailedEvents;
+
+static void forwardStreamFailure(const StreamFailure& failure) {
+    std::lock_guard<std::mutex> lock(streamFailedMutex);
+    if (!streamFailedEvents) {
+        return;
     }
-    
-    // Safe recreation after crash
-    bool recreateMediaPlayer() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!vlcInstance) {
-            return false;
-        }
-        
-        // Clean up old player
-        if (mediaPlayer) {
-            libvlc_media_player_release(mediaPlayer);
-            mediaPlayer = nullptr;
-        }
-        
-        // Create new player
-        mediaPlayer = libvlc_media_player_new(vlcInstance);
-        if (!mediaPlayer) {
-            return false;
-        }
-        
-        // Restore HWND
-        libvlc_media_player_set_hwnd(mediaPlayer, hwnd);
-        
-        isInErrorState = false;
-        return true;
+    StreamFailure* copy = new StreamFailure(failure);
+    auto deliver = [](Napi::Env jsEnv, Napi::Function callback, StreamFailure* data) {
+        Napi::Object event = Napi::Object::New(jsEnv);
+        event.Set("reason", Napi::String::New(jsEnv, streamFailureReasonName(data->reason)));
+        event.Set("detail", Napi::String::New(jsEnv, data->detail));
+        event.Set("url", Napi::String::New(jsEnv, data->url));
+        event.Set("firstFrame", Napi::Boolean::New(jsEnv, data->firstFrame));
+        callback.Call({event});
+        delete data;
+    };
+    if (streamFailedEvents.NonBlockingCall(copy, deliver) != napi_ok) {
+        delete copy;
     }
+}
 
-    bool initialize(HWND windowHandle) {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (initialized) {
-            return true;
-        }
+// N-API wrapper functions
+static VlcPlayer* ensurePlayer() {
+    if (!globalPlayer) {
+        globalPlayer = new VlcPlayer();
+        globalPlayer->setFailureListener(forwardStreamFailure);
+    }
+    return globalPlayer;
+}
 
-        hwnd = windowHandle;
+// Creates the libvlc instance (plugin load) on a worker thread
+class WarmUpWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    VlcPlayer* player;
+    bool resetPluginCache;
+    std::string resumeStatePath;
+    bool resume;
+    bool success = false;
+    double elapsedMs = 0;
+    std::string resumeUrl;
 
-        // Initialize libVLC with common options
-        const char* vlc_args[] = {
-            "--no-video-title-show",     // Don't show filename on video
-            "--no-xlib",                  // Don't use Xlib
-            "--no-snapshot-preview",      // No snapshot preview
-            "--quiet",                    // Less verbose
-            "--network-caching=3000",     // 3s network cache for IPTV
-            "--clock-jitter=0",           // Reduce jitter
-            "--clock-synchro=0"           // Disable clock sync issues
-        };
+public:
+    WarmUpWorker(Napi::Env env, VlcPlayer* target, bool resetCache, const std::string& statePath, bool resumeLast)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), player(target),
+          resetPluginCache(resetCache), resumeStatePath(statePath), resume(resumeLast) {}
 
-        vlcInstance = libvlc_new(sizeof(vlc_args) / sizeof(vlc_args[0]), vlc_args);
-        if (!vlcInstance) {
-            return false;
-        }
+    Napi::Promise GetPromise() { return deferred.Promise(); }
 
-        mediaPlayer = libvlc_media_player_new(vlcInstance);
-        if (!mediaPlayer) {
-            libvlc_release(vlcInstance);
-            vlcInstance = nullptr;
-            return false;
+    void Execute() override {
+        auto started = std::chrono::steady_clock::now();
+        if (!resumeStatePath.empty() && player->loadResumeState(resumeStatePath, resume)) {
+            resumeUrl = player->getResumeUrl();
         }
-
-        // Set output window (HWND)
-        libvlc_media_player_set_hwnd(mediaPlayer, hwnd);
-
-        initialized = true;
-        return true;
+        success = player->createInstance(resetPluginCache);
+        elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
     }
 
-    bool play(const std::string& url) {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
-        }
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("success", Napi::Boolean::New(env, success));
+        result.Set("elapsedMs", Napi::Number::New(env, elapsedMs));
+        result.Set("resumeUrl", Napi::String::New(env, resumeUrl));
+        deferred.Resolve(result);
+    }
 
-        try {
-            // Stop current playback
-            if (libvlc_media_player_is_playing(mediaPlayer)) {
-                libvlc_media_player_stop(mediaPlayer);
-                // Wait for clean stop
-                Sleep(100);
-            }
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+};
 
-            // Create media from URL
-            libvlc_media_t* media = libvlc_media_new_location(vlcInstance, url.c_str());
-            if (!media) {
-                return false;
-            }
+// warmUp({ resetPluginCache?, resumeStatePath?, resume? }) - start libvlc
+// before the window exists. With resume, the stream saved in the state file
+// is pre-opened as soon as initialize() attaches the window. Resolves with
+// { success, elapsedMs, resumeUrl }
+Napi::Value WarmUp(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
-            // Set media to player
-            libvlc_media_player_set_media(mediaPlayer, media);
-            libvlc_media_release(media);
-
-            // Start playback
-            int result = libvlc_media_player_play(mediaPlayer);
-            
-            if (result == 0) {
-                currentUrl = url;
-                lastFrameTime = std::chrono::steady_clock::now();
-                freezeDetectionEnabled = true;
-                lastFrameCount = 0;
-                isInErrorState = false;
-            }
-            
-            return result == 0;
-        } catch (...) {
-            isInErrorState = true;
-            return false;
+    bool resetPluginCache = false;
+    std::string resumeStatePath;
+    bool resume = false;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("resetPluginCache") && options.Get("resetPluginCache").IsBoolean()) {
+            resetPluginCache = options.Get("resetPluginCache").As<Napi::Boolean>().Value();
         }
-    }
-
-    bool stop() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
+        if (options.Has("resumeStatePath") && options.Get("resumeStatePath").IsString()) {
+            resumeStatePath = options.Get("resumeStatePath").As<Napi::String>().Utf8Value();
         }
-
-        try {
-            libvlc_media_player_stop(mediaPlayer);
-            freezeDetectionEnabled = false;
-            currentUrl.clear();
-            isInErrorState = false;
-            return true;
-        } catch (...) {
-            return false;
+        if (options.Has("resume") && options.Get("resume").IsBoolean()) {
+            resume = options.Get("resume").As<Napi::Boolean>().Value();
         }
     }
 
-    bool pause() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
-        }
+    WarmUpWorker* worker = new WarmUpWorker(env, ensurePlayer(), resetPluginCache, resumeStatePath, resume);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
 
-        libvlc_media_player_pause(mediaPlayer);
+// Window handles arrive as a BigInt (Buffer.readBigInt64LE) or a Number
+static bool hwndFromValue(const Napi::Value& value, HWND& hwnd) {
+    if (value.IsBigInt()) {
+        bool lossless = false;
+        hwnd = reinterpret_cast<HWND>(static_cast<uintptr_t>(value.As<Napi::BigInt>().Uint64Value(&lossless)));
         return true;
     }
-
-    bool resume() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
-        }
-
-        if (!libvlc_media_player_is_playing(mediaPlayer)) {
-            libvlc_media_player_play(mediaPlayer);
-        }
+    if (value.IsNumber()) {
+        hwnd = reinterpret_cast<HWND>(static_cast<uintptr_t>(value.As<Napi::Number>().Int64Value()));
         return true;
     }
+    return false;
+}
 
-    bool setVolume(int volume) {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
-        }
+// Finishes libvlc startup off the JS thread, then attaches the window on it
+class InitializeWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    VlcPlayer* player;
+    HWND hwnd;
+    bool created = false;
 
-        // VLC volume is 0-100
-        int clampedVolume = volume < 0 ? 0 : (volume > 100 ? 100 : volume);
-        libvlc_audio_set_volume(mediaPlayer, clampedVolume);
-        return true;
-    }
+public:
+    InitializeWorker(Napi::Env env, VlcPlayer* target, HWND window)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), player(target), hwnd(window) {}
 
-    int getVolume() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return 0;
-        }
+    Napi::Promise GetPromise() { return deferred.Promise(); }
 
-        return libvlc_audio_get_volume(mediaPlayer);
+    void Execute() override {
+        // No-op (or a wait on the running warm-up) once warmUp() has started
+        created = player->createInstance();
     }
 
-    bool isPlaying() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
+    void OnOK() override {
+        Napi::Env env = Env();
+        bool success = created && player->initialize(hwnd);
+        if (success && !commandQueue) {
+            commandQueue = new PlayerCommandQueue(*player);
+            commandQueue->start();
         }
+        deferred.Resolve(Napi::Boolean::New(env, success));
+    }
 
-        return libvlc_media_player_is_playing(mediaPlayer) == 1;
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
     }
+};
 
-    std::string getState() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return "stopped";
-        }
+// initialize(hwnd) - resolves with true once the player can play
+Napi::Value Initialize(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
-        try {
-            libvlc_state_t state = libvlc_media_player_get_state(mediaPlayer);
-            switch (state) {
-                case libvlc_Playing: return "playing";
-                case libvlc_Paused: return "paused";
-                case libvlc_Stopped: return "stopped";
-                case libvlc_Buffering: return "buffering";
-                case libvlc_Error: return "error";
-                default: return "stopped";
-            }
-        } catch (...) {
-            return "error";
-        }
-    }
-    
-    // Check for playback freeze (no frames for N seconds)
-    bool isStreamFrozen(int freezeThresholdSeconds = 10) {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer || !freezeDetectionEnabled) {
-            return false;
-        }
-        
-        try {
-            // Check if player is in error state
-            libvlc_state_t state = libvlc_media_player_get_state(mediaPlayer);
-            if (state == libvlc_Error || state == libvlc_Ended) {
-                return true;
-            }
-            
-            // If not playing, not frozen
-            if (state != libvlc_Playing) {
-                return false;
-            }
-            
-            // Check time since last frame update
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - lastFrameTime).count();
-            
-            // Get current playback statistics
-            libvlc_media_t* media = libvlc_media_player_get_media(mediaPlayer);
-            if (media) {
-                // Check if media is still valid
-                libvlc_state_t mediaState = libvlc_media_get_state(media);
-                if (mediaState == libvlc_Error) {
-                    return true;
-                }
-            }
-            
-            // If elapsed time exceeds threshold, stream is frozen
-            if (elapsed >= freezeThresholdSeconds) {
-                return true;
-            }
-            
-            return false;
-        } catch (...) {
-            // Exception means something is wrong
-            return true;
-        }
-    }
-    
-    // Update frame timestamp (call periodically during playback)
-    void updateFrameTime() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (freezeDetectionEnabled && mediaPlayer) {
-            try {
-                // Check if actually playing
-                if (libvlc_media_player_is_playing(mediaPlayer)) {
-                    // Get current time as proxy for frame activity
-                    int64_t currentTime = libvlc_media_player_get_time(mediaPlayer);
-                    
-                    // If time changed, we have activity
-                    if (currentTime != lastFrameCount && currentTime > 0) {
-                        lastFrameTime = std::chrono::steady_clock::now();
-                        lastFrameCount = currentTime;
-                    }
-                }
-            } catch (...) {
-                // Ignore errors during update
-            }
-        }
-    }
-    
-    std::string getCurrentUrl() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        return currentUrl;
-    }
-    
-    bool isInError() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        return isInErrorState;
-    }
-    
-    // Get stream statistics
-    StreamStats getStats() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        StreamStats stats;
-        
-        if (!initialized || !mediaPlayer) {
-            return stats;
-        }
-        
-        try {
-            libvlc_media_t* media = libvlc_media_player_get_media(mediaPlayer);
-            if (!media) {
-                return stats;
-            }
-            
-            // Get media statistics
-            libvlc_media_stats_t vlcStats;
-            if (libvlc_media_get_stats(media, &vlcStats)) {
-                // Bitrate is in bytes/s, convert to KB/s
-                stats.inputBitrate = vlcStats.f_input_bitrate;
-                stats.demuxBitrate = vlcStats.f_demux_bitrate;
-                stats.lostBuffers = vlcStats.i_lost_abuffers;
-                stats.displayedPictures = vlcStats.i_displayed_pictures;
-                stats.lostPictures = vlcStats.i_lost_pictures;
-                
-                lastStats = stats;
-            }
-        } catch (...) {
-            // Return last known stats on error
-            return lastStats;
-        }
-        
-        return stats;
-    }
-    
-    // Start recording to file
-    bool startRecording(const std::string& filePath) {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!initialized || !mediaPlayer) {
-            return false;
-        }
-        
-        if (isRecording) {
-            // Already recording
-            return false;
-        }
-        
-        try {
-            // Set recording file using sout (stream output)
-            // Format: #duplicate{dst=display,dst=std{access=file,mux=ts,dst=filepath}}
-            std::string sout = "#duplicate{dst=display,dst=std{access=file,mux=ts,dst=" + filePath + "}}";
-            
-            // Get current media
-            libvlc_media_t* media = libvlc_media_player_get_media(mediaPlayer);
-            if (!media) {
-                return false;
-            }
-            
-            // Add sout option to media
-            libvlc_media_add_option(media, sout.c_str());
-            
-            // Note: To make recording work without restarting playback,
-            // we need to use libvlc_media_player_set_record() if available
-            // For now, this requires media to be re-parsed
-            
-            isRecording = true;
-            recordingPath = filePath;
-            
-            return true;
-        } catch (...) {
-            return false;
-        }
-    }
-    
-    // Stop recording
-    bool stopRecording() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (!isRecording) {
-            return false;
-        }
-        
-        try {
-            // Clear recording state
-            isRecording = false;
-            recordingPath.clear();
-            
-            return true;
-        } catch (...) {
-            return false;
-        }
-    }
-    
-    // Check if currently recording
-    bool getIsRecording() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        return isRecording;
-    }
-    
-    // Get current recording path
-    std::string getRecordingPath() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        return recordingPath;
+    HWND hwnd = nullptr;
+    if (info.Length() < 1 || !hwndFromValue(info[0], hwnd)) {
+        Napi::TypeError::New(env, "HWND (bigint or number) expected").ThrowAsJavaScriptException();
+        return env.Null();
     }
 
-private:
-    void cleanup() {
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        if (mediaPlayer) {
-            libvlc_media_player_stop(mediaPlayer);
-            libvlc_media_player_release(mediaPlayer);
-            mediaPlayer = nullptr;
-        }
-
-        if (vlcInstance) {
-            libvlc_release(vlcInstance);
-            vlcInstance = nullptr;
-        }
+    InitializeWorker* worker = new InitializeWorker(env, ensurePlayer(), hwnd);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
 
-        initialized = false;
-    }
-};
+class RegeneratePluginCacheWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    bool success = false;
 
-// Global player instance
-static VlcPlayer* globalPlayer = nullptr;
+public:
+    explicit RegeneratePluginCacheWorker(Napi::Env env)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)) {}
 
-// N-API wrapper functions
-Napi::Value Initialize(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
+    Napi::Promise GetPromise() { return deferred.Promise(); }
 
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        Napi::TypeError::New(env, "HWND (number) expected").ThrowAsJavaScriptException();
-        return env.Null();
+    void Execute() override {
+        success = SharedLibvlc::instance().regeneratePluginCache();
     }
 
-    HWND hwnd = reinterpret_cast<HWND>(static_cast<uintptr_t>(info[0].As<Napi::Number>().Int64Value()));
+    void OnOK() override {
+        deferred.Resolve(Napi::Boolean::New(Env(), success));
+    }
 
-    if (!globalPlayer) {
-        globalPlayer = new VlcPlayer();
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
     }
+};
 
-    bool success = globalPlayer->initialize(hwnd);
-    return Napi::Boolean::New(env, success);
+// regeneratePluginCache() - one-time plugins.dat rebuild; must run before
+// warmUp()/initialize(). Resolves with false if libvlc is already loaded.
+Napi::Value RegeneratePluginCache(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    RegeneratePluginCacheWorker* worker = new RegeneratePluginCacheWorker(env);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
 }
 
 Napi::Value Play(const Napi::CallbackInfo& info) {
@@ -585,6 +324,27 @@ Napi::Value GetState(const Napi::CallbackInfo& info) {
     return Napi::String::New(env, state);
 }
 
+// getPlaybackPosition() - { timeMs, lengthMs, rate, seekable }, or null
+// with nothing playing
+Napi::Value GetPlaybackPosition(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t timeMs = 0;
+    int64_t lengthMs = 0;
+    double rate = 1;
+    bool seekable = false;
+    if (!globalPlayer || !globalPlayer->getPlaybackPosition(timeMs, lengthMs, rate, seekable)) {
+        return env.Null();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("timeMs", Napi::Number::New(env, static_cast<double>(timeMs)));
+    result.Set("lengthMs", Napi::Number::New(env, static_cast<double>(lengthMs)));
+    result.Set("rate", Napi::Number::New(env, rate));
+    result.Set("seekable", Napi::Boolean::New(env, seekable));
+    return result;
+}
+
 Napi::Value IsStreamFrozen(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
@@ -623,6 +383,194 @@ Napi::Value RecreateMediaPlayer(const Napi::CallbackInfo& info) {
     return Napi::Boolean::New(env, success);
 }
 
+// Waits for the standby's first frame on a worker thread
+class ReconnectWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    VlcPlayer* player;
+    std::string url;
+    int timeoutMs;
+    bool success = false;
+    double elapsedMs = 0;
+    std::function<void()> settled;
+
+public:
+    ReconnectWorker(Napi::Env env, VlcPlayer* target, const std::string& requestedUrl, int timeout,
+                    std::function<void()> onSettled = nullptr)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), player(target),
+          url(requestedUrl), timeoutMs(timeout), settled(std::move(onSettled)) {}
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    void Execute() override {
+        success = player->reconnect(url, timeoutMs, elapsedMs);
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("success", Napi::Boolean::New(env, success));
+        result.Set("elapsedMs", Napi::Number::New(env, elapsedMs));
+        deferred.Resolve(result);
+        if (settled) settled();
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+        if (settled) settled();
+    }
+};
+
+static void parseReconnectArgs(const Napi::CallbackInfo& info, std::string& url, int& timeoutMs) {
+    timeoutMs = 8000;
+    if (info.Length() > 0 && info[0].IsString()) {
+        url = info[0].As<Napi::String>().Utf8Value();
+    }
+    if (info.Length() > 1 && info[1].IsNumber()) {
+        timeoutMs = info[1].As<Napi::Number>().Int32Value();
+    }
+}
+
+// reconnect(url?, timeoutMs?) - resolves with { success, elapsedMs }
+Napi::Value Reconnect(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        Napi::Error::New(env, "Player not initialized").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string url;
+    int timeoutMs;
+    parseReconnectArgs(info, url, timeoutMs);
+
+    ReconnectWorker* worker = new ReconnectWorker(env, globalPlayer, url, timeoutMs);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+static Napi::Object commandResultToObject(Napi::Env env, const PlayerCommandResult& result) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("id", Napi::Number::New(env, static_cast<double>(result.id)));
+    obj.Set("command", Napi::String::New(env, commandTypeName(result.type)));
+    obj.Set("status", Napi::String::New(env, commandStatusName(result.status)));
+    obj.Set("success", Napi::Boolean::New(env, result.success));
+    obj.Set("queueMs", Napi::Number::New(env, result.queueMs));
+    obj.Set("execMs", Napi::Number::New(env, result.execMs));
+    return obj;
+}
+
+// Parses (type, url?) or (type, value) as given to enqueueCommand and
+// Player#command; throws a TypeError and returns false if they are not usable
+static bool parseCommand(const Napi::CallbackInfo& info, PlayerCommandType& type, std::string& url, double& value) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Command type string expected").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    if (name == "play") {
+        type = PlayerCommandType::Play;
+    } else if (name == "stop") {
+        type = PlayerCommandType::Stop;
+    } else if (name == "pause") {
+        type = PlayerCommandType::Pause;
+    } else if (name == "resume") {
+        type = PlayerCommandType::Resume;
+    } else if (name == "seek") {
+        type = PlayerCommandType::Seek;
+    } else if (name == "trickPlay") {
+        type = PlayerCommandType::TrickPlay;
+    } else {
+        Napi::TypeError::New(env, "Unknown command: " + name).ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (type == PlayerCommandType::Play) {
+        if (info.Length() < 2 || !info[1].IsString()) {
+            Napi::TypeError::New(env, "URL string expected").ThrowAsJavaScriptException();
+            return false;
+        }
+        url = info[1].As<Napi::String>().Utf8Value();
+    } else if (type == PlayerCommandType::Seek || type == PlayerCommandType::TrickPlay) {
+        if (info.Length() < 2 || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, type == PlayerCommandType::Seek ? "Time (ms) expected" : "Speed expected")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+        value = info[1].As<Napi::Number>().DoubleValue();
+    }
+    return true;
+}
+
+// Queues a command; the promise resolves with the command result
+static Napi::Promise enqueueOn(Napi::Env env, PlayerCommandQueue& queue, PlayerCommandType type, const std::string& url,
+                               double value = 0) {
+    // Completions arrive on the control thread; one thread-safe function per
+    // command hands the result back to the JS thread
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
+        env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "playerCommand", 0, 1);
+
+    queue.enqueue(type, url, [tsfn, deferred](const PlayerCommandResult& result) {
+        PlayerCommandResult* copy = new PlayerCommandResult(result);
+        auto resolve = [deferred](Napi::Env jsEnv, Napi::Function, PlayerCommandResult* data) {
+            deferred.Resolve(commandResultToObject(jsEnv, *data));
+            delete data;
+        };
+        if (tsfn.NonBlockingCall(copy, resolve) != napi_ok) {
+            delete copy;
+        }
+        tsfn.Release();
+    }, value);
+
+    return deferred.Promise();
+}
+
+// enqueueCommand(type, url?) or enqueueCommand('seek' | 'trickPlay', value) - resolves with { id, command, status, success, queueMs, execMs }
+// once the command has run or been dropped in favour of a newer one
+Napi::Value EnqueueCommand(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    PlayerCommandType type;
+    std::string url;
+    double value = 0;
+    if (!parseCommand(info, type, url, value)) {
+        return env.Null();
+    }
+
+    if (!commandQueue) {
+        Napi::Error::New(env, "Player not initialized").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return enqueueOn(env, *commandQueue, type, url, value);
+}
+
+// Cancels queued commands and refuses new ones (shutdown)
+Napi::Value ShutdownCommands(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (commandQueue) {
+        commandQueue->shutdown();
+    }
+    return env.Undefined();
+}
+
+// URL pre-opened for startup resume, "" once adopted or dropped
+Napi::Value GetResumeUrl(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return Napi::String::New(env, "");
+    }
+
+    return Napi::String::New(env, globalPlayer->getResumeUrl());
+}
+
 Napi::Value GetCurrentUrl(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
@@ -645,21 +593,7 @@ Napi::Value IsInError(const Napi::CallbackInfo& info) {
     return Napi::Boolean::New(env, error);
 }
 
-Napi::Value GetStats(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-
-    if (!globalPlayer) {
-        Napi::Object result = Napi::Object::New(env);
-        result.Set("inputBitrate", 0);
-        result.Set("demuxBitrate", 0);
-        result.Set("lostBuffers", 0);
-        result.Set("displayedPictures", 0);
-        result.Set("lostPictures", 0);
-        return result;
-    }
-
-    auto stats = globalPlayer->getStats();
-    
+static Napi::Object statsToObject(Napi::Env env, const VlcPlayer::StreamStats& stats) {
     Napi::Object result = Napi::Object::New(env);
     result.Set("inputBitrate", Napi::Number::New(env, stats.inputBitrate));
     result.Set("demuxBitrate", Napi::Number::New(env, stats.demuxBitrate));
@@ -670,40 +604,192 @@ Napi::Value GetStats(const Napi::CallbackInfo& info) {
     return result;
 }
 
-Napi::Value StartRecording(const Napi::CallbackInfo& info) {
+Napi::Value GetStats(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (!globalPlayer) {
-        return Napi::Boolean::New(env, false);
+        return statsToObject(env, VlcPlayer::StreamStats());
     }
 
-    if (info.Length() < 1 || !info[0].IsString()) {
-        Napi::TypeError::New(env, "File path string expected").ThrowAsJavaScriptException();
-        return Napi::Boolean::New(env, false);
-    }
+    return statsToObject(env, globalPlayer->getStats());
+}
 
-    std::string filePath = info[0].As<Napi::String>().Utf8Value();
-    bool success = globalPlayer->startRecording(filePath);
-    
-    return Napi::Boolean::New(env, success);
+static Napi::Object bufferHealthToObject(Napi::Env env, const VlcPlayer::BufferHealth& health) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("tracking", Napi::Boolean::New(env, health.tracking));
+    result.Set("bufferedMs", Napi::Number::New(env, health.bufferedMs));
+    result.Set("targetMs", Napi::Number::New(env, health.targetMs));
+    result.Set("trendMsPerSec", Napi::Number::New(env, health.trendMsPerSec));
+    result.Set("underrunInMs", Napi::Number::New(env, health.underrunInMs));
+    result.Set("inputKbps", Napi::Number::New(env, health.inputKbps));
+    result.Set("mediaKbps", Napi::Number::New(env, health.mediaKbps));
+    result.Set("atRisk", Napi::Boolean::New(env, health.atRisk));
+    result.Set("standby", Napi::String::New(env, health.standby));
+    return result;
 }
 
-Napi::Value StopRecording(const Napi::CallbackInfo& info) {
+Napi::Value GetBufferHealth(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
-    if (!globalPlayer) {
-        return Napi::Boolean::New(env, false);
+    VlcPlayer::BufferHealth health;
+    if (globalPlayer) {
+        health = globalPlayer->getBufferHealth();
     }
 
-    bool success = globalPlayer->stopRecording();
-    return Napi::Boolean::New(env, success);
+    return bufferHealthToObject(env, health);
 }
 
-Napi::Value IsRecording(const Napi::CallbackInfo& info) {
+Napi::Value SetStandbyUrl(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (!globalPlayer) {
-        return Napi::Boolean::New(env, false);
+        return env.Null();
+    }
+
+    std::string url;
+    if (info.Length() > 0 && info[0].IsString()) {
+        url = info[0].As<Napi::String>().Utf8Value();
+    }
+
+    globalPlayer->setStandbyUrl(url);
+    return env.Null();
+}
+
+// setRelayInput(localUrl) - play streams through the relay at localUrl from
+// the next play on; "" plays them directly
+Napi::Value SetRelayInput(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return env.Null();
+    }
+
+    std::string url;
+    if (info.Length() > 0 && info[0].IsString()) {
+        url = info[0].As<Napi::String>().Utf8Value();
+    }
+
+    globalPlayer->setRelayInput(url);
+    return env.Null();
+}
+
+// setNativeMulticast(enabled) - udp:// and rtp:// URLs opened from now on
+// use the native receiver instead of libvlc's access
+Napi::Value SetNativeMulticast(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    MulticastInput::setEnabled(info.Length() > 0 && info[0].ToBoolean().Value());
+    return env.Null();
+}
+
+static Napi::Value multicastStatsToObject(Napi::Env env, VlcPlayer* player) {
+    MulticastStats stats;
+    if (!player || !player->getMulticastStats(stats)) {
+        return env.Null();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("rtp", Napi::Boolean::New(env, stats.rtp));
+    result.Set("datagrams", Napi::Number::New(env, static_cast<double>(stats.datagrams)));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+    result.Set("batches", Napi::Number::New(env, static_cast<double>(stats.batches)));
+    result.Set("lost", Napi::Number::New(env, static_cast<double>(stats.lost)));
+    result.Set("reordered", Napi::Number::New(env, static_cast<double>(stats.reordered)));
+    result.Set("duplicates", Napi::Number::New(env, static_cast<double>(stats.duplicates)));
+    result.Set("late", Napi::Number::New(env, static_cast<double>(stats.late)));
+    result.Set("resyncs", Napi::Number::New(env, static_cast<double>(stats.resyncs)));
+    result.Set("malformed", Napi::Number::New(env, static_cast<double>(stats.malformed)));
+    result.Set("continuityErrors", Napi::Number::New(env, static_cast<double>(stats.continuityErrors)));
+    result.Set("overflows", Napi::Number::New(env, static_cast<double>(stats.overflows)));
+    result.Set("jitterMs", Napi::Number::New(env, stats.jitterMs));
+    result.Set("socketBuffer", Napi::Number::New(env, stats.socketBuffer));
+    return result;
+}
+
+// Receive statistics of the current channel, or null when it is not on
+// the native multicast input
+Napi::Value GetMulticastStats(const Napi::CallbackInfo& info) {
+    return multicastStatsToObject(info.Env(), globalPlayer);
+}
+
+// onStreamFailed(callback | null) - callback({ reason, detail, url, firstFrame })
+// when the playing stream fails after play() resolved: an HTTP error, a
+// refused connection or unknown host, no access or demuxer for it (seen in
+// libvlc's log within milliseconds) or libvlc's own error. A failure while
+// play() is still waiting makes play() resolve failed instead. "decoder"
+// may only concern a side track; check for pictures before giving up.
+Napi::Value OnStreamFailed(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::lock_guard<std::mutex> lock(streamFailedMutex);
+    if (streamFailedEvents) {
+        streamFailedEvents.Release();
+        streamFailedEvents = Napi::ThreadSafeFunction();
+    }
+    if (info.Length() > 0 && info[0].IsFunction()) {
+        streamFailedEvents = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "streamFailed", 0, 1);
+        streamFailedEvents.Unref(env);
+    }
+    return env.Null();
+}
+
+// { program?, audioTrack?, captions? } - which streams a recording keeps.
+// Anything but an object records the whole multiplex.
+static TsPidSelection parsePidSelection(const Napi::Value& value) {
+    TsPidSelection pids;
+    if (!value.IsObject()) {
+        return pids;
+    }
+
+    Napi::Object options = value.As<Napi::Object>();
+    pids.enabled = true;
+    if (options.Get("program").IsNumber()) {
+        pids.programNumber = static_cast<uint16_t>(options.Get("program").As<Napi::Number>().Uint32Value());
+    }
+    if (options.Get("audioTrack").IsNumber()) {
+        pids.audioTrack = options.Get("audioTrack").As<Napi::Number>().Int32Value();
+    }
+    if (options.Get("captions").IsBoolean()) {
+        pids.captions = options.Get("captions").As<Napi::Boolean>().Value();
+    }
+    return pids;
+}
+
+// startRecording(filePath, pids?) - see parsePidSelection
+Napi::Value StartRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "File path string expected").ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+
+    std::string filePath = info[0].As<Napi::String>().Utf8Value();
+    TsPidSelection pids = info.Length() > 1 ? parsePidSelection(info[1]) : TsPidSelection();
+    bool success = globalPlayer->startRecording(filePath, pids);
+    
+    return Napi::Boolean::New(env, success);
+}
+
+Napi::Value StopRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    bool success = globalPlayer->stopRecording();
+    return Napi::Boolean::New(env, success);
+}
+
+Napi::Value IsRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return Napi::Boolean::New(env, false);
     }
 
     bool recording = globalPlayer->getIsRecording();
@@ -721,26 +807,1770 @@ Napi::Value GetRecordingPath(const Napi::CallbackInfo& info) {
     return Napi::String::New(env, path);
 }
 
+Napi::Value StartMetrics(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    int port = 0;
+    std::string filePath;
+    int intervalMs = 15000;
+
+    if (options.Has("port") && options.Get("port").IsNumber()) {
+        port = options.Get("port").As<Napi::Number>().Int32Value();
+    }
+    if (options.Has("filePath") && options.Get("filePath").IsString()) {
+        filePath = options.Get("filePath").As<Napi::String>().Utf8Value();
+    }
+    if (options.Has("intervalMs") && options.Get("intervalMs").IsNumber()) {
+        intervalMs = options.Get("intervalMs").As<Napi::Number>().Int32Value();
+    }
+
+    if (port < 0 || port > 65535) {
+        Napi::RangeError::New(env, "Port must be between 0 and 65535").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!metricsExporter) {
+        metricsExporter = new MetricsExporter();
+    }
+
+    bool success = metricsExporter->start(port, filePath, intervalMs);
+    return Napi::Boolean::New(env, success);
+}
+
+Napi::Value StopMetrics(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (metricsExporter) {
+        metricsExporter->stop();
+    }
+    return env.Null();
+}
+
+Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    return Napi::String::New(env, MetricsRegistry::instance().render());
+}
+
+Napi::Value LogOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("dir") || !options.Get("dir").IsString()) {
+        Napi::TypeError::New(env, "Log directory expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string dir = options.Get("dir").As<Napi::String>().Utf8Value();
+    std::string baseName = "vlc-player";
+    int64_t maxSize = 0;
+    int maxFiles = 0;
+
+    if (options.Has("baseName") && options.Get("baseName").IsString()) {
+        baseName = options.Get("baseName").As<Napi::String>().Utf8Value();
+    }
+    if (options.Has("maxSize") && options.Get("maxSize").IsNumber()) {
+        maxSize = options.Get("maxSize").As<Napi::Number>().Int64Value();
+    }
+    if (options.Has("maxFiles") && options.Get("maxFiles").IsNumber()) {
+        maxFiles = options.Get("maxFiles").As<Napi::Number>().Int32Value();
+    }
+
+    bool success = NativeLog::instance().open(dir, baseName, maxSize > 0 ? static_cast<uint64_t>(maxSize) : 0, maxFiles);
+    return Napi::Boolean::New(env, success);
+}
+
+Napi::Value LogDefine(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Message string expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string message = info[0].As<Napi::String>().Utf8Value();
+    std::vector<std::string> argNames;
+    if (info.Length() > 1 && info[1].IsArray()) {
+        Napi::Array names = info[1].As<Napi::Array>();
+        for (uint32_t i = 0; i < names.Length() && i < NativeLog::MAX_ARGS; i++) {
+            argNames.push_back(names.Get(i).ToString().Utf8Value());
+        }
+    }
+
+    return Napi::Number::New(env, NativeLog::instance().defineEvent(message, argNames));
+}
+
+// logEvent(level, eventId, text, ...numbers) - returns immediately
+Napi::Value LogEvent(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Level and event id expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int level = info[0].As<Napi::Number>().Int32Value();
+    if (level < 0 || level > static_cast<int>(LogLevel::Error)) {
+        level = static_cast<int>(LogLevel::Info);
+    }
+    uint32_t eventId = info[1].As<Napi::Number>().Uint32Value();
+
+    std::string text;
+    if (info.Length() > 2 && info[2].IsString()) {
+        text = info[2].As<Napi::String>().Utf8Value();
+    }
+
+    double args[NativeLog::MAX_ARGS];
+    int argCount = 0;
+    for (size_t i = 3; i < info.Length() && argCount < NativeLog::MAX_ARGS; i++) {
+        args[argCount++] = info[i].IsNumber() ? info[i].As<Napi::Number>().DoubleValue() : 0.0;
+    }
+
+    NativeLog::instance().write(static_cast<LogLevel>(level), static_cast<uint16_t>(eventId),
+                                args, argCount, text.data(), text.size());
+    return env.Null();
+}
+
+Napi::Value LogClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    NativeLog::instance().close();
+    return env.Null();
+}
+
+// journalOpen({ dir, retentionDays })
+Napi::Value JournalOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("dir") || !options.Get("dir").IsString()) {
+        Napi::TypeError::New(env, "Journal directory expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string dir = options.Get("dir").As<Napi::String>().Utf8Value();
+    int retentionDays = 0;
+    if (options.Has("retentionDays") && options.Get("retentionDays").IsNumber()) {
+        retentionDays = options.Get("retentionDays").As<Napi::Number>().Int32Value();
+    }
+
+    return Napi::Boolean::New(env, SessionJournal::instance().open(dir, retentionDays));
+}
+
+Napi::Value JournalSetChannel(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!globalPlayer) {
+        return env.Null();
+    }
+
+    std::string channel;
+    if (info.Length() > 0 && info[0].IsString()) {
+        channel = info[0].As<Napi::String>().Utf8Value();
+    }
+
+    globalPlayer->setJournalChannel(channel);
+    return env.Null();
+}
+
+static void setMirrorFields(Napi::Object obj, const JournalMirrorStats& stats) {
+    Napi::Env env = obj.Env();
+    obj.Set("zaps", Napi::Number::New(env, static_cast<double>(stats.zaps)));
+    obj.Set("zapFailures", Napi::Number::New(env, static_cast<double>(stats.zapFailures)));
+    obj.Set("availability", Napi::Number::New(env, stats.availability()));
+    obj.Set("meanZapMs", Napi::Number::New(env, stats.meanZapMs()));
+    obj.Set("stalls", Napi::Number::New(env, static_cast<double>(stats.stalls)));
+    obj.Set("stallMinutes", Napi::Number::New(env, stats.stallMs / 60000.0));
+    obj.Set("watchSeconds", Napi::Number::New(env, stats.watchSeconds));
+    obj.Set("meanBitrateKbps", Napi::Number::New(env, stats.meanBitrateKbps()));
+}
+
+// Scans the day files off the JS thread; a year of history is a few MB
+class JournalQueryWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    int64_t fromMs;
+    int64_t toMs;
+    std::vector<JournalChannelStats> result;
+
+public:
+    JournalQueryWorker(Napi::Env env, int64_t from, int64_t to)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), fromMs(from), toMs(to) {}
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    void Execute() override {
+        result = SessionJournal::instance().query(fromMs, toMs);
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Array channels = Napi::Array::New(env, result.size());
+
+        for (size_t i = 0; i < result.size(); i++) {
+            const JournalChannelStats& stats = result[i];
+            Napi::Object channel = Napi::Object::New(env);
+            channel.Set("channel", Napi::String::New(env, stats.channel));
+            channel.Set("sessions", Napi::Number::New(env, static_cast<double>(stats.sessions)));
+            setMirrorFields(channel, stats);
+
+            Napi::Array mirrors = Napi::Array::New(env, stats.mirrors.size());
+            for (size_t m = 0; m < stats.mirrors.size(); m++) {
+                Napi::Object mirror = Napi::Object::New(env);
+                mirror.Set("url", Napi::String::New(env, stats.mirrors[m].url));
+                setMirrorFields(mirror, stats.mirrors[m]);
+                mirrors.Set(static_cast<uint32_t>(m), mirror);
+            }
+            channel.Set("mirrors", mirrors);
+
+            channels.Set(static_cast<uint32_t>(i), channel);
+        }
+
+        deferred.Resolve(channels);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+};
+
+// journalQuery(fromMs, toMs) - resolves with per-channel aggregates
+Napi::Value JournalQuery(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Time range expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int64_t fromMs = info[0].As<Napi::Number>().Int64Value();
+    int64_t toMs = info[1].As<Napi::Number>().Int64Value();
+
+    JournalQueryWorker* worker = new JournalQueryWorker(env, fromMs, toMs);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+Napi::Value JournalClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    SessionJournal::instance().close();
+    return env.Null();
+}
+
+// reliabilityOpen({ filePath, halfLifeDays })
+Napi::Value ReliabilityOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("filePath") || !options.Get("filePath").IsString()) {
+        Napi::TypeError::New(env, "Reliability file path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string filePath = options.Get("filePath").As<Napi::String>().Utf8Value();
+    double halfLifeDays = 0;
+    if (options.Has("halfLifeDays") && options.Get("halfLifeDays").IsNumber()) {
+        halfLifeDays = options.Get("halfLifeDays").As<Napi::Number>().DoubleValue();
+    }
+
+    return Napi::Boolean::New(env, ReliabilityStore::instance().open(filePath, halfLifeDays));
+}
+
+// reliabilityRank(urls) - returns the same URLs, most reliable first
+Napi::Value ReliabilityRank(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "URL array expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Array input = info[0].As<Napi::Array>();
+    std::vector<std::string> urls;
+    urls.reserve(input.Length());
+    for (uint32_t i = 0; i < input.Length(); i++) {
+        urls.push_back(input.Get(i).ToString().Utf8Value());
+    }
+
+    std::vector<std::string> ordered = ReliabilityStore::instance().rank(urls);
+    Napi::Array result = Napi::Array::New(env, ordered.size());
+    for (size_t i = 0; i < ordered.size(); i++) {
+        result.Set(static_cast<uint32_t>(i), Napi::String::New(env, ordered[i]));
+    }
+    return result;
+}
+
+Napi::Value ReliabilityClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    ReliabilityStore::instance().close();
+    return env.Null();
+}
+
+// scheduleOpen({ filePath, recordingsPath })
+Napi::Value ScheduleOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("filePath") || !options.Get("filePath").IsString() ||
+        !options.Has("recordingsPath") || !options.Get("recordingsPath").IsString()) {
+        Napi::TypeError::New(env, "Schedule file and recordings paths expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string filePath = options.Get("filePath").As<Napi::String>().Utf8Value();
+    std::string recordingsPath = options.Get("recordingsPath").As<Napi::String>().Utf8Value();
+    return Napi::Boolean::New(env, RecordingScheduler::instance().open(filePath, recordingsPath));
+}
+
+// scheduleSetChannels([{ id, name, urls, pids? }])
+Napi::Value ScheduleSetChannels(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "Channel array expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Array input = info[0].As<Napi::Array>();
+    for (uint32_t i = 0; i < input.Length(); i++) {
+        Napi::Value item = input.Get(i);
+        if (!item.IsObject()) continue;
+        Napi::Object channel = item.As<Napi::Object>();
+        if (!channel.Get("id").IsString()) continue;
+
+        std::vector<std::string> urls;
+        if (channel.Get("urls").IsArray()) {
+            Napi::Array list = channel.Get("urls").As<Napi::Array>();
+            for (uint32_t j = 0; j < list.Length(); j++) {
+                urls.push_back(list.Get(j).ToString().Utf8Value());
+            }
+        }
+        std::string name = channel.Get("name").IsString() ? channel.Get("name").As<Napi::String>().Utf8Value() : "";
+        RecordingScheduler::instance().setChannel(channel.Get("id").As<Napi::String>().Utf8Value(), name, urls,
+                                                  parsePidSelection(channel.Get("pids")));
+    }
+    return env.Null();
+}
+
+// scheduleUpdateEpg(channelId, [{ title, start, stop }]) - times in ms
+Napi::Value ScheduleUpdateEpg(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsArray()) {
+        Napi::TypeError::New(env, "Channel id and programme array expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Array input = info[1].As<Napi::Array>();
+    std::vector<ScheduleProgramme> programmes;
+    programmes.reserve(input.Length());
+    for (uint32_t i = 0; i < input.Length(); i++) {
+        Napi::Value item = input.Get(i);
+        if (!item.IsObject()) continue;
+        Napi::Object entry = item.As<Napi::Object>();
+        if (!entry.Get("start").IsNumber() || !entry.Get("stop").IsNumber()) continue;
+
+        ScheduleProgramme programme;
+        programme.title = entry.Get("title").IsString() ? entry.Get("title").As<Napi::String>().Utf8Value() : "";
+        programme.startMs = entry.Get("start").As<Napi::Number>().Int64Value();
+        programme.stopMs = entry.Get("stop").As<Napi::Number>().Int64Value();
+        programmes.push_back(std::move(programme));
+    }
+
+    RecordingScheduler::instance().updateProgrammes(info[0].As<Napi::String>().Utf8Value(), programmes);
+    return env.Null();
+}
+
+static const char* scheduleKindName(ScheduleRuleKind kind) {
+    switch (kind) {
+        case ScheduleRuleKind::Series: return "series";
+        case ScheduleRuleKind::Slot: return "slot";
+        case ScheduleRuleKind::Once: return "once";
+    }
+    return "series";
+}
+
+// scheduleAddRule({ id?, kind, enabled?, channelId?, title?, start?, stop?,
+//                   weekdays?, slotMinute?, durationMin?, prePadSec?, postPadSec? })
+// - returns the rule id, 0 if the rule was rejected
+Napi::Value ScheduleAddRule(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Rule object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    std::string kind = options.Get("kind").IsString() ? options.Get("kind").As<Napi::String>().Utf8Value() : "";
+    ScheduleRule rule;
+    if (kind == "series") {
+        rule.kind = ScheduleRuleKind::Series;
+    } else if (kind == "slot") {
+        rule.kind = ScheduleRuleKind::Slot;
+    } else if (kind == "once") {
+        rule.kind = ScheduleRuleKind::Once;
+    } else {
+        Napi::TypeError::New(env, "Rule kind must be series, slot or once").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto number = [&options](const char* name, double fallback) {
+        Napi::Value value = options.Get(name);
+        return value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : fallback;
+    };
+    rule.id = static_cast<uint32_t>(number("id", 0));
+    rule.enabled = !options.Get("enabled").IsBoolean() || options.Get("enabled").As<Napi::Boolean>().Value();
+    if (options.Get("channelId").IsString()) rule.channelId = options.Get("channelId").As<Napi::String>().Utf8Value();
+    if (options.Get("title").IsString()) rule.title = options.Get("title").As<Napi::String>().Utf8Value();
+    rule.startMs = static_cast<int64_t>(number("start", 0));
+    rule.stopMs = static_cast<int64_t>(number("stop", 0));
+    rule.weekdays = static_cast<uint8_t>(static_cast<int>(number("weekdays", 0)) & 0x7F);
+    rule.slotMinute = static_cast<int32_t>(number("slotMinute", 0));
+    rule.durationMin = static_cast<int32_t>(number("durationMin", 0));
+    rule.prePadSec = static_cast<int32_t>(number("prePadSec", rule.prePadSec));
+    rule.postPadSec = static_cast<int32_t>(number("postPadSec", rule.postPadSec));
+
+    return Napi::Number::New(env, RecordingScheduler::instance().putRule(std::move(rule)));
+}
+
+Napi::Value ScheduleRemoveRule(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Rule id expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+    return Napi::Boolean::New(env, RecordingScheduler::instance().removeRule(id));
+}
+
+// scheduleList() - { rules, jobs }; jobs are upcoming and running ones by
+// start time, then recently finished ones newest first
+Napi::Value ScheduleList(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<ScheduleRule> rules = RecordingScheduler::instance().listRules();
+    Napi::Array ruleArray = Napi::Array::New(env, rules.size());
+    for (size_t i = 0; i < rules.size(); i++) {
+        const ScheduleRule& rule = rules[i];
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("id", Napi::Number::New(env, rule.id));
+        obj.Set("kind", Napi::String::New(env, scheduleKindName(rule.kind)));
+        obj.Set("enabled", Napi::Boolean::New(env, rule.enabled));
+        obj.Set("channelId", Napi::String::New(env, rule.channelId));
+        obj.Set("title", Napi::String::New(env, rule.title));
+        obj.Set("start", Napi::Number::New(env, static_cast<double>(rule.startMs)));
+        obj.Set("stop", Napi::Number::New(env, static_cast<double>(rule.stopMs)));
+        obj.Set("weekdays", Napi::Number::New(env, rule.weekdays));
+        obj.Set("slotMinute", Napi::Number::New(env, rule.slotMinute));
+        obj.Set("durationMin", Napi::Number::New(env, rule.durationMin));
+        obj.Set("prePadSec", Napi::Number::New(env, rule.prePadSec));
+        obj.Set("postPadSec", Napi::Number::New(env, rule.postPadSec));
+        ruleArray.Set(static_cast<uint32_t>(i), obj);
+    }
+
+    std::vector<RecordingJobInfo> jobs = RecordingScheduler::instance().listJobs();
+    Napi::Array jobArray = Napi::Array::New(env, jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const RecordingJobInfo& job = jobs[i];
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("id", Napi::Number::New(env, static_cast<double>(job.id)));
+        obj.Set("ruleId", Napi::Number::New(env, job.ruleId));
+        obj.Set("channelId", Napi::String::New(env, job.channelId));
+        obj.Set("title", Napi::String::New(env, job.title));
+        obj.Set("start", Napi::Number::New(env, static_cast<double>(job.startMs)));
+        obj.Set("stop", Napi::Number::New(env, static_cast<double>(job.stopMs)));
+        obj.Set("state", Napi::String::New(env, recordingJobStateName(job.state)));
+        obj.Set("filePath", Napi::String::New(env, job.filePath));
+        obj.Set("parts", Napi::Number::New(env, job.parts));
+        jobArray.Set(static_cast<uint32_t>(i), obj);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("rules", ruleArray);
+    result.Set("jobs", jobArray);
+    return result;
+}
+
+Napi::Value ScheduleClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RecordingScheduler::instance().close();
+    return env.Null();
+}
+
+// Remux events reach JS through one thread-safe function, held while the
+// queue runs; unreferenced so it never keeps the app alive
+static Napi::ThreadSafeFunction remuxEvents;
+
+static Napi::Object remuxJobToObject(Napi::Env env, const RemuxJobInfo& job) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("id", Napi::Number::New(env, job.id));
+    obj.Set("inputPath", Napi::String::New(env, job.inputPath));
+    obj.Set("outputPath", Napi::String::New(env, job.outputPath));
+    obj.Set("state", Napi::String::New(env, remuxStateName(job.state)));
+    obj.Set("progress", Napi::Number::New(env, job.progress));
+    obj.Set("deleteSource", Napi::Boolean::New(env, job.deleteSource));
+    if (!job.error.empty()) {
+        obj.Set("error", Napi::String::New(env, job.error));
+    }
+    return obj;
+}
+
+static double numberOption(const Napi::Object& options, const char* name, double fallback) {
+    return options.Has(name) && options.Get(name).IsNumber()
+        ? options.Get(name).As<Napi::Number>().DoubleValue() : fallback;
+}
+
+static bool boolOption(const Napi::Object& options, const char* name, bool fallback) {
+    return options.Has(name) && options.Get(name).IsBoolean()
+        ? options.Get(name).As<Napi::Boolean>().Value() : fallback;
+}
+
+class ScanRecordingWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    std::string path;
+    bool repair;
+    bool writeIndex;
+    TsScanReport report;
+
+public:
+    ScanRecordingWorker(Napi::Env env, const std::string& filePath, bool repairTail, bool index)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), path(filePath),
+          repair(repairTail), writeIndex(index) {}
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    void Execute() override {
+        std::atomic<uint64_t> scanned{0};
+        std::atomic<bool> cancelled{false};
+        report = TsScanner::scan(path, repair, writeIndex, scanned, cancelled);
+        if (!report.ok) return;
+
+        uint64_t truncatedBytes = report.truncated ? report.fileSize - report.validEnd : 0;
+        if (truncatedBytes) {
+            PlayerMetrics::get().recordingRepairs.inc();
+        }
+        NativeLog::instance().write(report.syncErrors || truncatedBytes ? LogLevel::Warn : LogLevel::Info,
+                                    LOG_EVENT_RECORDING_SCANNED,
+                                    {static_cast<double>(report.syncErrors), static_cast<double>(report.continuityErrors),
+                                     static_cast<double>(truncatedBytes), report.elapsedMs / 1000},
+                                    NativeLog::jsonField("file", path));
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("ok", Napi::Boolean::New(env, report.ok));
+        if (!report.error.empty()) {
+            result.Set("error", Napi::String::New(env, report.error));
+        }
+        result.Set("fileSize", Napi::Number::New(env, static_cast<double>(report.fileSize)));
+        result.Set("packets", Napi::Number::New(env, static_cast<double>(report.packets)));
+        result.Set("syncErrors", Napi::Number::New(env, static_cast<double>(report.syncErrors)));
+        result.Set("droppedBytes", Napi::Number::New(env, static_cast<double>(report.droppedBytes)));
+        result.Set("continuityErrors", Napi::Number::New(env, static_cast<double>(report.continuityErrors)));
+        result.Set("errorPackets", Napi::Number::New(env, static_cast<double>(report.errorPackets)));
+        result.Set("validEnd", Napi::Number::New(env, static_cast<double>(report.validEnd)));
+        result.Set("truncated", Napi::Boolean::New(env, report.truncated));
+        result.Set("durationMs", Napi::Number::New(env, report.durationMs));
+        result.Set("indexEntries", Napi::Number::New(env, report.indexEntries));
+        result.Set("threads", Napi::Number::New(env, report.threads));
+        result.Set("elapsedMs", Napi::Number::New(env, report.elapsedMs));
+        deferred.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+};
+
+// scanRecording(filePath, { repair?, index? }) - checks a .ts recording on
+// worker threads. repair truncates a torn last packet (only when nothing
+// else has the file open); index (default true) writes "<filePath>.idx".
+// Resolves with the report.
+Napi::Value ScanRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "File path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    bool repair = false;
+    bool index = true;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object options = info[1].As<Napi::Object>();
+        repair = boolOption(options, "repair", repair);
+        index = boolOption(options, "index", index);
+    }
+
+    ScanRecordingWorker* worker = new ScanRecordingWorker(env, info[0].As<Napi::String>().Utf8Value(), repair, index);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+class BuildPreviewsWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    std::string path;
+    PreviewStripOptions options;
+    PreviewStripReport report;
+
+public:
+    BuildPreviewsWorker(Napi::Env env, const std::string& filePath, const PreviewStripOptions& stripOptions)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), path(filePath),
+          options(stripOptions) {}
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    void Execute() override {
+        // The pool thread goes back to normal priority for the next task
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        std::atomic<uint32_t> built{0};
+        std::atomic<bool> cancelled{false};
+        report = PreviewStrip::build(path, options, built, cancelled);
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        if (!report.ok) return;
+
+        PlayerMetrics::get().previewStrips.inc();
+        NativeLog::instance().write(LogLevel::Info, LOG_EVENT_PREVIEWS_BUILT,
+                                    {static_cast<double>(report.count), static_cast<double>(report.missing),
+                                     report.elapsedMs / 1000},
+                                    NativeLog::jsonField("file", path));
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("ok", Napi::Boolean::New(env, report.ok));
+        if (!report.error.empty()) {
+            result.Set("error", Napi::String::New(env, report.error));
+        }
+        result.Set("count", Napi::Number::New(env, report.count));
+        result.Set("missing", Napi::Number::New(env, report.missing));
+        result.Set("elapsedMs", Napi::Number::New(env, report.elapsedMs));
+        deferred.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+};
+
+// buildPreviews(filePath, { intervalSec?, width?, height? }) - writes the
+// scrub-preview strip "<filePath>.thumbs" at background priority. Needs the
+// seek index a scanRecording wrote. Resolves with { ok, error?, count,
+// missing, elapsedMs }.
+Napi::Value BuildPreviews(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "File path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    PreviewStripOptions options;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object object = info[1].As<Napi::Object>();
+        options.intervalMs = static_cast<uint32_t>(
+            std::max(1.0, numberOption(object, "intervalSec", options.intervalMs / 1000.0)) * 1000);
+        options.width = static_cast<uint16_t>(std::max(16.0, std::min(640.0, numberOption(object, "width", options.width))));
+        options.height = static_cast<uint16_t>(std::max(9.0, std::min(360.0, numberOption(object, "height", options.height))));
+    }
+
+    BuildPreviewsWorker* worker = new BuildPreviewsWorker(env, info[0].As<Napi::String>().Utf8Value(), options);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// readPreview(filePath, timeMs) - the strip's thumbnail for that time as
+// { width, height, data } with data a BGRA Buffer, or null without a strip
+Napi::Value ReadPreview(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "File path and time expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    double timeMs = std::max(0.0, std::min(info[1].As<Napi::Number>().DoubleValue(), 4294967295.0));
+    std::vector<uint8_t> bgra;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    if (!PreviewStrip::read(info[0].As<Napi::String>().Utf8Value(), static_cast<uint32_t>(timeMs), bgra, width, height)) {
+        return env.Null();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("width", Napi::Number::New(env, width));
+    result.Set("height", Napi::Number::New(env, height));
+    result.Set("data", Napi::Buffer<uint8_t>::Copy(env, bgra.data(), bgra.size()));
+    return result;
+}
+
+class AnalyzeRecordingsWorker : public Napi::AsyncWorker {
+private:
+    Napi::Promise::Deferred deferred;
+    std::vector<std::string> paths;
+    unsigned threads;
+    std::vector<ChapterReport> reports;
+
+public:
+    AnalyzeRecordingsWorker(Napi::Env env, std::vector<std::string> filePaths, unsigned threadCount)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), paths(std::move(filePaths)),
+          threads(threadCount) {}
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    void Execute() override {
+        std::atomic<bool> cancelled{false};
+        reports = ChapterAnalyzer::analyzeAll(paths, threads, cancelled);
+        for (const ChapterReport& report : reports) {
+            if (!report.ok) continue;
+            size_t breaks = std::count_if(report.markers.begin(), report.markers.end(),
+                                          [](const TsSeekIndex::Marker& marker) {
+                                              return marker.kind == TsSeekIndex::MARKER_BREAK;
+                                          });
+            PlayerMetrics::get().chapterAnalyses.inc();
+            NativeLog::instance().write(LogLevel::Info, LOG_EVENT_RECORDING_ANALYSED,
+                                        {static_cast<double>(report.markers.size()), static_cast<double>(breaks),
+                                         report.elapsedMs > 0 ? report.mediaMs / report.elapsedMs : 0},
+                                        NativeLog::jsonField("file", report.path));
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Array result = Napi::Array::New(env, reports.size());
+        for (size_t i = 0; i < reports.size(); i++) {
+            const ChapterReport& report = reports[i];
+            Napi::Object item = Napi::Object::New(env);
+            item.Set("path", Napi::String::New(env, report.path));
+            item.Set("ok", Napi::Boolean::New(env, report.ok));
+            if (!report.error.empty()) {
+                item.Set("error", Napi::String::New(env, report.error));
+            }
+            item.Set("markers", Napi::Number::New(env, static_cast<double>(report.markers.size())));
+            item.Set("keyframes", Napi::Number::New(env, report.keyframes));
+            item.Set("blackFrames", Napi::Number::New(env, report.blackFrames));
+            item.Set("elapsedMs", Napi::Number::New(env, report.elapsedMs));
+            item.Set("speed", Napi::Number::New(env, report.elapsedMs > 0 ? report.mediaMs / report.elapsedMs : 0));
+            result.Set(static_cast<uint32_t>(i), item);
+        }
+        deferred.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+};
+
+// analyzeRecordings(filePaths, { threads? }) - finds black frames, silences
+// and breaks in finished recordings and stores them in each one's seek
+// index (which scanRecording must have written). One decoder per thread;
+// threads default to 2. Resolves with [{ path, ok, error?, markers,
+// keyframes, blackFrames, elapsedMs, speed }], speed being media time per
+// wall time.
+Napi::Value AnalyzeRecordings(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "File paths expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Array array = info[0].As<Napi::Array>();
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < array.Length(); i++) {
+        Napi::Value value = array.Get(i);
+        if (value.IsString()) paths.push_back(value.As<Napi::String>().Utf8Value());
+    }
+    double threads = 2;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        threads = numberOption(info[1].As<Napi::Object>(), "threads", threads);
+    }
+
+    AnalyzeRecordingsWorker* worker = new AnalyzeRecordingsWorker(env, std::move(paths),
+                                                                  static_cast<unsigned>(std::max(1.0, threads)));
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
+// readChapters(filePath) - [{ startMs, endMs, kind }] with kind 'black',
+// 'silence' or 'break', or null if the recording was never analysed
+Napi::Value ReadChapters(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "File path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    TsSeekIndex index;
+    if (!TsScanner::loadIndex(info[0].As<Napi::String>().Utf8Value(), index) || !index.analysed) {
+        return env.Null();
+    }
+
+    Napi::Array result = Napi::Array::New(env, index.markers.size());
+    for (size_t i = 0; i < index.markers.size(); i++) {
+        const TsSeekIndex::Marker& marker = index.markers[i];
+        Napi::Object item = Napi::Object::New(env);
+        item.Set("startMs", Napi::Number::New(env, marker.startMs));
+        item.Set("endMs", Napi::Number::New(env, marker.endMs));
+        const char* kind = marker.kind == TsSeekIndex::MARKER_BREAK ? "break" :
+                           marker.kind == TsSeekIndex::MARKER_SILENCE ? "silence" : "black";
+        item.Set("kind", Napi::String::New(env, kind));
+        result.Set(static_cast<uint32_t>(i), item);
+    }
+    return result;
+}
+
+// remuxOpen({ onEvent, workers?, bytesPerSecond?, recordings?, deleteSource? })
+// onEvent(job) fires on every state change and each percent of progress.
+// recordings: queue every finished recording automatically.
+Napi::Value RemuxOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("onEvent") || !options.Get("onEvent").IsFunction()) {
+        Napi::TypeError::New(env, "onEvent callback expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    RemuxQueue& queue = RemuxQueue::instance();
+    double bytesPerSecond = numberOption(options, "bytesPerSecond", 0);
+    queue.configure(boolOption(options, "recordings", false), boolOption(options, "deleteSource", false),
+                    bytesPerSecond);
+    if (remuxEvents) {
+        return Napi::Boolean::New(env, true);
+    }
+
+    remuxEvents = Napi::ThreadSafeFunction::New(env, options.Get("onEvent").As<Napi::Function>(), "remuxEvents", 0, 1);
+    remuxEvents.Unref(env);
+    Napi::ThreadSafeFunction events = remuxEvents;
+    bool started = queue.start(static_cast<int>(numberOption(options, "workers", 1)), bytesPerSecond,
+        [events](const RemuxJobInfo& job) {
+            RemuxJobInfo* copy = new RemuxJobInfo(job);
+            auto deliver = [](Napi::Env jsEnv, Napi::Function callback, RemuxJobInfo* data) {
+                callback.Call({remuxJobToObject(jsEnv, *data)});
+                delete data;
+            };
+            if (events.NonBlockingCall(copy, deliver) != napi_ok) {
+                delete copy;
+            }
+        });
+    return Napi::Boolean::New(env, started);
+}
+
+// remuxConfigure({ recordings?, deleteSource?, bytesPerSecond? })
+Napi::Value RemuxConfigure(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    RemuxQueue::instance().configure(boolOption(options, "recordings", false), boolOption(options, "deleteSource", false),
+                                     numberOption(options, "bytesPerSecond", 0));
+    return env.Null();
+}
+
+// remuxEnqueue(inputPath, outputPath?, deleteSource?) - job id, 0 if closed
+Napi::Value RemuxEnqueue(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Input path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    std::string inputPath = info[0].As<Napi::String>().Utf8Value();
+    std::string outputPath = info.Length() > 1 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "";
+    bool deleteSource = info.Length() > 2 && info[2].IsBoolean() && info[2].As<Napi::Boolean>().Value();
+    return Napi::Number::New(env, RemuxQueue::instance().enqueue(inputPath, outputPath, deleteSource));
+}
+
+Napi::Value RemuxCancel(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Job id expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+    return Napi::Boolean::New(env, RemuxQueue::instance().cancel(id));
+}
+
+// remuxList() - running and queued jobs in order, then recent finished ones
+Napi::Value RemuxList(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<RemuxJobInfo> jobs = RemuxQueue::instance().list();
+    Napi::Array result = Napi::Array::New(env, jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        result.Set(static_cast<uint32_t>(i), remuxJobToObject(env, jobs[i]));
+    }
+    return result;
+}
+
+// Cancels running remuxes; call before quitting
+Napi::Value RemuxClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RemuxQueue::instance().stop();
+    if (remuxEvents) {
+        remuxEvents.Release();
+        remuxEvents = Napi::ThreadSafeFunction();
+    }
+    return env.Null();
+}
+
+static StoragePolicy storagePolicy(const Napi::Object& options) {
+    StoragePolicy policy;
+    policy.quotaBytes = static_cast<uint64_t>(std::max(0.0, numberOption(options, "quotaBytes", 0)));
+    policy.minFreeBytes = static_cast<uint64_t>(std::max(0.0, numberOption(options, "minFreeBytes", 0)));
+    policy.unlinksPerSecond = numberOption(options, "unlinksPerSecond", policy.unlinksPerSecond);
+    return policy;
+}
+
+// storageOpen(recordingsPath, { quotaBytes?, minFreeBytes?, unlinksPerSecond? })
+// Indexes the recordings tree and evicts the oldest recordings whenever
+// it exceeds quotaBytes or the volume has less than minFreeBytes free.
+// 0 disables a limit.
+Napi::Value StorageOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Recordings path expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    std::string root = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object options = info.Length() > 1 && info[1].IsObject() ? info[1].As<Napi::Object>() : Napi::Object::New(env);
+    return Napi::Boolean::New(env, RecordingStorage::instance().open(root, storagePolicy(options)));
+}
+
+Napi::Value StorageConfigure(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    RecordingStorage::instance().configure(storagePolicy(info[0].As<Napi::Object>()));
+    return env.Null();
+}
+
+// storageSetProtected(paths) - recordings never evicted; replaces the set
+Napi::Value StorageSetProtected(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "Path array expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Array array = info[0].As<Napi::Array>();
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < array.Length(); i++) {
+        Napi::Value value = array.Get(i);
+        if (value.IsString()) paths.push_back(value.As<Napi::String>().Utf8Value());
+    }
+    RecordingStorage::instance().setProtected(paths);
+    return env.Null();
+}
+
+Napi::Value StorageStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    RecordingStorageStats stats = RecordingStorage::instance().stats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("usedBytes", Napi::Number::New(env, static_cast<double>(stats.usedBytes)));
+    result.Set("files", Napi::Number::New(env, static_cast<double>(stats.files)));
+    result.Set("freeBytes", Napi::Number::New(env, static_cast<double>(stats.freeBytes)));
+    result.Set("totalBytes", Napi::Number::New(env, static_cast<double>(stats.totalBytes)));
+    result.Set("evictedFiles", Napi::Number::New(env, static_cast<double>(stats.evictedFiles)));
+    result.Set("evictedBytes", Napi::Number::New(env, static_cast<double>(stats.evictedBytes)));
+    result.Set("watching", Napi::Boolean::New(env, stats.watching));
+    return result;
+}
+
+// storageList() - recordings oldest first, the order they would be evicted in
+Napi::Value StorageList(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<StoredRecording> recordings = RecordingStorage::instance().list();
+    Napi::Array result = Napi::Array::New(env, recordings.size());
+    for (size_t i = 0; i < recordings.size(); i++) {
+        Napi::Object item = Napi::Object::New(env);
+        item.Set("path", Napi::String::New(env, recordings[i].path));
+        item.Set("bytes", Napi::Number::New(env, static_cast<double>(recordings[i].bytes)));
+        item.Set("modified", Napi::Number::New(env, static_cast<double>(recordings[i].modifiedMs)));
+        item.Set("protected", Napi::Boolean::New(env, recordings[i].isProtected));
+        result.Set(static_cast<uint32_t>(i), item);
+    }
+    return result;
+}
+
+Napi::Value StorageClose(const Napi::CallbackInfo& info) {
+    RecordingStorage::instance().close();
+    return info.Env().Null();
+}
+
+// Archive events reach JS like remux events
+static Napi::ThreadSafeFunction archiveEvents;
+
+static Napi::Object archiveJobToObject(Napi::Env env, const ArchiveJobInfo& job) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("path", Napi::String::New(env, job.path));
+    obj.Set("state", Napi::String::New(env, archiveStateName(job.state)));
+    obj.Set("progress", Napi::Number::New(env, job.progress));
+    obj.Set("sourceBytes", Napi::Number::New(env, static_cast<double>(job.sourceBytes)));
+    obj.Set("outputBytes", Napi::Number::New(env, static_cast<double>(job.outputBytes)));
+    if (!job.error.empty()) {
+        obj.Set("error", Napi::String::New(env, job.error));
+    }
+    return obj;
+}
+
+static ArchiveSettings archiveSettings(const Napi::Object& options) {
+    ArchiveSettings settings;
+    settings.afterDays = static_cast<uint32_t>(std::max(0.0, std::min(3650.0, numberOption(options, "afterDays", 0))));
+    settings.videoKbps = static_cast<uint32_t>(
+        std::max(250.0, std::min(20000.0, numberOption(options, "videoKbps", settings.videoKbps))));
+    settings.audioKbps = static_cast<uint32_t>(
+        std::max(32.0, std::min(320.0, numberOption(options, "audioKbps", settings.audioKbps))));
+    settings.maxHeight = static_cast<uint32_t>(
+        std::max(144.0, std::min(2160.0, numberOption(options, "maxHeight", settings.maxHeight))));
+    return settings;
+}
+
+// archiveOpen({ onEvent, afterDays?, videoKbps?, audioKbps?, maxHeight? })
+// Re-encodes recordings older than afterDays (0 = off) from the storage
+// index, pausing while the player plays or anything records. Needs
+// storageOpen first. onEvent(job) fires on state changes and progress.
+Napi::Value ArchiveOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Has("onEvent") || !options.Get("onEvent").IsFunction()) {
+        Napi::TypeError::New(env, "onEvent callback expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    ArchiveTranscoder& transcoder = ArchiveTranscoder::instance();
+    if (archiveEvents) {
+        transcoder.configure(archiveSettings(options));
+        return Napi::Boolean::New(env, true);
+    }
+
+    archiveEvents = Napi::ThreadSafeFunction::New(env, options.Get("onEvent").As<Napi::Function>(), "archiveEvents", 0, 1);
+    archiveEvents.Unref(env);
+    Napi::ThreadSafeFunction events = archiveEvents;
+    bool started = transcoder.start(archiveSettings(options),
+        []() {
+            return (globalPlayer && (globalPlayer->isPlaying() || globalPlayer->getIsRecording())) ||
+                   PlayerMetrics::get().recordingCaptures.get() > 0;
+        },
+        [events](const ArchiveJobInfo& job) {
+            ArchiveJobInfo* copy = new ArchiveJobInfo(job);
+            auto deliver = [](Napi::Env jsEnv, Napi::Function callback, ArchiveJobInfo* data) {
+                callback.Call({archiveJobToObject(jsEnv, *data)});
+                delete data;
+            };
+            if (events.NonBlockingCall(copy, deliver) != napi_ok) {
+                delete copy;
+            }
+        });
+    return Napi::Boolean::New(env, started);
+}
+
+// archiveConfigure({ afterDays?, videoKbps?, audioKbps?, maxHeight? })
+Napi::Value ArchiveConfigure(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    ArchiveTranscoder::instance().configure(archiveSettings(info[0].As<Napi::Object>()));
+    return env.Null();
+}
+
+// archiveList() - the running archive, the queue, then recent finished ones
+Napi::Value ArchiveList(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<ArchiveJobInfo> jobs = ArchiveTranscoder::instance().list();
+    Napi::Array result = Napi::Array::New(env, jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        result.Set(static_cast<uint32_t>(i), archiveJobToObject(env, jobs[i]));
+    }
+    return result;
+}
+
+// Stops the running archive (it resumes from its checkpoint next start);
+// call before quitting
+Napi::Value ArchiveClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    ArchiveTranscoder::instance().stop();
+    if (archiveEvents) {
+        archiveEvents.Release();
+        archiveEvents = Napi::ThreadSafeFunction();
+    }
+    return env.Null();
+}
+
+// relayOpen({ token, port?, lan? }) - starts the HTTP relay; clients fetch
+// /<token>.ts. Resolves to the port listened on; throws if it cannot listen.
+Napi::Value RelayOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Get("token").IsString()) {
+        Napi::TypeError::New(env, "Access token expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string error;
+    int port = StreamRelay::instance().start(static_cast<int>(numberOption(options, "port", 0)),
+                                             boolOption(options, "lan", false),
+                                             options.Get("token").As<Napi::String>().Utf8Value(), error);
+    if (port == 0) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    return Napi::Number::New(env, port);
+}
+
+// relaySetChannel(url) - what relay clients receive; "" stops the upstream
+Napi::Value RelaySetChannel(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string url;
+    if (info.Length() > 0 && info[0].IsString()) {
+        url = info[0].As<Napi::String>().Utf8Value();
+    }
+    StreamRelay::instance().setChannel(url);
+    return env.Null();
+}
+
+Napi::Value RelayStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    StreamRelayStats stats = StreamRelay::instance().stats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("running", Napi::Boolean::New(env, stats.running));
+    result.Set("port", Napi::Number::New(env, stats.port));
+    result.Set("url", Napi::String::New(env, stats.url));
+    result.Set("upstreamActive", Napi::Boolean::New(env, stats.upstreamActive));
+    result.Set("upstreamBytes", Napi::Number::New(env, static_cast<double>(stats.upstreamBytes)));
+    result.Set("upstreamRestarts", Napi::Number::New(env, static_cast<double>(stats.upstreamRestarts)));
+    Napi::Array clients = Napi::Array::New(env, stats.clients.size());
+    for (size_t i = 0; i < stats.clients.size(); i++) {
+        const RelayClientInfo& client = stats.clients[i];
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("address", Napi::String::New(env, client.address));
+        entry.Set("bytes", Napi::Number::New(env, static_cast<double>(client.bytes)));
+        entry.Set("skippedBytes", Napi::Number::New(env, static_cast<double>(client.skippedBytes)));
+        entry.Set("connectedAt", Napi::Number::New(env, static_cast<double>(client.connectedMs)));
+        clients.Set(static_cast<uint32_t>(i), entry);
+    }
+    result.Set("clients", clients);
+    return result;
+}
+
+// Disconnects all clients; call before quitting
+Napi::Value RelayClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    StreamRelay::instance().stop();
+    return env.Null();
+}
+
+// recordingServerOpen({ root, token, port?, lan? }) - serves the recordings
+// under root at /<token>/<path> and /<token>/recordings.m3u. Resolves to the
+// port listened on; throws if it cannot listen.
+Napi::Value RecordingServerOpen(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (!options.Get("root").IsString() || !options.Get("token").IsString()) {
+        Napi::TypeError::New(env, "Recordings folder and access token expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string error;
+    int port = RecordingServer::instance().start(options.Get("root").As<Napi::String>().Utf8Value(),
+                                                 static_cast<int>(numberOption(options, "port", 0)),
+                                                 boolOption(options, "lan", false),
+                                                 options.Get("token").As<Napi::String>().Utf8Value(), error);
+    if (port == 0) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    return Napi::Number::New(env, port);
+}
+
+Napi::Value RecordingServerStatsValue(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    RecordingServerStats stats = RecordingServer::instance().stats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("running", Napi::Boolean::New(env, stats.running));
+    result.Set("port", Napi::Number::New(env, stats.port));
+    result.Set("connections", Napi::Number::New(env, stats.connections));
+    result.Set("requests", Napi::Number::New(env, static_cast<double>(stats.requests)));
+    result.Set("bytesSent", Napi::Number::New(env, static_cast<double>(stats.bytesSent)));
+    return result;
+}
+
+// Drops every connection, live followers included; call before quitting
+Napi::Value RecordingServerClose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    RecordingServer::instance().stop();
+    return env.Null();
+}
+
+// Player - a VlcPlayer with its own command queue, for multiview tiles,
+// background probes and tests. All players, including the module-level
+// one above, share the process's libvlc instance, so creating one costs a
+// media player and two child windows rather than a plugin load.
+//
+//   const player = new Player({ hwnd });
+//   await player.initialize();              // resolves with true once it can play
+//   await player.play(url);                 // results as from enqueueCommand
+//   await player.dispose();
+//
+// Teardown joins the control thread and stops the input off the JS thread
+// (stopping may need the UI thread), then destroys the surfaces on it. A
+// finalizer cannot wait like that, so an initialized player keeps its JS
+// object alive until dispose(); one that never initialized is released by
+// its finalizer.
+class PlayerObject : public Napi::ObjectWrap<PlayerObject> {
+private:
+    enum State { CREATED, INITIALIZING, READY, DISPOSING, DISPOSED };
+
+    VlcPlayer* player = nullptr;
+    PlayerCommandQueue* queue = nullptr;
+    HWND hwnd = nullptr;
+    State state = CREATED;
+    bool pinned = false;                                // Ref held while READY
+    int pendingWork = 0;                                // Workers using player
+    std::vector<Napi::Promise::Deferred> disposeWaiters;
+
+    class InitializeWorker : public Napi::AsyncWorker {
+    private:
+        Napi::Promise::Deferred deferred;
+        PlayerObject* owner;
+        bool created = false;
+
+    public:
+        InitializeWorker(Napi::Env env, PlayerObject* target)
+            : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), owner(target) {}
+
+        Napi::Promise GetPromise() { return deferred.Promise(); }
+
+        void Execute() override {
+            created = owner->player->createInstance();
+        }
+
+        void OnOK() override {
+            deferred.Resolve(Napi::Boolean::New(Env(), owner->onInitialized(created)));
+        }
+
+        void OnError(const Napi::Error& error) override {
+            owner->onInitialized(false);
+            deferred.Reject(error.Value());
+        }
+    };
+
+    class DisposeWorker : public Napi::AsyncWorker {
+    private:
+        PlayerObject* owner;
+
+    public:
+        DisposeWorker(Napi::Env env, PlayerObject* target) : Napi::AsyncWorker(env), owner(target) {}
+
+        void Execute() override {
+            // Join first: a play still in progress would otherwise reopen the
+            // input after the stop below
+            if (owner->queue) {
+                owner->queue->shutdown();
+                owner->queue->join();
+            }
+            owner->player->stop();
+        }
+
+        void OnOK() override {
+            owner->onDisposed();
+        }
+
+        void OnError(const Napi::Error&) override {
+            owner->onDisposed();
+        }
+    };
+
+    void beginWork() {
+        Ref();
+        pendingWork++;
+    }
+
+    void endWork() {
+        pendingWork--;
+        if (state == DISPOSING && pendingWork == 0) {
+            (new DisposeWorker(Env(), this))->Queue();
+        }
+        Unref();
+    }
+
+    // JS thread, after createInstance() on a worker
+    bool onInitialized(bool created) {
+        bool success = false;
+        if (state == INITIALIZING) {
+            success = created && player->initialize(hwnd);
+            if (success) {
+                queue = new PlayerCommandQueue(*player);
+                queue->start();
+                Ref();
+                pinned = true;
+                state = READY;
+            } else {
+                state = CREATED;
+            }
+        }
+        endWork();
+        return success;
+    }
+
+    // JS thread; the queue is joined and the input stopped
+    void onDisposed() {
+        delete queue;
+        queue = nullptr;
+        delete player;
+        player = nullptr;
+        state = DISPOSED;
+
+        Napi::Env env = Env();
+        for (Napi::Promise::Deferred& waiter : disposeWaiters) {
+            waiter.Resolve(env.Undefined());
+        }
+        disposeWaiters.clear();
+        if (pinned) {
+            pinned = false;
+            Unref();
+        }
+        Unref();                                        // Taken by dispose()
+    }
+
+    // The player for a method call, or null (with a JS exception) once disposed
+    VlcPlayer* live(Napi::Env env) {
+        if (state == DISPOSING || state == DISPOSED) {
+            Napi::Error::New(env, "Player disposed").ThrowAsJavaScriptException();
+            return nullptr;
+        }
+        return player;
+    }
+
+    Napi::Value submit(Napi::Env env, PlayerCommandType type, const std::string& url, double value = 0) {
+        if (!live(env)) {
+            return env.Null();
+        }
+        if (state != READY) {
+            Napi::Error::New(env, "Player not initialized").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return enqueueOn(env, *queue, type, url, value);
+    }
+
+    Napi::Value runCommand(const Napi::CallbackInfo& info, PlayerCommandType type) {
+        Napi::Env env = info.Env();
+
+        std::string url;
+        if (type == PlayerCommandType::Play) {
+            if (info.Length() < 1 || !info[0].IsString()) {
+                Napi::TypeError::New(env, "URL string expected").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            url = info[0].As<Napi::String>().Utf8Value();
+        }
+        return submit(env, type, url);
+    }
+
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "Player", {
+            InstanceMethod("initialize", &PlayerObject::Initialize),
+            InstanceMethod("dispose", &PlayerObject::Dispose),
+            InstanceMethod("command", &PlayerObject::Command),
+            InstanceMethod("play", &PlayerObject::Play),
+            InstanceMethod("stop", &PlayerObject::Stop),
+            InstanceMethod("pause", &PlayerObject::Pause),
+            InstanceMethod("resume", &PlayerObject::Resume),
+            InstanceMethod("reconnect", &PlayerObject::Reconnect),
+            InstanceMethod("setVolume", &PlayerObject::SetVolume),
+            InstanceMethod("getVolume", &PlayerObject::GetVolume),
+            InstanceMethod("isPlaying", &PlayerObject::IsPlaying),
+            InstanceMethod("getState", &PlayerObject::GetState),
+            InstanceMethod("getCurrentUrl", &PlayerObject::GetCurrentUrl),
+            InstanceMethod("isInError", &PlayerObject::IsInError),
+            InstanceMethod("isStreamFrozen", &PlayerObject::IsStreamFrozen),
+            InstanceMethod("getStats", &PlayerObject::GetStats),
+            InstanceMethod("getBufferHealth", &PlayerObject::GetBufferHealth),
+            InstanceMethod("setStandbyUrl", &PlayerObject::SetStandbyUrl),
+            InstanceMethod("getMulticastStats", &PlayerObject::GetMulticastStats),
+            InstanceMethod("startRecording", &PlayerObject::StartRecording),
+            InstanceMethod("stopRecording", &PlayerObject::StopRecording),
+            InstanceMethod("isRecording", &PlayerObject::IsRecording)
+        });
+    }
+
+    // new Player({ hwnd }) - hwnd is the window to render into (bigint or number)
+    explicit PlayerObject(const Napi::CallbackInfo& info) : Napi::ObjectWrap<PlayerObject>(info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+            return;
+        }
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (!options.Has("hwnd") || !hwndFromValue(options.Get("hwnd"), hwnd)) {
+            Napi::TypeError::New(env, "options.hwnd (bigint or number) expected").ThrowAsJavaScriptException();
+            return;
+        }
+
+        player = new VlcPlayer();
+    }
+
+    void Finalize(Napi::Env) override {
+        // A live player only gets here when the environment is torn down at
+        // exit; its control thread may be waiting on this thread, so leave it
+        if (queue || pendingWork > 0) {
+            if (queue) queue->shutdown();
+            return;
+        }
+        delete player;
+        player = nullptr;
+    }
+
+    // initialize() - resolves with true once the player can play
+    Napi::Value Initialize(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!live(env)) {
+            return env.Null();
+        }
+        if (state != CREATED) {
+            Napi::Error::New(env, "Player already initialized").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        state = INITIALIZING;
+        beginWork();
+        InitializeWorker* worker = new InitializeWorker(env, this);
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    // dispose() - stops playback and releases the player; resolves once done.
+    // Waits for an initialize() or reconnect() still running.
+    Napi::Value Dispose(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        if (state == DISPOSED || !player) {
+            deferred.Resolve(env.Undefined());
+            return deferred.Promise();
+        }
+
+        disposeWaiters.push_back(deferred);
+        if (state != DISPOSING) {
+            state = DISPOSING;
+            Ref();
+            if (pendingWork == 0) {
+                (new DisposeWorker(env, this))->Queue();
+            }
+        }
+        return deferred.Promise();
+    }
+
+    // command(type, url?) - same as the module's enqueueCommand
+    Napi::Value Command(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        PlayerCommandType type;
+        std::string url;
+        double value = 0;
+        if (!parseCommand(info, type, url, value)) {
+            return env.Null();
+        }
+        return submit(env, type, url, value);
+    }
+
+    Napi::Value Play(const Napi::CallbackInfo& info) { return runCommand(info, PlayerCommandType::Play); }
+    Napi::Value Stop(const Napi::CallbackInfo& info) { return runCommand(info, PlayerCommandType::Stop); }
+    Napi::Value Pause(const Napi::CallbackInfo& info) { return runCommand(info, PlayerCommandType::Pause); }
+    Napi::Value Resume(const Napi::CallbackInfo& info) { return runCommand(info, PlayerCommandType::Resume); }
+
+    // reconnect(url?, timeoutMs?) - resolves with { success, elapsedMs }
+    Napi::Value Reconnect(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        VlcPlayer* target = live(env);
+        if (!target) {
+            return env.Null();
+        }
+
+        std::string url;
+        int timeoutMs;
+        parseReconnectArgs(info, url, timeoutMs);
+
+        beginWork();
+        ReconnectWorker* worker = new ReconnectWorker(env, target, url, timeoutMs, [this] { endWork(); });
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    Napi::Value SetVolume(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Volume (number) expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        VlcPlayer* target = live(env);
+        if (!target) {
+            return env.Null();
+        }
+        return Napi::Boolean::New(env, target->setVolume(info[0].As<Napi::Number>().Int32Value()));
+    }
+
+    Napi::Value GetVolume(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::Number::New(env, target->getVolume()) : env.Null();
+    }
+
+    Napi::Value IsPlaying(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::Boolean::New(env, target->isPlaying()) : env.Null();
+    }
+
+    Napi::Value GetState(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::String::New(env, target->getState()) : env.Null();
+    }
+
+    Napi::Value GetCurrentUrl(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::String::New(env, target->getCurrentUrl()) : env.Null();
+    }
+
+    Napi::Value IsInError(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::Boolean::New(env, target->isInError()) : env.Null();
+    }
+
+    Napi::Value IsStreamFrozen(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        if (!target) {
+            return env.Null();
+        }
+
+        int threshold = 10; // Default 10 seconds
+        if (info.Length() > 0 && info[0].IsNumber()) {
+            threshold = info[0].As<Napi::Number>().Int32Value();
+        }
+        return Napi::Boolean::New(env, target->isStreamFrozen(threshold));
+    }
+
+    Napi::Value GetStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? statsToObject(env, target->getStats()) : env.Null();
+    }
+
+    Napi::Value GetBufferHealth(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? bufferHealthToObject(env, target->getBufferHealth()) : env.Null();
+    }
+
+    Napi::Value GetMulticastStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        return multicastStatsToObject(env, live(env));
+    }
+
+    Napi::Value SetStandbyUrl(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        if (!target) {
+            return env.Null();
+        }
+
+        std::string url;
+        if (info.Length() > 0 && info[0].IsString()) {
+            url = info[0].As<Napi::String>().Utf8Value();
+        }
+        target->setStandbyUrl(url);
+        return env.Undefined();
+    }
+
+    Napi::Value StartRecording(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "File path string expected").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        VlcPlayer* target = live(env);
+        if (!target) {
+            return env.Null();
+        }
+        TsPidSelection pids = info.Length() > 1 ? parsePidSelection(info[1]) : TsPidSelection();
+        return Napi::Boolean::New(env, target->startRecording(info[0].As<Napi::String>().Utf8Value(), pids));
+    }
+
+    Napi::Value StopRecording(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::Boolean::New(env, target->stopRecording()) : env.Null();
+    }
+
+    Napi::Value IsRecording(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        VlcPlayer* target = live(env);
+        return target ? Napi::Boolean::New(env, target->getIsRecording()) : env.Null();
+    }
+};
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    exports.Set("Player", PlayerObject::Define(env));
+    exports.Set("warmUp", Napi::Function::New(env, WarmUp));
     exports.Set("initialize", Napi::Function::New(env, Initialize));
+    exports.Set("regeneratePluginCache", Napi::Function::New(env, RegeneratePluginCache));
+    exports.Set("getResumeUrl", Napi::Function::New(env, GetResumeUrl));
     exports.Set("play", Napi::Function::New(env, Play));
     exports.Set("stop", Napi::Function::New(env, Stop));
     exports.Set("pause", Napi::Function::New(env, Pause));
     exports.Set("resume", Napi::Function::New(env, Resume));
+    exports.Set("enqueueCommand", Napi::Function::New(env, EnqueueCommand));
+    exports.Set("shutdownCommands", Napi::Function::New(env, ShutdownCommands));
     exports.Set("setVolume", Napi::Function::New(env, SetVolume));
     exports.Set("getVolume", Napi::Function::New(env, GetVolume));
     exports.Set("isPlaying", Napi::Function::New(env, IsPlaying));
     exports.Set("getState", Napi::Function::New(env, GetState));
+    exports.Set("getPlaybackPosition", Napi::Function::New(env, GetPlaybackPosition));
     exports.Set("isStreamFrozen", Napi::Function::New(env, IsStreamFrozen));
     exports.Set("updateFrameTime", Napi::Function::New(env, UpdateFrameTime));
     exports.Set("recreateMediaPlayer", Napi::Function::New(env, RecreateMediaPlayer));
+    exports.Set("reconnect", Napi::Function::New(env, Reconnect));
     exports.Set("getCurrentUrl", Napi::Function::New(env, GetCurrentUrl));
     exports.Set("isInError", Napi::Function::New(env, IsInError));
     exports.Set("getStats", Napi::Function::New(env, GetStats));
+    exports.Set("getBufferHealth", Napi::Function::New(env, GetBufferHealth));
+    exports.Set("setStandbyUrl", Napi::Function::New(env, SetStandbyUrl));
+    exports.Set("setRelayInput", Napi::Function::New(env, SetRelayInput));
+    exports.Set("setNativeMulticast", Napi::Function::New(env, SetNativeMulticast));
+    exports.Set("getMulticastStats", Napi::Function::New(env, GetMulticastStats));
+    exports.Set("onStreamFailed", Napi::Function::New(env, OnStreamFailed));
     exports.Set("startRecording", Napi::Function::New(env, StartRecording));
     exports.Set("stopRecording", Napi::Function::New(env, StopRecording));
     exports.Set("isRecording", Napi::Function::New(env, IsRecording));
     exports.Set("getRecordingPath", Napi::Function::New(env, GetRecordingPath));
+    exports.Set("startMetrics", Napi::Function::New(env, StartMetrics));
+    exports.Set("stopMetrics", Napi::Function::New(env, StopMetrics));
+    exports.Set("getMetrics", Napi::Function::New(env, GetMetrics));
+    exports.Set("logOpen", Napi::Function::New(env, LogOpen));
+    exports.Set("logDefine", Napi::Function::New(env, LogDefine));
+    exports.Set("logEvent", Napi::Function::New(env, LogEvent));
+    exports.Set("logClose", Napi::Function::New(env, LogClose));
+    exports.Set("journalOpen", Napi::Function::New(env, JournalOpen));
+    exports.Set("journalSetChannel", Napi::Function::New(env, JournalSetChannel));
+    exports.Set("journalQuery", Napi::Function::New(env, JournalQuery));
+    exports.Set("journalClose", Napi::Function::New(env, JournalClose));
+    exports.Set("reliabilityOpen", Napi::Function::New(env, ReliabilityOpen));
+    exports.Set("reliabilityRank", Napi::Function::New(env, ReliabilityRank));
+    exports.Set("reliabilityClose", Napi::Function::New(env, ReliabilityClose));
+    exports.Set("scheduleOpen", Napi::Function::New(env, ScheduleOpen));
+    exports.Set("scheduleSetChannels", Napi::Function::New(env, ScheduleSetChannels));
+    exports.Set("scheduleUpdateEpg", Napi::Function::New(env, ScheduleUpdateEpg));
+    exports.Set("scheduleAddRule", Napi::Function::New(env, ScheduleAddRule));
+    exports.Set("scheduleRemoveRule", Napi::Function::New(env, ScheduleRemoveRule));
+    exports.Set("scheduleList", Napi::Function::New(env, ScheduleList));
+    exports.Set("scheduleClose", Napi::Function::New(env, ScheduleClose));
+    exports.Set("remuxOpen", Napi::Function::New(env, RemuxOpen));
+    exports.Set("remuxConfigure", Napi::Function::New(env, RemuxConfigure));
+    exports.Set("remuxEnqueue", Napi::Function::New(env, RemuxEnqueue));
+    exports.Set("remuxCancel", Napi::Function::New(env, RemuxCancel));
+    exports.Set("remuxList", Napi::Function::New(env, RemuxList));
+    exports.Set("remuxClose", Napi::Function::New(env, RemuxClose));
+    exports.Set("storageOpen", Napi::Function::New(env, StorageOpen));
+    exports.Set("storageConfigure", Napi::Function::New(env, StorageConfigure));
+    exports.Set("storageSetProtected", Napi::Function::New(env, StorageSetProtected));
+    exports.Set("storageStats", Napi::Function::New(env, StorageStats));
+    exports.Set("storageList", Napi::Function::New(env, StorageList));
+    exports.Set("storageClose", Napi::Function::New(env, StorageClose));
+    exports.Set("archiveOpen", Napi::Function::New(env, ArchiveOpen));
+    exports.Set("archiveConfigure", Napi::Function::New(env, ArchiveConfigure));
+    exports.Set("archiveList", Napi::Function::New(env, ArchiveList));
+    exports.Set("archiveClose", Napi::Function::New(env, ArchiveClose));
+    exports.Set("relayOpen", Napi::Function::New(env, RelayOpen));
+    exports.Set("relaySetChannel", Napi::Function::New(env, RelaySetChannel));
+    exports.Set("relayStats", Napi::Function::New(env, RelayStats));
+    exports.Set("relayClose", Napi::Function::New(env, RelayClose));
+    exports.Set("recordingServerOpen", Napi::Function::New(env, RecordingServerOpen));
+    exports.Set("recordingServerStats", Napi::Function::New(env, RecordingServerStatsValue));
+    exports.Set("recordingServerClose", Napi::Function::New(env, RecordingServerClose));
+    exports.Set("scanRecording", Napi::Function::New(env, ScanRecording));
+    exports.Set("buildPreviews", Napi::Function::New(env, BuildPreviews));
+    exports.Set("readPreview", Napi::Function::New(env, ReadPreview));
+    exports.Set("analyzeRecordings", Napi::Function::New(env, AnalyzeRecordings));
+    exports.Set("readChapters", Napi::Function::New(env, ReadChapters));
     return exports;
 }
 
@@ -0,0 +1,1686 @@
+#pragma once
+
+// VlcPlayer: libvlc playback, freeze detection, stats and recording.
+// Kept free of N-API so it can also be driven by native/bench.
+
+#include <vlc/vlc.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <windows.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+#include "multicast_input.h"
+#include "native_log.h"
+#include "recording_storage.h"
+#include "reliability_store.h"
+#include "remux_queue.h"
+#include "resume_state.h"
+#include "session_journal.h"
+#include "shared_libvlc.h"
+#include "stall_predictor.h"
+#include "stream_failure.h"
+#include "stream_relay.h"
+#include "ts_scanner.h"
+#include "ts_pipe_recorder.h"
+#include "video_surface.h"
+
+// Reference returned by libvlc_media_player_get_media, released on scope exit
+class CurrentMedia {
+private:
+    libvlc_media_t* media;
+
+public:
+    explicit CurrentMedia(libvlc_media_player_t* player)
+        : media(player ? libvlc_media_player_get_media(player) : nullptr) {}
+
+    ~CurrentMedia() {
+        if (media) {
+            libvlc_media_release(media);
+        }
+    }
+
+    CurrentMedia(const CurrentMedia&) = delete;
+    CurrentMedia& operator=(const CurrentMedia&) = delete;
+
+    libvlc_media_t* get() const {
+        return media;
+    }
+};
+
+class VlcPlayer {
+private:
+    static constexpr int DEFAULT_CACHING_MS = 3000;    // Matches --network-caching below
+    static constexpr int MAX_CACHING_MS = 10000;
+    static constexpr int SAMPLE_INTERVAL_MS = 250;
+    static constexpr int STANDBY_LINGER_MS = 20000;    // Drop an unused standby after this
+    static constexpr int RESUME_LINGER_MS = 60000;     // Startup standby waits for the UI longer
+    static constexpr int RESUME_ADOPT_TIMEOUT_MS = 3000;
+    static constexpr double KEYFRAME_ONLY_SPEED = 8;   // Trick play from here decodes keyframes only
+    static constexpr double MAX_TRICK_SPEED = 32;      // libvlc's input rate limit
+
+    std::shared_ptr<libvlc_instance_t> vlcInstance;    // Shared with every other player
+    libvlc_media_player_t* mediaPlayer = nullptr;
+    HWND hwnd = nullptr;
+    std::mutex playerMutex;
+    std::mutex instanceMutex;       // Serialises createInstance(); taken before playerMutex
+    bool initialized = false;
+    
+    // Freeze detection
+    std::chrono::steady_clock::time_point lastFrameTime;
+    bool freezeDetectionEnabled = false;
+    int64_t lastFrameCount = 0;
+    
+    // Current playback info. currentUrl is the stream (the mirror) and what
+    // statistics, the journal and resume are keyed by; inputUrl is what
+    // libvlc opened for it, the relay's local URL while playing through it.
+    std::string currentUrl;
+    std::string inputUrl;
+    std::string relayInput;                             // The relay's local URL, "" = open streams directly
+    bool isInErrorState = false;
+    
+public:
+    // Stream statistics
+    struct StreamStats {
+        float inputBitrate = 0.0f;      // Bytes per microsecond, as libvlc reports it
+        float demuxBitrate = 0.0f;      // Bytes per microsecond
+        int64_t lostBuffers = 0;
+        int64_t displayedPictures = 0;
+        int64_t lostPictures = 0;
+    };
+
+private:
+    StreamStats lastStats;
+    
+    // Recording state
+    bool isRecording = false;
+    std::string recordingPath;
+    std::unique_ptr<TsPipeRecorder> recordingFilter;    // Set when recording one programme
+    libvlc_media_player_t* recorder = nullptr;          // Headless input writing the recording
+    uint64_t recorderWatch = 0;
+    
+    // Audio-only mode
+    bool audioOnlyMode = false;
+
+    // Recording playback: the played file's seek index (loaded on its first
+    // seek) and whether the input was reopened for keyframe-only trick play
+    std::string seekIndexPath;
+    TsSeekIndex seekIndex;
+    bool keyframeOnly = false;
+    
+    // Metrics bookkeeping (event callbacks only touch the atomics)
+    std::atomic<int64_t> zapStartNs{0};
+    std::atomic<int64_t> lastZapLatencyNs{0};
+    StreamStats metricsBaseline;
+    bool frozenReported = false;
+    std::string lastFrozenUrl;
+    uint64_t lastRecordingSize = 0;
+    std::chrono::steady_clock::time_point lastRecordingSample;
+
+    // Telemetry journal session (thread-safe on its own)
+    JournalSession journal;
+
+    // Reliability model key of the current URL; read from event callbacks
+    std::atomic<uint64_t> urlHash{0};
+    std::chrono::steady_clock::time_point watchStart;
+    bool watching = false;
+
+    // Stall prediction, fed by the sampler thread every SAMPLE_INTERVAL_MS
+    StallPredictor predictor;
+    bool predictorActive = false;
+    bool wasAtRisk = false;
+    std::atomic<bool> firstFrameSeen{false};
+    std::atomic<int> bufferingPermille{-1};
+    int currentCachingMs = DEFAULT_CACHING_MS;
+    std::unordered_map<uint64_t, int> cachingBoostMs;  // Raised after a predicted stall
+
+    std::thread sampler;
+    std::mutex samplerMutex;
+    std::condition_variable samplerWake;
+    bool samplerRunning = false;
+
+    // Standby pool: one muted player rendering beneath the active surface
+    VideoSurfaces surfaces;
+    bool surfacesReady = false;
+    libvlc_media_player_t* standbyPlayer = nullptr;
+    std::string standbyUrl;
+    std::string standbyInput;                           // What the standby opened for standbyUrl
+    std::string standbyCandidate;                       // Mirror to pre-open, "" = current URL if HLS
+    std::chrono::steady_clock::time_point standbyOpenedAt;
+    int64_t standbyRequestNs = 0;
+    std::atomic<bool> standbyReady{false};
+    std::atomic<bool> standbyFailed{false};
+    int standbyLingerMs = STANDBY_LINGER_MS;
+
+    // Reconnect waits on the standby's events; ids tell its standby apart
+    // from one opened or promoted by the sampler in the meantime
+    std::mutex standbyMutex;
+    std::condition_variable standbyChanged;
+    std::atomic<uint64_t> standbyId{0};
+    uint64_t nextStandbyId = 0;
+    uint64_t lastPromotedId = 0;
+
+    // Startup resume: the last stream is pre-opened in the standby as soon as
+    // the window is attached, then adopted by the first play() of that URL
+    std::string resumePath;
+    std::string resumeUrl;                              // Loaded at warm-up, "" once used
+    std::string resumeChannel;
+    std::string savedResumeUrl;                         // Skip rewriting an unchanged file
+    uint64_t resumeStandbyId = 0;
+
+    // Set by play() until the input opens or fails; the listener (the
+    // command queue) is installed before the first play and never changes
+    std::atomic<bool> openPending{false};
+    std::function<void(bool)> openListener;
+
+    // Failures classified from libvlc's log, or its error event: reported
+    // once per zap (decoder ones every time, they may be a side track), to
+    // the open listener while play() waits and to failureListener after
+    std::atomic<uint64_t> failureWatch{0};
+    std::atomic<int64_t> failureWatchNs{0};
+    std::atomic<bool> failureReported{false};
+    std::mutex failureMutex;
+    std::string failureUrl;
+    std::function<void(const StreamFailure&)> failureListener;
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Runs on libvlc's event thread - must not take playerMutex
+    static void handlePlayerEvent(const libvlc_event_t* event, void* opaque) {
+        VlcPlayer* self = static_cast<VlcPlayer*>(opaque);
+        auto& metrics = PlayerMetrics::get();
+
+        switch (event->type) {
+            case libvlc_MediaPlayerVout: {
+                int64_t start = self->zapStartNs.exchange(0);
+                if (start != 0 && event->u.media_player_vout.new_count > 0) {
+                    int64_t latencyNs = nowNs() - start;
+                    self->lastZapLatencyNs.store(latencyNs);
+                    double seconds = latencyNs / 1e9;
+                    metrics.zapLatency.observe(seconds);
+                    self->journal.zapPhase(ZAP_PHASE_FIRST_FRAME);
+                    self->firstFrameSeen.store(true);
+                    ReliabilityStore::instance().recordZap(self->urlHash.load(), true, seconds * 1000.0);
+                    StreamFailureMonitor::instance().opened(self->failureWatch.load());
+                    NativeLog::instance().write(LogLevel::Info, LOG_EVENT_FIRST_FRAME, {seconds * 1000.0});
+                }
+                break;
+            }
+            case libvlc_MediaPlayerPlaying:
+                if (self->openPending.exchange(false) && self->openListener) {
+                    self->openListener(true);
+                }
+                break;
+            case libvlc_MediaPlayerEncounteredError:
+                NativeLog::instance().write(LogLevel::Error, LOG_EVENT_PLAYER_ERROR);
+                self->reportFailure(StreamFailureReason::PlayerError, std::string());
+                break;
+            case libvlc_MediaPlayerBuffering:
+                self->bufferingPermille.store(static_cast<int>(event->u.media_player_buffering.new_cache * 10));
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Runs on libvlc's event thread, or on whichever libvlc thread logged the
+    // failure - must not take playerMutex
+    void reportFailure(StreamFailureReason reason, const std::string& detail) {
+        StreamFailure failure;
+        failure.reason = reason;
+        failure.detail = detail;
+        failure.firstFrame = lastZapLatencyNs.load() != 0;
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            failure.url = failureUrl;
+        }
+        if (reason == StreamFailureReason::Decoder) {
+            if (failureListener) {
+                failureListener(failure);
+            }
+            return;
+        }
+        if (failureReported.exchange(true)) {
+            return;
+        }
+
+        auto& metrics = PlayerMetrics::get();
+        if (zapStartNs.exchange(0) != 0) {
+            metrics.zapFailures.inc();
+            ReliabilityStore::instance().recordZap(urlHash.load(), false, 0);
+        } else {
+            ReliabilityStore::instance().recordStall(urlHash.load());
+        }
+        journal.zapPhase(ZAP_PHASE_FAILED);
+        metrics.streamFailures.inc();
+        NativeLog::instance().write(LogLevel::Error, LOG_EVENT_STREAM_FAILED,
+                                    {(nowNs() - failureWatchNs.load()) / 1e6},
+                                    NativeLog::jsonField("reason", streamFailureReasonName(reason)) + "," +
+                                        NativeLog::jsonField("detail", detail));
+
+        // play() is still waiting: fail it now rather than when libvlc
+        // gives up, so the caller moves on to the next mirror
+        if (openPending.exchange(false)) {
+            if (openListener) {
+                openListener(false);
+            }
+        } else if (failureListener) {
+            failureListener(failure);
+        }
+    }
+
+    // Attributes log failures of url to this player from now on, replacing
+    // the previous watch; opening until the first frame
+    void watchFailures(const std::string& url, bool opening) {
+        StreamFailureMonitor& monitor = StreamFailureMonitor::instance();
+        monitor.unwatch(failureWatch.exchange(0));
+        failureReported.store(false);
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            failureUrl = url;
+        }
+        failureWatchNs.store(nowNs());
+        failureWatch.store(monitor.watch(url, opening, [this](StreamFailureReason reason, const std::string& detail) {
+            reportFailure(reason, detail);
+        }));
+    }
+
+    void unwatchFailures() {
+        StreamFailureMonitor::instance().unwatch(failureWatch.exchange(0));
+    }
+
+    // Runs on libvlc's event thread for the standby player
+    static void handleStandbyEvent(const libvlc_event_t* event, void* opaque) {
+        VlcPlayer* self = static_cast<VlcPlayer*>(opaque);
+        if (event->type == libvlc_MediaPlayerVout && event->u.media_player_vout.new_count > 0) {
+            self->standbyReady.store(true);
+        } else if (event->type == libvlc_MediaPlayerEncounteredError) {
+            self->standbyFailed.store(true);
+        } else {
+            return;
+        }
+        self->notifyStandbyChanged();
+    }
+
+    void notifyStandbyChanged() {
+        {
+            std::lock_guard<std::mutex> lock(standbyMutex);
+        }
+        standbyChanged.notify_all();
+    }
+
+    void attachEvents() {
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(mediaPlayer);
+        libvlc_event_attach(events, libvlc_MediaPlayerVout, handlePlayerEvent, this);
+        libvlc_event_attach(events, libvlc_MediaPlayerEncounteredError, handlePlayerEvent, this);
+        libvlc_event_attach(events, libvlc_MediaPlayerBuffering, handlePlayerEvent, this);
+        libvlc_event_attach(events, libvlc_MediaPlayerPlaying, handlePlayerEvent, this);
+    }
+
+    void detachEvents() {
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(mediaPlayer);
+        libvlc_event_detach(events, libvlc_MediaPlayerVout, handlePlayerEvent, this);
+        libvlc_event_detach(events, libvlc_MediaPlayerEncounteredError, handlePlayerEvent, this);
+        libvlc_event_detach(events, libvlc_MediaPlayerBuffering, handlePlayerEvent, this);
+        libvlc_event_detach(events, libvlc_MediaPlayerPlaying, handlePlayerEvent, this);
+    }
+
+    void setStandbyEvents(bool attach) {
+        libvlc_event_manager_t* events = libvlc_media_player_event_manager(standbyPlayer);
+        if (attach) {
+            libvlc_event_attach(events, libvlc_MediaPlayerVout, handleStandbyEvent, this);
+            libvlc_event_attach(events, libvlc_MediaPlayerEncounteredError, handleStandbyEvent, this);
+        } else {
+            libvlc_event_detach(events, libvlc_MediaPlayerVout, handleStandbyEvent, this);
+            libvlc_event_detach(events, libvlc_MediaPlayerEncounteredError, handleStandbyEvent, this);
+        }
+    }
+
+    // The file a file:/// URL names, or "" for anything else
+    static std::string localPath(const std::string& url) {
+        static const char prefix[] = "file:///";
+        if (url.compare(0, sizeof(prefix) - 1, prefix) != 0) return "";
+        std::string path;
+        for (size_t i = sizeof(prefix) - 1; i < url.size(); i++) {
+            char c = url[i];
+            if (c == '%' && i + 2 < url.size() && isxdigit(static_cast<unsigned char>(url[i + 1])) &&
+                isxdigit(static_cast<unsigned char>(url[i + 2]))) {
+                c = static_cast<char>(std::stoi(url.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else if (c == '/') {
+                c = '\\';
+            }
+            path.push_back(c);
+        }
+        return path;
+    }
+
+    static bool isHls(const std::string& url) {
+        return url.find(".m3u8") != std::string::npos;
+    }
+
+    int cachingFor(uint64_t hash) const {
+        auto it = cachingBoostMs.find(hash);
+        return it != cachingBoostMs.end() ? it->second : DEFAULT_CACHING_MS;
+    }
+
+    // What libvlc opens for `url`: the relay while the player plays through
+    // it (the relay's own URL played directly is left as it is)
+    std::string inputFor(const std::string& url) const {
+        return relayInput.empty() || url == relayInput ? url : relayInput;
+    }
+
+    // Create a media with per-input options (caching boost, HLS variant cap).
+    // UDP/RTP goes through the native multicast input when it is enabled.
+    libvlc_media_t* newMedia(const std::string& url, int cachingMs, const std::string& extraOption) {
+        libvlc_media_t* media = MulticastInput::handles(url)
+            ? MulticastInput::newMedia(vlcInstance.get(), url) : nullptr;
+        if (!media) media = libvlc_media_new_location(vlcInstance.get(), url.c_str());
+        if (!media) return nullptr;
+        if (cachingMs != DEFAULT_CACHING_MS) {
+            libvlc_media_add_option(media, (":network-caching=" + std::to_string(cachingMs)).c_str());
+        }
+        if (!extraOption.empty()) {
+            libvlc_media_add_option(media, extraOption.c_str());
+        }
+        return media;
+    }
+
+    // Detach the standby under playerMutex; the caller stops and releases it.
+    // Stopping tears down the vout window, so off the UI thread it must run
+    // without the lock held.
+    libvlc_media_player_t* takeStandby() {
+        libvlc_media_player_t* player = standbyPlayer;
+        if (player) {
+            setStandbyEvents(false);
+            standbyPlayer = nullptr;
+            standbyUrl.clear();
+            standbyInput.clear();
+            standbyReady.store(false);
+            standbyFailed.store(false);
+            standbyId.store(0);
+            notifyStandbyChanged();
+        }
+        return player;
+    }
+
+    // A native multicast read blocks until data arrives; wake it so the
+    // stop that follows does not wait on the network
+    static void interruptInput(libvlc_media_player_t* player) {
+        CurrentMedia media(player);
+        if (media.get()) MulticastInput::interrupt(media.get());
+    }
+
+    static void releasePlayer(libvlc_media_player_t* player) {
+        if (player) {
+            interruptInput(player);
+            libvlc_media_player_stop(player);
+            libvlc_media_player_release(player);
+            PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+        }
+    }
+
+    // Must hold playerMutex. A reference to the active player if it has an
+    // input to stop; stopping tears down the vout, which can wait on the UI
+    // thread, so callers do it with stopRetained() after unlocking
+    libvlc_media_player_t* retainForStop() {
+        libvlc_state_t state = libvlc_media_player_get_state(mediaPlayer);
+        if (state == libvlc_NothingSpecial || state == libvlc_Stopped) {
+            return nullptr;
+        }
+        libvlc_media_player_retain(mediaPlayer);
+        return mediaPlayer;
+    }
+
+    // Also interrupts an open still in progress
+    static void stopRetained(libvlc_media_player_t* player) {
+        if (player) {
+            interruptInput(player);
+            libvlc_media_player_stop(player);
+            libvlc_media_player_release(player);
+        }
+    }
+
+    // Must hold playerMutex
+    void openStandby(const std::string& url, int cachingMs, const std::string& extraOption) {
+        standbyPlayer = libvlc_media_player_new(vlcInstance.get());
+        if (!standbyPlayer) return;
+        PlayerMetrics::get().libvlcMediaPlayers.add(1);
+
+        libvlc_media_player_set_hwnd(standbyPlayer, surfaces.standby());
+        libvlc_audio_set_mute(standbyPlayer, 1);
+        setStandbyEvents(true);
+        standbyUrl = url;
+        standbyInput = inputFor(url);
+        standbyLingerMs = STANDBY_LINGER_MS;
+        standbyReady.store(false);
+        standbyFailed.store(false);
+        standbyOpenedAt = std::chrono::steady_clock::now();
+        standbyRequestNs = nowNs();
+        standbyId.store(++nextStandbyId);
+
+        if (standbyInput != url) {
+            StreamRelay::instance().setChannel(url);
+        }
+        libvlc_media_t* media = newMedia(standbyInput, cachingMs, extraOption);
+        if (media) {
+            libvlc_media_player_set_media(standbyPlayer, media);
+            libvlc_media_release(media);
+        }
+        if (!media || libvlc_media_player_play(standbyPlayer) != 0) {
+            standbyFailed.store(true);
+        }
+    }
+
+    // Underrun is coming: deepen the buffer for the next open of this URL and
+    // pre-open the standby (another mirror, or the same URL at a lower HLS
+    // variant / larger cache). Must hold playerMutex.
+    void onStallPredicted() {
+        PlayerMetrics::get().stallPredictions.inc();
+        NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_STALL_PREDICTED,
+                                    {predictor.bufferedMs(), predictor.trendMsPerSecond()},
+                                    NativeLog::jsonField("url", currentUrl));
+
+        int boosted = std::min(MAX_CACHING_MS, std::max(currentCachingMs + 1000, currentCachingMs * 3 / 2));
+        if (cachingBoostMs.size() >= 256) cachingBoostMs.clear();
+        cachingBoostMs[urlHash.load()] = boosted;
+
+        // Through the relay there is one upstream; a standby would either be
+        // a second one or switch the relay away from the stream still playing
+        if (standbyPlayer || !surfacesReady || inputUrl != currentUrl) {
+            return;
+        }
+
+        // Without a distinct mirror only HLS is worth a second connection:
+        // the standby can take a lower rendition. Any other stream would just
+        // be the same bytes from the same server, competing for the link.
+        std::string url = standbyCandidate.empty() ? currentUrl : standbyCandidate;
+        if (url == currentUrl && !isHls(url)) {
+            return;
+        }
+        std::string extraOption;
+        int cachingMs = cachingFor(ReliabilityStore::hashUrl(url));
+        if (url == currentUrl) {
+            unsigned width = 0, height = 0;
+            if (libvlc_video_get_size(mediaPlayer, 0, &width, &height) == 0 && height > 1) {
+                extraOption = ":adaptive-maxheight=" + std::to_string(height - 1);
+            }
+        }
+        openStandby(url, cachingMs, extraOption);
+    }
+
+    // Swap the ready standby in as the active player; returns the old one
+    // for the caller to release. Must hold playerMutex.
+    libvlc_media_player_t* promoteStandby() {
+        libvlc_media_player_t* previous = mediaPlayer;
+        int volume = libvlc_audio_get_volume(previous);
+        std::string url = standbyUrl;
+        std::string input = standbyInput;
+        double firstFrameMs = (nowNs() - standbyRequestNs) / 1e6;
+
+        lastPromotedId = standbyId.load();
+        detachEvents();
+        mediaPlayer = takeStandby();
+        attachEvents();
+        libvlc_audio_set_mute(mediaPlayer, 0);
+        if (volume >= 0) {
+            libvlc_audio_set_volume(mediaPlayer, volume);
+        }
+        surfaces.swap();
+
+        endWatch();
+        uint64_t hash = ReliabilityStore::hashUrl(url);
+        urlHash.store(hash);
+        ReliabilityStore::instance().recordZap(hash, true, firstFrameMs);
+        watchStart = std::chrono::steady_clock::now();
+        watching = true;
+
+        if (url != currentUrl) {
+            journal.begin(url);
+            journal.zapPhase(ZAP_PHASE_OPENED);
+            journal.zapPhase(ZAP_PHASE_FIRST_FRAME);
+        } else {
+            journal.stallEnded();
+        }
+
+        currentUrl = url;
+        inputUrl = input;
+        rememberResume(url);
+        watchFailures(url, false);
+        currentCachingMs = cachingFor(hash);
+        lastFrameTime = std::chrono::steady_clock::now();
+        lastFrameCount = 0;
+        frozenReported = false;
+        isInErrorState = false;
+        metricsBaseline = StreamStats();
+        predictor.reset(currentCachingMs);
+        predictorActive = true;
+        wasAtRisk = false;
+
+        PlayerMetrics::get().standbySwitches.inc();
+        NativeLog::instance().write(LogLevel::Info, LOG_EVENT_STANDBY_PROMOTED, {}, NativeLog::jsonField("url", url));
+        return previous;
+    }
+
+    // Wait for standby `id` to show a frame, then swap it in; drops it if it
+    // failed or the deadline passed. Must not hold playerMutex.
+    bool promoteWhenReady(uint64_t id, std::chrono::steady_clock::time_point deadline) {
+        {
+            std::unique_lock<std::mutex> lock(standbyMutex);
+            standbyChanged.wait_until(lock, deadline, [&] {
+                return standbyReady.load() || standbyFailed.load() || standbyId.load() != id;
+            });
+        }
+
+        bool success = false;
+        libvlc_media_player_t* retired = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            if (lastPromotedId == id) {
+                success = true;                     // The sampler swapped it in first
+            } else if (standbyPlayer && standbyId.load() == id) {
+                if (standbyReady.load() && !standbyFailed.load()) {
+                    retired = promoteStandby();
+                    success = true;
+                } else {
+                    retired = takeStandby();
+                }
+            }
+        }
+        releasePlayer(retired);
+        return success;
+    }
+
+    // Persist the URL now playing for the next launch (must hold playerMutex)
+    void rememberResume(const std::string& url) {
+        if (resumePath.empty() || url.empty() || url == savedResumeUrl) {
+            return;
+        }
+        ResumeState state;
+        state.url = url;
+        state.channel = resumeChannel;
+        state.savedMs = ResumeState::nowMs();
+        if (state.save(resumePath)) {
+            savedResumeUrl = url;
+        }
+    }
+
+    // First play() of the URL pre-opened at startup adopts that standby
+    // instead of opening the stream again
+    bool adoptResumeStandby(const std::string& url) {
+        auto started = std::chrono::steady_clock::now();
+        uint64_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            if (!standbyPlayer || resumeStandbyId == 0 || standbyId.load() != resumeStandbyId || standbyUrl != url ||
+                standbyInput != inputFor(url)) {
+                return false;
+            }
+            id = resumeStandbyId;
+            resumeStandbyId = 0;
+            resumeUrl.clear();
+        }
+
+        if (!promoteWhenReady(id, started + std::chrono::milliseconds(RESUME_ADOPT_TIMEOUT_MS))) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            int64_t latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started).count();
+            auto& metrics = PlayerMetrics::get();
+            metrics.zaps.inc();
+            metrics.zapLatency.observe(latencyNs / 1e9);
+            lastZapLatencyNs.store(latencyNs);
+            freezeDetectionEnabled = true;
+        }
+        if (openListener) {
+            openListener(true);
+        }
+        return true;
+    }
+
+    void sampleOnce() {
+        libvlc_media_player_t* retired = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            if (!initialized || !mediaPlayer) {
+                return;
+            }
+
+            if (firstFrameSeen.exchange(false)) {
+                predictor.reset(currentCachingMs);
+                predictorActive = true;
+                wasAtRisk = false;
+            }
+
+            if (predictorActive) {
+                int permille = bufferingPermille.exchange(-1);
+                if (permille >= 0) {
+                    predictor.onBuffering(permille / 10.0f);
+                }
+
+                CurrentMedia media(mediaPlayer);
+                libvlc_media_stats_t stats;
+                if (media.get() && libvlc_media_get_stats(media.get(), &stats)) {
+                    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+                    predictor.sample(now, static_cast<uint32_t>(stats.i_read_bytes),
+                                     static_cast<uint32_t>(stats.i_demux_read_bytes),
+                                     static_cast<uint32_t>(stats.i_displayed_pictures));
+                    PlayerMetrics::get().bufferLevel.set(predictor.bufferedMs());
+                }
+
+                bool atRisk = predictor.isAtRisk();
+                if (atRisk && !wasAtRisk) {
+                    onStallPredicted();
+                }
+                wasAtRisk = atRisk;
+            }
+
+            if (standbyPlayer) {
+                auto idle = std::chrono::steady_clock::now() - standbyOpenedAt;
+                if (standbyFailed.load()) {
+                    retired = takeStandby();
+                } else if (standbyReady.load() && wasAtRisk) {
+                    retired = promoteStandby();
+                } else if (!wasAtRisk && idle > std::chrono::milliseconds(standbyLingerMs)) {
+                    retired = takeStandby();
+                }
+            }
+        }
+        releasePlayer(retired);
+    }
+
+    void runSampler() {
+        std::unique_lock<std::mutex> lock(samplerMutex);
+        while (samplerRunning) {
+            samplerWake.wait_for(lock, std::chrono::milliseconds(SAMPLE_INTERVAL_MS));
+            if (!samplerRunning) break;
+            lock.unlock();
+            sampleOnce();
+            lock.lock();
+        }
+    }
+
+    void stopSampler() {
+        {
+            std::lock_guard<std::mutex> lock(samplerMutex);
+            samplerRunning = false;
+        }
+        samplerWake.notify_all();
+        if (sampler.joinable()) {
+            sampler.join();
+        }
+    }
+
+    // Count each freeze once, not on every poll while it lasts
+    bool markFrozen() {
+        if (!frozenReported) {
+            frozenReported = true;
+            lastFrozenUrl = currentUrl;
+            PlayerMetrics::get().freezes.inc();
+            journal.stallStarted();
+            ReliabilityStore::instance().recordStall(urlHash.load());
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastFrameTime).count();
+            NativeLog::instance().write(LogLevel::Warn, LOG_EVENT_STREAM_FROZEN, {elapsed},
+                                        NativeLog::jsonField("url", currentUrl));
+        }
+        return true;
+    }
+
+    // One recovery of a frozen stream is one restart, however many attempts
+    // (seamless reconnect, then a cold play) it takes. Must hold playerMutex.
+    void countRestart(const std::string& url) {
+        if (!lastFrozenUrl.empty() && url == lastFrozenUrl) {
+            PlayerMetrics::get().restarts.inc();
+            lastFrozenUrl.clear();
+        }
+    }
+
+    HWND videoWindow() const {
+        return surfacesReady ? surfaces.active() : hwnd;
+    }
+
+    // Credit playback time to the URL that was playing (must hold playerMutex)
+    void endWatch() {
+        if (watching) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - watchStart).count();
+            ReliabilityStore::instance().recordWatch(urlHash.load(), seconds);
+            watching = false;
+        }
+    }
+
+    // Feed deltas of libvlc's cumulative per-media counters into the registry
+    void publishStats(const StreamStats& stats) {
+        // libvlc's rates are bytes per microsecond; the metrics are KB/s
+        auto& metrics = PlayerMetrics::get();
+        metrics.inputBitrate.set(stats.inputBitrate * 1000.0);
+        metrics.demuxBitrate.set(stats.demuxBitrate * 1000.0);
+        metrics.inputBitrateSamples.observe(stats.inputBitrate * 1000.0);
+
+        if (stats.displayedPictures >= metricsBaseline.displayedPictures) {
+            metrics.framesDisplayed.inc(stats.displayedPictures - metricsBaseline.displayedPictures);
+        }
+        uint64_t dropped = 0;
+        if (stats.lostPictures >= metricsBaseline.lostPictures) {
+            dropped = stats.lostPictures - metricsBaseline.lostPictures;
+            metrics.framesDropped.inc(dropped);
+        }
+        if (stats.lostBuffers >= metricsBaseline.lostBuffers) {
+            metrics.audioBuffersLost.inc(stats.lostBuffers - metricsBaseline.lostBuffers);
+        }
+        metricsBaseline = stats;
+
+        journal.sampleBitrate(stats.inputBitrate * 8000.0, dropped);
+    }
+
+    // Recording throughput comes from the output file growing on disk
+    void sampleRecordingThroughput() {
+        if (!isRecording) {
+            return;
+        }
+
+        uint64_t size = 0;
+        if (!getFileSize(recordingPath, size) || size < lastRecordingSize) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastRecordingSample).count();
+        uint64_t delta = size - lastRecordingSize;
+
+        auto& metrics = PlayerMetrics::get();
+        metrics.recordingBytes.inc(delta);
+        if (seconds > 0) {
+            metrics.recordingThroughput.set(delta / seconds);
+        }
+
+        lastRecordingSize = size;
+        lastRecordingSample = now;
+    }
+
+public:
+    VlcPlayer() {
+        lastFrameTime = std::chrono::steady_clock::now();
+    }
+
+    ~VlcPlayer() {
+        cleanup();
+    }
+    
+    // Safe recreation after crash
+    bool recreateMediaPlayer() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!vlcInstance) {
+            return false;
+        }
+        
+        // Clean up old player
+        if (mediaPlayer) {
+            detachEvents();
+            libvlc_media_player_release(mediaPlayer);
+            mediaPlayer = nullptr;
+            PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+        }
+        
+        // Create new player
+        mediaPlayer = libvlc_media_player_new(vlcInstance.get());
+        if (!mediaPlayer) {
+            return false;
+        }
+        PlayerMetrics::get().libvlcMediaPlayers.add(1);
+        
+        // Restore HWND
+        libvlc_media_player_set_hwnd(mediaPlayer, videoWindow());
+        attachEvents();
+        predictorActive = false;
+        
+        PlayerMetrics::get().playerRecreations.inc();
+        NativeLog::instance().write(LogLevel::Info, LOG_EVENT_PLAYER_RECREATED);
+        isInErrorState = false;
+        return true;
+    }
+
+    // libvlc_new loads every plugin (or reads plugins.dat) and needs no
+    // window, so it can run on a worker thread while the UI boots; initialize()
+    // then only attaches the window. The instance is shared: only the first
+    // player pays for the plugin load. resetPluginCache rewrites plugins.dat
+    // from a full scan (the plugins directory must be writable).
+    bool createInstance(bool resetPluginCache = false) {
+        std::lock_guard<std::mutex> creating(instanceMutex);
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            if (vlcInstance) {
+                return true;
+            }
+        }
+
+        std::shared_ptr<libvlc_instance_t> instance = SharedLibvlc::instance().acquire(resetPluginCache);
+        if (!instance) {
+            return false;
+        }
+
+        libvlc_media_player_t* player = libvlc_media_player_new(instance.get());
+        if (!player) {
+            return false;
+        }
+        PlayerMetrics::get().libvlcMediaPlayers.add(1);
+
+        std::lock_guard<std::mutex> lock(playerMutex);
+        vlcInstance = std::move(instance);
+        mediaPlayer = player;
+        return true;
+    }
+
+    // Must run on the UI thread (it creates the video surfaces). Creates the
+    // libvlc instance first if createInstance() has not already done so.
+    bool initialize(HWND windowHandle) {
+        if (!createInstance()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (initialized) {
+            return true;
+        }
+        if (!mediaPlayer) {
+            return false;
+        }
+
+        hwnd = windowHandle;
+
+        // Render into our own surface so a standby player can be swapped in;
+        // without one the host window is used directly and there is no standby
+        surfacesReady = surfaces.create(hwnd);
+
+        // Set output window (HWND)
+        libvlc_media_player_set_hwnd(mediaPlayer, videoWindow());
+        attachEvents();
+
+        samplerRunning = true;
+        sampler = std::thread(&VlcPlayer::runSampler, this);
+
+        // Start on the last stream while the UI is still loading
+        if (!resumeUrl.empty() && surfacesReady && !standbyPlayer) {
+            openStandby(resumeUrl, cachingFor(ReliabilityStore::hashUrl(resumeUrl)), "");
+            standbyLingerMs = RESUME_LINGER_MS;
+            resumeStandbyId = standbyId.load();
+        }
+
+        initialized = true;
+        return true;
+    }
+
+    // Read the startup resume file (worker thread, before initialize). The
+    // file is also where successful zaps are recorded from now on.
+    bool loadResumeState(const std::string& path, bool resume) {
+        ResumeState state;
+        bool loaded = resume && state.load(path);
+
+        std::lock_guard<std::mutex> lock(playerMutex);
+        resumePath = path;
+        if (loaded) {
+            resumeUrl = state.url;
+            resumeChannel = state.channel;
+            savedResumeUrl = state.url;
+        }
+        return loaded;
+    }
+
+    // URL pre-opened for startup resume, "" once adopted or dropped
+    std::string getResumeUrl() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        if (resumeStandbyId != 0 && standbyPlayer && standbyId.load() == resumeStandbyId) {
+            return standbyUrl;
+        }
+        return initialized ? "" : resumeUrl;
+    }
+
+    // May run on the command queue's control thread; playerMutex is not held
+    // while the previous input is stopped
+    bool play(const std::string& url) {
+        if (adoptResumeStandby(url)) {
+            return true;
+        }
+
+        int64_t requestNs = nowNs();
+        auto& metrics = PlayerMetrics::get();
+        uint64_t hash = ReliabilityStore::hashUrl(url);
+        libvlc_media_player_t* previous = nullptr;
+        libvlc_media_player_t* standby = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+
+            if (!initialized || !mediaPlayer) {
+                return false;
+            }
+
+            metrics.zaps.inc();
+            countRestart(url);
+            lastFrozenUrl.clear();
+            NativeLog::instance().write(LogLevel::Info, LOG_EVENT_ZAP_STARTED, {}, NativeLog::jsonField("url", url));
+            journal.begin(url);
+            endWatch();
+            abandonZap();
+            urlHash.store(hash);
+            standby = takeStandby();
+            predictorActive = false;
+            firstFrameSeen.store(false);
+            openPending.store(false);
+            currentCachingMs = cachingFor(hash);
+            keyframeOnly = false;
+            seekIndexPath.clear();
+            previous = retainForStop();
+        }
+
+        releasePlayer(standby);
+        if (previous) {
+            stopRetained(previous);
+            // Wait for clean stop
+            Sleep(100);
+        }
+
+        std::lock_guard<std::mutex> lock(playerMutex);
+        if (!initialized || !mediaPlayer) {
+            return false;
+        }
+
+        try {
+            // Create media from URL; through the relay, point it at the URL first
+            std::string input = inputFor(url);
+            if (input != url) {
+                StreamRelay::instance().setChannel(url);
+            }
+            libvlc_media_t* media = newMedia(input, currentCachingMs, "");
+            if (!media) {
+                metrics.zapFailures.inc();
+                journal.zapPhase(ZAP_PHASE_FAILED);
+                ReliabilityStore::instance().recordZap(hash, false, 0);
+                return false;
+            }
+
+            // Set media to player
+            libvlc_media_player_set_media(mediaPlayer, media);
+            libvlc_media_release(media);
+
+            // Start playback (armed first so a fast first frame or failure
+            // is not missed)
+            lastZapLatencyNs.store(0);
+            zapStartNs.store(requestNs);
+            openPending.store(true);
+            watchFailures(url, true);
+            int result = libvlc_media_player_play(mediaPlayer);
+            
+            if (result == 0) {
+                currentUrl = url;
+                inputUrl = input;
+                rememberResume(url);
+                lastFrameTime = std::chrono::steady_clock::now();
+                freezeDetectionEnabled = true;
+                lastFrameCount = 0;
+                isInErrorState = false;
+                frozenReported = false;
+                metricsBaseline = StreamStats();
+                journal.zapPhase(ZAP_PHASE_OPENED);
+                watchStart = std::chrono::steady_clock::now();
+                watching = true;
+            } else {
+                zapStartNs.store(0);
+                openPending.store(false);
+                unwatchFailures();
+                metrics.zapFailures.inc();
+                journal.zapPhase(ZAP_PHASE_FAILED);
+                ReliabilityStore::instance().recordZap(hash, false, 0);
+            }
+            
+            return result == 0;
+        } catch (...) {
+            isInErrorState = true;
+            openPending.store(false);
+            unwatchFailures();
+            metrics.zapFailures.inc();
+            journal.zapPhase(ZAP_PHASE_FAILED);
+            ReliabilityStore::instance().recordZap(hash, false, 0);
+            return false;
+        }
+    }
+
+    bool stop() {
+        libvlc_media_player_t* previous = nullptr;
+        libvlc_media_player_t* standby = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+
+            if (!initialized || !mediaPlayer) {
+                return false;
+            }
+
+            abandonZap();
+            openPending.store(false);
+            unwatchFailures();
+            previous = retainForStop();
+            standby = takeStandby();
+            predictorActive = false;
+            journal.end();
+            endWatch();
+            freezeDetectionEnabled = false;
+            currentUrl.clear();
+            inputUrl.clear();
+            isInErrorState = false;
+        }
+
+        try {
+            stopRetained(previous);
+            releasePlayer(standby);
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool pause() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return false;
+        }
+
+        libvlc_media_player_pause(mediaPlayer);
+        return true;
+    }
+
+    bool resume() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return false;
+        }
+
+        if (!libvlc_media_player_is_playing(mediaPlayer)) {
+            libvlc_media_player_play(mediaPlayer);
+        }
+        return true;
+    }
+
+    // Seeks a seekable input (a recording) to timeMs. A file with a seek
+    // index is positioned at the indexed keyframe by byte offset, which the
+    // TS demuxer reaches directly instead of bisecting the file for a time.
+    bool seek(int64_t timeMs) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+
+        if (!initialized || !mediaPlayer || currentUrl.empty() || !libvlc_media_player_is_seekable(mediaPlayer)) {
+            return false;
+        }
+
+        timeMs = std::max<int64_t>(0, timeMs);
+        std::string path = localPath(currentUrl);
+        if (!path.empty() && path != seekIndexPath) {
+            seekIndexPath = path;
+            if (!TsScanner::loadIndex(path, seekIndex)) {
+                seekIndex = TsSeekIndex();
+            }
+        }
+
+        const TsSeekIndex::Point* point = path.empty() ? nullptr
+            : seekIndex.find(static_cast<uint32_t>(std::min<int64_t>(timeMs, UINT32_MAX)));
+        uint64_t size = 0;
+        if (point && getFileSize(path, size) && size > 0) {
+            libvlc_media_player_set_position(mediaPlayer, static_cast<float>(static_cast<double>(point->offset) / size));
+        } else {
+            libvlc_media_player_set_time(mediaPlayer, timeMs);
+        }
+        lastFrameTime = std::chrono::steady_clock::now();      // No frames while it refills
+        return true;
+    }
+
+    // Playback speed for a seekable input. Up to KEYFRAME_ONLY_SPEED the
+    // decoder keeps up; from there the input is reopened at the current time
+    // with only keyframes decoded (and no audio), so 8x/16x shows a steady
+    // run of pictures instead of a stalled decoder. Going back below it
+    // reopens the input normally.
+    bool setTrickPlay(double speed) {
+        speed = std::max(0.25, std::min(speed, MAX_TRICK_SPEED));
+        bool wantKeyframeOnly = speed >= KEYFRAME_ONLY_SPEED;
+        libvlc_media_player_t* previous = nullptr;
+        std::string url;
+        int64_t timeMs = 0;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+
+            if (!initialized || !mediaPlayer || currentUrl.empty() || !libvlc_media_player_is_seekable(mediaPlayer)) {
+                return false;
+            }
+            if (wantKeyframeOnly == keyframeOnly) {
+                return libvlc_media_player_set_rate(mediaPlayer, static_cast<float>(speed)) == 0;
+            }
+            url = currentUrl;
+            timeMs = std::max<int64_t>(0, libvlc_media_player_get_time(mediaPlayer));
+            freezeDetectionEnabled = false;
+            previous = retainForStop();
+        }
+
+        // Stopping tears down the vout; not under the lock (see play)
+        stopRetained(previous);
+
+        std::lock_guard<std::mutex> lock(playerMutex);
+        if (!initialized || !mediaPlayer || currentUrl != url) {
+            return false;       // A play or stop got in first
+        }
+
+        libvlc_media_t* media = newMedia(inputUrl, currentCachingMs,
+                                         ":start-time=" + std::to_string(timeMs / 1000.0));
+        if (!media) {
+            return false;
+        }
+        if (wantKeyframeOnly) {
+            libvlc_media_add_option(media, ":avcodec-skip-frame=3");
+            libvlc_media_add_option(media, ":no-audio");
+        }
+        libvlc_media_player_set_media(mediaPlayer, media);
+        libvlc_media_release(media);
+
+        keyframeOnly = wantKeyframeOnly;
+        if (libvlc_media_player_play(mediaPlayer) != 0) {
+            isInErrorState = true;
+            return false;
+        }
+        libvlc_media_player_set_rate(mediaPlayer, static_cast<float>(speed));
+        lastFrameTime = std::chrono::steady_clock::now();
+        freezeDetectionEnabled = true;
+        return true;
+    }
+
+    // Time and length (ms) of the input, and whether it can seek
+    bool getPlaybackPosition(int64_t& timeMs, int64_t& lengthMs, double& rate, bool& seekable) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+
+        if (!initialized || !mediaPlayer || currentUrl.empty()) {
+            return false;
+        }
+
+        timeMs = libvlc_media_player_get_time(mediaPlayer);
+        lengthMs = libvlc_media_player_get_length(mediaPlayer);
+        rate = libvlc_media_player_get_rate(mediaPlayer);
+        seekable = libvlc_media_player_is_seekable(mediaPlayer) != 0;
+        return true;
+    }
+
+    bool setVolume(int volume) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return false;
+        }
+
+        // VLC volume is 0-100
+        int clampedVolume = volume < 0 ? 0 : (volume > 100 ? 100 : volume);
+        libvlc_audio_set_volume(mediaPlayer, clampedVolume);
+        return true;
+    }
+
+    int getVolume() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return 0;
+        }
+
+        return libvlc_audio_get_volume(mediaPlayer);
+    }
+
+    bool isPlaying() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return false;
+        }
+
+        return libvlc_media_player_is_playing(mediaPlayer) == 1;
+    }
+
+    std::string getState() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer) {
+            return "stopped";
+        }
+
+        try {
+            libvlc_state_t state = libvlc_media_player_get_state(mediaPlayer);
+            switch (state) {
+                case libvlc_Playing: return "playing";
+                case libvlc_Paused: return "paused";
+                case libvlc_Stopped: return "stopped";
+                case libvlc_Buffering: return "buffering";
+                case libvlc_Error: return "error";
+                default: return "stopped";
+            }
+        } catch (...) {
+            return "error";
+        }
+    }
+    
+    // Check for playback freeze (no frames for N seconds)
+    bool isStreamFrozen(int freezeThresholdSeconds = 10) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer || !freezeDetectionEnabled) {
+            return false;
+        }
+        
+        try {
+            // Check if player is in error state
+            libvlc_state_t state = libvlc_media_player_get_state(mediaPlayer);
+            if (state == libvlc_Error || state == libvlc_Ended) {
+                return markFrozen();
+            }
+            
+            // If not playing, not frozen
+            if (state != libvlc_Playing) {
+                return false;
+            }
+            
+            // Check time since last frame update
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - lastFrameTime).count();
+            
+            // Get current playback statistics
+            CurrentMedia media(mediaPlayer);
+            if (media.get()) {
+                // Check if media is still valid
+                libvlc_state_t mediaState = libvlc_media_get_state(media.get());
+                if (mediaState == libvlc_Error) {
+                    return markFrozen();
+                }
+            }
+            
+            // If elapsed time exceeds threshold, stream is frozen
+            if (elapsed >= freezeThresholdSeconds) {
+                return markFrozen();
+            }
+            
+            return false;
+        } catch (...) {
+            // Exception means something is wrong
+            return markFrozen();
+        }
+    }
+    
+    // Update frame timestamp (call periodically during playback)
+    void updateFrameTime() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (freezeDetectionEnabled && mediaPlayer) {
+            try {
+                // Check if actually playing
+                if (libvlc_media_player_is_playing(mediaPlayer)) {
+                    // Get current time as proxy for frame activity
+                    int64_t currentTime = libvlc_media_player_get_time(mediaPlayer);
+                    
+                    // If time changed, we have activity
+                    if (currentTime != lastFrameCount && currentTime > 0) {
+                        lastFrameTime = std::chrono::steady_clock::now();
+                        lastFrameCount = currentTime;
+                        if (frozenReported) {
+                            journal.stallEnded();
+                        }
+                        frozenReported = false;
+                    }
+                }
+            } catch (...) {
+                // Ignore errors during update
+            }
+        }
+    }
+    
+    std::string getCurrentUrl() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        return currentUrl;
+    }
+    
+    bool isInError() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        return isInErrorState;
+    }
+
+    // Seamless restart: open the URL ("" = current) on the standby player,
+    // wait for its first frame and swap surfaces. The active player keeps
+    // its last frame on screen meanwhile and is only stopped after the swap.
+    // Blocks up to timeoutMs; run it off the JS thread. Returns false if the
+    // standby failed, timed out or was superseded by another zap.
+    bool reconnect(const std::string& requestedUrl, int timeoutMs, double& elapsedMs) {
+        auto started = std::chrono::steady_clock::now();
+        uint64_t id = 0;
+        libvlc_media_player_t* discarded = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            std::string url = requestedUrl.empty() ? currentUrl : requestedUrl;
+            if (!initialized || !mediaPlayer || !surfacesReady || url.empty()) {
+                return false;
+            }
+
+            if (standbyPlayer && standbyUrl == url && standbyInput == inputFor(url) && !standbyFailed.load()) {
+                id = standbyId.load();              // Already pre-opened by the predictor
+            } else {
+                discarded = takeStandby();
+                openStandby(url, cachingFor(ReliabilityStore::hashUrl(url)), "");
+                id = standbyId.load();
+            }
+            countRestart(url);
+        }
+        releasePlayer(discarded);
+        if (id == 0) {
+            return false;
+        }
+
+        bool success = promoteWhenReady(id, started + std::chrono::milliseconds(timeoutMs));
+
+        elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return success;
+    }
+
+    // Mirror to pre-open when a stall is predicted ("" = reopen the current URL)
+    void setStandbyUrl(const std::string& url) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        standbyCandidate = url;
+    }
+
+    // Plays streams through the relay at `localUrl` ("" = directly) from the
+    // next play on: the relay is pointed at the stream and libvlc opens the
+    // relay, so this player is one more client of its single upstream
+    void setRelayInput(const std::string& localUrl) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        relayInput = localUrl;
+    }
+
+    struct BufferHealth {
+        bool tracking = false;
+        double bufferedMs = 0;
+        double targetMs = 0;
+        double trendMsPerSec = 0;
+        double underrunInMs = -1;
+        double inputKbps = 0;
+        double mediaKbps = 0;
+        bool atRisk = false;
+        std::string standby = "idle";       // idle | opening | ready
+    };
+
+    BufferHealth getBufferHealth() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+
+        BufferHealth health;
+        health.tracking = predictorActive && predictor.ready();
+        health.bufferedMs = predictor.bufferedMs();
+        health.targetMs = predictor.targetBufferMs();
+        health.trendMsPerSec = predictor.trendMsPerSecond();
+        health.underrunInMs = predictor.underrunInMs();
+        health.inputKbps = predictor.inputKbps();
+        health.mediaKbps = predictor.mediaKbps();
+        health.atRisk = predictorActive && predictor.isAtRisk();
+        if (standbyPlayer) {
+            health.standby = standbyReady.load() ? "ready" : "opening";
+        }
+        return health;
+    }
+
+    // Channel key for telemetry; sticky across zaps, "" keys sessions by URL
+    void setJournalChannel(const std::string& channel) {
+        journal.setChannel(channel);
+        std::lock_guard<std::mutex> lock(playerMutex);
+        resumeChannel = channel;
+    }
+
+    // A zap that ends with neither a first frame nor an error - it hung,
+    // timed out, or was zapped away from - still counts against its URL
+    void abandonZap() {
+        if (zapStartNs.exchange(0) != 0) {
+            PlayerMetrics::get().zapFailures.inc();
+            ReliabilityStore::instance().recordZap(urlHash.load(), false, 0);
+        }
+    }
+
+    // Called with true once the input opened, false if it failed. Install
+    // before the first play(); runs on libvlc's event thread
+    void setOpenListener(std::function<void(bool)> listener) {
+        openListener = std::move(listener);
+    }
+
+    // Called with each reported failure once play() has stopped waiting.
+    // Install before the first play(); runs on a libvlc thread
+    void setFailureListener(std::function<void(const StreamFailure&)> listener) {
+        failureListener = std::move(listener);
+    }
+
+    // Request-to-first-frame time of the last zap, 0 until the first frame
+    int64_t getLastZapLatencyNs() const {
+        return lastZapLatencyNs.load();
+    }
+    
+    // Get stream statistics
+    StreamStats getStats() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        StreamStats stats;
+        
+        if (!initialized || !mediaPlayer) {
+            return stats;
+        }
+        
+        try {
+            CurrentMedia media(mediaPlayer);
+            if (!media.get()) {
+                return stats;
+            }
+            
+            // Get media statistics
+            libvlc_media_stats_t vlcStats;
+            if (libvlc_media_get_stats(media.get(), &vlcStats)) {
+                // Bytes per microsecond: x1000 for KB/s, x8000 for kbit/s
+                stats.inputBitrate = vlcStats.f_input_bitrate;
+                stats.demuxBitrate = vlcStats.f_demux_bitrate;
+                stats.lostBuffers = vlcStats.i_lost_abuffers;
+                stats.displayedPictures = vlcStats.i_displayed_pictures;
+                stats.lostPictures = vlcStats.i_lost_pictures;
+                
+                lastStats = stats;
+                publishStats(stats);
+            }
+            
+            sampleRecordingThroughput();
+        } catch (...) {
+            // Return last known stats on error
+            return lastStats;
+        }
+        
+        return stats;
+    }
+    
+    // Start recording the current input to file. With pids.enabled the
+    // stream goes through a pipe and only the selected programme's streams
+    // reach the file. The recording is a headless input of its own, like a
+    // scheduled capture: a sout added to the playing media is only read when
+    // the media is reopened, and this way a zap, reconnect or trick play on
+    // the player does not end the file.
+    bool startRecording(const std::string& filePath, const TsPidSelection& pids = TsPidSelection()) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        
+        if (!initialized || !mediaPlayer || currentUrl.empty()) {
+            return false;
+        }
+        
+        if (isRecording) {
+            // Already recording
+            return false;
+        }
+        RecordingStorage::instance().requestSpace();
+        
+        try {
+            std::unique_ptr<TsPipeRecorder> filter;
+            std::string destination = filePath;
+            if (pids.enabled) {
+                filter.reset(new TsPipeRecorder(filePath, pids));
+                if (!filter->start()) {
+                    return false;
+                }
+                destination = filter->getPipePath();
+            }
+
+            // The stream itself, not the relay: the relay follows the next zap
+            libvlc_media_t* media = libvlc_media_new_location(vlcInstance.get(), currentUrl.c_str());
+            if (!media) {
+                return false;
+            }
+            if (filter && rawTsInput(currentUrl)) {
+                // The input as received, before any demuxing
+                std::string dump = ":demuxdump-file=" + destination;
+                libvlc_media_add_option(media, ":demux=dump");
+                libvlc_media_add_option(media, dump.c_str());
+            } else {
+                std::string sout = ":sout=#std{access=file,mux=ts,dst=" + soutString(destination) + "}";
+                libvlc_media_add_option(media, sout.c_str());
+                libvlc_media_add_option(media, ":sout-all");
+                libvlc_media_add_option(media, ":no-sout-keep");
+            }
+
+            libvlc_media_player_t* capture = libvlc_media_player_new_from_media(media);
+            libvlc_media_release(media);
+            if (!capture) {
+                return false;
+            }
+            PlayerMetrics::get().libvlcMediaPlayers.add(1);
+            uint64_t watch = StreamFailureMonitor::instance().watch(
+                currentUrl, true, [](StreamFailureReason, const std::string&) {});
+            if (libvlc_media_player_play(capture) != 0) {
+                closeRecorder(capture, watch);
+                return false;
+            }
+            
+            isRecording = true;
+            recordingPath = filePath;
+            recordingFilter = std::move(filter);
+            recorder = capture;
+            recorderWatch = watch;
+            lastRecordingSize = 0;
+            lastRecordingSample = std::chrono::steady_clock::now();
+            PlayerMetrics::get().recordingActive.set(1);
+            
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+    
+    // Stop recording
+    bool stopRecording() {
+        std::unique_ptr<TsPipeRecorder> filter;
+        std::string path;
+        libvlc_media_player_t* capture = nullptr;
+        uint64_t watch = 0;
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            
+            if (!isRecording) {
+                return false;
+            }
+            
+            // Clear recording state
+            isRecording = false;
+            path.swap(recordingPath);
+            filter = std::move(recordingFilter);
+            capture = recorder;
+            watch = recorderWatch;
+            recorder = nullptr;
+            recorderWatch = 0;
+            PlayerMetrics::get().recordingActive.set(0);
+        }
+
+        // Closes the file (or the pipe); then the pipe thread is joined and
+        // flushes the filtered file
+        closeRecorder(capture, watch);
+        if (filter) {
+            filter->stop();
+        }
+        RemuxQueue::instance().recordingFinished(path);
+        return true;
+    }
+    
+    // Receive statistics when the current input is the native multicast one
+    bool getMulticastStats(MulticastStats& stats) {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        if (!mediaPlayer) return false;
+        CurrentMedia media(mediaPlayer);
+        return media.get() && MulticastInput::statsFor(media.get(), stats);
+    }
+
+    // Check if currently recording
+    bool getIsRecording() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        return isRecording;
+    }
+    
+    // Get current recording path
+    std::string getRecordingPath() {
+        std::lock_guard<std::mutex> lock(playerMutex);
+        return recordingPath;
+    }
+
+private:
+    static void closeRecorder(libvlc_media_player_t* capture, uint64_t watch) {
+        if (!capture) return;
+        libvlc_media_player_stop(capture);
+        libvlc_media_player_release(capture);
+        StreamFailureMonitor::instance().unwatch(watch);
+        PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+    }
+
+    void cleanup() {
+        stopSampler();
+        std::lock_guard<std::mutex> lock(playerMutex);
+
+        unwatchFailures();
+        releasePlayer(takeStandby());
+        if (mediaPlayer) {
+            detachEvents();
+            interruptInput(mediaPlayer);
+            libvlc_media_player_stop(mediaPlayer);
+            journal.end();
+            endWatch();
+            libvlc_media_player_release(mediaPlayer);
+            mediaPlayer = nullptr;
+            PlayerMetrics::get().libvlcMediaPlayers.add(-1);
+        }
+        if (isRecording) {
+            closeRecorder(recorder, recorderWatch);
+            recorder = nullptr;
+            recordingFilter.reset();
+            isRecording = false;
+            PlayerMetrics::get().recordingActive.set(0);
+        }
+
+        // Released with the last player holding it
+        vlcInstance.reset();
+
+        surfaces.destroy();
+        surfacesReady = false;
+        initialized = false;
+    }
+};
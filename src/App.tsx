@@ -539,6 +539,14 @@ function App({ profileSession }: AppProps) {
     }
   }, [channels]);
 
+  // The recording scheduler captures by channel id (tvg-id) and needs the URLs
+  useEffect(() => {
+    if (channels.length === 0 || !window.electron?.schedule) return;
+    window.electron.schedule
+      .setChannels(channels.map(c => ({ id: c.id, name: c.name, urls: c.urls.length > 0 ? c.urls : [c.url] })))
+      .catch(() => {});
+  }, [channels]);
+
   // Cleanup audio normalization monitoring on unmount
   useEffect(() => {
     return () => {
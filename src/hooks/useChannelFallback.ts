@@ -12,6 +12,7 @@ export interface PlaybackResult {
   success: boolean;
   error?: string;
   url?: string;
+  superseded?: boolean;
 }
 
 export interface UseChannelFallbackReturn {
@@ -48,7 +49,7 @@ export function useChannelFallback(): UseChannelFallbackReturn {
           lastSuccessfulUrl
         );
 
-        if (!result.success) {
+        if (!result.success && !result.superseded) {
           console.error('[Fallback] All URLs failed for channel:', channel.name);
         }
 
@@ -0,0 +1,487 @@
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import * as inspector from 'inspector';
+import { fork } from 'child_process';
+import { parseM3U } from './m3u-parser';
+import { parseXmltvFile } from '../../electron/xmltv-parser';
+
+/**
+ * Parser microbenchmarks at production scale.
+ *
+ * Generates deterministic M3U playlists (1k-500k entries) and XMLTV files
+ * (10-190 MB) with Japanese text and attribute-heavy lines, then runs every
+ * registered engine on every input in its own child process so peak RSS is
+ * per case. Reports throughput (MB/s), peak RSS and heap bytes allocated
+ * per entry as JSON.
+ *
+ * Usage: npm run bench:parser -- [--quick] [--filter m3u|xmltv] [--engine name]
+ *                                [--iterations n] [--out results.json]
+ */
+
+// Engines: add alternative parsers here to compare them head to head
+interface M3uEngine {
+  name: string;
+  parse(content: string): { entries: number; error?: string };
+}
+
+interface XmltvEngine {
+  name: string;
+  parseFile(filePath: string): Promise<{ entries: number; error?: string }>;
+}
+
+const M3U_ENGINES: M3uEngine[] = [
+  {
+    name: 'parseM3U',
+    parse: (content) => {
+      const result = parseM3U(content, false);
+      return { entries: result.data?.channels.length ?? 0, error: result.error };
+    },
+  },
+];
+
+const XMLTV_ENGINES: XmltvEngine[] = [
+  {
+    name: 'parseXmltvFile',
+    parseFile: async (filePath) => {
+      const result = await parseXmltvFile(filePath);
+      return { entries: result.programCount, error: result.error };
+    },
+  },
+];
+
+interface BenchCase {
+  kind: 'm3u' | 'xmltv';
+  engine: string;
+  label: string;
+  size: number;          // Entries for M3U, bytes for XMLTV
+}
+
+interface BenchResult {
+  kind: string;
+  engine: string;
+  label: string;
+  inputBytes: number;
+  entries: number;
+  iterations: number;
+  medianMs: number;
+  bestMs: number;
+  throughputMBps: number;
+  baselineRssBytes: number;
+  peakRssBytes: number;
+  allocatedBytesPerEntry: number;
+  error?: string;
+}
+
+const M3U_SIZES = [1_000, 10_000, 100_000, 500_000];
+// parseXmltvFile rejects files over 200 MB, and the generator overshoots its
+// target by a programme, so the largest case stays just under the limit
+const XMLTV_SIZES = [10, 100, 190].map(mb => mb * 1024 * 1024);
+const QUICK_M3U_SIZES = [1_000, 10_000];
+const QUICK_XMLTV_SIZES = [10 * 1024 * 1024];
+
+const FIXTURE_DIR = path.join(os.tmpdir(), 'jptv-parser-bench');
+const SAMPLING_INTERVAL = 1024;   // Heap profiler sampling interval, bytes
+
+// ---------------------------------------------------------------------------
+// Input generation (deterministic, cached in the temp directory)
+// ---------------------------------------------------------------------------
+
+function mulberry32(seed: number): () => number {
+  let a = seed >>> 0;
+  return () => {
+    a = (a + 0x6d2b79f5) >>> 0;
+    let t = a;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+const JAPANESE_WORDS = ['ニュース', '天気予報', 'ドラマ', 'アニメ', '映画', '音楽', 'スポーツ', '地上波',
+  '東京', '大阪', '特集', '生中継', '日本', '情報番組', 'バラエティ', '時代劇', '報道', '料理'];
+const CATEGORIES = ['地上波', 'BS放送', 'CS放送', 'スポーツ', '映画', 'ニュース', 'アニメ', '音楽'];
+
+function pick<T>(rand: () => number, items: T[]): T {
+  return items[Math.floor(rand() * items.length)];
+}
+
+function japaneseText(rand: () => number, words: number): string {
+  let text = '';
+  for (let i = 0; i < words; i++) {
+    text += pick(rand, JAPANESE_WORDS);
+  }
+  return text;
+}
+
+// Writes in large chunks so GB-scale fixtures never sit in one string
+class ChunkWriter {
+  private fd: number;
+  private parts: string[] = [];
+  private pending = 0;
+  bytes = 0;             // Includes buffered text not yet flushed
+
+  constructor(filePath: string) {
+    this.fd = fs.openSync(filePath, 'w');
+  }
+
+  write(text: string): void {
+    this.parts.push(text);
+    this.pending += text.length;
+    this.bytes += Buffer.byteLength(text, 'utf-8');
+    if (this.pending > 4 * 1024 * 1024) {
+      this.flush();
+    }
+  }
+
+  flush(): void {
+    if (this.parts.length === 0) return;
+    fs.writeSync(this.fd, Buffer.from(this.parts.join(''), 'utf-8'));
+    this.parts = [];
+    this.pending = 0;
+  }
+
+  close(): void {
+    this.flush();
+    fs.closeSync(this.fd);
+  }
+}
+
+function m3uEntry(rand: () => number, i: number): string {
+  const name = `${japaneseText(rand, 2)}${i}`;
+  const group = pick(rand, CATEGORIES);
+  const url = `https://stream.example.com/live/${i}/index.m3u8`;
+
+  switch (i % 8) {
+    case 0: {
+      // Pathological: many attributes, long quoted values, commas inside quotes
+      let attrs = `tvg-id="ch${i}.jp" tvg-name="${name}" tvg-logo="https://cdn.example.com/logos/${'x'.repeat(120)}/${i}.png"`;
+      for (let a = 0; a < 24; a++) {
+        attrs += ` x-attr-${a}="value, with, commas ${japaneseText(rand, 1)} ${a}"`;
+      }
+      return `#EXTINF:-1 ${attrs} group-title="${group}",${name}, extra, commas\n${url}`;
+    }
+    case 1:
+      return `#EXTINF:-1,${name}\n${url}`;
+    case 2:
+      // CRLF line endings and blank lines
+      return `#EXTINF:-1 tvg-id="${i}" group-title="${group}",${name}\r\n\r\n${url}\r`;
+    case 3:
+      // Missing URL (skipped entry)
+      return `#EXTINF:-1 tvg-name="${name}",${name}`;
+    case 4:
+      return `#EXTINF:-1 tvg-id="${i}" tvg-name="${name}" tvg-logo="https://example.com/${i}.png" group-title="${group}" catchup="default" catchup-days="7",${name}\n#EXTVLCOPT:http-user-agent=Mozilla/5.0\n${url}`;
+    default:
+      return `#EXTINF:-1 tvg-id="${i}" tvg-name="${name}" tvg-logo="https://example.com/logo${i}.png" group-title="${group}",${name}\n${url}`;
+  }
+}
+
+function generateM3u(entries: number): string {
+  const filePath = path.join(FIXTURE_DIR, `playlist-${entries}.m3u`);
+  if (fs.existsSync(filePath)) return filePath;
+
+  const rand = mulberry32(entries);
+  const temp = `${filePath}.tmp`;
+  const writer = new ChunkWriter(temp);
+  writer.write('#EXTM3U x-tvg-url="https://epg.example.com/guide.xml"\n');
+  for (let i = 1; i <= entries; i++) {
+    writer.write(m3uEntry(rand, i) + '\n');
+  }
+  writer.close();
+  fs.renameSync(temp, filePath);
+  return filePath;
+}
+
+function xmlEscape(text: string): string {
+  return text.replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/>/g, '&gt;').replace(/"/g, '&quot;');
+}
+
+function xmltvTime(ms: number): string {
+  const d = new Date(ms + 9 * 3600 * 1000);
+  const pad = (n: number) => String(n).padStart(2, '0');
+  return `${d.getUTCFullYear()}${pad(d.getUTCMonth() + 1)}${pad(d.getUTCDate())}` +
+    `${pad(d.getUTCHours())}${pad(d.getUTCMinutes())}00 +0900`;
+}
+
+function generateXmltv(targetBytes: number): string {
+  const filePath = path.join(FIXTURE_DIR, `guide-${Math.round(targetBytes / 1024 / 1024)}mb.xml`);
+  if (fs.existsSync(filePath)) return filePath;
+
+  const rand = mulberry32(targetBytes);
+  const temp = `${filePath}.tmp`;
+  const writer = new ChunkWriter(temp);
+  const channelCount = 300;
+
+  writer.write('<?xml version="1.0" encoding="UTF-8"?>\n<!DOCTYPE tv SYSTEM "xmltv.dtd">\n');
+  writer.write('<tv source-info-name="jptv-bench" generator-info-name="parser-bench">\n');
+  for (let c = 0; c < channelCount; c++) {
+    writer.write(`  <channel id="ch${c}.jp">\n    <display-name lang="ja">${japaneseText(rand, 2)}${c}</display-name>\n` +
+      `    <display-name lang="en">Channel ${c}</display-name>\n    <icon src="https://example.com/logo${c}.png"/>\n  </channel>\n`);
+  }
+
+  const epoch = Date.UTC(2026, 0, 1);
+  const slot = new Array<number>(channelCount).fill(epoch);
+  let n = 0;
+  while (writer.bytes < targetBytes) {
+    const c = n % channelCount;
+    const start = slot[c];
+    const stop = start + (15 + Math.floor(rand() * 8) * 15) * 60 * 1000;
+    slot[c] = stop;
+
+    writer.write(`  <programme start="${xmltvTime(start)}" stop="${xmltvTime(stop)}" channel="ch${c}.jp">\n` +
+      `    <title lang="ja">${xmlEscape(japaneseText(rand, 3))} #${n}</title>\n` +
+      `    <sub-title lang="ja">${japaneseText(rand, 2)}</sub-title>\n` +
+      `    <desc lang="ja">${xmlEscape(japaneseText(rand, 20 + Math.floor(rand() * 30)))} &amp; more &lt;info&gt;</desc>\n` +
+      `    <credits><director>${japaneseText(rand, 1)}</director><actor>${japaneseText(rand, 1)}</actor><actor>${japaneseText(rand, 1)}</actor></credits>\n` +
+      `    <category lang="ja">${pick(rand, CATEGORIES)}</category>\n    <category lang="en">Drama</category>\n` +
+      `    <episode-num system="onscreen">S${1 + (n % 5)}E${1 + (n % 24)}</episode-num>\n` +
+      `    <rating system="JP"><value>G</value></rating>\n  </programme>\n`);
+    n++;
+  }
+  writer.write('</tv>\n');
+  writer.close();
+  fs.renameSync(temp, filePath);
+  return filePath;
+}
+
+// ---------------------------------------------------------------------------
+// Measurement (runs in a child process per case)
+// ---------------------------------------------------------------------------
+
+function post<T>(session: inspector.Session, method: string, params?: object): Promise<T> {
+  return new Promise((resolve, reject) => {
+    session.post(method, params ?? {}, (err: Error | null, result?: object) => {
+      if (err) reject(err);
+      else resolve(result as T);
+    });
+  });
+}
+
+interface SamplingNode {
+  selfSize: number;
+  children: SamplingNode[];
+}
+
+function sumSelfSize(node: SamplingNode): number {
+  let total = node.selfSize;
+  for (const child of node.children) {
+    total += sumSelfSize(child);
+  }
+  return total;
+}
+
+/**
+ * Estimate bytes allocated by `run` with the V8 sampling heap profiler,
+ * counting objects that were already collected by the time it stopped.
+ */
+async function measureAllocations(run: () => Promise<void>): Promise<number> {
+  const session = new inspector.Session();
+  session.connect();
+  try {
+    await post(session, 'HeapProfiler.enable');
+    await post(session, 'HeapProfiler.startSampling', {
+      samplingInterval: SAMPLING_INTERVAL,
+      includeObjectsCollectedByMajorGC: true,
+      includeObjectsCollectedByMinorGC: true,
+    });
+    await run();
+    const { profile } = await post<{ profile: { head: SamplingNode } }>(session, 'HeapProfiler.stopSampling');
+    return sumSelfSize(profile.head);
+  } catch {
+    return -1;
+  } finally {
+    session.disconnect();
+  }
+}
+
+function collectGarbage(): void {
+  const gc = (global as unknown as { gc?: () => void }).gc;
+  if (gc) gc();
+}
+
+async function runCase(benchCase: BenchCase, iterations: number): Promise<BenchResult> {
+  const filePath = benchCase.kind === 'm3u' ? generateM3u(benchCase.size) : generateXmltv(benchCase.size);
+  const inputBytes = fs.statSync(filePath).size;
+
+  let once: () => Promise<{ entries: number; error?: string }>;
+  if (benchCase.kind === 'm3u') {
+    const engine = M3U_ENGINES.find(e => e.name === benchCase.engine)!;
+    // Reading the file is not part of the measurement for string parsers
+    const content = fs.readFileSync(filePath, 'utf-8');
+    once = async () => engine.parse(content);
+  } else {
+    const engine = XMLTV_ENGINES.find(e => e.name === benchCase.engine)!;
+    once = () => engine.parseFile(filePath);
+  }
+
+  collectGarbage();
+  const baselineRssBytes = process.memoryUsage().rss;
+
+  const times: number[] = [];
+  let entries = 0;
+  let error: string | undefined;
+  for (let i = 0; i < iterations; i++) {
+    const start = process.hrtime.bigint();
+    const result = await once();
+    times.push(Number(process.hrtime.bigint() - start) / 1e6);
+    entries = result.entries;
+    error = result.error;
+    collectGarbage();
+    if (error) break;
+  }
+
+  // Separate pass so profiler overhead does not skew the timings
+  let allocatedBytes = -1;
+  if (!error) {
+    allocatedBytes = await measureAllocations(async () => { await once(); });
+  }
+
+  times.sort((a, b) => a - b);
+  const medianMs = times[Math.floor(times.length / 2)];
+  return {
+    kind: benchCase.kind,
+    engine: benchCase.engine,
+    label: benchCase.label,
+    inputBytes,
+    entries,
+    iterations: times.length,
+    medianMs,
+    bestMs: times[0],
+    throughputMBps: error ? 0 : inputBytes / 1024 / 1024 / (medianMs / 1000),
+    baselineRssBytes,
+    peakRssBytes: process.resourceUsage().maxRSS * 1024,
+    allocatedBytesPerEntry: allocatedBytes >= 0 && entries > 0 ? allocatedBytes / entries : -1,
+    error,
+  };
+}
+
+// ---------------------------------------------------------------------------
+// Runner
+// ---------------------------------------------------------------------------
+
+function runChild(benchCase: BenchCase, iterations: number): Promise<BenchResult> {
+  return new Promise((resolve) => {
+    const child = fork(__filename, ['--child', JSON.stringify(benchCase), String(iterations)], {
+      execArgv: ['--expose-gc', '--max-old-space-size=8192'],
+    });
+
+    let result: BenchResult | null = null;
+    child.on('message', (message) => {
+      result = message as BenchResult;
+    });
+    child.on('exit', (code) => {
+      resolve(result ?? {
+        kind: benchCase.kind,
+        engine: benchCase.engine,
+        label: benchCase.label,
+        inputBytes: 0,
+        entries: 0,
+        iterations: 0,
+        medianMs: 0,
+        bestMs: 0,
+        throughputMBps: 0,
+        baselineRssBytes: 0,
+        peakRssBytes: 0,
+        allocatedBytesPerEntry: -1,
+        error: `Child exited with code ${code} (out of memory?)`,
+      });
+    });
+  });
+}
+
+function parseArgs(argv: string[]): { quick: boolean; filter?: string; engine?: string; iterations: number; out?: string } {
+  const options: { quick: boolean; filter?: string; engine?: string; iterations: number; out?: string } = {
+    quick: false,
+    iterations: 3,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    switch (argv[i]) {
+      case '--quick': options.quick = true; break;
+      case '--filter': options.filter = argv[++i]; break;
+      case '--engine': options.engine = argv[++i]; break;
+      case '--iterations': options.iterations = Math.max(1, parseInt(argv[++i], 10) || 1); break;
+      case '--out': options.out = argv[++i]; break;
+    }
+  }
+  return options;
+}
+
+function buildCases(quick: boolean, filter?: string, engine?: string): BenchCase[] {
+  const cases: BenchCase[] = [];
+  if (!filter || filter === 'm3u') {
+    for (const size of quick ? QUICK_M3U_SIZES : M3U_SIZES) {
+      for (const e of M3U_ENGINES) {
+        cases.push({ kind: 'm3u', engine: e.name, label: `${size / 1000}k entries`, size });
+      }
+    }
+  }
+  if (!filter || filter === 'xmltv') {
+    for (const size of quick ? QUICK_XMLTV_SIZES : XMLTV_SIZES) {
+      for (const e of XMLTV_ENGINES) {
+        cases.push({ kind: 'xmltv', engine: e.name, label: `${size / 1024 / 1024} MB`, size });
+      }
+    }
+  }
+  return engine ? cases.filter(c => c.engine === engine) : cases;
+}
+
+/**
+ * Run parser benchmarks
+ */
+export async function runParserBench(argv: string[]): Promise<void> {
+  const options = parseArgs(argv);
+  fs.mkdirSync(FIXTURE_DIR, { recursive: true });
+
+  console.log('=== Parser Benchmarks ===\n');
+  console.log(`Fixtures: ${FIXTURE_DIR}\n`);
+
+  const results: BenchResult[] = [];
+  for (const benchCase of buildCases(options.quick, options.filter, options.engine)) {
+    const result = await runChild(benchCase, options.iterations);
+    results.push(result);
+
+    const mb = (n: number) => (n / 1024 / 1024).toFixed(1);
+    if (result.error) {
+      console.log(`  ${result.kind} ${result.engine} ${result.label}: ERROR ${result.error}`);
+    } else {
+      console.log(`  ${result.kind} ${result.engine} ${result.label}: ` +
+        `${result.throughputMBps.toFixed(1)} MB/s, ${result.medianMs.toFixed(1)} ms, ` +
+        `${result.entries} entries, peak RSS ${mb(result.peakRssBytes)} MB, ` +
+        `${result.allocatedBytesPerEntry.toFixed(0)} B allocated/entry`);
+    }
+  }
+
+  const report = JSON.stringify({
+    version: 1,
+    timestamp: new Date().toISOString(),
+    node: process.version,
+    platform: `${process.platform}-${process.arch}`,
+    results,
+  }, null, 2);
+
+  if (options.out) {
+    fs.writeFileSync(options.out, report);
+    console.log(`\nResults written to ${options.out}`);
+  } else {
+    console.log(`\n${report}`);
+  }
+  console.log('\n=== Benchmarks Complete ===');
+}
+
+// Run benchmarks if executed directly
+if (require.main === module) {
+  const args = process.argv.slice(2);
+  if (args[0] === '--child') {
+    runCase(JSON.parse(args[1]) as BenchCase, parseInt(args[2], 10))
+      .then(result => process.send!(result, () => process.exit(0)))
+      .catch(error => {
+        console.error(error);
+        process.exit(1);
+      });
+  } else {
+    runParserBench(args).catch(error => {
+      console.error(error);
+      process.exit(1);
+    });
+  }
+}
@@ -42,7 +42,10 @@ export class VlcPlayerAdapter implements PlayerAdapter {
 
           const result = await window.electronAPI.player.play(url);
           
-          if (result.success) {
+          if (result.superseded) {
+            // A newer zap owns the player state now
+            resolve();
+          } else if (result.success) {
             this.updateState('playing');
             resolve();
           } else {
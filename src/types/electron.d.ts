@@ -9,6 +9,28 @@ export interface AppSettings {
   channelHistory: string[]; // Stack of channel IDs (max 50)
   favorites: string[];
   volume: number;
+  recordingPids?: Record<string, RecordingPidSelection>; // By channel id
+  remuxRecordings?: boolean; // Remux finished recordings to fragmented MP4
+  remuxDeleteSource?: boolean; // Delete the .ts once its MP4 is complete
+  recordingQuotaGB?: number; // Evict the oldest recordings above this; 0 or unset = no quota
+  recordingMinFreeGB?: number; // ...or when the disk has less free; 0 or unset = off
+  protectedRecordings?: string[]; // Recording paths never evicted
+  archiveAfterDays?: number; // Re-encode recordings older than this to a smaller size; 0 or unset = off
+  archiveVideoKbps?: number; // Video bitrate of archived recordings; default 2000
+  nativeMulticast?: boolean; // Receive udp:// and rtp:// channels natively instead of through libvlc
+  relayEnabled?: boolean; // Re-stream the current channel over HTTP from a single upstream
+  relayLan?: boolean; // ...to other devices too, not just this machine
+  relayPort?: number; // Default 8090; 0 picks a free one
+  recordingServerEnabled?: boolean; // Serve recordings (and the one being recorded) over HTTP with byte ranges
+  recordingServerLan?: boolean; // ...to other devices too, not just this machine
+  recordingServerPort?: number; // Default 8091; 0 picks a free one
+}
+
+// Streams a recording keeps; channels without one record the whole multiplex
+export interface RecordingPidSelection {
+  program?: number; // MPEG programme number; default the first in the PAT
+  audioTrack?: number; // Index among audio streams, -1 for all; default 0
+  captions?: boolean; // Default true
 }
 
 export interface PlaylistFile {
@@ -28,6 +50,7 @@ export interface PlaylistFile {
 export interface PlayerResult {
   success: boolean;
   error?: string;
+  superseded?: boolean;   // A newer play/stop replaced this one before it ran
 }
 
 export interface PlayerVolumeResult {
@@ -42,6 +65,31 @@ export interface PlayerPlayingResult {
   playing: boolean;
 }
 
+export interface PlayerPosition {
+  timeMs: number;
+  lengthMs: number;
+  rate: number;
+  seekable: boolean; // Recordings; live streams are not
+}
+
+// Native UDP/RTP input counters since the channel was opened
+export interface MulticastStats {
+  rtp: boolean; // false: plain UDP, no sequence numbers to check
+  datagrams: number;
+  bytes: number; // TS passed to the player
+  batches: number; // datagrams / batches = receives collected per wakeup
+  lost: number;
+  reordered: number;
+  duplicates: number;
+  late: number; // Arrived after being delivered or given up on
+  resyncs: number; // Sequence jumps taken as a sender restart
+  malformed: number;
+  continuityErrors: number; // TS continuity counter jumps
+  overflows: number; // TS dropped because the player fell behind
+  jitterMs: number; // RFC 3550 interarrival jitter
+  socketBuffer: number; // Receive buffer granted, bytes
+}
+
 export interface ChannelHealth {
   channelId: string;
   score: number;
@@ -54,6 +102,24 @@ export interface ChannelHealth {
   };
 }
 
+export interface TelemetryMirrorStats {
+  url: string;
+  zaps: number;
+  zapFailures: number;
+  availability: number; // Fraction of zaps that reached a first frame
+  meanZapMs: number;
+  stalls: number;
+  stallMinutes: number;
+  watchSeconds: number;
+  meanBitrateKbps: number;
+}
+
+export interface TelemetryChannelStats extends Omit<TelemetryMirrorStats, 'url'> {
+  channel: string; // Channel id, or the URL for direct playback
+  sessions: number;
+  mirrors: TelemetryMirrorStats[];
+}
+
 export interface RecordingInfo {
   channelId: string;
   channelName: string;
@@ -61,6 +127,110 @@ export interface RecordingInfo {
   startTime: number;
 }
 
+// Found by the chapter analyser; a break is black and silence together
+export interface RecordingMarker {
+  startMs: number;
+  endMs: number;
+  kind: 'black' | 'silence' | 'break';
+}
+
+export type ScheduleRuleKind = 'series' | 'slot' | 'once';
+
+export interface ScheduleRule {
+  id?: number; // Omit to add; an existing id replaces that rule
+  kind: ScheduleRuleKind;
+  enabled?: boolean;
+  channelId?: string; // Series: omit to match any channel
+  title?: string; // Series: programme title (case-insensitive)
+  start?: number; // Once: Unix timestamp (ms)
+  stop?: number;
+  weekdays?: number; // Slot: bit 0 = Sunday, local time
+  slotMinute?: number; // Slot: minutes after midnight
+  durationMin?: number; // Slot
+  prePadSec?: number; // Default 60
+  postPadSec?: number; // Default 300
+}
+
+export interface ScheduledRecording {
+  id: number;
+  ruleId: number;
+  channelId: string;
+  title: string;
+  start: number; // Padded
+  stop: number;
+  state: 'armed' | 'recording' | 'done' | 'failed' | 'cancelled';
+  filePath: string; // Latest part
+  parts: number;
+}
+
+// Also the payload of 'remux:progress' events
+export interface RemuxJob {
+  id: number;
+  inputPath: string;
+  outputPath: string;
+  state: 'queued' | 'running' | 'waiting' | 'done' | 'failed' | 'cancelled'; // waiting: input still being written
+  progress: number; // 0..1
+  deleteSource: boolean;
+  error?: string;
+}
+
+export interface RelayClient {
+  address: string;
+  bytes: number;
+  skippedBytes: number; // Dropped because the client fell a whole buffer behind
+  connectedAt: number; // Unix ms
+}
+
+export interface RelayInfo {
+  running: boolean;
+  port: number;
+  url: string; // Channel being relayed
+  upstreamActive: boolean; // Pulled only while a client is connected
+  upstreamBytes: number;
+  upstreamRestarts: number;
+  clients: RelayClient[];
+  localUrl: string; // Playable here to watch through the relay
+  lanUrls: string[]; // For other devices, when relayLan is on
+}
+
+export interface RecordingServerInfo {
+  running: boolean;
+  port: number;
+  connections: number;
+  requests: number;
+  bytesSent: number;
+  playlistUrl: string; // M3U of every recording, newest first
+  lanPlaylistUrls: string[]; // For other devices, when recordingServerLan is on
+}
+
+// Also the payload of 'archive:progress' events
+export interface ArchiveJob {
+  path: string; // The recording; replaced by its archive when done
+  state: 'queued' | 'running' | 'paused' | 'done' | 'failed'; // paused: playback or a recording is running
+  progress: number; // 0..1
+  sourceBytes: number;
+  outputBytes: number;
+  error?: string;
+}
+
+export interface StorageStats {
+  usedBytes: number;
+  files: number;
+  freeBytes: number; // On the recordings volume
+  totalBytes: number;
+  evictedFiles: number; // Since startup
+  evictedBytes: number;
+  watching: boolean; // False: the index is only refreshed by rescans
+}
+
+// Oldest first, the order eviction takes them in
+export interface StoredRecording {
+  path: string;
+  bytes: number; // With its index and MP4
+  modified: number; // Unix timestamp (ms)
+  protected: boolean;
+}
+
 export interface ElectronAPI {
   openPlaylist: () => Promise<PlaylistFile | null>;
   loadPlaylistFromPath: (filePath: string) => Promise<PlaylistFile>;
@@ -97,6 +267,10 @@ export interface ElectronAPI {
     getVolume: () => Promise<PlayerVolumeResult>;
     getState: () => Promise<PlayerStateResult>;
     isPlaying: () => Promise<PlayerPlayingResult>;
+    seek: (timeMs: number) => Promise<PlayerResult>;
+    setTrickPlay: (speed: number) => Promise<PlayerResult>; // 1 = normal; 8 and up decode keyframes only
+    getPosition: () => Promise<PlayerPosition | null>;
+    getMulticastStats: () => Promise<MulticastStats | null>; // null unless on the native multicast input
     playWithFallback: (channelId: string, urls: string[], lastSuccessfulUrl?: string) => Promise<PlayerResult & { url?: string }>;
     retryFallback: (channelId: string) => Promise<PlayerResult & { url?: string }>;
     getLastSuccessfulUrl: (channelId: string) => Promise<string | null>;
@@ -114,6 +288,10 @@ export interface ElectronAPI {
     getAllScores: () => Promise<ChannelHealth[]>;
     clear: (channelId?: string) => Promise<void>;
   };
+
+  telemetry: {
+    query: (fromMs: number, toMs: number) => Promise<TelemetryChannelStats[]>;
+  };
   
   recording: {
     start: (channelId: string, channelName: string) => Promise<{ success: boolean; filePath?: string; error?: string }>;
@@ -122,6 +300,40 @@ export interface ElectronAPI {
     getInfo: (channelId: string) => Promise<RecordingInfo | null>;
     getActive: () => Promise<RecordingInfo[]>;
     getPath: () => Promise<string>;
+    play: (filePath: string) => Promise<PlayerResult>;
+    getPreview: (filePath: string, timeMs: number) => Promise<string | null>; // Data URL from the recording's strip
+    getChapters: (filePath: string) => Promise<RecordingMarker[] | null>; // Null until analysed
+  };
+
+  schedule: {
+    addRule: (rule: ScheduleRule) => Promise<number>;
+    removeRule: (id: number) => Promise<boolean>;
+    list: () => Promise<{ rules: Required<ScheduleRule>[]; jobs: ScheduledRecording[] }>;
+    setChannels: (channels: { id: string; name: string; urls: string[] }[]) => Promise<void>;
+  };
+
+  remux: {
+    enqueue: (filePath: string) => Promise<number>;
+    cancel: (id: number) => Promise<boolean>;
+    list: () => Promise<RemuxJob[]>;
+  };
+
+  relay: {
+    getInfo: () => Promise<RelayInfo | null>; // null while the relay is off
+  };
+
+  recordingServer: {
+    getInfo: () => Promise<RecordingServerInfo | null>; // null while the server is off
+  };
+
+  archive: {
+    list: () => Promise<ArchiveJob[]>;
+  };
+
+  storage: {
+    stats: () => Promise<StorageStats | null>;
+    list: () => Promise<StoredRecording[]>;
+    protect: (filePath: string, keep: boolean) => Promise<boolean>;
   };
 
   epg: {